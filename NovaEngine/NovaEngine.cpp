@@ -1,12 +1,35 @@
 #include "Prerequisites.h"
 #include "BaseApp.h"
+#include "MeshBenchmark.h"
 
 //--------------------------------------------------------------------------------------
 // Entry point to the program. Initializes everything and goes into a message processing 
 // loop. Idle time is used to render the scene.
+// "-meshbench [model]" runs the mesh loading benchmarks instead and exits.
 //--------------------------------------------------------------------------------------
 int WINAPI
 wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine, int nCmdShow) {
+	std::wstring commandLine = lpCmdLine ? lpCmdLine : L"";
+	size_t benchFlag = commandLine.find(L"-meshbench");
+	if (benchFlag != std::wstring::npos) {
+		std::wstring model = commandLine.substr(benchFlag + wcslen(L"-meshbench"));
+		model.erase(0, model.find_first_not_of(L" \t\""));
+		model.erase(model.find_last_not_of(L" \t\"") + 1);
+		if (model.empty()) {
+			model = L"models/Peashooter";
+		}
+
+		std::string modelName;
+		for (wchar_t c : model) {
+			modelName.push_back(static_cast<char>(c));
+		}
+
+		MeshBenchmark benchmark;
+		benchmark.run(modelName);
+		benchmark.writeReport("mesh_benchmark.txt");
+		return 0;
+	}
+
 	BaseApp app;
 	return app.run(hInstance, nCmdShow);
 }
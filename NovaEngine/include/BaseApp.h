@@ -13,6 +13,8 @@
 #include "Buffer.h"
 #include "SamplerState.h"
 #include "ModelLoader.h"
+#include "ModelLoadTask.h"
+#include "MeshQuantization.h"
 
 /*
 	@class BaseApp
@@ -81,6 +83,45 @@ private:
 	static LRESULT CALLBACK
 		WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
 
+	/*
+		@brief Checks the background model load; on completion uploads the mesh, on failure quits.
+		@details Called from update() on the thread that owns the device, so buffer creation never races the loader.
+	*/
+	void
+		pollModelLoad();
+
+	/*
+		@brief Creates the vertex and index buffers and material textures of the freshly loaded m_mesh.
+		@return HRESULT indicating success or failure of the operation.
+	*/
+	HRESULT
+		finishModelLoad();
+
+	/*
+		@brief Loads the diffuse texture of every material of m_mesh into m_materialTextures.
+		@details Materials without a diffuse texture, or whose texture fails to load, keep an empty entry and are drawn with m_textureCube.
+	*/
+	void
+		loadMaterialTextures();
+
+	/*
+		@brief Uploads the ranges of m_mesh marked dirty since the last frame (MeshComponent::markVerticesDirty,
+		       markIndicesDirty) and clears them. The bytes sent are added to m_frameUploads.
+		@details If a changed index no longer fits the 16-bit index buffer, the index buffers are created again.
+		@return HRESULT indicating success or failure of the operation.
+	*/
+	HRESULT
+		uploadMeshEdits();
+
+	/*
+		@brief Adds m_frameUploads to the running totals and, once a second, shows the average bytes and
+		       UpdateSubresource calls per frame in the window title.
+		@details Mesh edits and the culled cluster indices are both counted, so the title shows everything the
+		         mesh sends to the GPU each frame.
+	*/
+	void
+		reportFrameUploads();
+
 private:
 	Window                              m_window;
 	Device															m_device;
@@ -95,11 +136,24 @@ private:
 	MeshComponent												m_mesh;
 	Buffer															m_vertexBuffer;
 	Buffer															m_indexBuffer;
+	Buffer															m_visibleIndexBuffer;
+	std::vector<unsigned int>						m_visibleIndices;
+	std::vector<unsigned short>					m_visibleIndices16;
+	std::vector<MeshSubmesh>						m_visibleSubmeshes;
+	BufferUploadStats										m_frameUploads;
+	BufferUploadStats										m_uploadTotals;
+	unsigned int												m_uploadFrames = 0;
+	DWORD																m_uploadReportTime = 0;
 	ModelLoader													m_modelLoader;
+	std::shared_ptr<ModelLoadTask>			m_modelLoad;
+	bool																m_modelReady = false;
+	int																	m_loadPercent = -1;
+	std::string													m_windowTitle;
 	Buffer															m_cbNeverChanges;
 	Buffer															m_cbChangeOnResize;
 	Buffer															m_cbChangesEveryFrame;
 	Texture 														m_textureCube;
+	std::vector<Texture>								m_materialTextures;
 	SamplerState												m_samplerState;
 
 	XMMATRIX                            m_World;
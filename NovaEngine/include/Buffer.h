@@ -5,6 +5,22 @@
 class Device;
 class DeviceContext;
 
+/*
+  @struct BufferUploadStats
+  @brief Bytes sent to the GPU by Buffer::updateDirtyRanges, summed over the buffers of a frame.
+*/
+struct BufferUploadStats {
+  /*
+    @brief Bytes copied into the buffers.
+  */
+  size_t bytes = 0;
+
+  /*
+    @brief Number of UpdateSubresource calls (one per merged range and vertex stream).
+  */
+  size_t updates = 0;
+};
+
 /*
   @class Buffer
   @brief A wrapper class for the ID3D11Buffer interface.
@@ -30,10 +46,39 @@ public:
     @param mesh The mesh component containing the vertex data.
     @param bindFlag The bind flags for the buffer (e.g., D3D11_BIND_VERTEX_BUFFER).
 		@return HRESULT indicating success or failure of the operation.
+    @note An index buffer takes mesh.m_index16 (DXGI_FORMAT_R16_UINT) when MeshComponent::buildIndex16 filled it
+          and mesh.m_index (DXGI_FORMAT_R32_UINT) otherwise; render binds it with that format.
   */
   HRESULT
     init(Device& device, const MeshComponent& mesh, unsigned int bindFlag);
 
+  /*
+    @brief Initializes the buffer with an array of elements.
+    @details Used for vertex formats other than SimpleVertex, such as PackedVertex (see MeshQuantization.h).
+    @param device The device to create the buffer on.
+    @param data The elements to copy into the buffer.
+    @param stride The size of one element in bytes.
+    @param count The number of elements.
+    @param bindFlag The bind flags for the buffer (e.g., D3D11_BIND_VERTEX_BUFFER).
+    @return HRESULT indicating success or failure of the operation.
+    @note An index buffer with a stride of 2 is bound as DXGI_FORMAT_R16_UINT, any other as DXGI_FORMAT_R32_UINT.
+  */
+  HRESULT
+    init(Device& device, const void* data, unsigned int stride, unsigned int count, unsigned int bindFlag);
+
+  /*
+    @brief Initializes a vertex buffer with the vertices of a mesh split into two streams.
+    @details Stream 0 holds the positions (12 bytes per vertex) and stream 1 the texture coordinates and normals
+             (VertexAttributes). render(deviceContext, slot, 2) binds both to consecutive slots, and
+             render(deviceContext, slot, 1) only the positions, so a depth-only pass reads no attribute data. The
+             matching input layouts come from vertexInputLayout (VERTEX_STREAMS_SPLIT, VERTEX_STREAMS_POSITION).
+    @param device The device to create the buffers on.
+    @param mesh The mesh component containing the vertex data.
+    @return HRESULT indicating success or failure of the operation.
+  */
+  HRESULT
+    initVertexStreams(Device& device, const MeshComponent& mesh);
+
   /*
     @brief Initializes the buffer with a specified byte width.
     @details This method creates a buffer with the given byte width and bind flags.
@@ -63,14 +108,31 @@ public:
       unsigned int    SrcRowPitch,
       unsigned int    SrcDepthPitch);
 
+  /*
+    @brief Uploads only the dirty ranges of a mesh (MeshComponent::m_dirtyVertices or m_dirtyIndices) into a buffer
+           created from it, instead of the whole buffer.
+    @details Each merged range is one UpdateSubresource call with a D3D11_BOX around its bytes, so a small edit of
+             a large mesh sends only the touched vertices or indices. A vertex buffer from initVertexStreams
+             updates both streams; a 16-bit index buffer reads mesh.m_index16 (MeshComponent::refreshIndex16).
+             Ranges past the end of the buffer are clipped. The dirty ranges are left for the caller to clear.
+    @param deviceContext The device context to use for the update.
+    @param mesh The mesh the buffer was created from, with its dirty ranges.
+    @param stats Receives the bytes and calls, added to its current values.
+    @return HRESULT indicating success, or E_INVALIDARG if the buffer does not hold mesh data in a known layout.
+  */
+  HRESULT
+    updateDirtyRanges(DeviceContext& deviceContext, const MeshComponent& mesh, BufferUploadStats& stats);
+
   /*
     @brief Renders the buffer by binding it to the input-assembler stage.
-    @details This method binds the buffer to the input-assembler stage for use in rendering.
+    @details This method binds the buffer to the input-assembler stage for use in rendering. A buffer created with
+             initVertexStreams binds its position stream with NumBuffers 1 and both streams with NumBuffers 2.
     @param deviceContext The device context to use for rendering.
     @param StartSlot The first slot to bind the buffer to.
     @param NumBuffers The number of buffers to bind.
     @param setPixelShader A boolean indicating whether to set the pixel shader (default is false).
-		@param format The format of the index data if binding as an index buffer (default is DXGI_FORMAT_UNKNOWN).
+		@param format The format of the index data if binding as an index buffer (default is DXGI_FORMAT_UNKNOWN,
+                  which uses the format the buffer was created with).
   */
   void
     render(DeviceContext& deviceContext,
@@ -116,4 +178,20 @@ private:
 		@brief Bind flag del buffer (indica cmo se utilizar el buffer).
   */
   unsigned int m_bindFlag = 0;
+
+  /*
+    @brief Segundo stream de vertices (texcoords y normales) y su stride, creado por initVertexStreams.
+  */
+  ID3D11Buffer* m_attributeBuffer = nullptr;
+  unsigned int m_attributeStride = 0;
+
+  /*
+    @brief Formato de los indices (R16 o R32) de un index buffer, elegido en init.
+  */
+  DXGI_FORMAT m_format = DXGI_FORMAT_UNKNOWN;
+
+  /*
+    @brief Memoria temporal de updateDirtyRanges para copiar un rango de un stream de vertices.
+  */
+  std::vector<unsigned char> m_staging;
 };
\ No newline at end of file
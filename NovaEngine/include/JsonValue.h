@@ -0,0 +1,97 @@
+#pragma once
+#include "Prerequisites.h"
+
+/*
+  @class JsonValue
+  @brief A parsed JSON document node (null, bool, number, string, array or object).
+  @note Built for small metadata documents such as glTF headers: objects keep their members in file order and
+        look keys up linearly. Missing members and out-of-range items read as a shared null value, so lookups chain
+        without checks (doc["meshes"].item(0)["name"]).
+*/
+class
+  JsonValue {
+public:
+  enum Type {
+    JSON_NULL = 0,
+    JSON_BOOL = 1,
+    JSON_NUMBER = 2,
+    JSON_STRING = 3,
+    JSON_ARRAY = 4,
+    JSON_OBJECT = 5
+  };
+
+  /*
+    @brief Default constructor. The value is null.
+  */
+  JsonValue() = default;
+
+  /*
+    @brief Destructor
+  */
+  ~JsonValue() = default;
+
+  /*
+    @brief Parses a UTF-8 JSON document.
+    @param begin First byte of the document.
+    @param end One past the last byte.
+    @param out Receives the root value.
+    @param error Receives a description of the first syntax error.
+    @return @c true on success.
+  */
+  static bool
+    parse(const char* begin, const char* end, JsonValue& out, std::string& error);
+
+  Type
+    type() const { return m_type; }
+
+  bool
+    isNull() const { return m_type == JSON_NULL; }
+
+  /*
+    @brief Number of array items or object members.
+  */
+  size_t
+    size() const { return m_items.size(); }
+
+  /*
+    @brief Returns the member with the given key, or null if this is not an object or has no such member.
+  */
+  const JsonValue&
+    operator[](const char* key) const;
+
+  /*
+    @brief Returns the item (or member value) at index, or null if out of range.
+  */
+  const JsonValue&
+    item(size_t index) const;
+
+  /*
+    @brief Returns true if this is an object with the given key.
+  */
+  bool
+    has(const char* key) const { return !(*this)[key].isNull(); }
+
+  double
+    asNumber(double fallback = 0.0) const { return m_type == JSON_NUMBER ? m_number : fallback; }
+
+  /*
+    @brief Returns the number truncated to an integer, or fallback if this is not a number.
+  */
+  long long
+    asInt(long long fallback = 0) const { return m_type == JSON_NUMBER ? static_cast<long long>(m_number) : fallback; }
+
+  bool
+    asBool(bool fallback = false) const { return m_type == JSON_BOOL ? m_bool : fallback; }
+
+  const std::string&
+    asString() const { return m_string; }
+
+public:
+  Type m_type = JSON_NULL;
+  bool m_bool = false;
+  double m_number = 0.0;
+  std::string m_string;
+  // Array items, or object member values with their keys in m_keys.
+  std::vector<JsonValue> m_items;
+  std::vector<std::string> m_keys;
+};
@@ -0,0 +1,75 @@
+#pragma once
+#include "Prerequisites.h"
+
+/*
+  @class MappedFile
+  @brief A read-only memory mapping of a file on disk.
+  @note The MappedFile class exposes the file contents as a contiguous byte range so parsers can tokenize in place without copying into stream buffers.
+*/
+class
+  MappedFile {
+public:
+  /*
+    @brief Default constructor
+  */
+  MappedFile() = default;
+
+  /*
+    @brief Destructor
+  */
+  ~MappedFile() { destroy(); }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /*
+    @brief Opens and maps a file for reading.
+    @param fileName Path of the file to map.
+    @param mapWholeFile If false, only the file mapping is created and mapWindow() maps slices of it.
+    @return HRESULT indicating success or failure of the operation. An empty file succeeds with a null view.
+  */
+  HRESULT
+    init(const std::string& fileName, bool mapWholeFile = true);
+
+  /*
+    @brief Replaces the current view with one covering [offset, offset + size).
+    @details The view starts at the allocation-granularity boundary below offset, so only the touched
+             window is resident at a time. Any pointer from an earlier view becomes invalid.
+    @param offset File offset of the first byte wanted.
+    @param size Number of bytes wanted; offset + size must not exceed the file size.
+    @return Pointer to the byte at offset, or nullptr on failure.
+  */
+  const char*
+    mapWindow(unsigned long long offset, size_t size);
+
+  /*
+    @brief Unmaps the view and closes the file handles.
+  */
+  void
+    destroy();
+
+  /*
+    @brief Returns the first byte of the mapped view.
+  */
+  const char*
+    data() const { return m_view; }
+
+  /*
+    @brief Returns the size of the file in bytes.
+  */
+  size_t
+    size() const { return static_cast<size_t>(m_size); }
+
+  /*
+    @brief Returns the size of the current view in bytes.
+  */
+  size_t
+    viewSize() const { return m_viewSize; }
+
+public:
+  HANDLE m_file = INVALID_HANDLE_VALUE;
+  HANDLE m_mapping = nullptr;
+  const char* m_view = nullptr;
+  size_t m_viewSize = 0;
+  unsigned long long m_size = 0;
+};
@@ -0,0 +1,144 @@
+#pragma once
+#include "Prerequisites.h"
+#include "MeshComponent.h"
+
+/*
+  @brief Marks a missing half-edge: the twin of an open edge, or the edge of a degenerate half-edge.
+*/
+const unsigned int kNoHalfEdge = 0xFFFFFFFFu;
+
+/*
+  @brief What MeshAdjacency::edgeFlags records about an edge.
+  @details MESH_EDGE_OPEN is an edge with a single half-edge (a border or a hole). MESH_EDGE_NON_MANIFOLD is an edge
+           with more than two half-edges, or two with the same direction (flipped winding); in half-edge order, the k-th
+           half-edge of one direction is paired with the k-th of the other and the rest stay without a twin.
+*/
+enum MeshEdgeFlag {
+  MESH_EDGE_OPEN = 1,
+  MESH_EDGE_NON_MANIFOLD = 2
+};
+
+/*
+  @struct MeshAdjacency
+  @brief Half-edge connectivity of a triangle list, in flat arrays.
+  @details Half-edge h = 3 * t + k runs from corner k of triangle t to corner (k + 1) % 3, so the triangle, next and
+           previous half-edges are arithmetic (halfEdgeTriangle, halfEdgeNext, halfEdgePrev) and only the twin
+           and the edge are stored. Edges are numbered in order of their smaller vertex, then their larger one.
+*/
+struct MeshAdjacency {
+  /*
+    @brief Vertex each half-edge leaves; the index list itself, or its welded positions (buildAdjacency).
+    @note kNoHalfEdge where the index is past the vertex count.
+  */
+  std::vector<unsigned int> origin;
+
+  /*
+    @brief Half-edge running the other way along the same edge, or kNoHalfEdge if there is none.
+  */
+  std::vector<unsigned int> twin;
+
+  /*
+    @brief Undirected edge of each half-edge, or kNoHalfEdge for a half-edge whose two ends are the same vertex.
+  */
+  std::vector<unsigned int> edge;
+
+  /*
+    @brief Per edge: its first half-edge (the smallest index) and its MeshEdgeFlag bits.
+  */
+  std::vector<unsigned int> edgeHalfEdge;
+  std::vector<unsigned char> edgeFlags;
+
+  /*
+    @brief Per vertex: a half-edge leaving it, the first open one if the vertex is on a border, so walking
+           halfEdgeAroundVertex from it visits the whole fan. kNoHalfEdge for a vertex no triangle uses.
+  */
+  std::vector<unsigned int> vertexHalfEdge;
+
+  /*
+    @brief Number of open and non-manifold edges, and of half-edges that join a vertex to itself.
+  */
+  size_t openEdges = 0;
+  size_t nonManifoldEdges = 0;
+  size_t degenerateHalfEdges = 0;
+};
+
+/*
+  @brief Triangle of a half-edge.
+*/
+inline unsigned int
+halfEdgeTriangle(unsigned int h) {
+  return h / 3;
+}
+
+/*
+  @brief Next half-edge of the same triangle (it leaves the vertex h points to).
+*/
+inline unsigned int
+halfEdgeNext(unsigned int h) {
+  return (h % 3 == 2) ? h - 2 : h + 1;
+}
+
+/*
+  @brief Previous half-edge of the same triangle (it enters the vertex h leaves).
+*/
+inline unsigned int
+halfEdgePrev(unsigned int h) {
+  return (h % 3 == 0) ? h + 2 : h - 1;
+}
+
+/*
+  @brief Next half-edge leaving the same vertex as h, one triangle further around it.
+  @return kNoHalfEdge when the walk reaches an open or non-manifold edge.
+*/
+inline unsigned int
+halfEdgeAroundVertex(const MeshAdjacency& adjacency, unsigned int h) {
+  return adjacency.twin[halfEdgePrev(h)];
+}
+
+/*
+  @brief Whether any half-edge runs the other way along the edge of h, paired with h or not.
+  @details Twins pair half-edges one to one, so a half-edge of a non-manifold edge may have no twin while the edge
+           still has both directions; the first half-edge of such an edge always has one.
+*/
+inline bool
+halfEdgeHasOpposite(const MeshAdjacency& adjacency, unsigned int h) {
+  unsigned int e = adjacency.edge[h];
+  return e != kNoHalfEdge && adjacency.twin[adjacency.edgeHalfEdge[e]] != kNoHalfEdge;
+}
+
+/*
+  @brief Builds the half-edges of a triangle list in O(n), in parallel.
+  @details Each half-edge is keyed by the smaller of its two vertices and the keys are radix sorted: one parallel
+           pass scatters them into partitions by their top bits, and each partition is then sorted by the rest in
+           cache, one partition per task. Every run of equal keys then holds the few
+           half-edges around one vertex; they are ordered by their other vertex, and the half-edges of each edge are
+           paired by direction. Open, non-manifold and degenerate edges are flagged rather than rejected, and
+           indices past vertexCount count as degenerate. The result does not depend on the thread count.
+  @param adjacency Receives the half-edges (replaced).
+  @param indices The triangle list.
+  @param indexCount Number of indices; a trailing partial triangle is ignored.
+  @param vertexCount Number of vertices the indices refer to.
+  @param threadCount Number of worker threads; 0 uses one per hardware thread.
+*/
+void
+buildAdjacency(MeshAdjacency& adjacency,
+               const unsigned int* indices,
+               size_t indexCount,
+               size_t vertexCount,
+               unsigned int threadCount = 0);
+
+/*
+  @brief Builds the half-edges of m_index.
+  @param adjacency Receives the half-edges (replaced).
+  @param mesh The mesh.
+  @param weldPositions If true, vertices with the same position count as one (origin holds the first of them), so
+                       UV and normal seams are not open edges; crease and silhouette detection want this. If false,
+                       vertices are taken as they are and seams are open edges, as simplification wants.
+  @param threadCount Number of worker threads; 0 uses one per hardware thread.
+  @note With weldPositions, vertexHalfEdge of every vertex is that of the first vertex at its position.
+*/
+void
+buildAdjacency(MeshAdjacency& adjacency,
+               const MeshComponent& mesh,
+               bool weldPositions = false,
+               unsigned int threadCount = 0);
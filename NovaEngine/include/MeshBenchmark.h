@@ -0,0 +1,293 @@
+#pragma once
+#include "Prerequisites.h"
+#include "ModelLoader.h"
+
+/*
+  @class MeshBenchmark
+  @brief Measures the model loaders and mesh passes and collects a plain-text report.
+  @note Run it with "NovaEngine.exe -meshbench <model>"; results go to the debug output and to mesh_benchmark.txt.
+*/
+class
+  MeshBenchmark {
+public:
+  /*
+    @brief Default constructor
+  */
+  MeshBenchmark() = default;
+
+  /*
+    @brief Destructor
+  */
+  ~MeshBenchmark() = default;
+
+  /*
+    @brief Runs every benchmark against a model.
+    @param modelName Path to the model without extension (e.g., "models/Peashooter").
+  */
+  void
+    run(const std::string& modelName);
+
+  /*
+    @brief Compares the memory-mapped OBJ parser against the reference stream parser.
+    @details Reports the best throughput of each in MB/s and whether both produced identical meshes.
+    @param modelName Path to the .obj file without extension.
+    @param iterations Number of timed loads per parser.
+  */
+  void
+    benchmarkOBJ(const std::string& modelName, unsigned int iterations);
+
+  /*
+    @brief Measures LoadOBJ with 1, 2, 4, 8, 16 and 32 worker threads.
+    @details Reports the throughput curve and checks every result against the single-threaded mesh.
+    @param modelName Path to the .obj file without extension.
+  */
+  void
+    benchmarkOBJThreads(const std::string& modelName);
+
+  /*
+    @brief Measures a cold LoadOBJ (parse and write the .novamesh cache) against warm loads from the cache.
+    @details Runs once with a compressed and once with a raw cache and reports the size of each file.
+    @param modelName Path to the .obj file without extension. Its cache file is deleted first.
+  */
+  void
+    benchmarkCache(const std::string& modelName);
+
+  /*
+    @brief Compares StreamOBJ under a memory budget against LoadOBJ.
+    @details Reports throughput and peak memory of both and checks that they produce the same set of triangles.
+             It runs first in run() because the process peak working set only ever grows.
+    @param modelName Path to the .obj file without extension.
+    @param memoryBudget Memory budget passed to StreamOBJ in bytes.
+  */
+  void
+    benchmarkStream(const std::string& modelName, size_t memoryBudget);
+
+  /*
+    @brief Compares LoadGLTF against LoadOBJ on the same asset.
+    @details Uses <model>.glb if it exists; otherwise writes the OBJ mesh to a temporary interleaved GLB first.
+             Reports both load times, how many primitives took the block-copy path and whether the triangles match.
+    @param modelName Path to the model without extension.
+  */
+  void
+    benchmarkGLTF(const std::string& modelName);
+
+  /*
+    @brief Compares LoadPLY against LoadOBJ and against a plain read of the mapped file.
+    @details Writes the OBJ mesh to a temporary binary PLY (float x/y/z, nx/ny/nz, u/v and a triangle list) and a
+             points-only copy, then reports the throughput of each load next to the read bandwidth of the same file.
+    @param modelName Path to the model without extension.
+  */
+  void
+    benchmarkPLY(const std::string& modelName);
+
+  /*
+    @brief Measures LoadSTL on the OBJ mesh written as a binary STL triangle soup.
+    @details Reports import speed and weld ratio for exact smooth welding, faceted welding and a tolerance of
+             1e-5 of the bounding box diagonal, and checks that exact welding keeps every triangle's positions.
+    @param modelName Path to the model without extension.
+  */
+  void
+    benchmarkSTL(const std::string& modelName);
+
+  /*
+    @brief Measures normal generation on the OBJ mesh written back without vn records.
+    @details Reports the load time with and without generated normals, the vertices split at creases and flat
+             groups, the mean angle to the source normals and whether one and many threads give identical meshes.
+    @param modelName Path to the model without extension.
+  */
+  void
+    benchmarkNormals(const std::string& modelName);
+
+  /*
+    @brief Measures the cost of ModelLoadOptions::generateTangents on LoadOBJ.
+    @details Reports the load time with and without tangents, the time of the tangent pass on one and on all
+             threads, the vertices split for mirrored texture mapping and the largest |dot(normal, tangent)|.
+    @param modelName Path to the model without extension.
+  */
+  void
+    benchmarkTangents(const std::string& modelName);
+
+  /*
+    @brief Measures optimizeVertexCache on the OBJ mesh and on a synthetic grid with shuffled triangles.
+    @details Reports ACMR and ATVR before and after for 16- and 32-entry caches and the time of the pass.
+    @param modelName Path to the model without extension.
+    @param gridTriangles Number of triangles of the synthetic grid (e.g., 10M).
+  */
+  void
+    benchmarkVertexCache(const std::string& modelName, size_t gridTriangles);
+
+  /*
+    @brief Measures optimizeOverdraw on the OBJ mesh with ACMR budgets of 1.05, 1.25 and 2.
+    @details Reports the estimated overdraw (analyzeOverdraw) and FIFO-16 ACMR of the file order, the vertex cache
+             order and each overdraw order, and the time of the pass.
+    @param modelName Path to the model without extension.
+  */
+  void
+    benchmarkOverdraw(const std::string& modelName);
+
+  /*
+    @brief Measures optimizeVertexFetch on the OBJ mesh after optimizeVertexCache.
+    @details Reports the simulated overfetch of the file order, the vertex cache order and the remapped order,
+             the time of the remap and whether the mesh still draws the same triangles, then what a depth-only
+             pass reads from the interleaved buffer against the position stream of splitVertexStreams.
+    @param modelName Path to the model without extension.
+  */
+  void
+    benchmarkVertexFetch(const std::string& modelName);
+
+  /*
+    @brief Measures generateLods on the OBJ mesh (four levels, each keeping half of the triangles).
+    @details Reports the triangles, error and open edges (counted between positions, so cracks at attribute seams
+             show up) of every level, the time on one and on all threads and whether both give identical levels.
+    @param modelName Path to the model without extension.
+  */
+  void
+    benchmarkLods(const std::string& modelName);
+
+  /*
+    @brief Measures buildClusters on the OBJ mesh after optimizeVertexCache, and cullClusters from 64 cameras.
+    @details Reports the cluster count and fill, the ACMR before and after, the build time on one and on all
+             threads and whether both agree, then the share of triangles kept, rejected by the frustum and rejected
+             as back-facing, and the time of one cull. Half of the cameras see the whole mesh from outside, half
+             stand close to it looking past its center.
+    @param modelName Path to the model without extension.
+  */
+  void
+    benchmarkClusters(const std::string& modelName);
+
+  /*
+    @brief Measures quantizeVertices on the OBJ mesh with UNORM16 and with half positions.
+    @details Reports the memory saved, the largest and typical position, normal and texture coordinate error, the
+             encoding throughput on one and on all threads and whether both give identical buffers.
+    @param modelName Path to the model without extension.
+  */
+  void
+    benchmarkQuantization(const std::string& modelName);
+
+  /*
+    @brief Measures the vertex and index codecs (MeshCodec.h) on the OBJ mesh.
+    @details Reports the compression ratio in file order and after optimizeVertexCache and optimizeVertexFetch, the
+             encoding throughput, the decoding throughput on one and on all threads, whether the round trip is exact
+             and the disk speed below which loading the compressed buffers is faster than reading them raw.
+    @param modelName Path to the model without extension.
+  */
+  void
+    benchmarkCodec(const std::string& modelName);
+
+  /*
+    @brief Measures cleanupMesh on the OBJ mesh and on a copy damaged the way careless exporters do.
+    @details The copy gives every face corner its own vertex, moves positions by a hundredth of the weld
+             tolerance and adds a degenerate triangle every 50 and a duplicate every 100 triangles. Reports the
+             vertices and indices before and after, what was removed, the time on one and on all threads and
+             whether both give identical meshes.
+    @param modelName Path to the model without extension.
+  */
+  void
+    benchmarkCleanup(const std::string& modelName);
+
+  /*
+    @brief Measures the 16-bit index path (MeshComponent::buildIndex16) on the OBJ mesh.
+    @details Reports the index format chosen for the mesh as loaded and for a copy in optimizeVertexFetch order
+             cut into submeshes of 16384 triangles, which a mesh of more than 65536 vertices needs for per-submesh
+             base vertices; the index bytes in 32 and in 16 bits, the build time and whether every 16-bit index
+             plus its base vertex gives back the 32-bit one.
+    @param modelName Path to the model without extension.
+  */
+  void
+    benchmarkIndexFormat(const std::string& modelName);
+
+  /*
+    @brief Measures the dirty range tracking of MeshComponent for an editor brush that deforms a small region.
+    @details Every vertex within 5% of the mesh size of a point is moved and marked on its own, in file order and
+             in optimizeVertexFetch order. Reports the ranges left without merging and with kDirtyRangeMergeGap, the
+             bytes Buffer::updateDirtyRanges would send for both vertex streams against a full upload, and the
+             marking time.
+    @param modelName Path to the model without extension.
+  */
+  void
+    benchmarkDirtyRanges(const std::string& modelName);
+
+  /*
+    @brief Measures buildAdjacency on the OBJ mesh and on a large shuffled grid.
+    @details Reports the edges, open, non-manifold and degenerate counts of the mesh by vertex and with welded
+             positions, and for the grid the build time on one and on all threads, triangles per second and whether
+             both give the same half-edges.
+    @param modelName Path to the model without extension.
+    @param gridTriangles Number of triangles of the grid (e.g., 10M).
+  */
+  void
+    benchmarkAdjacency(const std::string& modelName, size_t gridTriangles);
+
+  /*
+    @brief Measures computeVertexBounds and MeshComponent::computeBounds on the OBJ mesh.
+    @details Reports the scalar box loop computeBounds used before against the SIMD box and sphere on one and on all
+             threads, in GB/s of vertex data, whether both threads counts agree and the sphere holds every vertex,
+             and its radius against the sphere around the box.
+    @param modelName Path to the model without extension.
+  */
+  void
+    benchmarkBounds(const std::string& modelName);
+
+  /*
+    @brief Compares the string-keyed std::map corner dedup against VertexDedupTable.
+    @details Builds a synthetic quad grid with the given number of face corners and reports corners per second for both.
+    @param cornerCount Number of face corners to deduplicate (e.g., 10M).
+  */
+  void
+    benchmarkDedup(size_t cornerCount);
+
+  /*
+    @brief Writes the collected report to a text file.
+    @param fileName Path of the report file.
+    @return HRESULT indicating success or failure of the operation.
+  */
+  HRESULT
+    writeReport(const std::string& fileName) const;
+
+private:
+  /*
+    @brief Appends a line to the report and echoes it to the debug output.
+  */
+  void
+    report(const std::string& line);
+
+  /*
+    @brief Returns true if both meshes hold bit-identical vertex and index data.
+  */
+  static bool
+    identical(const MeshComponent& a, const MeshComponent& b);
+
+  /*
+    @brief Writes a mesh as a binary glTF with one interleaved vertex buffer view and one primitive per submesh.
+  */
+  static HRESULT
+    writeGLB(const std::string& fileName, const MeshComponent& mesh);
+
+  /*
+    @brief Writes a mesh as a binary little-endian PLY; with withFaces false only the vertices are written.
+  */
+  static HRESULT
+    writePLY(const std::string& fileName, const MeshComponent& mesh, bool withFaces);
+
+  /*
+    @brief Writes the triangles of a mesh as a binary STL, three unshared corners each.
+  */
+  static HRESULT
+    writeSTL(const std::string& fileName, const MeshComponent& mesh);
+
+  /*
+    @brief Writes a mesh as an OBJ with welded positions and texture coordinates but no normals.
+  */
+  static HRESULT
+    writeOBJ(const std::string& fileName, const MeshComponent& mesh);
+
+  /*
+    @brief Returns an order-independent hash of the triangles of a mesh, taken over their vertex data.
+    @note Meshes that draw the same triangles hash equal however their vertices are shared or ordered.
+  */
+  static unsigned long long
+    triangleHash(const MeshComponent& mesh);
+
+private:
+  std::vector<std::string> m_lines;
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include "Prerequisites.h"
+
+/*
+  @struct MeshBounds
+  @brief Axis-aligned box and bounding sphere of a set of vertex positions.
+  @note An empty set gets zero-sized bounds at the origin.
+*/
+struct MeshBounds {
+  XMFLOAT3 boundsMin = XMFLOAT3(0.0f, 0.0f, 0.0f);
+  XMFLOAT3 boundsMax = XMFLOAT3(0.0f, 0.0f, 0.0f);
+  XMFLOAT3 center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+  float radius = 0.0f;
+};
+
+/*
+  @brief Computes the bounds of a vertex array.
+  @details Three parallel SIMD passes over fixed-size chunks, each as fast as memory delivers the vertices. The
+           first reduces the box and the vertices at its six faces. The second grows Ritter's sphere, started on the
+           farthest apart pair of those vertices, over every chunk and merges the chunk spheres. The third takes the
+           exact radius around that center and around the box center, and keeps the smaller sphere. The result does
+           not depend on the thread count.
+  @param vertices The vertices.
+  @param count Number of vertices.
+  @param threadCount Number of worker threads; 0 uses one per hardware thread.
+*/
+MeshBounds
+computeVertexBounds(const SimpleVertex* vertices, size_t count, unsigned int threadCount = 0);
+
+/*
+  @brief Computes the bounds of the vertices an index range references, as computeVertexBounds.
+  @details A vertex referenced several times counts several times; the bounds are the same.
+  @param vertices The vertices the indices refer to.
+  @param indices The index range.
+  @param indexCount Number of indices.
+  @param threadCount Number of worker threads; 0 uses one per hardware thread.
+*/
+MeshBounds
+computeIndexedBounds(const SimpleVertex* vertices,
+                     const unsigned int* indices,
+                     size_t indexCount,
+                     unsigned int threadCount = 0);
@@ -0,0 +1,155 @@
+#pragma once
+#include "Prerequisites.h"
+#include "MeshComponent.h"
+#include <cstdint>
+#include <vector>
+
+/*
+  @brief Version of the .novamesh layout. Bump it whenever NovaMeshHeader or the payload layout changes.
+*/
+const uint32_t kNovaMeshVersion = 7;
+
+/*
+  @struct NovaMeshHeader
+  @brief Fixed-size header at the start of every .novamesh file.
+  @note Payloads follow the header at 16-byte aligned offsets, so a mapped view can read them without realigning;
+        MeshCache::load still copies (or decodes) each one into the MeshComponent.
+        Vertices, indices and tangents may be stored compressed (MeshCodec.h) instead.
+*/
+struct NovaMeshHeader {
+  char     magic[4];        // "NMSH"
+  uint32_t version;         // kNovaMeshVersion
+  uint32_t headerSize;      // sizeof(NovaMeshHeader)
+  uint32_t vertexStride;    // sizeof(SimpleVertex)
+  uint32_t indexStride;     // sizeof(unsigned int)
+  uint32_t clusterStride;   // sizeof(MeshCluster)
+  uint64_t sourceSize;      // Size in bytes of the source model file
+  uint64_t sourceHash;      // MeshCache::hashBytes of the source model file (mixed with import options)
+  uint64_t vertexCount;
+  uint64_t indexCount;
+  uint64_t vertexOffset;    // Byte offset of the SimpleVertex array
+  uint64_t indexOffset;     // Byte offset of the index array
+  float    boundsMin[3];
+  float    boundsMax[3];
+  float    boundsCenter[3];   // Bounding sphere (MeshComponent::m_boundsCenter, m_boundsRadius)
+  float    boundsRadius;
+  uint64_t submeshCount;
+  uint64_t submeshOffset;   // Byte offset of the NovaMeshSubmesh array
+  uint64_t metadataSize;
+  uint64_t metadataOffset;  // Byte offset of the material and dependency tables
+  uint64_t tangentCount;    // 0 or vertexCount
+  uint64_t tangentOffset;   // Byte offset of the XMFLOAT4 tangent array
+  uint64_t lodCount;        // Number of MeshComponent::m_lods
+  uint64_t lodOffset;       // Byte offset of the float error of every level of detail
+  uint64_t clusterCount;    // Number of MeshComponent::m_clusters
+  uint64_t clusterOffset;   // Byte offset of the MeshCluster array
+  uint64_t vertexEncodedSize;  // Size of the vertex array compressed with encodeVertexBuffer; 0 if stored raw
+  uint64_t indexEncodedSize;   // Size of the index array compressed with encodeIndexBuffer; 0 if stored raw
+  uint64_t tangentEncodedSize; // Size of the tangent array compressed with encodeVertexBuffer; 0 if stored raw
+};
+
+/*
+  @struct NovaMeshSubmesh
+  @brief On-disk record of a MeshSubmesh.
+*/
+struct NovaMeshSubmesh {
+  uint32_t indexOffset;
+  uint32_t indexCount;
+  uint32_t materialId;
+  uint32_t lodLevel;        // 0 for m_submeshes, n for m_lods[n - 1]
+  float    boundsMin[3];
+  float    boundsMax[3];
+  float    center[3];       // Bounding sphere
+  float    radius;
+};
+
+/*
+  @struct MeshCacheDependency
+  @brief A file besides the source model that the cached mesh was built from (e.g. a .mtl library).
+  @note A file that was missing at import time is recorded with size kMissingFile; it stays valid while the file is absent.
+*/
+struct MeshCacheDependency {
+  static const unsigned long long kMissingFile = ~0ull;
+
+  std::string path;
+  unsigned long long size = kMissingFile;
+  unsigned long long hash = 0;
+};
+
+/*
+  @class MeshCache
+  @brief Reads and writes .novamesh files, the binary cache of an imported model.
+  @note A cache entry is only used when the size and content hash of the source file still match,
+        so editing the source model invalidates it automatically.
+*/
+class
+  MeshCache {
+public:
+  /*
+    @brief Default constructor
+  */
+  MeshCache() = default;
+
+  /*
+    @brief Destructor
+  */
+  ~MeshCache() = default;
+
+  /*
+    @brief Loads a cache file into a mesh.
+    @details The file is memory-mapped and the vertex, index, submesh and cluster payloads are block-copied into the
+             mesh, or decoded in parallel if they were saved compressed; there is no per-element parsing. Recorded
+             dependencies are re-hashed before the cache is accepted. Every payload range, submesh and cluster
+             range and index is checked, so a corrupt or stale file is rejected rather than uploaded.
+    @param cachePath Path of the .novamesh file.
+    @param sourceSize Size of the source model file.
+    @param sourceHash Content hash of the source model file.
+    @param outMesh The mesh to fill.
+    @param threadCount Number of threads that decode compressed payloads; 0 uses one per hardware thread.
+    @return S_OK on a hit, S_FALSE if the cache is missing, stale or unreadable.
+  */
+  HRESULT
+    load(const std::string& cachePath,
+      unsigned long long sourceSize,
+      unsigned long long sourceHash,
+      MeshComponent& outMesh,
+      unsigned int threadCount = 0);
+
+  /*
+    @brief Writes a mesh to a cache file.
+    @details The file is written next to its final name and renamed into place, so a reader never sees a partial cache.
+    @param cachePath Path of the .novamesh file.
+    @param sourceSize Size of the source model file.
+    @param sourceHash Content hash of the source model file.
+    @param mesh The mesh to store; its bounds must be up to date.
+    @param dependencies Other files the mesh was built from.
+    @param compress Stores the vertices, indices and tangents compressed (encodeVertexBuffer, encodeIndexBuffer).
+    @return HRESULT indicating success or failure of the operation.
+  */
+  HRESULT
+    save(const std::string& cachePath,
+      unsigned long long sourceSize,
+      unsigned long long sourceHash,
+      const MeshComponent& mesh,
+      const std::vector<MeshCacheDependency>& dependencies = std::vector<MeshCacheDependency>(),
+      bool compress = true);
+
+  /*
+    @brief Describes the current state of a dependency file.
+    @param path Path of the file.
+    @return The dependency record, with size kMissingFile if the file does not exist.
+  */
+  static MeshCacheDependency
+    describeFile(const std::string& path);
+
+  /*
+    @brief Computes a 64-bit content hash of a byte range.
+    @details The range is hashed in fixed 4 MB blocks on up to threadCount threads and the block hashes are
+             combined in order, so the value does not depend on the thread count.
+    @param data First byte of the range.
+    @param size Size of the range in bytes.
+    @param threadCount Number of threads to use.
+  */
+  static unsigned long long
+    hashBytes(const void* data, size_t size, unsigned int threadCount);
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include "Prerequisites.h"
+#include "MeshComponent.h"
+
+/*
+  @struct MeshCleanupOptions
+  @brief Tolerances of cleanupMesh. Two vertices are welded only if every attribute is within its tolerance.
+*/
+struct MeshCleanupOptions {
+  /*
+    @brief Largest distance between welded positions, as a fraction of the largest side of the mesh bounds.
+    @note 0 welds bit-identical positions only (-0 and +0 are equal).
+  */
+  float positionTolerance = 1e-5f;
+
+  /*
+    @brief Largest difference of welded texture coordinates, per component, in UV units.
+  */
+  float texcoordTolerance = 1e-5f;
+
+  /*
+    @brief Largest angle between welded normals, and between welded tangents, in degrees.
+    @note Tangents must also agree in handedness (w); colors must match exactly.
+  */
+  float normalTolerance = 1.0f;
+
+  /*
+    @brief Removes triangles with a repeated vertex and triangles thinner than the position tolerance.
+  */
+  bool removeDegenerate = true;
+
+  /*
+    @brief Removes triangles that repeat an earlier triangle of the same index range with the same winding.
+    @note The same triangle with the opposite winding is a back face and is kept.
+  */
+  bool removeDuplicates = true;
+};
+
+/*
+  @struct MeshCleanupStats
+  @brief What cleanupMesh removed.
+*/
+struct MeshCleanupStats {
+  /*
+    @brief Size of m_vertex and m_index before and after the cleanup.
+  */
+  size_t verticesBefore = 0;
+  size_t verticesAfter = 0;
+  size_t indicesBefore = 0;
+  size_t indicesAfter = 0;
+
+  /*
+    @brief Vertices merged into an earlier vertex.
+  */
+  size_t weldedVertices = 0;
+
+  /*
+    @brief Vertices dropped because no remaining triangle uses them.
+  */
+  size_t unusedVertices = 0;
+
+  /*
+    @brief Triangles removed as degenerate (repeated vertex or no area) and as duplicates.
+  */
+  size_t degenerateTriangles = 0;
+  size_t duplicateTriangles = 0;
+};
+
+/*
+  @brief Welds vertices within per-attribute tolerances and removes degenerate and duplicate triangles.
+  @details Vertices are bucketed by a spatial hash of cells max(2 * tolerance, spacing / 2) wide, where spacing is
+           the bounds extent over the square root of the vertex count. Each vertex then compares against the
+           vertices of at most 2x2x2 cells, and most against those of its own cell only. Every vertex is merged into the earliest vertex
+           that matches it, and a chain of matches merges into its first vertex; the search runs in parallel
+           and the result does not depend on the thread count. Indices are then rewritten, triangles that
+           collapsed or repeat are removed from every index range (submeshes and levels of detail, which keep
+           their order and shrink in place) and the vertices no triangle uses are dropped. The surviving
+           vertices keep their order and their own values.
+           m_color and m_tangent follow m_vertex; clusters (m_clusters) are dropped and the bounds recomputed.
+  @param mesh The mesh to clean. A mesh without indices (a point cloud) is left as it is.
+  @param options Tolerances and what to remove.
+  @param threadCount Number of worker threads; 0 uses one per hardware thread.
+  @return The sizes before and after and what was removed.
+*/
+MeshCleanupStats
+cleanupMesh(MeshComponent& mesh,
+            const MeshCleanupOptions& options = MeshCleanupOptions(),
+            unsigned int threadCount = 0);
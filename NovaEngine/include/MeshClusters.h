@@ -0,0 +1,145 @@
+#pragma once
+#include "Prerequisites.h"
+#include "MeshComponent.h"
+
+/*
+  @brief Vertex and triangle limits of a cluster; 64 and 124 are the meshlet sizes GPUs favour.
+*/
+const unsigned int kClusterMaxVertices = 64;
+const unsigned int kClusterMaxTriangles = 124;
+
+/*
+  @brief How much buildClusters favours narrow normal cones (better backface culling) over compact clusters.
+*/
+const float kDefaultClusterConeWeight = 0.5f;
+
+/*
+  @struct ClusterCullView
+  @brief A camera expressed in the object space of a mesh, as cullClusters tests it.
+*/
+struct ClusterCullView {
+  /*
+    @brief Left, right, bottom, top, near and far planes; a point p is inside when dot(xyz, p) + w >= 0.
+           xyz is unit length.
+  */
+  XMFLOAT4 planes[6];
+
+  /*
+    @brief Position of the camera.
+  */
+  XMFLOAT3 cameraPosition;
+};
+
+/*
+  @struct ClusterCullStats
+  @brief How many clusters a cullClusters call kept and why the others were rejected.
+*/
+struct ClusterCullStats {
+  size_t visible = 0;
+  size_t outsideFrustum = 0;
+  size_t backfacing = 0;
+};
+
+/*
+  @brief Partitions a triangle list into clusters of neighbouring triangles and reorders it so every cluster is a
+         contiguous range.
+  @details Clusters grow greedily over triangles that share a position with them (so UV and normal seams do not
+           stop them): first triangles that add no vertex, then the last triangle left at a position, then the
+           fewest new vertices; ties go to the triangle closest to the cluster and best aligned with its average
+           normal (coneWeight trades the two), which keeps spheres small and normal cones narrow. A cluster closes
+           when it reaches maxVertices or maxTriangles or runs out of neighbours, and the next one starts beside it.
+           The triangles of each cluster are then put in vertex cache order. Triangle winding is preserved.
+  @param clusters Receives the clusters, appended in order; offsets are relative to indices and the
+                  bounds are computed from vertices.
+  @param indices Triangle list, reordered in place; a vertex cache optimized order gives the most compact clusters.
+  @param indexCount Number of indices (a multiple of 3).
+  @param vertices Vertex array the indices refer to.
+  @param vertexCount Number of vertices.
+  @param maxVertices Largest number of distinct vertices in a cluster (3 to 256).
+  @param maxTriangles Largest number of triangles in a cluster.
+  @param coneWeight 0 favours compact clusters, 1 favours narrow normal cones.
+*/
+void
+buildClusters(std::vector<MeshCluster>& clusters,
+              unsigned int* indices,
+              size_t indexCount,
+              const SimpleVertex* vertices,
+              size_t vertexCount,
+              unsigned int maxVertices = kClusterMaxVertices,
+              unsigned int maxTriangles = kClusterMaxTriangles,
+              float coneWeight = kDefaultClusterConeWeight);
+
+/*
+  @brief Builds MeshComponent::m_clusters for every submesh of every level of detail (see the overload above).
+  @details Triangles never move between submeshes. Submeshes are processed in parallel and the result does not
+           depend on the thread count. Run it after optimizeVertexCache and optimizeOverdraw, which reorder
+           m_index again and drop the clusters; optimizeVertexFetch keeps them.
+  @param mesh The mesh. Existing clusters are replaced. A mesh without submeshes gets one covering m_index first.
+  @param maxVertices Largest number of distinct vertices in a cluster.
+  @param maxTriangles Largest number of triangles in a cluster.
+  @param coneWeight 0 favours compact clusters, 1 favours narrow normal cones.
+  @param threadCount Number of worker threads; 0 uses one per hardware thread.
+  @return Number of clusters built.
+*/
+size_t
+buildClusters(MeshComponent& mesh,
+              unsigned int maxVertices = kClusterMaxVertices,
+              unsigned int maxTriangles = kClusterMaxTriangles,
+              float coneWeight = kDefaultClusterConeWeight,
+              unsigned int threadCount = 0);
+
+/*
+  @brief Computes the object space culling view of a mesh drawn with the given matrices.
+  @param world World matrix of the mesh.
+  @param view View matrix.
+  @param projection Projection matrix (D3D clip space, depth from 0 to 1).
+*/
+ClusterCullView
+makeClusterCullView(const XMMATRIX& world, const XMMATRIX& view, const XMMATRIX& projection);
+
+/*
+  @brief Tests a bounding sphere (a cluster's, a submesh's or a mesh's) against the frustum planes of a view.
+  @return False if the sphere is entirely behind one of the planes.
+*/
+inline bool
+sphereInView(const ClusterCullView& view, const XMFLOAT3& center, float radius) {
+  for (const XMFLOAT4& plane : view.planes) {
+    if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+  @brief Rejects the clusters of a level of detail that are outside the view frustum or face away from the
+         camera, and copies the indices of the rest into one compacted list.
+  @details Each cluster is tested by its bounding sphere against the frustum planes and by its normal cone
+           against the camera position. The surviving ranges of each submesh are copied one after the other, so
+           the list is drawn with one call per submesh. A mesh without clusters keeps every triangle.
+  @param mesh The mesh.
+  @param level Level of detail, as in MeshComponent::lodSubmeshes.
+  @param view Camera in the object space of the mesh (makeClusterCullView).
+  @param outIndices Receives the indices of the visible clusters.
+  @param outSubmeshes Receives one range of outIndices per submesh of the level, parallel to lodSubmeshes(level).
+  @return Counts of visible and rejected clusters.
+*/
+ClusterCullStats
+cullClusters(const MeshComponent& mesh,
+             size_t level,
+             const ClusterCullView& view,
+             std::vector<unsigned int>& outIndices,
+             std::vector<MeshSubmesh>& outSubmeshes);
+
+/*
+  @brief cullClusters over the 16-bit indices of the mesh (MeshComponent::m_index16).
+  @details The copied indices stay relative to the baseVertex of their submesh, so outSubmeshes is drawn with
+           DrawIndexed(indexCount, indexOffset, baseVertex) from a DXGI_FORMAT_R16_UINT buffer.
+  @note Fails (empty outputs) if buildIndex16 has not filled m_index16 for the current m_index.
+*/
+ClusterCullStats
+cullClusters(const MeshComponent& mesh,
+             size_t level,
+             const ClusterCullView& view,
+             std::vector<unsigned short>& outIndices,
+             std::vector<MeshSubmesh>& outSubmeshes);
@@ -0,0 +1,67 @@
+#pragma once
+#include "Prerequisites.h"
+
+/*
+  @brief Vertices per block of the vertex codec. Blocks are coded independently, so a buffer decodes in parallel.
+*/
+const size_t kVertexCodecBlockSize = 256;
+
+/*
+  @brief Compresses a vertex buffer without loss.
+  @details Every 32-bit word of a vertex is coded as the difference to the same word of the previous vertex,
+           zigzag-mapped so small negative differences become small numbers. The four bytes of those numbers are
+           stored as separate planes, and every group of 16 bytes of a plane takes 0, 2, 4 or 8 bits per byte,
+           whichever holds all of them. Neighbouring vertices differ mostly in their low bytes, so the high planes
+           shrink to a few bits; an optimizeVertexFetch order compresses best.
+  @param out Receives the encoded bytes (replaced).
+  @param vertices The vertex array.
+  @param vertexCount Number of vertices.
+  @param vertexSize Size of one vertex in bytes; a multiple of 4, at most 256.
+*/
+void
+encodeVertexBuffer(std::vector<unsigned char>& out, const void* vertices, size_t vertexCount, size_t vertexSize);
+
+/*
+  @brief Decodes a buffer written by encodeVertexBuffer.
+  @details Each block is unpacked, de-zigzagged, prefix-summed and transposed back into vertices with SSE2, and the
+           blocks are spread over the worker threads.
+  @param destination Receives vertexCount vertices.
+  @param vertexCount Number of vertices, as encoded.
+  @param vertexSize Size of one vertex in bytes, as encoded.
+  @param data The encoded bytes.
+  @param size Number of encoded bytes.
+  @param threadCount Number of worker threads; 0 uses one per hardware thread.
+  @return False if the data is malformed or does not match the counts.
+*/
+bool
+decodeVertexBuffer(void* destination,
+                   size_t vertexCount,
+                   size_t vertexSize,
+                   const unsigned char* data,
+                   size_t size,
+                   unsigned int threadCount = 0);
+
+/*
+  @brief Compresses a triangle list without loss.
+  @details Encoder and decoder keep the same FIFOs of the last 16 edges and the last 16 new vertices. A triangle
+           that shares an edge with a recent one is coded as one byte (which edge, and whether its third vertex is
+           the next unused index, a recent vertex or a varint delta) plus two bits saying where the shared edge
+           starts, so the triangles come back exactly as they went in. A vertex cache order followed by
+           optimizeVertexFetch gives about two bytes per triangle.
+  @param out Receives the encoded bytes (replaced).
+  @param indices The triangle list.
+  @param indexCount Number of indices (a multiple of 3).
+*/
+void
+encodeIndexBuffer(std::vector<unsigned char>& out, const unsigned int* indices, size_t indexCount);
+
+/*
+  @brief Decodes a triangle list written by encodeIndexBuffer.
+  @param destination Receives indexCount indices.
+  @param indexCount Number of indices, as encoded.
+  @param data The encoded bytes.
+  @param size Number of encoded bytes.
+  @return False if the data is malformed or does not match the count.
+*/
+bool
+decodeIndexBuffer(unsigned int* destination, size_t indexCount, const unsigned char* data, size_t size);
@@ -3,7 +3,125 @@
 //#include "ECS\Component.h"
 // Forward declaration
 class DeviceContext;
- 
+
+/*
+  @struct MeshMaterial
+  @brief Surface description of a material referenced by a mesh (parsed from .mtl files).
+*/
+struct MeshMaterial {
+  std::string name;
+  XMFLOAT3 ambient = XMFLOAT3(0.0f, 0.0f, 0.0f);
+  XMFLOAT3 diffuse = XMFLOAT3(1.0f, 1.0f, 1.0f);
+  XMFLOAT3 specular = XMFLOAT3(0.0f, 0.0f, 0.0f);
+  float shininess = 0.0f;
+  float opacity = 1.0f;
+
+  /*
+    @brief Path of the diffuse texture (map_Kd), relative to the working directory. Empty if none.
+  */
+  std::string diffuseTexture;
+
+  /*
+    @brief Path of the normal/bump texture (map_Bump, bump, norm). Empty if none.
+  */
+  std::string normalTexture;
+};
+
+/*
+  @struct MeshSubmesh
+  @brief A contiguous range of the index buffer drawn with a single material.
+  @note Submeshes share the vertex and index buffers of their MeshComponent; each one is a single DrawIndexed call.
+*/
+struct MeshSubmesh {
+  unsigned int indexOffset = 0;
+  unsigned int indexCount = 0;
+  unsigned int materialId = 0;
+  XMFLOAT3 boundsMin = XMFLOAT3(0.0f, 0.0f, 0.0f);
+  XMFLOAT3 boundsMax = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+  /*
+    @brief Bounding sphere of the vertices the range references.
+  */
+  XMFLOAT3 center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+  float radius = 0.0f;
+
+  /*
+    @brief Value added to every index of the range before it reads m_vertex (the BaseVertexLocation of
+           DrawIndexed). Non-zero only for the 16-bit indices of a mesh with more than 65536 vertices (buildIndex16).
+  */
+  unsigned int baseVertex = 0;
+};
+
+/*
+  @struct MeshLod
+  @brief A coarser level of detail of a mesh: its own index ranges into the vertex and index buffers of the
+         MeshComponent, one per submesh of the full-detail level.
+*/
+struct MeshLod {
+  /*
+    @brief Geometric error of the level, as a fraction of the largest side of the mesh bounds.
+  */
+  float error = 0.0f;
+
+  /*
+    @brief Index ranges of this level, parallel to MeshComponent::m_submeshes (same materials). A range can be empty.
+  */
+  std::vector<MeshSubmesh> submeshes;
+};
+
+/*
+  @struct MeshCluster
+  @brief A small group of neighbouring triangles (a meshlet) stored as a contiguous range of the index buffer, with
+         the bounds a culling stage tests before drawing it (buildClusters, cullClusters).
+*/
+struct MeshCluster {
+  unsigned int indexOffset = 0;
+  unsigned int indexCount = 0;
+
+  /*
+    @brief Number of distinct vertices the range references.
+  */
+  unsigned int vertexCount = 0;
+
+  /*
+    @brief Level of detail (as in MeshComponent::lodSubmeshes) and submesh of that level the range belongs to.
+  */
+  unsigned int lodLevel = 0;
+  unsigned int submesh = 0;
+
+  XMFLOAT3 boundsMin = XMFLOAT3(0.0f, 0.0f, 0.0f);
+  XMFLOAT3 boundsMax = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+  /*
+    @brief Bounding sphere of the vertices.
+  */
+  XMFLOAT3 center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+  float radius = 0.0f;
+
+  /*
+    @brief Backface cone: the whole cluster faces away from any camera position p with
+           dot(normalize(coneApex - p), coneAxis) >= coneCutoff. A cutoff of 1 never culls (normals too spread).
+  */
+  XMFLOAT3 coneApex = XMFLOAT3(0.0f, 0.0f, 0.0f);
+  XMFLOAT3 coneAxis = XMFLOAT3(0.0f, 0.0f, 0.0f);
+  float coneCutoff = 1.0f;
+};
+
+/*
+  @struct MeshDirtyRange
+  @brief Elements [first, first + count) of m_vertex or m_index changed since the last upload.
+*/
+struct MeshDirtyRange {
+  unsigned int first = 0;
+  unsigned int count = 0;
+};
+
+/*
+  @brief Dirty ranges less than this many elements apart are merged into one upload: re-sending a few unchanged
+         vertices costs less than another UpdateSubresource call.
+*/
+const unsigned int kDirtyRangeMergeGap = 64;
+
 /*
   @class MeshComponent
   @brief A component that represents a 3D mesh in the ECS architecture.
@@ -23,6 +141,14 @@ public:
   virtual
     ~MeshComponent() = default;
 
+  /*
+    @brief Copy and move. Declared explicitly because the virtual destructor would otherwise turn moves into copies.
+  */
+  MeshComponent(const MeshComponent&) = default;
+  MeshComponent(MeshComponent&&) = default;
+  MeshComponent& operator=(const MeshComponent&) = default;
+  MeshComponent& operator=(MeshComponent&&) = default;
+
   /*
 		@brief Initializes the mesh component.
   */
@@ -47,6 +173,96 @@ public:
   void
     destroy() /*override {}*/;
 
+  /*
+    @brief Recomputes the box and sphere of the vertex positions (m_boundsMin, m_boundsMax, m_boundsCenter,
+           m_boundsRadius), and those of every submesh and level of detail from the vertices its indices reference.
+    @details Uses computeVertexBounds and computeIndexedBounds (MeshBounds.h): parallel SIMD passes.
+    @param threadCount Number of worker threads; 0 uses one per hardware thread.
+    @note An empty mesh or submesh gets zero-sized bounds at the origin.
+  */
+  void
+    computeBounds(unsigned int threadCount = 0);
+
+  /*
+    @brief Returns the index ranges of a level of detail: 0 is m_submeshes, level n is m_lods[n - 1].submeshes.
+    @param level Level of detail; values past the coarsest level return the coarsest.
+  */
+  const std::vector<MeshSubmesh>&
+    lodSubmeshes(size_t level) const;
+
+  /*
+    @brief Picks the coarsest level of detail whose error stays below a pixel budget on screen.
+    @param distance Distance from the camera to the mesh.
+    @param viewportHeight Height of the viewport in pixels.
+    @param fovY Vertical field of view in radians.
+    @param maxPixelError Largest error allowed on screen, in pixels.
+    @return Level to pass to lodSubmeshes.
+  */
+  size_t
+    selectLod(float distance, float viewportHeight, float fovY, float maxPixelError = 1.0f) const;
+
+  /*
+    @brief Splits m_vertex into a position stream and an attribute stream, both parallel to m_vertex.
+    @details A pass that needs only positions (depth prepass, shadow map) then reads 12 bytes per vertex instead
+             of 32. See Buffer::initVertexStreams.
+    @param positions Receives the positions.
+    @param attributes Receives the texture coordinates and normals.
+  */
+  void
+    splitVertexStreams(std::vector<XMFLOAT3>& positions, std::vector<VertexAttributes>& attributes) const;
+
+  /*
+    @brief Fills m_index16 with a 16-bit copy of m_index when every index range fits in 16 bits.
+    @details A mesh of at most 65536 vertices is copied as it is. A larger mesh still qualifies if every index
+             range (the submeshes of every level of detail, or the whole list without submeshes) references a
+             span of at most 65536 vertices: the range gets baseVertex = its smallest index and stores its
+             indices relative to it. The index buffer then takes half the memory and half the bandwidth.
+             Call it again after changing m_index or the ranges.
+    @return True if m_index16 was filled; false leaves it empty and every baseVertex at 0 (use 32-bit indices).
+  */
+  bool
+    buildIndex16();
+
+  /*
+    @brief Records that m_vertex[first, first + count) changed, so Buffer::updateDirtyRanges uploads only those
+           vertices. Call it after writing the vertices (m_color and m_tangent are not uploaded).
+    @details The range joins m_dirtyVertices, merged with every range that overlaps it or is less than mergeGap
+             vertices away, so marking vertices one by one still ends in a few large uploads.
+    @param first First changed vertex.
+    @param count Number of changed vertices.
+    @param mergeGap Largest gap, in vertices, bridged between two ranges.
+    @note The vertex count must not change; a resized mesh needs a new Buffer. Bounds and clusters are not updated.
+  */
+  void
+    markVerticesDirty(unsigned int first, unsigned int count, unsigned int mergeGap = kDirtyRangeMergeGap);
+
+  /*
+    @brief Records that m_index[first, first + count) changed; see markVerticesDirty.
+    @note The index ranges (submeshes) must not change. A mesh drawn with 16-bit indices also needs refreshIndex16.
+  */
+  void
+    markIndicesDirty(unsigned int first, unsigned int count, unsigned int mergeGap = kDirtyRangeMergeGap);
+
+  /*
+    @brief Returns true if some vertex or index range was marked since the last clearDirtyRanges.
+  */
+  bool
+    hasDirtyRanges() const;
+
+  /*
+    @brief Forgets the dirty ranges, once every buffer made from the mesh has uploaded them.
+  */
+  void
+    clearDirtyRanges();
+
+  /*
+    @brief Converts the dirty index ranges of m_index into m_index16, relative to the baseVertex of their range.
+    @return False if a changed index no longer fits in the 16 bits of its range; call buildIndex16 and create the
+            index buffer again. True if every index fits, or if the mesh has no 16-bit indices.
+  */
+  bool
+    refreshIndex16();
+
 public:
   /*
 		@brief The name of the mesh.
@@ -63,6 +279,33 @@ public:
   */
   std::vector<unsigned int> m_index;
 
+  /*
+    @brief m_index in 16 bits, each index relative to the baseVertex of its range, for a DXGI_FORMAT_R16_UINT
+           index buffer.
+    @note Empty unless buildIndex16 succeeded. Not stored in the .novamesh cache.
+  */
+  std::vector<unsigned short> m_index16;
+
+  /*
+    @brief Ranges of m_vertex and m_index changed since the last upload, sorted and disjoint (markVerticesDirty,
+           markIndicesDirty).
+  */
+  std::vector<MeshDirtyRange> m_dirtyVertices;
+  std::vector<MeshDirtyRange> m_dirtyIndices;
+
+  /*
+    @brief Optional per-vertex colors packed as RGBA8 (red in the low byte), parallel to m_vertex.
+    @note Empty unless the source file has colors (LoadPLY). Not stored in the .novamesh cache.
+  */
+  std::vector<unsigned int> m_color;
+
+  /*
+    @brief Optional per-vertex tangents, parallel to m_vertex: xyz is the unit tangent along +U and w the
+           bitangent sign (bitangent = cross(Normal, xyz) * w).
+    @note Empty unless the load asked for ModelLoadOptions::generateTangents.
+  */
+  std::vector<XMFLOAT4> m_tangent;
+
   /*
     @brief The number of vertices in the mesh.
 	*/
@@ -72,4 +315,42 @@ public:
 		@brief The number of indices in the mesh.
 	*/
   int m_numIndex;
+
+  /*
+    @brief Minimum corner of the axis-aligned bounding box of the vertex positions.
+  */
+  XMFLOAT3 m_boundsMin = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+  /*
+    @brief Maximum corner of the axis-aligned bounding box of the vertex positions.
+  */
+  XMFLOAT3 m_boundsMax = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+  /*
+    @brief Bounding sphere of the vertex positions; usually much tighter than the sphere around the box.
+  */
+  XMFLOAT3 m_boundsCenter = XMFLOAT3(0.0f, 0.0f, 0.0f);
+  float m_boundsRadius = 0.0f;
+
+  /*
+    @brief Index ranges drawn with one material each. They cover m_index without overlap.
+  */
+  std::vector<MeshSubmesh> m_submeshes;
+
+  /*
+    @brief Coarser levels of detail, finest first. They share m_vertex and store their indices after the
+           full-detail ranges in m_index. Empty unless generated (generateLods).
+  */
+  std::vector<MeshLod> m_lods;
+
+  /*
+    @brief Clusters of every level of detail, ordered by level, then submesh, then index offset; within a submesh
+           they cover its range without overlap. Empty unless generated (buildClusters).
+  */
+  std::vector<MeshCluster> m_clusters;
+
+  /*
+    @brief Materials referenced by MeshSubmesh::materialId.
+  */
+  std::vector<MeshMaterial> m_materials;
 };
\ No newline at end of file
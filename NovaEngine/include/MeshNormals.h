@@ -0,0 +1,36 @@
+#pragma once
+#include "Prerequisites.h"
+
+/*
+  @brief Smoothing group of faces that merge with their neighbours by crease angle alone.
+  @note Group 0 means flat shading ("s off" in OBJ files).
+*/
+const unsigned int kDefaultSmoothingGroup = 0xFFFFFFFFu;
+
+/*
+  @brief Computes a normal for every triangle corner of an indexed triangle list.
+  @details Each corner averages the normals of the triangles around its position, weighted by triangle area
+           times the corner angle, so long thin triangles and tessellation density do not bias the result.
+           A neighbour only contributes if it is in the same smoothing group and its face normal is within the
+           crease angle of the corner's own face. Corners in group 0 get their face normal. Triangles are
+           processed in parallel; every corner sums its neighbours in triangle order, so the result is
+           bit-identical for any thread count.
+  @param positions Position array.
+  @param positionCount Number of positions.
+  @param positionIndices Three position indices per triangle. Corners that share a position index are smoothed
+                         together, whatever their other attributes (e.g., UV seams do not split normals).
+  @param triangleCount Number of triangles.
+  @param smoothingGroups One group per triangle, or nullptr to put every triangle in kDefaultSmoothingGroup.
+  @param creaseAngleDegrees Largest angle between face normals that are still smoothed together.
+  @param threadCount Number of worker threads; 0 uses one per hardware thread.
+  @param cornerNormals Receives triangleCount * 3 unit normals, one per corner.
+*/
+void
+generateCornerNormals(const XMFLOAT3* positions,
+                      size_t positionCount,
+                      const unsigned int* positionIndices,
+                      size_t triangleCount,
+                      const unsigned int* smoothingGroups,
+                      float creaseAngleDegrees,
+                      unsigned int threadCount,
+                      XMFLOAT3* cornerNormals);
@@ -0,0 +1,218 @@
+#pragma once
+#include "Prerequisites.h"
+#include "MeshComponent.h"
+
+/*
+  @brief Vertex cache size the optimization passes target. Tipsify orders well for any real cache of at least this size.
+*/
+const unsigned int kDefaultVertexCacheSize = 16;
+
+/*
+  @struct VertexCacheStats
+  @brief Post-transform vertex cache efficiency of an index buffer, simulated as a FIFO cache.
+*/
+struct VertexCacheStats {
+  /*
+    @brief Average cache miss ratio: vertices transformed per triangle. 3 is the worst case; about 0.5 is the
+           practical lower bound for large regular meshes.
+  */
+  float acmr = 0.0f;
+
+  /*
+    @brief Average transform to vertex ratio: vertices transformed per referenced vertex. 1 is ideal.
+  */
+  float atvr = 0.0f;
+};
+
+/*
+  @struct OverdrawStats
+  @brief Overdraw of a triangle order, measured by rasterizing the mesh from several directions.
+*/
+struct OverdrawStats {
+  /*
+    @brief Pixels that passed the depth test (were shaded) across all views.
+  */
+  unsigned long long pixelsShaded = 0;
+
+  /*
+    @brief Pixels covered by the mesh across all views.
+  */
+  unsigned long long pixelsCovered = 0;
+
+  /*
+    @brief pixelsShaded / pixelsCovered. 1 means every covered pixel was shaded once.
+  */
+  float overdraw = 0.0f;
+};
+
+/*
+  @struct VertexFetchStats
+  @brief Vertex memory traffic of an index buffer, simulated as 64-byte cache lines in a direct-mapped cache.
+*/
+struct VertexFetchStats {
+  /*
+    @brief Bytes read from the vertex buffer, counted in whole cache lines.
+  */
+  unsigned long long bytesFetched = 0;
+
+  /*
+    @brief bytesFetched / (referenced vertices * vertex size). 1 means every referenced vertex was read once;
+           scattered fetches read lines again after they were evicted, or lines that hold unused vertices.
+  */
+  float overfetch = 0.0f;
+};
+
+/*
+  @brief Renumbers the vertices of an index range to 0..n-1 in order of first use.
+  @details Uses a hash table sized for the range, so the cost does not depend on the size of the whole vertex
+           buffer; the per-submesh passes run on these compact ranges.
+  @param indices Index range.
+  @param indexCount Number of indices.
+  @param localIndices Receives the renumbered indices.
+  @param globalIds Receives the original index of every local vertex.
+*/
+void
+compactVertices(const unsigned int* indices,
+                size_t indexCount,
+                std::vector<unsigned int>& localIndices,
+                std::vector<unsigned int>& globalIds);
+
+/*
+  @brief Simulates a FIFO post-transform cache over a triangle list.
+  @param indices Triangle list.
+  @param indexCount Number of indices (a multiple of 3).
+  @param vertexCount Number of vertices the indices refer to.
+  @param cacheSize Number of entries of the simulated cache.
+*/
+VertexCacheStats
+analyzeVertexCache(const unsigned int* indices,
+                   size_t indexCount,
+                   size_t vertexCount,
+                   unsigned int cacheSize = kDefaultVertexCacheSize);
+
+/*
+  @brief Reorders the triangles of a triangle list for post-transform vertex cache locality.
+  @details Tipsify (Sander, Nehab and Barczak 2007): triangles are emitted in fans around a current vertex; the next
+           fan vertex is the one cached longest among those just touched that will still be in the cache after its
+           remaining triangles are emitted (any vertex with triangles left when none will), with a dead-end stack
+           when none has triangles left. Runs in linear time.
+           Vertex order and triangle winding are preserved.
+  @param indices Triangle list, reordered in place.
+  @param indexCount Number of indices (a multiple of 3).
+  @param vertexCount Number of vertices the indices refer to.
+  @param cacheSize Size of the cache to optimize for.
+*/
+void
+optimizeVertexCache(unsigned int* indices,
+                    size_t indexCount,
+                    size_t vertexCount,
+                    unsigned int cacheSize = kDefaultVertexCacheSize);
+
+/*
+  @brief Reorders the triangles of every submesh of a mesh for vertex cache locality (see the overload above).
+  @details Triangles never move between submeshes; the submeshes of every level of detail in m_lods are
+           reordered too. Each submesh is optimized over its own compact vertex range, so the cost is linear in
+           the index count however many submeshes there are; submeshes are processed in parallel.
+           Clusters (m_clusters) no longer match the new order and are dropped.
+  @param mesh The mesh whose m_index is reordered.
+  @param threadCount Number of worker threads; 0 uses one per hardware thread.
+  @param cacheSize Size of the cache to optimize for.
+*/
+void
+optimizeVertexCache(MeshComponent& mesh,
+                    unsigned int threadCount = 0,
+                    unsigned int cacheSize = kDefaultVertexCacheSize);
+
+/*
+  @brief Estimates the overdraw of a triangle order on the CPU.
+  @details The triangles are rasterized in index order with a depth test and back-face culling (counter-clockwise
+           front faces, as in the source files) into a square depth buffer, once from each side along X, Y and Z with
+           an orthographic view of the mesh bounds. The six views run in parallel.
+  @param indices Triangle list.
+  @param indexCount Number of indices (a multiple of 3).
+  @param vertices Vertex array the indices refer to.
+  @param vertexCount Number of vertices.
+  @param resolution Width and height of each view in pixels.
+  @param threadCount Number of worker threads; 0 uses one per hardware thread.
+*/
+OverdrawStats
+analyzeOverdraw(const unsigned int* indices,
+                size_t indexCount,
+                const SimpleVertex* vertices,
+                size_t vertexCount,
+                unsigned int resolution = 256,
+                unsigned int threadCount = 0);
+
+/*
+  @brief Reorders a vertex cache optimized triangle list to reduce overdraw, keeping most of its cache efficiency.
+  @details Follows the second half of Tipsify: the list is cut into clusters where the simulated cache starts over
+           (a triangle whose three vertices all miss), and clusters are cut further wherever the ACMR of the
+           cluster so far is within threshold times the ACMR of the whole cluster. Clusters are then sorted by how
+           far they face outward from the mesh centroid (dot of centroid offset and average normal), so the
+           outer surface is drawn first and hides the inner parts. Each cluster starts with a cold cache, so the
+           ACMR grows by at most about the threshold factor.
+  @param indices Triangle list, reordered in place; it should come from optimizeVertexCache.
+  @param indexCount Number of indices (a multiple of 3).
+  @param vertices Vertex array the indices refer to.
+  @param vertexCount Number of vertices.
+  @param threshold ACMR budget relative to the input order (e.g., 1.05 allows 5% more vertex transforms).
+                   Larger values give smaller clusters and better sorting.
+  @param cacheSize Size of the simulated cache.
+*/
+void
+optimizeOverdraw(unsigned int* indices,
+                 size_t indexCount,
+                 const SimpleVertex* vertices,
+                 size_t vertexCount,
+                 float threshold = 1.05f,
+                 unsigned int cacheSize = kDefaultVertexCacheSize);
+
+/*
+  @brief Reorders the triangles of every submesh of a mesh to reduce overdraw (see the overload above).
+  @details Submeshes, including those of the levels of detail, are processed in parallel; triangles never move
+           between submeshes. Clusters (m_clusters) are dropped.
+  @param mesh The mesh whose m_index is reordered; it should already be in vertex cache order.
+  @param threshold ACMR budget relative to the vertex cache optimized order.
+  @param threadCount Number of worker threads; 0 uses one per hardware thread.
+*/
+void
+optimizeOverdraw(MeshComponent& mesh,
+                 float threshold = 1.05f,
+                 unsigned int threadCount = 0);
+
+/*
+  @brief Simulates the vertex fetches of a triangle list through a 128 KB direct-mapped cache of 64-byte lines.
+  @param indices Triangle list.
+  @param indexCount Number of indices.
+  @param vertexCount Number of vertices the indices refer to.
+  @param vertexSize Stride of the vertex buffer in bytes.
+*/
+VertexFetchStats
+analyzeVertexFetch(const unsigned int* indices,
+                   size_t indexCount,
+                   size_t vertexCount,
+                   size_t vertexSize);
+
+/*
+  @brief Simulates the vertex fetches of a mesh as it is drawn: every submesh of every level of detail (or the whole
+         index buffer of a mesh without submeshes) is one draw call that starts with a cold cache.
+  @param mesh The mesh.
+  @param vertexSize Stride of the vertex buffer in bytes (sizeof(XMFLOAT3) for the position stream alone).
+  @return The fetches of all ranges added up; overfetch divides them by the vertices each range references.
+*/
+VertexFetchStats
+analyzeVertexFetch(const MeshComponent& mesh, size_t vertexSize = sizeof(SimpleVertex));
+
+/*
+  @brief Renumbers the vertices of a mesh in the order its draw ranges first reference them and drops the vertices
+         no index references.
+  @details First use is taken per submesh, level 0 first, then the coarser levels. The new order is kept only if it
+           fetches less than the current one by the per-range measure of analyzeVertexFetch; otherwise the vertices
+           keep their order and only the unused ones are dropped. m_vertex, m_color and m_tangent are reordered
+           together and m_index is rewritten. Run it after the index order is final (optimizeVertexCache,
+           optimizeOverdraw); the triangles drawn do not change.
+  @param mesh The mesh to remap. A mesh without indices (a point cloud) is left as it is.
+  @return Number of unreferenced vertices removed.
+*/
+size_t
+optimizeVertexFetch(MeshComponent& mesh);
@@ -0,0 +1,110 @@
+#pragma once
+#include "Prerequisites.h"
+#include "MeshComponent.h"
+
+/*
+  @brief Vertex layouts a mesh can be uploaded with.
+  @details VERTEX_FORMAT_FLOAT is SimpleVertex (32 bytes). The packed formats are PackedVertex (16 bytes): octahedral
+           SNORM16 normals, UNORM16 texture coordinates over their bounds and positions over the mesh bounds, either
+           UNORM16 (uniform error across the bounds) or half floats around the center (finer near the center).
+*/
+enum VertexFormat {
+  VERTEX_FORMAT_FLOAT = 0,
+  VERTEX_FORMAT_UNORM16 = 1,
+  VERTEX_FORMAT_HALF = 2
+};
+
+/*
+  @brief How the vertex data is spread over input slots.
+  @details VERTEX_STREAMS_SPLIT puts positions in slot 0 and texture coordinates and normals (VertexAttributes) in
+           slot 1, as Buffer::initVertexStreams uploads them; VERTEX_STREAMS_POSITION describes slot 0 alone for
+           depth-only passes. Both are available for VERTEX_FORMAT_FLOAT only.
+*/
+enum VertexStreams {
+  VERTEX_STREAMS_INTERLEAVED = 0,
+  VERTEX_STREAMS_SPLIT = 1,
+  VERTEX_STREAMS_POSITION = 2
+};
+
+/*
+  @struct VertexQuantizationStats
+  @brief Memory saved by a packed vertex buffer and the error it introduces, measured by decoding every vertex.
+*/
+struct VertexQuantizationStats {
+  /*
+    @brief Size of the vertices as SimpleVertex and in the chosen format, in bytes.
+  */
+  size_t sourceBytes = 0;
+  size_t packedBytes = 0;
+
+  /*
+    @brief Largest and root mean square distance between a decoded and an original position, in object units.
+  */
+  float maxPositionError = 0.0f;
+  float rmsPositionError = 0.0f;
+
+  /*
+    @brief Largest and mean angle between a decoded and an original normal, in degrees.
+  */
+  float maxNormalError = 0.0f;
+  float meanNormalError = 0.0f;
+
+  /*
+    @brief Largest difference of a decoded texture coordinate, in UV units.
+  */
+  float maxTexcoordError = 0.0f;
+};
+
+/*
+  @brief Size in bytes of one vertex in the given format.
+*/
+unsigned int
+vertexStride(VertexFormat format);
+
+/*
+  @brief Builds the input layout of a vertex format for InputLayout::init.
+  @details The formats use POSITION, TEXCOORD and NORMAL, interleaved in slot 0 or split over slots 0 and 1, so
+           the same vertex shader reads either; VERTEX_STREAMS_POSITION has POSITION only and needs a vertex shader
+           that reads nothing else. For the packed formats the vertex shader has to restore the values:
+             float3 pos = input.Pos.xyz * vPositionScale.xyz + vPositionOffset.xyz;
+             float2 tex = input.Tex * vTexcoordScaleOffset.xy + vTexcoordScaleOffset.zw;
+             float3 n = float3(input.Normal, 1.0f - abs(input.Normal.x) - abs(input.Normal.y));
+             if (n.z < 0.0f) n.xy = (1.0f - abs(n.yx)) * (n.xy >= 0.0f ? 1.0f : -1.0f);
+             n = normalize(n);
+  @param format The vertex format.
+  @param streams How the vertices are spread over input slots.
+  @return The input element descriptions; empty for split streams of a packed format.
+*/
+std::vector<D3D11_INPUT_ELEMENT_DESC>
+vertexInputLayout(VertexFormat format, VertexStreams streams = VERTEX_STREAMS_INTERLEAVED);
+
+/*
+  @brief Packs the vertices of a mesh into a quantized vertex format.
+  @details Positions and texture coordinates are mapped over their bounds, so the error scales with the size of
+           the mesh rather than its distance from the origin. Four vertices are encoded at a time with SSE2 and
+           the result is bit-identical to the scalar path and independent of the thread count.
+  @param mesh The mesh; m_vertex is read, m_index is not needed.
+  @param format VERTEX_FORMAT_UNORM16 or VERTEX_FORMAT_HALF. VERTEX_FORMAT_FLOAT leaves outVertices empty and
+                returns identity constants, since m_vertex can be uploaded as it is.
+  @param outVertices Receives one PackedVertex per vertex of m_vertex, in the same order.
+  @param outConstants Receives the dequantization constants of the buffer.
+  @param outStats Optional; receives the memory saved and the error, measured by decoding every vertex.
+  @param threadCount Number of worker threads; 0 uses one per hardware thread.
+*/
+void
+quantizeVertices(const MeshComponent& mesh,
+                 VertexFormat format,
+                 std::vector<PackedVertex>& outVertices,
+                 CBVertexDequantization& outConstants,
+                 VertexQuantizationStats* outStats = nullptr,
+                 unsigned int threadCount = 0);
+
+/*
+  @brief Decodes a packed vertex the way the vertex shader does (see vertexInputLayout).
+  @param vertex The packed vertex.
+  @param constants Dequantization constants of its buffer.
+  @param format Format the vertex was packed with.
+  @return The decoded vertex, with a unit length normal.
+*/
+SimpleVertex
+dequantizeVertex(const PackedVertex& vertex, const CBVertexDequantization& constants, VertexFormat format);
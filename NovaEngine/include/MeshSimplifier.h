@@ -0,0 +1,77 @@
+#pragma once
+#include "Prerequisites.h"
+#include "MeshComponent.h"
+
+/*
+  @brief Fraction of the triangles of the previous level that each generated level of detail keeps.
+*/
+const float kDefaultLodRatio = 0.5f;
+
+/*
+  @brief Largest error a generated level of detail may reach, as a fraction of the largest side of the mesh bounds.
+*/
+const float kDefaultLodError = 0.01f;
+
+/*
+  @brief Simplifies a triangle list with quadric error metrics (Garland and Heckbert 1997).
+  @details Every step collapses an edge onto one of its existing vertices (a half-edge collapse), so the result
+           indexes the same vertex array and no vertex is created or moved. Each vertex carries the sum of the
+           area-weighted plane quadrics of its faces, plus planes through open edges that keep borders in place.
+           Collapses are taken cheapest first in passes over the whole list, and a collapse that would flip a
+           triangle is skipped.
+           Vertices that share a position but not their attributes (UV or normal seams) only collapse in pairs
+           along the seam, so the seam stays closed; where three or more of them meet, the vertex is locked.
+           Border vertices only move along the border.
+  @param destination Receives the simplified triangle list; it must hold indexCount indices and may equal indices.
+  @param indices Triangle list.
+  @param indexCount Number of indices (a multiple of 3).
+  @param vertices Vertex array the indices refer to.
+  @param vertexCount Number of vertices.
+  @param targetIndexCount Simplification stops once the list has at most this many indices.
+  @param targetError Simplification also stops before a collapse would exceed this error, as a fraction of the
+                     largest side of the bounds of the referenced vertices (e.g., 0.01 is 1%).
+  @param resultError Receives the error of the result in the same units; may be nullptr.
+  @return Number of indices written to destination.
+*/
+size_t
+simplifyMesh(unsigned int* destination,
+             const unsigned int* indices,
+             size_t indexCount,
+             const SimpleVertex* vertices,
+             size_t vertexCount,
+             size_t targetIndexCount,
+             float targetError = kDefaultLodError,
+             float* resultError = nullptr);
+
+/*
+  @brief Generates coarser levels of detail for a mesh into MeshComponent::m_lods.
+  @details Level n targets ratio^n of the full-detail triangles, all within maxError. Every level is simplified
+           from the full-detail submeshes at once, so a vertex shared by two submeshes is locked in place and the
+           parts cannot crack apart. The levels share m_vertex; their indices are appended after the full-detail
+           ranges of m_index. Levels are simplified in parallel. A level that removes less than a tenth of the
+           triangles of the previous one (because maxError was reached) ends the chain.
+  @param mesh The mesh. Existing levels and clusters are dropped. A mesh without submeshes gets one covering m_index first.
+  @param levelCount Number of coarser levels to try.
+  @param ratio Fraction of the triangles each level keeps of the previous one.
+  @param maxError Error bound of every level (see simplifyMesh).
+  @param threadCount Number of worker threads; 0 uses one per hardware thread.
+  @return Number of levels generated.
+*/
+size_t
+generateLods(MeshComponent& mesh,
+             unsigned int levelCount,
+             float ratio = kDefaultLodRatio,
+             float maxError = kDefaultLodError,
+             unsigned int threadCount = 0);
+
+/*
+  @brief Generates levels of detail for several meshes (see the overload above).
+  @details Every level of every mesh is an independent task, so many small meshes use all threads as well as
+           one large mesh with several levels does.
+*/
+void
+generateLods(const std::vector<MeshComponent*>& meshes,
+             unsigned int levelCount,
+             float ratio = kDefaultLodRatio,
+             float maxError = kDefaultLodError,
+             unsigned int threadCount = 0);
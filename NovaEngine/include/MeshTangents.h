@@ -0,0 +1,22 @@
+#pragma once
+#include "Prerequisites.h"
+#include "MeshComponent.h"
+
+/*
+  @brief Fills mesh.m_tangent with a MikkTSpace-style tangent frame for every vertex.
+  @details Follows the MikkTSpace construction: per triangle, the direction of increasing U is taken from the
+           positions and texture coordinates, projected into the tangent plane of each corner's vertex normal and
+           weighted by the corner angle measured in that plane. The sums are normalized per vertex. A vertex used by
+           triangles with mirrored texture mapping on both sides gets one copy per orientation, so w is constant
+           across each vertex. Triangles whose texture area is zero contribute nothing and join either
+           orientation. Triangles are processed in parallel and every vertex sums its corners in triangle order,
+           so the result is bit-identical for any thread count.
+  @param mesh Indexed triangle list with normals and texture coordinates. Vertices are appended (and m_color
+              entries copied with them) when a vertex is split; m_index is updated in place.
+  @param threadCount Number of worker threads; 0 uses one per hardware thread.
+  @return Number of vertices added by splitting.
+  @note Texture coordinates are used as stored (V down, as in Direct3D). The bitangent is
+        cross(normal, tangent.xyz) * tangent.w.
+*/
+size_t
+generateTangents(MeshComponent& mesh, unsigned int threadCount);
@@ -0,0 +1,116 @@
+#pragma once
+#include "Prerequisites.h"
+#include "ModelLoader.h"
+
+enum ModelLoadState {
+  LOAD_RUNNING = 0,
+  LOAD_READY = 1,
+  LOAD_FAILED = 2,
+  LOAD_CANCELLED = 3
+};
+
+/*
+  @class ModelLoadTask
+  @brief A model load running on a worker thread, polled from the thread that owns the GPU resources.
+  @note The worker parses the file (itself using the loader's parse threads) and keeps the result until
+        takeMesh() is called. Destroying the task cancels the load and waits for the worker to exit.
+*/
+class
+  ModelLoadTask {
+public:
+  /*
+    @brief Default constructor
+  */
+  ModelLoadTask() = default;
+
+  /*
+    @brief Destructor. Cancels a running load and joins the worker.
+  */
+  ~ModelLoadTask() { destroy(); }
+
+  ModelLoadTask(const ModelLoadTask&) = delete;
+  ModelLoadTask& operator=(const ModelLoadTask&) = delete;
+
+  /*
+    @brief Starts the worker thread.
+    @param filename  Path to the .obj file without extension.
+    @param options   Import options passed to ModelLoader::LoadOBJ.
+    @return HRESULT indicating success or failure of starting the worker.
+  */
+  HRESULT
+    init(const std::string& filename, const ModelLoadOptions& options);
+
+  /*
+    @brief Returns the path passed to init. Set before the worker starts and never written by it.
+  */
+  const std::string&
+    filename() const { return m_filename; }
+
+  /*
+    @brief Returns the current state of the load.
+  */
+  ModelLoadState
+    state() const { return static_cast<ModelLoadState>(m_state.load(std::memory_order_acquire)); }
+
+  /*
+    @brief Returns true once the load has finished, failed or been cancelled.
+  */
+  bool
+    isDone() const { return state() != LOAD_RUNNING; }
+
+  /*
+    @brief Returns the fraction of the source file parsed so far, from 0 to 1.
+  */
+  float
+    progress() const;
+
+  /*
+    @brief Returns the source bytes parsed so far.
+  */
+  unsigned long long
+    bytesDone() const { return m_progress.bytesDone.load(std::memory_order_relaxed); }
+
+  /*
+    @brief Returns the size of the source file, or 0 until it has been opened.
+  */
+  unsigned long long
+    bytesTotal() const { return m_progress.bytesTotal.load(std::memory_order_relaxed); }
+
+  /*
+    @brief Asks the worker to stop. The task ends in LOAD_CANCELLED unless it had already finished.
+  */
+  void
+    cancel() { m_progress.cancel.store(true, std::memory_order_relaxed); }
+
+  /*
+    @brief Blocks until the worker has exited.
+  */
+  void
+    wait();
+
+  /*
+    @brief Moves the loaded mesh out of the task.
+    @details Joins the worker first, so the mesh is read only after the thread that wrote it has exited.
+    @param outMesh The mesh to fill.
+    @return @c true if the task was LOAD_READY and still held the mesh.
+  */
+  bool
+    takeMesh(MeshComponent& outMesh);
+
+  /*
+    @brief Cancels the load if it is running and joins the worker.
+  */
+  void
+    destroy();
+
+private:
+  // The worker writes m_loader, m_mesh and m_state; the owning thread reads the
+  // mesh only through takeMesh, after the join.
+  std::string m_filename;
+  ModelLoader m_loader;
+  MeshComponent m_mesh;
+  ModelLoadProgress m_progress;
+  std::atomic<int> m_state{ LOAD_RUNNING };
+  std::thread m_thread;
+  bool m_meshTaken = false;
+};
@@ -1,9 +1,308 @@
 #pragma once
 #include "MeshComponent.h"
+#include "MeshCache.h"
+#include "MeshCleanup.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshClusters.h"
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <map>
+#include <functional>
+#include <atomic>
+#include <memory>
+
+class ModelLoadTask;
+
+/*
+  @struct ModelLoadStats
+  @brief Timing figures of the last model load.
+*/
+struct ModelLoadStats {
+  /*
+    @brief Size of the source file in bytes.
+  */
+  unsigned long long bytes = 0;
+
+  /*
+    @brief Wall-clock time spent in the loader, in seconds.
+  */
+  double seconds = 0.0;
+
+  /*
+    @brief True if the mesh came from a .novamesh cache instead of being parsed.
+  */
+  bool fromCache = false;
+
+  /*
+    @brief High-water mark of the memory the loader itself held, in bytes: working buffers plus the mapped
+           part of the source file. It excludes the mesh handed to the caller by StreamOBJ.
+  */
+  unsigned long long peakBytes = 0;
+
+  /*
+    @brief Bytes written to temporary spill files (StreamOBJ only).
+  */
+  unsigned long long spilledBytes = 0;
+
+  /*
+    @brief Vertices before welding (LoadSTL only: three per triangle). Divided by the final vertex count
+           it gives the weld ratio.
+  */
+  unsigned long long inputVertices = 0;
+
+  /*
+    @brief Number of meshes emitted (StreamOBJ) or parse chunks used (LoadOBJ).
+  */
+  size_t chunks = 0;
+
+  /*
+    @brief glTF vertex ranges that were block-copied because their layout already matched SimpleVertex (LoadGLTF only).
+  */
+  size_t directCopies = 0;
+
+  /*
+    @brief Vertices added because generated normals differ across the faces sharing them (LoadOBJ only).
+  */
+  size_t normalSplits = 0;
+
+  /*
+    @brief Vertices added because mirrored texture mapping needs two tangent frames at them.
+  */
+  size_t tangentSplits = 0;
+
+  /*
+    @brief Vertices welded and triangles removed by ModelLoadOptions::cleanupMesh.
+  */
+  MeshCleanupStats cleanup;
+
+  /*
+    @brief Part of seconds spent in the cleanup pass.
+  */
+  double cleanupSeconds = 0.0;
+
+  /*
+    @brief Part of seconds spent generating tangents.
+  */
+  double tangentSeconds = 0.0;
+
+  /*
+    @brief Part of seconds spent generating levels of detail.
+  */
+  double lodSeconds = 0.0;
+
+  /*
+    @brief Part of seconds spent building clusters.
+  */
+  double clusterSeconds = 0.0;
+
+  /*
+    @brief Simulated vertex cache efficiency before and after ModelLoadOptions::optimizeVertexCache
+           (and optimizeOverdraw, which runs after it).
+  */
+  VertexCacheStats vertexCacheBefore;
+  VertexCacheStats vertexCacheAfter;
+
+  /*
+    @brief Simulated vertex fetch traffic of the draw ranges before and after ModelLoadOptions::optimizeVertexFetch.
+  */
+  VertexFetchStats vertexFetchBefore;
+  VertexFetchStats vertexFetchAfter;
+
+  /*
+    @brief Vertices no index referenced, removed by ModelLoadOptions::optimizeVertexFetch.
+  */
+  size_t unusedVertices = 0;
+
+  /*
+    @brief Parse throughput in megabytes per second.
+  */
+  double
+    megabytesPerSecond() const {
+    return seconds > 0.0 ? (static_cast<double>(bytes) / (1024.0 * 1024.0)) / seconds : 0.0;
+  }
+};
+
+/*
+  @struct ModelLoadProgress
+  @brief Progress and cancellation state shared between a load and the thread watching it.
+*/
+struct ModelLoadProgress {
+  /*
+    @brief Source bytes parsed so far.
+  */
+  std::atomic<unsigned long long> bytesDone{ 0 };
+
+  /*
+    @brief Size of the source file, set once it is opened.
+  */
+  std::atomic<unsigned long long> bytesTotal{ 0 };
+
+  /*
+    @brief Raised by the watching thread to stop the load early.
+  */
+  std::atomic<bool> cancel{ false };
+};
+
+/*
+  @struct ModelWeldOptions
+  @brief How LoadSTL turns its triangle soup into an indexed mesh (ModelLoadOptions::weldOptions).
+*/
+struct ModelWeldOptions {
+  /*
+    @brief Largest distance between positions that are merged into one vertex, in model units.
+    @note 0 merges bit-identical positions only, which is enough for most CAD exports.
+  */
+  float tolerance = 0.0f;
+
+  /*
+    @brief True to share vertices across faces and average their normals (weighted by face area).
+           False keeps faceted shading: vertices only merge with neighbours of nearly the same face normal.
+  */
+  bool smoothNormals = true;
+};
+
+/*
+  @struct ModelLoadOptions
+  @brief Options that control how a model is imported.
+*/
+struct ModelLoadOptions {
+  /*
+    @brief Number of worker threads used to parse the file; 0 uses one per hardware thread.
+    @note The resulting mesh is bit-identical for every thread count.
+  */
+  unsigned int threadCount = 0;
+
+  /*
+    @brief Reads and writes the binary .novamesh cache next to the source file.
+    @note The cache is rebuilt automatically when the source file content changes.
+  */
+  bool useCache = true;
+
+  /*
+    @brief Stores the vertices, indices and tangents of the cache compressed (see MeshCodec.h).
+    @note Compressed and raw caches both load, so changing this does not invalidate an existing cache.
+  */
+  bool compressCache = true;
+
+  /*
+    @brief Optional progress and cancellation state; LoadOBJ updates it about once per megabyte parsed.
+    @note A cancelled load returns false and leaves the mesh empty.
+  */
+  ModelLoadProgress* progress = nullptr;
+
+  /*
+    @brief Generates normals for face corners that have no vn record, weighted by face area and corner angle.
+    @note Smoothing groups (s records) are honoured; "s off" gives flat shading. StreamOBJ does not generate
+          normals and keeps (0, 1, 0).
+  */
+  bool generateNormals = true;
+
+  /*
+    @brief Faces of one smoothing group whose normals differ by more than this angle (in degrees) keep a hard edge.
+  */
+  float normalCreaseAngle = 60.0f;
+
+  /*
+    @brief Welds vertices within cleanupOptions' tolerances and removes degenerate and duplicate triangles
+           (cleanupMesh). Runs before the other passes.
+    @note The vertex and index counts before and after are reported and kept in ModelLoadStats.
+  */
+  bool cleanupMesh = false;
+
+  /*
+    @brief Tolerances of the cleanup pass.
+  */
+  MeshCleanupOptions cleanupOptions;
+
+  /*
+    @brief Weld tolerance and normal mode of LoadSTL; the other loaders ignore it.
+  */
+  ModelWeldOptions weldOptions;
+
+  /*
+    @brief Generates MeshComponent::m_tangent after the load (see generateTangents).
+    @note Vertices whose faces mirror the texture mapping are split, so the vertex count can grow.
+  */
+  bool generateTangents = false;
+
+  /*
+    @brief Reorders the triangles of every submesh for the post-transform vertex cache (optimizeVertexCache).
+    @note ACMR and ATVR before and after are reported and kept in ModelLoadStats.
+  */
+  bool optimizeVertexCache = false;
+
+  /*
+    @brief After the vertex cache order, sorts clusters of triangles so outward-facing ones are drawn first
+           (optimizeOverdraw). Implies optimizeVertexCache.
+  */
+  bool optimizeOverdraw = false;
+
+  /*
+    @brief ACMR budget of optimizeOverdraw relative to the vertex cache order (1.05 allows 5% more transforms).
+  */
+  float overdrawThreshold = 1.05f;
+
+  /*
+    @brief Number of coarser levels of detail to generate into MeshComponent::m_lods (generateLods); 0 for none.
+    @note Levels are generated before the reordering passes, which then optimize every level.
+  */
+  unsigned int lodCount = 0;
+
+  /*
+    @brief Fraction of the triangles each level of detail keeps of the previous one.
+  */
+  float lodRatio = kDefaultLodRatio;
+
+  /*
+    @brief Largest error of a level of detail, as a fraction of the largest side of the mesh bounds.
+  */
+  float lodMaxError = kDefaultLodError;
+
+  /*
+    @brief Renumbers the vertices in the order the final index buffer first uses them and drops unreferenced ones
+           (optimizeVertexFetch). Runs after the triangle reordering passes.
+    @note Overfetch before and after is reported and kept in ModelLoadStats.
+  */
+  bool optimizeVertexFetch = false;
+
+  /*
+    @brief Partitions every submesh into clusters with culling bounds (buildClusters, MeshComponent::m_clusters).
+    @note Runs after the vertex cache and overdraw passes; it reorders the triangles of each submesh cluster by
+          cluster, which takes the place of the overdraw order.
+  */
+  bool buildClusters = false;
+
+  /*
+    @brief Vertex and triangle limits of a cluster.
+  */
+  unsigned int clusterMaxVertices = kClusterMaxVertices;
+  unsigned int clusterMaxTriangles = kClusterMaxTriangles;
+};
+
+/*
+  @struct ModelStreamOptions
+  @brief Options of the out-of-core StreamOBJ import.
+*/
+struct ModelStreamOptions {
+  /*
+    @brief Ceiling in bytes for the memory the importer holds at once (see ModelLoadStats::peakBytes).
+    @note Values below 16 MB are raised to 16 MB.
+  */
+  size_t memoryBudget = 256u << 20;
+
+  /*
+    @brief Folder for the temporary spill files; empty uses the system temporary folder.
+  */
+  std::string tempDirectory;
+};
+
+/*
+  @brief Receives one emitted piece of a streamed model. The callback may move the data out of the mesh.
+  @return @c false to stop the import.
+*/
+typedef std::function<bool(MeshComponent& chunk)> MeshChunkCallback;
 
 /*
   @class ModelLoader
@@ -16,7 +315,7 @@ public:
     @brief Default constructor
 	*/
   ModelLoader() = default;
-  
+
   /*
     @brief Destructor
 	*/
@@ -27,10 +326,135 @@ public:
     This function parses the vertex positions (v), texture coordinates (vt),
     normals (vn), and faces (f). It handles quad triangulation
     and correct vertex indexing for D3D11.
+    The file is memory-mapped and split at line boundaries into one chunk per
+    worker. Chunks are counted, parsed and deduplicated in parallel, then merged
+    in file order so the mesh does not depend on the thread count.
+    Materials come from the mtllib libraries (paths relative to the .obj). Faces
+    are grouped by their usemtl material into contiguous index ranges, one
+    MeshSubmesh per material in order of first use, so the whole model is drawn
+    from a single vertex and index buffer with one DrawIndexed per material.
+    Groups (o/g) do not split the mesh.
+    When caching is enabled the parsed mesh is stored in "<filename>.novamesh";
+    later loads of an unchanged file map that cache instead of parsing.
     @param filename  Path to the .obj file (e.g., "Models/car.obj").
     @param outMesh   The MeshComponent instance to be filled with the data.
+    @param options   Import options (thread count, cache, normal and tangent generation).
     @return @c true if the loading was successful, @c false on error (e.g., file not found).
   */
   bool
-    LoadOBJ(const std::string& filename, MeshComponent& outMesh);
-};
\ No newline at end of file
+    LoadOBJ(const std::string& filename,
+      MeshComponent& outMesh,
+      const ModelLoadOptions& options = ModelLoadOptions());
+
+  /*
+    @brief Starts loading a .obj model file on a worker thread.
+    @details The returned task runs LoadOBJ with its own loader, so this loader stays free. Poll the task from the
+             owning thread and create GPU resources there once it reports LOAD_READY.
+    @param filename  Path to the .obj file without extension.
+    @param options   Import options; the progress member is replaced by the task's own.
+    @return The running task, or nullptr if the worker could not be started.
+  */
+  std::shared_ptr<ModelLoadTask>
+    LoadOBJAsync(const std::string& filename,
+      const ModelLoadOptions& options = ModelLoadOptions());
+
+  /*
+    @brief Imports a .obj model file without holding it in memory, for files too large for LoadOBJ.
+    @details The file is read through a sliding mapped window. Positions, texture coordinates and normals are
+             appended to temporary spill files and read back through a bounded page cache when faces reference
+             them. Faces are deduplicated into a chunk mesh that is handed to onChunk whenever its buffers reach
+             their share of the memory budget; every chunk is self-contained (its own vertices, indices from 0,
+             submeshes per material and the materials known so far). Vertices shared across a chunk boundary
+             are repeated in both chunks. The .novamesh cache is not used.
+    @param filename  Path to the .obj file without extension.
+    @param options   Memory budget and spill folder.
+    @param onChunk   Called once per emitted chunk, in file order.
+    @return @c true if the whole file was imported, @c false on error or if onChunk stopped the import.
+  */
+  bool
+    StreamOBJ(const std::string& filename,
+      const ModelStreamOptions& options,
+      const MeshChunkCallback& onChunk);
+
+  /*
+    @brief Loads a glTF 2.0 model from a .gltf or .glb file.
+    @details Accessors are resolved straight into the memory-mapped GLB binary chunk or external .bin files; only
+             base64 data: buffers are decoded. A primitive whose position, texture coordinate and normal accessors
+             are interleaved floats at the SimpleVertex offsets with a 32-byte stride is copied as one block;
+             other layouts are gathered per stream. Every triangle primitive of the default scene becomes one
+             submesh with the node transform applied. Texture coordinates are kept as stored (glTF has V down).
+             The .novamesh cache is not used.
+    @param filename  Path to the .gltf or .glb file, with extension.
+    @param outMesh   The MeshComponent instance to be filled with the data.
+    @param options   Import options (thread count, progress, tangent generation).
+    @return @c true if the loading was successful, @c false on error.
+  */
+  bool
+    LoadGLTF(const std::string& filename,
+      MeshComponent& outMesh,
+      const ModelLoadOptions& options = ModelLoadOptions());
+
+  /*
+    @brief Loads a binary .ply model file (little or big endian), with or without faces.
+    @details The file is memory-mapped and vertex records are copied in parallel blocks. x/y/z, nx/ny/nz and u/v
+             (or s/t, texture_u/texture_v) map onto SimpleVertex; red/green/blue/alpha go to m_color. When the
+             positions, normals and texture coordinates are little-endian float runs each record is a few block
+             copies, otherwise every component is converted. Triangle-only face lists with a uchar count are copied
+             in parallel; other polygons are fan-triangulated. A file without faces loads as a point cloud with
+             no indices or submeshes. The .novamesh cache is not used.
+    @param filename  Path to the .ply file without extension.
+    @param outMesh   The MeshComponent instance to be filled with the data.
+    @param options   Import options (thread count, progress, tangent generation).
+    @return @c true if the loading was successful, @c false on error.
+  */
+  bool
+    LoadPLY(const std::string& filename,
+      MeshComponent& outMesh,
+      const ModelLoadOptions& options = ModelLoadOptions());
+
+  /*
+    @brief Loads a binary .stl model file and welds its unshared triangle corners into an indexed mesh.
+    @details Corners are merged through a PositionWeldGrid within options.weldOptions.tolerance, so the mesh keeps
+             one vertex per distinct position (per distinct position and face normal when smoothNormals is false).
+             Normals are recomputed from the geometry; the stored facet normal is only used for degenerate triangles.
+             Triangles that collapse when their corners weld are dropped, then the mesh passes the options ask for
+             run as after LoadOBJ. ASCII STL is not supported and the .novamesh cache is not used.
+    @param filename  Path to the .stl file without extension.
+    @param outMesh   The MeshComponent instance to be filled with the data.
+    @param options   Import options (weld options, thread count, progress, mesh passes).
+    @return @c true if the loading was successful, @c false on error.
+  */
+  bool
+    LoadSTL(const std::string& filename,
+      MeshComponent& outMesh,
+      const ModelLoadOptions& options = ModelLoadOptions());
+
+  /*
+    @brief Loads a .obj model file through the original std::getline/std::stringstream parser.
+    @details Kept as the reference implementation that LoadOBJ is validated and benchmarked against.
+    @param filename  Path to the .obj file without extension.
+    @param outMesh   The MeshComponent instance to be filled with the data.
+    @return @c true if the loading was successful, @c false on error.
+  */
+  bool
+    LoadOBJReference(const std::string& filename, MeshComponent& outMesh);
+
+private:
+  /*
+    @brief Runs the mesh passes the options ask for (tangents, levels of detail, vertex cache and overdraw
+           order, clusters, vertex fetch order) on a loaded mesh and records their results in m_stats.
+  */
+  void
+    applyMeshPasses(MeshComponent& mesh, const ModelLoadOptions& options);
+
+public:
+  /*
+    @brief Timing figures of the last load performed by this loader.
+  */
+  ModelLoadStats m_stats;
+
+  /*
+    @brief Binary cache used by LoadOBJ.
+  */
+  MeshCache m_meshCache;
+};
@@ -0,0 +1,78 @@
+#pragma once
+#include "Prerequisites.h"
+#include <algorithm>
+#include <atomic>
+
+/*
+  @brief Resolves a requested worker count.
+  @param requested Number of threads asked for; 0 selects one per hardware thread.
+  @return The number of threads to use, at least 1.
+*/
+inline unsigned int
+resolveThreadCount(unsigned int requested) {
+  if (requested == 0) {
+    requested = std::thread::hardware_concurrency();
+  }
+  return requested == 0 ? 1u : requested;
+}
+
+/*
+  @brief Runs task(i) for every i in [0, taskCount) on up to threadCount threads.
+  @details Tasks are handed out dynamically from a shared counter and the calling thread
+           takes part in the work. With one thread or one task it runs inline.
+  @param taskCount Number of tasks.
+  @param threadCount Maximum number of threads, including the caller.
+  @param task Callable taking the task index as size_t.
+*/
+template<typename Task>
+void
+parallelFor(size_t taskCount, unsigned int threadCount, Task task) {
+  size_t workers = std::min(static_cast<size_t>(threadCount), taskCount);
+  if (workers <= 1) {
+    for (size_t i = 0; i < taskCount; ++i) {
+      task(i);
+    }
+    return;
+  }
+
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    for (;;) {
+      size_t i = next.fetch_add(1);
+      if (i >= taskCount) break;
+      task(i);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(workers - 1);
+  for (size_t t = 1; t < workers; ++t) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+/*
+  @brief Splits [0, count) into contiguous blocks and runs block(first, last) on each in parallel.
+  @param count Number of elements.
+  @param threadCount Maximum number of threads.
+  @param minBlock Smallest block worth handing to a thread.
+  @param block Callable taking (size_t first, size_t last).
+*/
+template<typename Block>
+void
+parallelForRange(size_t count, unsigned int threadCount, size_t minBlock, Block block) {
+  if (count == 0) return;
+  size_t blocks = std::max<size_t>(1, std::min(static_cast<size_t>(threadCount) * 4, count / std::max<size_t>(1, minBlock)));
+  size_t blockSize = (count + blocks - 1) / blocks;
+  parallelFor(blocks, threadCount, [&](size_t b) {
+    size_t first = b * blockSize;
+    size_t last = std::min(count, first + blockSize);
+    if (first < last) {
+      block(first, last);
+    }
+  });
+}
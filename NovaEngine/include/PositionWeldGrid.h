@@ -0,0 +1,164 @@
+#pragma once
+#include "Prerequisites.h"
+#include "WeldCell.h"
+
+/*
+  @class PositionWeldGrid
+  @brief A spatial hash that merges positions closer than a tolerance.
+  @note Cells are twice the tolerance wide, so the tolerance box of a query overlaps at most
+        2x2x2 cells. Points are chained per cell and a lookup returns the first match it finds,
+        so the result depends only on the insertion order. With a tolerance of 0 only
+        bit-identical positions merge (-0 and +0 are equal).
+*/
+class
+  PositionWeldGrid {
+public:
+  /*
+    @brief Default constructor
+  */
+  PositionWeldGrid() = default;
+
+  /*
+    @brief Destructor
+  */
+  ~PositionWeldGrid() = default;
+
+  /*
+    @brief Sets the tolerance and sizes the tables for an expected number of unique points.
+    @param tolerance Largest distance between merged positions, in model units. 0 merges exact matches only.
+    @param expectedPoints Estimate of the unique points; the tables grow past it if needed.
+  */
+  void
+    init(float tolerance, size_t expectedPoints);
+
+  /*
+    @brief Returns the id of a stored point within the tolerance of position that accept(id) agrees with,
+           or stores position with newId.
+    @param position The position to look up.
+    @param newId The id to store when no existing point matches.
+    @param inserted Set to true when the position was stored as a new point.
+    @param accept Callable taking an unsigned int id; returns false to keep a nearby point from matching
+                  (e.g., when its normal differs).
+    @return The id of the matching or inserted point.
+  */
+  template<typename Accept>
+  unsigned int
+    findOrInsert(const XMFLOAT3& position, unsigned int newId, bool& inserted, Accept accept) {
+    int low[3];
+    int high[3];
+    cellRange(position, low, high);
+    for (int x = low[0]; x <= high[0]; ++x) {
+      for (int y = low[1]; y <= high[1]; ++y) {
+        for (int z = low[2]; z <= high[2]; ++z) {
+          size_t slot = findCell(x, y, z);
+          for (unsigned int point = m_cells[slot].head; point != kNone; point = m_points[point].next) {
+            const Point& candidate = m_points[point];
+            if (matches(candidate.position, position) && accept(candidate.id)) {
+              inserted = false;
+              return candidate.id;
+            }
+          }
+        }
+      }
+    }
+    insert(position, newId);
+    inserted = true;
+    return newId;
+  }
+
+  /*
+    @brief Returns the number of points stored.
+  */
+  size_t
+    size() const { return m_points.size(); }
+
+  /*
+    @brief Returns the memory held by the tables in bytes.
+  */
+  size_t
+    memoryBytes() const;
+
+  /*
+    @brief Releases the table memory.
+  */
+  void
+    destroy();
+
+private:
+  static const unsigned int kNone = 0xFFFFFFFFu;
+
+  struct Cell {
+    int x;
+    int y;
+    int z;
+    unsigned int head;  // First point of the cell's chain, kNone for an unused slot.
+  };
+
+  // Position, id and chain link together, so a chain step is one memory access.
+  struct Point {
+    XMFLOAT3 position;
+    unsigned int id;
+    unsigned int next;
+  };
+
+  /*
+    @brief Returns the cell a position is stored in.
+  */
+  void
+    homeCell(const XMFLOAT3& position, int& x, int& y, int& z) const {
+    if (m_tolerance == 0.0f) {
+      x = weldCellBits(position.x);
+      y = weldCellBits(position.y);
+      z = weldCellBits(position.z);
+    }
+    else {
+      x = weldCellOf(position.x * m_inverseCell);
+      y = weldCellOf(position.y * m_inverseCell);
+      z = weldCellOf(position.z * m_inverseCell);
+    }
+  }
+
+  /*
+    @brief Returns the inclusive cell range covered by the tolerance box of a position.
+  */
+  void
+    cellRange(const XMFLOAT3& position, int (&low)[3], int (&high)[3]) const;
+
+  /*
+    @brief Returns the slot holding a cell, or the empty slot where it would go.
+  */
+  size_t
+    findCell(int x, int y, int z) const {
+    size_t slot = static_cast<size_t>(weldCellHash(x, y, z)) & m_mask;
+    while (m_cells[slot].head != kNone &&
+           (m_cells[slot].x != x || m_cells[slot].y != y || m_cells[slot].z != z)) {
+      slot = (slot + 1) & m_mask;
+    }
+    return slot;
+  }
+
+  bool
+    matches(const XMFLOAT3& a, const XMFLOAT3& b) const {
+    if (m_tolerance == 0.0f) {
+      return a.x == b.x && a.y == b.y && a.z == b.z;
+    }
+    float dx = a.x - b.x;
+    float dy = a.y - b.y;
+    float dz = a.z - b.z;
+    return dx * dx + dy * dy + dz * dz <= m_tolerance * m_tolerance;
+  }
+
+  void
+    insert(const XMFLOAT3& position, unsigned int id);
+
+  void
+    grow();
+
+private:
+  float m_tolerance = 0.0f;
+  float m_inverseCell = 0.0f;
+  std::vector<Cell> m_cells;
+  size_t m_mask = 0;
+  size_t m_usedCells = 0;
+  std::vector<Point> m_points;
+};
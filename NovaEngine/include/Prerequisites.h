@@ -38,6 +38,18 @@
     }                                                         \
 }
 
+#define REPORT(classObj, method, reportMSG)                   \
+{                                                             \
+    try {                                                     \
+        std::wostringstream os_;                              \
+        os_ << classObj << L"::" << method                    \
+            << L" : " << reportMSG << L"\n";                  \
+        OutputDebugStringW(os_.str().c_str());                \
+    } catch (...) {                                           \
+        OutputDebugStringW(L"Failed to log report message.\n");\
+    }                                                         \
+}
+
 //--------------------------------------------------------------------------------------
 // Structures
 //--------------------------------------------------------------------------------------
@@ -48,6 +60,29 @@ struct SimpleVertex
   XMFLOAT3 Normal;
 };
 
+/*
+  @brief The non-position part of a SimpleVertex, stored in its own vertex stream next to a position-only stream
+         (MeshComponent::splitVertexStreams, Buffer::initVertexStreams).
+*/
+struct VertexAttributes
+{
+  XMFLOAT2 Tex;
+  XMFLOAT3 Normal;
+};
+
+/*
+  @brief A SimpleVertex packed into 16 bytes (see MeshQuantization.h).
+  @details Pos holds 16-bit normalized or half positions relative to the mesh bounds (w is 1), Normal an
+           octahedral-encoded normal as 16-bit signed normalized values and Tex 16-bit normalized texture
+           coordinates relative to their bounds. CBVertexDequantization restores the original ranges.
+*/
+struct PackedVertex
+{
+  unsigned short Pos[4];
+  short Normal[2];
+  unsigned short Tex[2];
+};
+
 struct CBNeverChanges
 {
   XMMATRIX mView;
@@ -64,6 +99,17 @@ struct CBChangesEveryFrame
   XMFLOAT4 vMeshColor;
 };
 
+/*
+  @brief Dequantization constants of a PackedVertex buffer: position = Pos * vPositionScale + vPositionOffset and
+         texcoord = Tex * vTexcoordScaleOffset.xy + vTexcoordScaleOffset.zw.
+*/
+struct CBVertexDequantization
+{
+  XMFLOAT4 vPositionScale;
+  XMFLOAT4 vPositionOffset;
+  XMFLOAT4 vTexcoordScaleOffset;
+};
+
 enum ExtensionType {
   DDS = 0,
   PNG = 1,
@@ -0,0 +1,31 @@
+#pragma once
+#include "Prerequisites.h"
+#include <psapi.h>
+
+/*
+  @brief Returns the peak working set of this process in bytes, or 0 if it cannot be queried.
+  @note The peak never decreases, so it bounds everything the process has done so far.
+*/
+inline unsigned long long
+processPeakWorkingSet() {
+  PROCESS_MEMORY_COUNTERS counters = {};
+  counters.cb = sizeof(counters);
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return 0;
+  }
+  return static_cast<unsigned long long>(counters.PeakWorkingSetSize);
+}
+
+/*
+  @brief Returns the peak private (committed) bytes of this process, or 0 if it cannot be queried.
+  @note Unlike the working set this excludes mapped file pages, which the system can drop at any time.
+*/
+inline unsigned long long
+processPeakPrivateBytes() {
+  PROCESS_MEMORY_COUNTERS counters = {};
+  counters.cb = sizeof(counters);
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return 0;
+  }
+  return static_cast<unsigned long long>(counters.PeakPagefileUsage);
+}
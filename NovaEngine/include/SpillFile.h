@@ -0,0 +1,107 @@
+#pragma once
+#include "Prerequisites.h"
+#include <fstream>
+#include <unordered_map>
+
+/*
+  @class SpillFile
+  @brief An append-only array of fixed-size records that lives in a temporary file, read back through a bounded page cache.
+  @note Records are appended into a write page; full pages are written to disk and kept in the LRU cache, because
+        recently written records are the ones read back soonest. The file is only created once the first page spills,
+        so data that fits in one page never touches the disk.
+*/
+class
+  SpillFile {
+public:
+  /*
+    @brief Default constructor
+  */
+  SpillFile() = default;
+
+  /*
+    @brief Destructor
+  */
+  ~SpillFile() { destroy(); }
+
+  SpillFile(const SpillFile&) = delete;
+  SpillFile& operator=(const SpillFile&) = delete;
+
+  /*
+    @brief Prepares an empty spill file.
+    @param directory Folder for the temporary file; empty uses the system temporary folder.
+    @param recordSize Size of one record in bytes.
+    @param memoryBudget Bytes available for the write page and the page cache together.
+    @return HRESULT indicating success or failure of the operation.
+  */
+  HRESULT
+    init(const std::string& directory, size_t recordSize, size_t memoryBudget);
+
+  /*
+    @brief Appends one record.
+    @param record Pointer to recordSize bytes.
+    @return HRESULT indicating success or failure of the operation.
+  */
+  HRESULT
+    append(const void* record);
+
+  /*
+    @brief Returns a record by index.
+    @param index Record index, lower than count().
+    @return Pointer to the record, valid until the next append() or read(); nullptr if it could not be read back.
+  */
+  const void*
+    read(size_t index);
+
+  /*
+    @brief Returns the number of records appended.
+  */
+  size_t
+    count() const { return m_count; }
+
+  /*
+    @brief Returns the memory held by the write page and the page cache in bytes.
+  */
+  size_t
+    memoryBytes() const { return m_writePage.capacity() + m_cache.size(); }
+
+  /*
+    @brief Returns the number of bytes written to disk.
+  */
+  unsigned long long
+    spilledBytes() const { return m_spilledBytes; }
+
+  /*
+    @brief Closes and deletes the temporary file and releases the buffers.
+  */
+  void
+    destroy();
+
+private:
+  HRESULT
+    writePage();
+
+  size_t
+    cacheSlot(size_t page);
+
+public:
+  std::string m_directory;
+  std::string m_path;
+  std::fstream m_file;
+  size_t m_recordSize = 0;
+  size_t m_recordsPerPage = 0;
+  size_t m_pageBytes = 0;
+  size_t m_count = 0;
+  unsigned long long m_spilledBytes = 0;
+
+  // The page being filled; it holds records [m_writePageIndex * m_recordsPerPage, m_count).
+  std::vector<char> m_writePage;
+  size_t m_writePageIndex = 0;
+
+  // Cached pages: slot s holds page m_cachedPage[s], last used at m_lastUse[s].
+  std::vector<char> m_cache;
+  std::vector<size_t> m_cachedPage;
+  std::vector<unsigned long long> m_lastUse;
+  std::unordered_map<size_t, size_t> m_slotOfPage;
+  size_t m_lastSlot = 0;
+  unsigned long long m_clock = 0;
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include "Prerequisites.h"
+
+/*
+  @class Timer
+  @brief A small high-resolution stopwatch built on QueryPerformanceCounter.
+  @note Used by the loaders and mesh passes to report their throughput.
+*/
+class
+  Timer {
+public:
+  /*
+    @brief Constructor. The timer starts running immediately.
+  */
+  Timer() {
+    QueryPerformanceFrequency(&m_frequency);
+    start();
+  }
+
+  /*
+    @brief Restarts the timer.
+  */
+  void
+    start() { QueryPerformanceCounter(&m_start); }
+
+  /*
+    @brief Returns the seconds elapsed since the last start().
+  */
+  double
+    elapsedSeconds() const {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return static_cast<double>(now.QuadPart - m_start.QuadPart) / static_cast<double>(m_frequency.QuadPart);
+  }
+
+private:
+  LARGE_INTEGER m_frequency;
+  LARGE_INTEGER m_start;
+};
@@ -0,0 +1,149 @@
+#pragma once
+#include "Prerequisites.h"
+#include <algorithm>
+
+/*
+  @struct OBJCorner
+  @brief A face corner of an OBJ file as resolved one-based v/vt/vn indices.
+  @note Zero means the corner has no texture coordinate or normal.
+*/
+struct OBJCorner {
+  unsigned int v;
+  unsigned int vt;
+  unsigned int vn;
+};
+
+/*
+  @class VertexDedupTable
+  @brief An open-addressing hash table that maps OBJ corners to vertex indices.
+  @note Each slot packs the v/vt/vn triple and its vertex index into 16 bytes, so a probe
+        touches a single cache line most of the time. Lookup and insertion are one probe sequence.
+*/
+class
+  VertexDedupTable {
+public:
+  /*
+    @brief Default constructor
+  */
+  VertexDedupTable() = default;
+
+  /*
+    @brief Destructor
+  */
+  ~VertexDedupTable() = default;
+
+  /*
+    @brief Sizes the table for an expected number of unique corners.
+    @param expectedUnique Estimate of the unique corners; the table grows past it if needed.
+  */
+  void
+    init(size_t expectedUnique) {
+    size_t capacity = 16;
+    while (capacity < expectedUnique * 2) {
+      capacity <<= 1;
+    }
+    m_slots.assign(capacity, Slot{ 0, 0, 0, 0 });
+    m_mask = capacity - 1;
+    m_count = 0;
+  }
+
+  /*
+    @brief Returns the vertex index stored for a corner, inserting newIndex if the corner is new.
+    @param corner The resolved corner; corner.v must be non-zero.
+    @param newIndex The index to store when the corner is not in the table yet.
+    @param inserted Set to true when the corner was inserted.
+    @return The vertex index of the corner.
+  */
+  unsigned int
+    findOrInsert(const OBJCorner& corner, unsigned int newIndex, bool& inserted) {
+    if ((m_count + 1) * 2 > m_slots.size()) {
+      grow();
+    }
+    size_t slot = hash(corner) & m_mask;
+    for (;;) {
+      Slot& s = m_slots[slot];
+      if (s.v == 0) {
+        s = Slot{ corner.v, corner.vt, corner.vn, newIndex };
+        ++m_count;
+        inserted = true;
+        return newIndex;
+      }
+      if (s.v == corner.v && s.vt == corner.vt && s.vn == corner.vn) {
+        inserted = false;
+        return s.index;
+      }
+      slot = (slot + 1) & m_mask;
+    }
+  }
+
+  /*
+    @brief Returns the number of unique corners stored.
+  */
+  size_t
+    size() const { return m_count; }
+
+  /*
+    @brief Returns the memory held by the slot array in bytes.
+  */
+  size_t
+    memoryBytes() const { return m_slots.capacity() * sizeof(Slot); }
+
+  /*
+    @brief Empties the table but keeps its slot array.
+  */
+  void
+    clear() {
+    std::fill(m_slots.begin(), m_slots.end(), Slot{ 0, 0, 0, 0 });
+    m_count = 0;
+  }
+
+  /*
+    @brief Releases the table memory.
+  */
+  void
+    destroy() {
+    std::vector<Slot>().swap(m_slots);
+    m_mask = 0;
+    m_count = 0;
+  }
+
+private:
+  struct Slot {
+    unsigned int v;
+    unsigned int vt;
+    unsigned int vn;
+    unsigned int index;
+  };
+
+  static size_t
+    hash(const OBJCorner& corner) {
+    unsigned long long h = (static_cast<unsigned long long>(corner.v) |
+                            (static_cast<unsigned long long>(corner.vt) << 32)) * 0x9E3779B97F4A7C15ull;
+    h ^= static_cast<unsigned long long>(corner.vn) * 0xC2B2AE3D27D4EB4Full;
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ull;
+    h ^= h >> 32;
+    return static_cast<size_t>(h);
+  }
+
+  void
+    grow() {
+    std::vector<Slot> old;
+    old.swap(m_slots);
+    m_slots.assign(old.empty() ? 16 : old.size() * 2, Slot{ 0, 0, 0, 0 });
+    m_mask = m_slots.size() - 1;
+    for (const Slot& s : old) {
+      if (s.v == 0) continue;
+      size_t slot = hash(OBJCorner{ s.v, s.vt, s.vn }) & m_mask;
+      while (m_slots[slot].v != 0) {
+        slot = (slot + 1) & m_mask;
+      }
+      m_slots[slot] = s;
+    }
+  }
+
+private:
+  std::vector<Slot> m_slots;
+  size_t m_mask = 0;
+  size_t m_count = 0;
+};
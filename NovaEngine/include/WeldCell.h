@@ -0,0 +1,42 @@
+#pragma once
+#include <climits>
+#include <cstring>
+
+/*
+  @brief Cell coordinate of a position already scaled by the inverse cell size.
+  @details Rounds down without std::floor, which is a library call on targets without SSE4.1. Values past the int
+           range clamp to it with 128 cells to spare, so a neighbouring cell still fits, and NaN goes to the lowest
+           cell; no float reaches an out-of-range (undefined) int conversion.
+*/
+inline int
+weldCellOf(float value) {
+  if (!(value > -2147483520.0f)) return INT_MIN + 128;
+  if (value > 2147483520.0f) return INT_MAX - 128;
+  int cell = static_cast<int>(value);
+  return (static_cast<float>(cell) > value) ? cell - 1 : cell;
+}
+
+/*
+  @brief Cell coordinate for exact welding: the bit pattern of the value, with -0 and +0 sharing a cell.
+*/
+inline int
+weldCellBits(float value) {
+  if (value == 0.0f) value = 0.0f;
+  int bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+/*
+  @brief Mixes the three coordinates of a cell into a hash; callers mask it to their table size.
+*/
+inline unsigned long long
+weldCellHash(int x, int y, int z) {
+  unsigned long long h = (static_cast<unsigned long long>(static_cast<unsigned int>(x)) |
+                          (static_cast<unsigned long long>(static_cast<unsigned int>(y)) << 32)) * 0x9E3779B97F4A7C15ull;
+  h ^= static_cast<unsigned long long>(static_cast<unsigned int>(z)) * 0xC2B2AE3D27D4EB4Full;
+  h ^= h >> 32;
+  h *= 0xD6E8FEB86659FD93ull;
+  h ^= h >> 32;
+  return h;
+}
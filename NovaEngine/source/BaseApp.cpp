@@ -1,4 +1,5 @@
 #include "BaseApp.h"
+#include <algorithm>
 
 int
 BaseApp::run(HINSTANCE hInst, int nCmdShow) {
@@ -93,37 +94,9 @@ BaseApp::init() {
 	// Load Resources
 
 
-	// Define the input layout
-	std::vector<D3D11_INPUT_ELEMENT_DESC> Layout;
-	D3D11_INPUT_ELEMENT_DESC position;
-	position.SemanticName = "POSITION";
-	position.SemanticIndex = 0;
-	position.Format = DXGI_FORMAT_R32G32B32_FLOAT;
-	position.InputSlot = 0;
-	position.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT /*0*/;
-	position.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-	position.InstanceDataStepRate = 0;
-	Layout.push_back(position);
-
-	D3D11_INPUT_ELEMENT_DESC texcoord;
-	texcoord.SemanticName = "TEXCOORD";
-	texcoord.SemanticIndex = 0;
-	texcoord.Format = DXGI_FORMAT_R32G32_FLOAT;
-	texcoord.InputSlot = 0;
-	texcoord.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT /*0*/;
-	texcoord.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-	texcoord.InstanceDataStepRate = 0;
-	Layout.push_back(texcoord);
-
-	D3D11_INPUT_ELEMENT_DESC normal;
-	normal.SemanticName = "NORMAL";
-	normal.SemanticIndex = 0;
-	normal.Format = DXGI_FORMAT_R32G32B32_FLOAT;
-	normal.InputSlot = 0;
-	normal.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT /*0*/;
-	normal.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-	normal.InstanceDataStepRate = 0;
-	Layout.push_back(normal);
+	// Define the input layout: positions in slot 0, texcoords and normals in slot 1,
+	// matching the streams m_vertexBuffer.initVertexStreams uploads
+	std::vector<D3D11_INPUT_ELEMENT_DESC> Layout = vertexInputLayout(VERTEX_FORMAT_FLOAT, VERTEX_STREAMS_SPLIT);
 
 	// Create the Shader Program
 	hr = m_shaderProgram.init(m_device, "NovaEngine.fx", Layout);
@@ -133,32 +106,25 @@ BaseApp::init() {
 		return hr;
 	}
 
-	// Load the mesh using ModelLoader
-	bool modelLoaded = m_modelLoader.LoadOBJ("models/Peashooter", m_mesh);
+	// Load the mesh on a worker thread; update() creates its buffers once it is ready.
+	// Its coarser levels of detail are generated with it and picked by distance in render(),
+	// and every level is split into clusters that render() culls against the camera
+	ModelLoadOptions loadOptions;
+	loadOptions.lodCount = 4;
+	loadOptions.optimizeVertexCache = true;
+	loadOptions.buildClusters = true;
+	m_modelLoad = m_modelLoader.LoadOBJAsync("models/Peashooter", loadOptions);
 
-	if (!modelLoaded) {
+	if (!m_modelLoad) {
 		ERROR("Main", "InitDevice",
-			"Failed to load model using ModelLoader.");
+			"Failed to start loading the model using ModelLoader.");
 		return E_FAIL;
 	}
 
-	// Create vertex buffer
-	hr = m_vertexBuffer.init(m_device, m_mesh, D3D11_BIND_VERTEX_BUFFER);
-
-	if (FAILED(hr)) {
-		ERROR("Main", "InitDevice",
-			("Failed to initialize VertexBuffer. HRESULT: " + std::to_string(hr)).c_str());
-		return hr;
-	}
-
-	// Create index buffer
-	hr = m_indexBuffer.init(m_device, m_mesh, D3D11_BIND_INDEX_BUFFER);
-
-	if (FAILED(hr)) {
-		ERROR("Main", "InitDevice",
-			("Failed to initialize IndexBuffer. HRESULT: " + std::to_string(hr)).c_str());
-		return hr;
-	}
+	// The title shows the load progress until the model is ready
+	char title[256] = {};
+	GetWindowTextA(m_window.m_hWnd, title, sizeof(title));
+	m_windowTitle = title;
 
 	// Set primitive topology
 	m_deviceContext.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
@@ -221,6 +187,16 @@ BaseApp::init() {
 
 void BaseApp::update(float deltaTime)
 {
+	if (m_modelLoad) {
+		pollModelLoad();
+	}
+
+	// Subir solo los rangos del mesh editados desde el frame anterior
+	m_frameUploads = BufferUploadStats();
+	if (m_modelReady && m_mesh.hasDirtyRanges() && FAILED(uploadMeshEdits())) {
+		ERROR("Main", "update", "Failed to upload the edited mesh ranges.");
+	}
+
 	// Update our time
 	static float t = 0.0f;
 	if (m_swapChain.m_driverType == D3D_DRIVER_TYPE_REFERENCE)
@@ -276,10 +252,16 @@ BaseApp::render() {
 	// Set shader program
 	m_shaderProgram.render(m_deviceContext);
 
+	// Hasta que el modelo termine de cargar solo se limpia y presenta el frame
+	if (!m_modelReady) {
+		m_swapChain.present();
+		return;
+	}
+
 	// Render the cube
 	 // Asignar buffers Vertex e Index
-	m_vertexBuffer.render(m_deviceContext, 0, 1);
-	m_indexBuffer.render(m_deviceContext, 0, 1, false, DXGI_FORMAT_R32_UINT);
+	m_vertexBuffer.render(m_deviceContext, 0, 2);
+	m_indexBuffer.render(m_deviceContext, 0, 1);
 
 	// Asignar buffers constantes
 	m_cbNeverChanges.render(m_deviceContext, 0, 1);
@@ -287,27 +269,85 @@ BaseApp::render() {
 	m_cbChangesEveryFrame.render(m_deviceContext, 2, 1);
 	m_cbChangesEveryFrame.render(m_deviceContext, 2, 1, true);
 
-	// Asignar textura y sampler
-	m_textureCube.render(m_deviceContext, 0, 1);
+	// Elegir el nivel de detalle mas simple cuyo error en pantalla no pase de un pixel
+	XMVECTOR viewCenter = XMVector3TransformCoord(XMLoadFloat3(&m_mesh.m_boundsCenter), XMMatrixMultiply(m_World, m_View));
+	size_t level = m_mesh.selectLod(XMVectorGetX(XMVector3Length(viewCenter)),
+		static_cast<float>(m_window.m_height), XM_PIDIV4);
+
+	// Descartar los clusters fuera del frustum o de espaldas a la camara y subir
+	// solo los indices de los visibles, compactados por material
+	const std::vector<MeshSubmesh>* ranges = &m_mesh.lodSubmeshes(level);
+	ClusterCullView cullView = makeClusterCullView(m_World, m_View, m_Projection);
+	if (!m_mesh.m_clusters.empty()) {
+		const void* visibleData = nullptr;
+		size_t visibleBytes = 0;
+		if (m_mesh.m_index16.empty()) {
+			cullClusters(m_mesh, level, cullView, m_visibleIndices, m_visibleSubmeshes);
+			visibleData = m_visibleIndices.data();
+			visibleBytes = m_visibleIndices.size() * sizeof(unsigned int);
+		}
+		else {
+			cullClusters(m_mesh, level, cullView, m_visibleIndices16, m_visibleSubmeshes);
+			visibleData = m_visibleIndices16.data();
+			visibleBytes = m_visibleIndices16.size() * sizeof(unsigned short);
+		}
+		if (visibleBytes != 0) {
+			D3D11_BOX box = { 0, 0, 0, static_cast<UINT>(visibleBytes), 1, 1 };
+			m_visibleIndexBuffer.update(m_deviceContext, nullptr, 0, &box, visibleData, 0, 0);
+			m_frameUploads.bytes += visibleBytes;
+			++m_frameUploads.updates;
+		}
+		m_visibleIndexBuffer.render(m_deviceContext, 0, 1);
+		ranges = &m_visibleSubmeshes;
+	}
+
+	// Asignar sampler y dibujar un rango de indices por material
 	m_samplerState.render(m_deviceContext, 0, 1);
-	m_deviceContext.DrawIndexed(m_mesh.m_numIndex, 0, 0);
+	if (m_mesh.m_submeshes.empty()) {
+		m_textureCube.render(m_deviceContext, 0, 1);
+		m_deviceContext.DrawIndexed(m_mesh.m_numIndex, 0, 0);
+	}
+	for (const MeshSubmesh& submesh : *ranges) {
+		if (submesh.indexCount == 0) {
+			continue;
+		}
+		// Sin clusters, descartar al menos los materiales enteros fuera del frustum
+		if (m_mesh.m_clusters.empty() && !sphereInView(cullView, submesh.center, submesh.radius)) {
+			continue;
+		}
+		Texture& texture = (submesh.materialId < m_materialTextures.size() &&
+			m_materialTextures[submesh.materialId].m_textureFromImg)
+			? m_materialTextures[submesh.materialId]
+			: m_textureCube;
+		texture.render(m_deviceContext, 0, 1);
+		m_deviceContext.DrawIndexed(submesh.indexCount, submesh.indexOffset, static_cast<int>(submesh.baseVertex));
+	}
 
 	// Present our back buffer to our front buffer
 	m_swapChain.present();
+	reportFrameUploads();
 }
 
 void
 BaseApp::destroy() {
+	// Stop a load still in flight before the resources it would feed go away
+	m_modelLoad.reset();
+
 	if (m_deviceContext.m_deviceContext) m_deviceContext.m_deviceContext->ClearState();
 
 	m_samplerState.destroy();
 	m_textureCube.destroy();
+	for (Texture& texture : m_materialTextures) {
+		texture.destroy();
+	}
+	m_materialTextures.clear();
 
 	m_cbNeverChanges.destroy();
 	m_cbChangeOnResize.destroy();
 	m_cbChangesEveryFrame.destroy();
 	m_vertexBuffer.destroy();
 	m_indexBuffer.destroy();
+	m_visibleIndexBuffer.destroy();
 	m_shaderProgram.destroy();
 	m_depthStencil.destroy();
 	m_depthStencilView.destroy();
@@ -318,6 +358,163 @@ BaseApp::destroy() {
 	m_device.destroy();
 }
 
+void
+BaseApp::pollModelLoad() {
+	ModelLoadState state = m_modelLoad->state();
+	if (state == LOAD_RUNNING) {
+		int percent = static_cast<int>(m_modelLoad->progress() * 100.0f);
+		if (percent != m_loadPercent) {
+			m_loadPercent = percent;
+			SetWindowTextA(m_window.m_hWnd,
+				(m_windowTitle + " - Loading " + m_modelLoad->filename() + " " + std::to_string(percent) + "%").c_str());
+		}
+		return;
+	}
+
+	if (state != LOAD_READY || !m_modelLoad->takeMesh(m_mesh) || FAILED(finishModelLoad())) {
+		ERROR("Main", "pollModelLoad",
+			"Failed to load model using ModelLoader.");
+		m_modelLoad.reset();
+		PostQuitMessage(0);
+		return;
+	}
+	m_modelLoad.reset();
+	SetWindowTextA(m_window.m_hWnd, m_windowTitle.c_str());
+}
+
+void
+BaseApp::reportFrameUploads() {
+	m_uploadTotals.bytes += m_frameUploads.bytes;
+	m_uploadTotals.updates += m_frameUploads.updates;
+	++m_uploadFrames;
+
+	// Promediar sobre un segundo para que el titulo se pueda leer
+	DWORD now = GetTickCount();
+	if (m_uploadReportTime == 0) {
+		m_uploadReportTime = now;
+	}
+	if (now - m_uploadReportTime < 1000) {
+		return;
+	}
+	SetWindowTextA(m_window.m_hWnd,
+		(m_windowTitle + " - GPU uploads " + std::to_string(m_uploadTotals.bytes / m_uploadFrames) + " bytes/frame, " +
+			std::to_string(m_uploadTotals.updates / m_uploadFrames) + " updates/frame").c_str());
+	m_uploadTotals = BufferUploadStats();
+	m_uploadFrames = 0;
+	m_uploadReportTime = now;
+}
+
+HRESULT
+BaseApp::finishModelLoad() {
+	HRESULT hr = S_OK;
+
+	// Create vertex buffer
+	hr = m_vertexBuffer.initVertexStreams(m_device, m_mesh);
+
+	if (FAILED(hr)) {
+		ERROR("Main", "finishModelLoad",
+			("Failed to initialize VertexBuffer. HRESULT: " + std::to_string(hr)).c_str());
+		return hr;
+	}
+
+	// Create index buffer, with 16-bit indices when every index range spans at most 65536 vertices
+	m_mesh.buildIndex16();
+	hr = m_indexBuffer.init(m_device, m_mesh, D3D11_BIND_INDEX_BUFFER);
+
+	if (FAILED(hr)) {
+		ERROR("Main", "finishModelLoad",
+			("Failed to initialize IndexBuffer. HRESULT: " + std::to_string(hr)).c_str());
+		return hr;
+	}
+
+	// Destination of the indices of the visible clusters, rewritten every frame
+	if (!m_mesh.m_clusters.empty()) {
+		hr = m_visibleIndexBuffer.init(m_device, m_mesh, D3D11_BIND_INDEX_BUFFER);
+
+		if (FAILED(hr)) {
+			ERROR("Main", "finishModelLoad",
+				("Failed to initialize the visible cluster IndexBuffer. HRESULT: " + std::to_string(hr)).c_str());
+			return hr;
+		}
+	}
+
+	loadMaterialTextures();
+	m_modelReady = true;
+	return S_OK;
+}
+
+HRESULT
+BaseApp::uploadMeshEdits() {
+	HRESULT hr = S_OK;
+	if (!m_mesh.m_dirtyVertices.empty()) {
+		hr = m_vertexBuffer.updateDirtyRanges(m_deviceContext, m_mesh, m_frameUploads);
+		if (FAILED(hr)) {
+			return hr;
+		}
+	}
+
+	if (!m_mesh.m_dirtyIndices.empty()) {
+		if (m_mesh.refreshIndex16()) {
+			hr = m_indexBuffer.updateDirtyRanges(m_deviceContext, m_mesh, m_frameUploads);
+		}
+		else {
+			// A changed index left the 16-bit range of its submesh: upload the whole list again
+			m_indexBuffer.destroy();
+			m_mesh.buildIndex16();
+			hr = m_indexBuffer.init(m_device, m_mesh, D3D11_BIND_INDEX_BUFFER);
+			if (SUCCEEDED(hr) && !m_mesh.m_clusters.empty()) {
+				m_visibleIndexBuffer.destroy();
+				hr = m_visibleIndexBuffer.init(m_device, m_mesh, D3D11_BIND_INDEX_BUFFER);
+			}
+			m_frameUploads.bytes += m_mesh.m_index16.empty() ? m_mesh.m_index.size() * sizeof(unsigned int)
+				: m_mesh.m_index16.size() * sizeof(unsigned short);
+			++m_frameUploads.updates;
+		}
+		if (FAILED(hr)) {
+			return hr;
+		}
+	}
+
+	m_mesh.clearDirtyRanges();
+	return S_OK;
+}
+
+void
+BaseApp::loadMaterialTextures() {
+	m_materialTextures.assign(m_mesh.m_materials.size(), Texture());
+	for (size_t i = 0; i < m_mesh.m_materials.size(); ++i) {
+		const std::string& path = m_mesh.m_materials[i].diffuseTexture;
+		size_t dot = path.find_last_of('.');
+		if (path.empty() || dot == std::string::npos) {
+			continue;
+		}
+
+		// Texture::init appends the extension itself.
+		std::string extension = path.substr(dot + 1);
+		std::transform(extension.begin(), extension.end(), extension.begin(),
+			[](unsigned char c) { return static_cast<char>(tolower(c)); });
+		ExtensionType type;
+		if (extension == "png") {
+			type = PNG;
+		}
+		else if (extension == "jpg") {
+			type = JPG;
+		}
+		else if (extension == "dds") {
+			type = DDS;
+		}
+		else {
+			ERROR("Main", "loadMaterialTextures", ("Unsupported texture format: " + path).c_str());
+			continue;
+		}
+
+		if (FAILED(m_materialTextures[i].init(m_device, path.substr(0, dot), type))) {
+			ERROR("Main", "loadMaterialTextures",
+				("Failed to load texture of material " + m_mesh.m_materials[i].name + ", using the default texture.").c_str());
+		}
+	}
+}
+
 LRESULT
 BaseApp::WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
 	//if (ImGui_ImplWin32_WndProcHandler(hWnd, message, wParam, lParam))
@@ -1,6 +1,27 @@
 #include "Buffer.h"
 #include "Device.h"
 #include "DeviceContext.h"
+#include <algorithm>
+
+namespace {
+	/*
+		Copies count elements of stride bytes into the buffer, starting at element
+		first, with a box around them.
+	*/
+	void
+	updateRange(ID3D11DeviceContext* context,
+		ID3D11Buffer* buffer,
+		const void* source,
+		unsigned int stride,
+		unsigned int first,
+		unsigned int count,
+		BufferUploadStats& stats) {
+		D3D11_BOX box = { first * stride, 0, 0, (first + count) * stride, 1, 1 };
+		context->UpdateSubresource(buffer, 0, &box, source, 0, 0);
+		stats.bytes += static_cast<size_t>(count) * stride;
+		++stats.updates;
+	}
+}
 
 HRESULT
 Buffer::init(Device& device, const MeshComponent& mesh, unsigned int bindFlag) {
@@ -31,15 +52,86 @@ Buffer::init(Device& device, const MeshComponent& mesh, unsigned int bindFlag) {
 		data.pSysMem = mesh.m_vertex.data();
 	}
 	else if (bindFlag & D3D11_BIND_INDEX_BUFFER) {
-		m_stride = sizeof(unsigned int);
+		// buildIndex16 leaves m_index16 empty when some range does not fit in 16 bits.
+		bool use16 = mesh.m_index16.size() == mesh.m_index.size();
+		m_stride = use16 ? sizeof(unsigned short) : sizeof(unsigned int);
+		m_format = use16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
 		desc.ByteWidth = m_stride * static_cast<unsigned int>(mesh.m_index.size());
 		desc.BindFlags = (D3D11_BIND_FLAG)bindFlag;
-		data.pSysMem = mesh.m_index.data();
+		data.pSysMem = use16 ? static_cast<const void*>(mesh.m_index16.data()) : mesh.m_index.data();
 	}
 
 	return createBuffer(device, desc, &data);
 }
 
+HRESULT
+Buffer::init(Device& device, const void* data, unsigned int stride, unsigned int count, unsigned int bindFlag) {
+	if (!device.m_device) {
+		ERROR("Buffer", "init", "Device is null.");
+		return E_POINTER;
+	}
+	if (!data || stride == 0 || count == 0) {
+		ERROR("Buffer", "init", "Buffer data is empty");
+		return E_INVALIDARG;
+	}
+
+	D3D11_BUFFER_DESC desc = {};
+	D3D11_SUBRESOURCE_DATA initData = {};
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.ByteWidth = stride * count;
+	desc.BindFlags = (D3D11_BIND_FLAG)bindFlag;
+	desc.CPUAccessFlags = 0;
+	initData.pSysMem = data;
+	m_stride = stride;
+	m_bindFlag = bindFlag;
+	if (bindFlag & D3D11_BIND_INDEX_BUFFER) {
+		m_format = (stride == sizeof(unsigned short)) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	}
+
+	return createBuffer(device, desc, &initData);
+}
+
+HRESULT
+Buffer::initVertexStreams(Device& device, const MeshComponent& mesh) {
+	if (!device.m_device) {
+		ERROR("Buffer", "initVertexStreams", "Device is null.");
+		return E_POINTER;
+	}
+	if (mesh.m_vertex.empty()) {
+		ERROR("Buffer", "initVertexStreams", "Vertex buffer is empty");
+		return E_INVALIDARG;
+	}
+
+	std::vector<XMFLOAT3> positions;
+	std::vector<VertexAttributes> attributes;
+	mesh.splitVertexStreams(positions, attributes);
+
+	D3D11_BUFFER_DESC desc = {};
+	D3D11_SUBRESOURCE_DATA data = {};
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	desc.CPUAccessFlags = 0;
+	m_bindFlag = D3D11_BIND_VERTEX_BUFFER;
+
+	m_stride = sizeof(XMFLOAT3);
+	desc.ByteWidth = m_stride * static_cast<unsigned int>(positions.size());
+	data.pSysMem = positions.data();
+	HRESULT hr = createBuffer(device, desc, &data);
+	if (FAILED(hr)) {
+		return hr;
+	}
+
+	m_attributeStride = sizeof(VertexAttributes);
+	desc.ByteWidth = m_attributeStride * static_cast<unsigned int>(attributes.size());
+	data.pSysMem = attributes.data();
+	hr = device.CreateBuffer(&desc, &data, &m_attributeBuffer);
+	if (FAILED(hr)) {
+		ERROR("Buffer", "initVertexStreams", "Failed to create attribute stream");
+		return hr;
+	}
+	return S_OK;
+}
+
 HRESULT
 Buffer::init(Device& device, unsigned int ByteWidth) {
 	if (!device.m_device) {
@@ -87,6 +179,77 @@ Buffer::update(DeviceContext& deviceContext,
 
 }
 
+HRESULT
+Buffer::updateDirtyRanges(DeviceContext& deviceContext, const MeshComponent& mesh, BufferUploadStats& stats) {
+	if (!deviceContext.m_deviceContext) {
+		ERROR("Buffer", "updateDirtyRanges", "DeviceContext is nullptr.");
+		return E_POINTER;
+	}
+	if (!m_buffer) {
+		ERROR("Buffer", "updateDirtyRanges", "m_buffer is null.");
+		return E_POINTER;
+	}
+
+	D3D11_BUFFER_DESC desc = {};
+	m_buffer->GetDesc(&desc);
+	unsigned int capacity = desc.ByteWidth / m_stride;
+	ID3D11DeviceContext* context = deviceContext.m_deviceContext;
+
+	if (m_bindFlag == D3D11_BIND_INDEX_BUFFER) {
+		bool use16 = m_stride == sizeof(unsigned short);
+		if (use16 ? mesh.m_index16.size() != mesh.m_index.size() : m_stride != sizeof(unsigned int)) {
+			ERROR("Buffer", "updateDirtyRanges", "The index buffer does not match the mesh indices");
+			return E_INVALIDARG;
+		}
+		for (const MeshDirtyRange& range : mesh.m_dirtyIndices) {
+			unsigned int last = static_cast<unsigned int>(std::min<size_t>(
+				std::min<size_t>(static_cast<size_t>(range.first) + range.count, capacity), mesh.m_index.size()));
+			if (range.first >= last) {
+				continue;
+			}
+			const void* source = use16 ? static_cast<const void*>(mesh.m_index16.data() + range.first)
+				: mesh.m_index.data() + range.first;
+			updateRange(context, m_buffer, source, m_stride, range.first, last - range.first, stats);
+		}
+		return S_OK;
+	}
+
+	if (m_bindFlag != D3D11_BIND_VERTEX_BUFFER ||
+		(m_attributeBuffer ? m_stride != sizeof(XMFLOAT3) : m_stride != sizeof(SimpleVertex))) {
+		ERROR("Buffer", "updateDirtyRanges", "The buffer does not hold SimpleVertex data");
+		return E_INVALIDARG;
+	}
+	for (const MeshDirtyRange& range : mesh.m_dirtyVertices) {
+		unsigned int last = static_cast<unsigned int>(std::min<size_t>(
+			std::min<size_t>(static_cast<size_t>(range.first) + range.count, capacity), mesh.m_vertex.size()));
+		if (range.first >= last) {
+			continue;
+		}
+		unsigned int count = last - range.first;
+		const SimpleVertex* vertices = mesh.m_vertex.data() + range.first;
+		if (!m_attributeBuffer) {
+			updateRange(context, m_buffer, vertices, m_stride, range.first, count, stats);
+			continue;
+		}
+
+		// The streams are not interleaved in m_vertex; gather each one first.
+		m_staging.resize(static_cast<size_t>(count) * sizeof(VertexAttributes));
+		XMFLOAT3* positions = reinterpret_cast<XMFLOAT3*>(m_staging.data());
+		for (unsigned int i = 0; i < count; ++i) {
+			positions[i] = vertices[i].Pos;
+		}
+		updateRange(context, m_buffer, positions, m_stride, range.first, count, stats);
+
+		VertexAttributes* attributes = reinterpret_cast<VertexAttributes*>(m_staging.data());
+		for (unsigned int i = 0; i < count; ++i) {
+			attributes[i].Tex = vertices[i].Tex;
+			attributes[i].Normal = vertices[i].Normal;
+		}
+		updateRange(context, m_attributeBuffer, attributes, m_attributeStride, range.first, count, stats);
+	}
+	return S_OK;
+}
+
 void
 Buffer::render(DeviceContext& deviceContext,
 	unsigned int StartSlot,
@@ -104,7 +267,15 @@ Buffer::render(DeviceContext& deviceContext,
 
 	switch (m_bindFlag) {
 	case D3D11_BIND_VERTEX_BUFFER:
-		deviceContext.m_deviceContext->IASetVertexBuffers(StartSlot, NumBuffers, &m_buffer, &m_stride, &m_offset);
+		if (m_attributeBuffer && NumBuffers > 1) {
+			ID3D11Buffer* buffers[2] = { m_buffer, m_attributeBuffer };
+			unsigned int strides[2] = { m_stride, m_attributeStride };
+			unsigned int offsets[2] = { m_offset, m_offset };
+			deviceContext.m_deviceContext->IASetVertexBuffers(StartSlot, 2, buffers, strides, offsets);
+		}
+		else {
+			deviceContext.m_deviceContext->IASetVertexBuffers(StartSlot, NumBuffers, &m_buffer, &m_stride, &m_offset);
+		}
 		break;
 	case D3D11_BIND_CONSTANT_BUFFER:
 		deviceContext.m_deviceContext->VSSetConstantBuffers(StartSlot, NumBuffers, &m_buffer);
@@ -113,7 +284,7 @@ Buffer::render(DeviceContext& deviceContext,
 		}
 		break;
 	case D3D11_BIND_INDEX_BUFFER:
-		deviceContext.m_deviceContext->IASetIndexBuffer(m_buffer, format, m_offset);
+		deviceContext.m_deviceContext->IASetIndexBuffer(m_buffer, format != DXGI_FORMAT_UNKNOWN ? format : m_format, m_offset);
 		break;
 	default:
 		ERROR("Buffer", "render", "Unsupported BindFlag");
@@ -124,6 +295,7 @@ Buffer::render(DeviceContext& deviceContext,
 void
 Buffer::destroy() {
 	SAFE_RELEASE(m_buffer);
+	SAFE_RELEASE(m_attributeBuffer);
 }
 
 HRESULT
@@ -0,0 +1,256 @@
+#include "JsonValue.h"
+#include <charconv>
+#include <cstring>
+
+namespace {
+  const JsonValue kNull;
+  const int kMaxDepth = 256;
+
+  /*
+    Recursive-descent parser over [p, end). Each parse function leaves p after
+    the value it read and returns false with error set on malformed input.
+  */
+  class JsonReader {
+  public:
+    JsonReader(const char* begin, const char* end, std::string& error)
+      : p(begin), m_begin(begin), m_end(end), m_error(error) {}
+
+    bool
+    value(JsonValue& out, int depth) {
+      if (depth > kMaxDepth) return fail("nesting too deep");
+      skipSpace();
+      if (p >= m_end) return fail("unexpected end of document");
+      switch (*p) {
+      case '{': return object(out, depth);
+      case '[': return array(out, depth);
+      case '"':
+        out.m_type = JsonValue::JSON_STRING;
+        return string(out.m_string);
+      case 't':
+        out.m_type = JsonValue::JSON_BOOL;
+        out.m_bool = true;
+        return literal("true");
+      case 'f':
+        out.m_type = JsonValue::JSON_BOOL;
+        out.m_bool = false;
+        return literal("false");
+      case 'n':
+        out.m_type = JsonValue::JSON_NULL;
+        return literal("null");
+      default:
+        return number(out);
+      }
+    }
+
+    void
+    skipSpace() {
+      while (p < m_end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) ++p;
+    }
+
+    bool
+    fail(const char* message) {
+      m_error = std::string(message) + " at offset " + std::to_string(p - m_begin);
+      return false;
+    }
+
+    const char* p;
+
+  private:
+    bool
+    literal(const char* text) {
+      size_t length = strlen(text);
+      if (static_cast<size_t>(m_end - p) < length || memcmp(p, text, length) != 0) return fail("invalid literal");
+      p += length;
+      return true;
+    }
+
+    bool
+    number(JsonValue& out) {
+      const char* first = p;
+      if (p < m_end && *p == '-') ++p;
+      while (p < m_end && ((*p >= '0' && *p <= '9') || *p == '.' || *p == 'e' || *p == 'E' || *p == '+' || *p == '-')) ++p;
+      std::from_chars_result result = std::from_chars(first, p, out.m_number);
+      if (result.ec != std::errc() || result.ptr != p) {
+        p = first;
+        return fail("invalid number");
+      }
+      out.m_type = JsonValue::JSON_NUMBER;
+      return true;
+    }
+
+    static void
+    appendUtf8(std::string& out, unsigned int codepoint) {
+      if (codepoint < 0x80) {
+        out.push_back(static_cast<char>(codepoint));
+      }
+      else if (codepoint < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+      }
+      else if (codepoint < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+      }
+      else {
+        out.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+      }
+    }
+
+    bool
+    hex4(unsigned int& value) {
+      if (m_end - p < 4) return fail("truncated \\u escape");
+      value = 0;
+      for (int i = 0; i < 4; ++i, ++p) {
+        char c = *p;
+        value <<= 4;
+        if (c >= '0' && c <= '9') value |= static_cast<unsigned int>(c - '0');
+        else if (c >= 'a' && c <= 'f') value |= static_cast<unsigned int>(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') value |= static_cast<unsigned int>(c - 'A' + 10);
+        else return fail("invalid \\u escape");
+      }
+      return true;
+    }
+
+    bool
+    string(std::string& out) {
+      ++p;  // opening quote
+      out.clear();
+      for (;;) {
+        const char* run = p;
+        while (p < m_end && *p != '"' && *p != '\\') ++p;
+        out.append(run, p);
+        if (p >= m_end) return fail("unterminated string");
+        if (*p == '"') {
+          ++p;
+          return true;
+        }
+
+        ++p;  // backslash
+        if (p >= m_end) return fail("unterminated escape");
+        char c = *p++;
+        switch (c) {
+        case '"': out.push_back('"'); break;
+        case '\\': out.push_back('\\'); break;
+        case '/': out.push_back('/'); break;
+        case 'b': out.push_back('\b'); break;
+        case 'f': out.push_back('\f'); break;
+        case 'n': out.push_back('\n'); break;
+        case 'r': out.push_back('\r'); break;
+        case 't': out.push_back('\t'); break;
+        case 'u': {
+          unsigned int codepoint = 0;
+          if (!hex4(codepoint)) return false;
+          if (codepoint >= 0xD800 && codepoint < 0xDC00 && m_end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+            p += 2;
+            unsigned int low = 0;
+            if (!hex4(low)) return false;
+            codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+          }
+          appendUtf8(out, codepoint);
+          break;
+        }
+        default:
+          return fail("invalid escape");
+        }
+      }
+    }
+
+    bool
+    array(JsonValue& out, int depth) {
+      ++p;
+      out.m_type = JsonValue::JSON_ARRAY;
+      skipSpace();
+      if (p < m_end && *p == ']') {
+        ++p;
+        return true;
+      }
+      for (;;) {
+        out.m_items.emplace_back();
+        if (!value(out.m_items.back(), depth + 1)) return false;
+        skipSpace();
+        if (p < m_end && *p == ',') {
+          ++p;
+          continue;
+        }
+        if (p < m_end && *p == ']') {
+          ++p;
+          return true;
+        }
+        return fail("expected ',' or ']'");
+      }
+    }
+
+    bool
+    object(JsonValue& out, int depth) {
+      ++p;
+      out.m_type = JsonValue::JSON_OBJECT;
+      skipSpace();
+      if (p < m_end && *p == '}') {
+        ++p;
+        return true;
+      }
+      for (;;) {
+        skipSpace();
+        if (p >= m_end || *p != '"') return fail("expected member name");
+        out.m_keys.emplace_back();
+        if (!string(out.m_keys.back())) return false;
+        skipSpace();
+        if (p >= m_end || *p != ':') return fail("expected ':'");
+        ++p;
+        out.m_items.emplace_back();
+        if (!value(out.m_items.back(), depth + 1)) return false;
+        skipSpace();
+        if (p < m_end && *p == ',') {
+          ++p;
+          continue;
+        }
+        if (p < m_end && *p == '}') {
+          ++p;
+          return true;
+        }
+        return fail("expected ',' or '}'");
+      }
+    }
+
+    const char* m_begin;
+    const char* m_end;
+    std::string& m_error;
+  };
+}
+
+bool
+JsonValue::parse(const char* begin, const char* end, JsonValue& out, std::string& error) {
+  out = JsonValue();
+  JsonReader reader(begin, end, error);
+  if (!reader.value(out, 0)) {
+    return false;
+  }
+  reader.skipSpace();
+  // GLB pads its JSON chunk with spaces; anything else after the root is an error.
+  if (reader.p != end) {
+    return reader.fail("trailing characters after document");
+  }
+  return true;
+}
+
+const JsonValue&
+JsonValue::operator[](const char* key) const {
+  if (m_type != JSON_OBJECT) {
+    return kNull;
+  }
+  for (size_t i = 0; i < m_keys.size(); ++i) {
+    if (m_keys[i] == key) {
+      return m_items[i];
+    }
+  }
+  return kNull;
+}
+
+const JsonValue&
+JsonValue::item(size_t index) const {
+  return index < m_items.size() ? m_items[index] : kNull;
+}
@@ -0,0 +1,98 @@
+#include "MappedFile.h"
+
+HRESULT
+MappedFile::init(const std::string& fileName, bool mapWholeFile) {
+  destroy();
+
+  m_file = CreateFileA(fileName.c_str(),
+    GENERIC_READ,
+    FILE_SHARE_READ,
+    nullptr,
+    OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+    nullptr);
+  if (m_file == INVALID_HANDLE_VALUE) {
+    ERROR("MappedFile", "init", ("Failed to open file: " + fileName).c_str());
+    return E_FAIL;
+  }
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(m_file, &fileSize)) {
+    ERROR("MappedFile", "init", ("Failed to query file size: " + fileName).c_str());
+    destroy();
+    return E_FAIL;
+  }
+  m_size = static_cast<unsigned long long>(fileSize.QuadPart);
+
+  // Windows refuses to map zero-length files; callers just see an empty range.
+  if (m_size == 0) {
+    return S_OK;
+  }
+
+  m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!m_mapping) {
+    ERROR("MappedFile", "init", ("Failed to create file mapping: " + fileName).c_str());
+    destroy();
+    return E_FAIL;
+  }
+
+  if (!mapWholeFile) {
+    return S_OK;
+  }
+
+  m_view = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+  if (!m_view) {
+    ERROR("MappedFile", "init", ("Failed to map view of file: " + fileName).c_str());
+    destroy();
+    return E_FAIL;
+  }
+  m_viewSize = static_cast<size_t>(m_size);
+
+  return S_OK;
+}
+
+const char*
+MappedFile::mapWindow(unsigned long long offset, size_t size) {
+  if (!m_mapping || size == 0 || offset + size > m_size) {
+    return nullptr;
+  }
+  if (m_view) {
+    UnmapViewOfFile(m_view);
+    m_view = nullptr;
+    m_viewSize = 0;
+  }
+
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  unsigned long long base = offset - offset % info.dwAllocationGranularity;
+  size_t viewSize = static_cast<size_t>(offset - base) + size;
+  m_view = static_cast<const char*>(MapViewOfFile(m_mapping,
+    FILE_MAP_READ,
+    static_cast<DWORD>(base >> 32),
+    static_cast<DWORD>(base & 0xFFFFFFFFull),
+    viewSize));
+  if (!m_view) {
+    ERROR("MappedFile", "mapWindow", "Failed to map view of file.");
+    return nullptr;
+  }
+  m_viewSize = viewSize;
+  return m_view + (offset - base);
+}
+
+void
+MappedFile::destroy() {
+  if (m_view) {
+    UnmapViewOfFile(m_view);
+    m_view = nullptr;
+  }
+  m_viewSize = 0;
+  if (m_mapping) {
+    CloseHandle(m_mapping);
+    m_mapping = nullptr;
+  }
+  if (m_file != INVALID_HANDLE_VALUE) {
+    CloseHandle(m_file);
+    m_file = INVALID_HANDLE_VALUE;
+  }
+  m_size = 0;
+}
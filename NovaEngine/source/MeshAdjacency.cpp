@@ -0,0 +1,423 @@
+#include "MeshAdjacency.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+  // Widest radix digit; 2048 counters per block stay in L1.
+  const unsigned int kRadixBits = 11;
+
+  // Smallest block of items worth a thread.
+  const size_t kMinBlockItems = 1 << 16;
+
+  // Other vertex of a degenerate half-edge; sorts after every real one.
+  const unsigned long long kDegenerateOther = 0x7FFFFFFFull;
+
+  inline size_t
+  blockCountFor(size_t count, unsigned int threadCount) {
+    return std::max<size_t>(1, std::min(static_cast<size_t>(threadCount), count / kMinBlockItems));
+  }
+
+  /*
+    Stable counting sort of [first, last) of keys and values by one digit,
+    from the source arrays into the destination arrays at the same positions.
+  */
+  void
+  sortByDigit(const unsigned int* sourceKeys,
+              const unsigned long long* sourceValues,
+              unsigned int* destinationKeys,
+              unsigned long long* destinationValues,
+              size_t count,
+              unsigned int shift,
+              unsigned int digitBits,
+              std::vector<unsigned int>& cursor) {
+    unsigned int mask = (1u << digitBits) - 1;
+    cursor.assign(static_cast<size_t>(1) << digitBits, 0);
+    for (size_t i = 0; i < count; ++i) {
+      ++cursor[(sourceKeys[i] >> shift) & mask];
+    }
+    unsigned int sum = 0;
+    for (unsigned int& slot : cursor) {
+      unsigned int digitCount = slot;
+      slot = sum;
+      sum += digitCount;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      unsigned int slot = cursor[(sourceKeys[i] >> shift) & mask]++;
+      destinationKeys[slot] = sourceKeys[i];
+      destinationValues[slot] = sourceValues[i];
+    }
+  }
+
+  /*
+    Stable radix sort of values by the low keyBits bits of keys. One parallel
+    pass scatters by the top digit into partitions, counting per block and
+    turning the counts into digit-major, block-minor offsets; every partition
+    is then small enough to sort by the remaining bits in cache, one partition
+    per task. The order does not depend on the thread count.
+  */
+  void
+  radixSortByKey(std::vector<unsigned int>& keys,
+                 std::vector<unsigned long long>& values,
+                 unsigned int keyBits,
+                 unsigned int threadCount) {
+    size_t count = keys.size();
+    if (keyBits == 0 || count < 2) {
+      return;
+    }
+    unsigned int lowBits = std::min(keyBits, kRadixBits + 1);
+    unsigned int highBits = std::min(keyBits - lowBits, kRadixBits);
+    lowBits = keyBits - highBits;
+    std::vector<unsigned int> scratchKeys(count);
+    std::vector<unsigned long long> scratchValues(count);
+
+    size_t partitions = static_cast<size_t>(1) << highBits;
+    std::vector<size_t> partitionStart(partitions + 1, 0);
+    if (highBits == 0) {
+      scratchKeys.swap(keys);
+      scratchValues.swap(values);
+      partitionStart[1] = count;
+    }
+    else {
+      size_t blocks = blockCountFor(count, threadCount);
+      size_t blockSize = (count + blocks - 1) / blocks;
+      unsigned int mask = static_cast<unsigned int>(partitions - 1);
+      std::vector<unsigned int> offsets(blocks * partitions);
+      parallelFor(blocks, threadCount, [&](size_t b) {
+        unsigned int* counts = offsets.data() + b * partitions;
+        std::fill(counts, counts + partitions, 0u);
+        size_t last = std::min(count, (b + 1) * blockSize);
+        for (size_t i = b * blockSize; i < last; ++i) {
+          ++counts[(keys[i] >> lowBits) & mask];
+        }
+      });
+      unsigned int sum = 0;
+      for (size_t d = 0; d < partitions; ++d) {
+        partitionStart[d] = sum;
+        for (size_t b = 0; b < blocks; ++b) {
+          unsigned int& slot = offsets[b * partitions + d];
+          unsigned int blockCount = slot;
+          slot = sum;
+          sum += blockCount;
+        }
+      }
+      partitionStart[partitions] = count;
+      parallelFor(blocks, threadCount, [&](size_t b) {
+        unsigned int* cursor = offsets.data() + b * partitions;
+        size_t last = std::min(count, (b + 1) * blockSize);
+        for (size_t i = b * blockSize; i < last; ++i) {
+          unsigned int slot = cursor[(keys[i] >> lowBits) & mask]++;
+          scratchKeys[slot] = keys[i];
+          scratchValues[slot] = values[i];
+        }
+      });
+    }
+
+    // Sort each partition by the low bits, from scratch back into place; an
+    // even number of digits ends in scratch and is copied back.
+    unsigned int passes = (lowBits + kRadixBits) / (kRadixBits + 1);
+    unsigned int digitBits = (lowBits + passes - 1) / passes;
+    parallelFor(partitions, threadCount, [&](size_t d) {
+      size_t first = partitionStart[d];
+      size_t size = partitionStart[d + 1] - first;
+      if (size == 0) {
+        return;
+      }
+      std::vector<unsigned int> cursor;
+      unsigned int* fromKeys = scratchKeys.data() + first;
+      unsigned long long* fromValues = scratchValues.data() + first;
+      unsigned int* toKeys = keys.data() + first;
+      unsigned long long* toValues = values.data() + first;
+      for (unsigned int pass = 0; pass < passes; ++pass) {
+        unsigned int bits = std::min(digitBits, lowBits - pass * digitBits);
+        sortByDigit(fromKeys, fromValues, toKeys, toValues, size, pass * digitBits, bits, cursor);
+        std::swap(fromKeys, toKeys);
+        std::swap(fromValues, toValues);
+      }
+      if (passes % 2 == 0) {
+        std::copy(fromKeys, fromKeys + size, toKeys);
+        std::copy(fromValues, fromValues + size, toValues);
+      }
+    });
+  }
+
+  /*
+    Splits sorted keys into one block per thread, each starting at the start
+    of a run of equal keys, so a run is always handled by a single thread.
+    Returns blocks + 1 boundaries.
+  */
+  std::vector<size_t>
+  runBlocks(const std::vector<unsigned int>& keys, unsigned int threadCount) {
+    size_t count = keys.size();
+    size_t blocks = blockCountFor(count, threadCount);
+    size_t blockSize = (count + blocks - 1) / blocks;
+    std::vector<size_t> bounds(blocks + 1, count);
+    bounds[0] = 0;
+    for (size_t b = 1; b < blocks; ++b) {
+      size_t bound = std::max(bounds[b - 1], std::min(count, b * blockSize));
+      while (bound > 0 && bound < count && keys[bound] == keys[bound - 1]) {
+        ++bound;
+      }
+      bounds[b] = bound;
+    }
+    return bounds;
+  }
+
+  /*
+    Sorts a short run in place; most runs hold the half-edges around one
+    vertex, about six.
+  */
+  inline void
+  sortRun(unsigned long long* first, unsigned long long* last) {
+    if (last - first > 16) {
+      std::sort(first, last);
+      return;
+    }
+    for (unsigned long long* i = first + 1; i < last; ++i) {
+      unsigned long long value = *i;
+      unsigned long long* j = i;
+      for (; j > first && *(j - 1) > value; --j) {
+        *j = *(j - 1);
+      }
+      *j = value;
+    }
+  }
+
+  /*
+    Builds twins, edges and vertex half-edges once adjacency.origin holds the
+    vertex every half-edge leaves (kNoHalfEdge for an invalid index).
+  */
+  void
+  buildFromOrigins(MeshAdjacency& adjacency, size_t vertexCount, unsigned int threadCount) {
+    const std::vector<unsigned int>& origin = adjacency.origin;
+    size_t halfEdgeCount = origin.size();
+    adjacency.twin.resize(halfEdgeCount);
+    adjacency.edge.resize(halfEdgeCount);
+    adjacency.edgeHalfEdge.clear();
+    adjacency.edgeFlags.clear();
+    adjacency.vertexHalfEdge.assign(vertexCount, kNoHalfEdge);
+    adjacency.openEdges = 0;
+    adjacency.nonManifoldEdges = 0;
+    adjacency.degenerateHalfEdges = 0;
+    if (halfEdgeCount == 0) {
+      return;
+    }
+
+    // Key every half-edge by its smaller vertex and carry the other vertex,
+    // the direction (1 if it leaves the larger vertex) and the half-edge, so
+    // the runs are resolved without going back to origin.
+    std::vector<unsigned int> keys(halfEdgeCount);
+    std::vector<unsigned long long> values(halfEdgeCount);
+    parallelForRange(halfEdgeCount, threadCount, kMinBlockItems, [&](size_t first, size_t last) {
+      for (size_t h = first; h < last; ++h) {
+        unsigned int a = origin[h];
+        unsigned int b = origin[halfEdgeNext(static_cast<unsigned int>(h))];
+        bool degenerate = a == kNoHalfEdge || b == kNoHalfEdge || a == b;
+        keys[h] = degenerate ? 0 : std::min(a, b);
+        unsigned long long other = degenerate ? kDegenerateOther : std::max(a, b);
+        values[h] = (other << 33) | (static_cast<unsigned long long>(!degenerate && a > b) << 32) | h;
+      }
+    });
+    unsigned int keyBits = 0;
+    while (keyBits < 32 && (static_cast<size_t>(1) << keyBits) < vertexCount) {
+      ++keyBits;
+    }
+    radixSortByKey(keys, values, keyBits, threadCount);
+
+    // Order every run by other vertex, then direction, then half-edge, and
+    // count the edges of each block to number them in sorted order.
+    std::vector<size_t> bounds = runBlocks(keys, threadCount);
+    size_t blocks = bounds.size() - 1;
+    std::vector<unsigned int> blockEdges(blocks + 1, 0);
+    std::vector<size_t> blockDegenerate(blocks, 0);
+    parallelFor(blocks, threadCount, [&](size_t b) {
+      for (size_t first = bounds[b]; first < bounds[b + 1];) {
+        size_t end = first + 1;
+        while (end < bounds[b + 1] && keys[end] == keys[first]) {
+          ++end;
+        }
+        sortRun(values.data() + first, values.data() + end);
+        for (size_t i = first; i < end; ++i) {
+          unsigned long long other = values[i] >> 33;
+          if (other == kDegenerateOther) {
+            blockDegenerate[b] += end - i;
+            break;
+          }
+          if (i == first || other != (values[i - 1] >> 33)) {
+            ++blockEdges[b + 1];
+          }
+        }
+        first = end;
+      }
+    });
+    for (size_t b = 0; b < blocks; ++b) {
+      blockEdges[b + 1] += blockEdges[b];
+      adjacency.degenerateHalfEdges += blockDegenerate[b];
+    }
+    adjacency.edgeHalfEdge.resize(blockEdges[blocks]);
+    adjacency.edgeFlags.resize(blockEdges[blocks]);
+
+    // Pair the k-th half-edge of each direction of every edge; the rest of a
+    // non-manifold edge stays without a twin. The vertex half-edges keep the
+    // smallest half-edge, open ones first, through an atomic minimum.
+    std::vector<std::atomic<unsigned int>> start(vertexCount);
+    parallelForRange(vertexCount, threadCount, kMinBlockItems, [&](size_t first, size_t last) {
+      for (size_t v = first; v < last; ++v) {
+        start[v].store(kNoHalfEdge, std::memory_order_relaxed);
+      }
+    });
+    auto offerStart = [&](unsigned int vertex, unsigned int h, bool open) {
+      unsigned int candidate = open ? h : (h | 0x80000000u);
+      std::atomic<unsigned int>& slot = start[vertex];
+      unsigned int current = slot.load(std::memory_order_relaxed);
+      while (candidate < current && !slot.compare_exchange_weak(current, candidate, std::memory_order_relaxed)) {
+      }
+    };
+    parallelFor(blocks, threadCount, [&](size_t b) {
+      unsigned int next = blockEdges[b];
+      for (size_t i = bounds[b]; i < bounds[b + 1];) {
+        unsigned long long other = values[i] >> 33;
+        size_t j = i + 1;
+        while (j < bounds[b + 1] && keys[j] == keys[i] && (values[j] >> 33) == other) {
+          ++j;
+        }
+        if (other == kDegenerateOther) {
+          for (size_t k = i; k < j; ++k) {
+            unsigned int h = static_cast<unsigned int>(values[k]);
+            adjacency.twin[h] = kNoHalfEdge;
+            adjacency.edge[h] = kNoHalfEdge;
+          }
+          i = j;
+          continue;
+        }
+
+        size_t forward = i;
+        while (forward < j && !((values[forward] >> 32) & 1)) {
+          ++forward;
+        }
+        size_t forwardCount = forward - i;
+        size_t backwardCount = j - forward;
+        unsigned int id = next++;
+        unsigned int firstHalfEdge = static_cast<unsigned int>(values[i]);
+        if (forwardCount != 0 && backwardCount != 0) {
+          firstHalfEdge = std::min(firstHalfEdge, static_cast<unsigned int>(values[forward]));
+        }
+        adjacency.edgeHalfEdge[id] = firstHalfEdge;
+        adjacency.edgeFlags[id] = static_cast<unsigned char>(
+          (j - i == 1) ? MESH_EDGE_OPEN : (forwardCount != 1 || backwardCount != 1) ? MESH_EDGE_NON_MANIFOLD : 0);
+
+        for (size_t k = i; k < j; ++k) {
+          unsigned int h = static_cast<unsigned int>(values[k]);
+          bool backward = k >= forward;
+          size_t rank = backward ? k - forward : k - i;
+          unsigned int twin = kNoHalfEdge;
+          if (rank < (backward ? forwardCount : backwardCount)) {
+            twin = static_cast<unsigned int>(values[(backward ? i : forward) + rank]);
+          }
+          adjacency.twin[h] = twin;
+          adjacency.edge[h] = id;
+          offerStart(backward ? static_cast<unsigned int>(other) : keys[i], h, twin == kNoHalfEdge);
+        }
+        i = j;
+      }
+    });
+    for (unsigned char flags : adjacency.edgeFlags) {
+      adjacency.openEdges += (flags & MESH_EDGE_OPEN) ? 1 : 0;
+      adjacency.nonManifoldEdges += (flags & MESH_EDGE_NON_MANIFOLD) ? 1 : 0;
+    }
+    parallelForRange(vertexCount, threadCount, kMinBlockItems, [&](size_t first, size_t last) {
+      for (size_t v = first; v < last; ++v) {
+        unsigned int value = start[v].load(std::memory_order_relaxed);
+        adjacency.vertexHalfEdge[v] = (value == kNoHalfEdge) ? kNoHalfEdge : (value & 0x7FFFFFFFu);
+      }
+    });
+  }
+}
+
+void
+buildAdjacency(MeshAdjacency& adjacency,
+               const unsigned int* indices,
+               size_t indexCount,
+               size_t vertexCount,
+               unsigned int threadCount) {
+  threadCount = resolveThreadCount(threadCount);
+  size_t halfEdgeCount = indexCount / 3 * 3;
+  adjacency.origin.resize(halfEdgeCount);
+  parallelForRange(halfEdgeCount, threadCount, kMinBlockItems, [&](size_t first, size_t last) {
+    for (size_t h = first; h < last; ++h) {
+      adjacency.origin[h] = (indices[h] < vertexCount) ? indices[h] : kNoHalfEdge;
+    }
+  });
+  buildFromOrigins(adjacency, vertexCount, threadCount);
+}
+
+void
+buildAdjacency(MeshAdjacency& adjacency, const MeshComponent& mesh, bool weldPositions, unsigned int threadCount) {
+  if (!weldPositions) {
+    buildAdjacency(adjacency, mesh.m_index.data(), mesh.m_index.size(), mesh.m_vertex.size(), threadCount);
+    return;
+  }
+  threadCount = resolveThreadCount(threadCount);
+  size_t vertexCount = mesh.m_vertex.size();
+
+  // Sort the vertices by a hash of their position; within a run of equal
+  // hashes every vertex maps to the first one at the same position. Adding 0
+  // turns -0 into +0.
+  unsigned int hashBits = 1;
+  while (hashBits < 32 && (static_cast<size_t>(1) << hashBits) < vertexCount) {
+    ++hashBits;
+  }
+  std::vector<unsigned int> keys(vertexCount);
+  std::vector<unsigned long long> values(vertexCount);
+  parallelForRange(vertexCount, threadCount, kMinBlockItems, [&](size_t first, size_t last) {
+    for (size_t v = first; v < last; ++v) {
+      const XMFLOAT3& p = mesh.m_vertex[v].Pos;
+      float key[3] = { p.x + 0.0f, p.y + 0.0f, p.z + 0.0f };
+      unsigned int bits[3];
+      memcpy(bits, key, sizeof(bits));
+      keys[v] = ((bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u)) >> (32 - hashBits);
+      values[v] = v;
+    }
+  });
+  radixSortByKey(keys, values, hashBits, threadCount);
+
+  std::vector<unsigned int> remap(vertexCount);
+  std::vector<size_t> bounds = runBlocks(keys, threadCount);
+  parallelFor(bounds.size() - 1, threadCount, [&](size_t b) {
+    for (size_t first = bounds[b]; first < bounds[b + 1];) {
+      size_t end = first + 1;
+      while (end < bounds[b + 1] && keys[end] == keys[first]) {
+        ++end;
+      }
+      for (size_t i = first; i < end; ++i) {
+        unsigned int v = static_cast<unsigned int>(values[i]);
+        const XMFLOAT3& p = mesh.m_vertex[v].Pos;
+        remap[v] = v;
+        for (size_t j = first; j < i; ++j) {
+          unsigned int w = static_cast<unsigned int>(values[j]);
+          const XMFLOAT3& q = mesh.m_vertex[w].Pos;
+          if (q.x == p.x && q.y == p.y && q.z == p.z) {
+            remap[v] = w;
+            break;
+          }
+        }
+      }
+      first = end;
+    }
+  });
+  std::vector<unsigned int>().swap(keys);
+  std::vector<unsigned long long>().swap(values);
+
+  size_t halfEdgeCount = mesh.m_index.size() / 3 * 3;
+  adjacency.origin.resize(halfEdgeCount);
+  parallelForRange(halfEdgeCount, threadCount, kMinBlockItems, [&](size_t first, size_t last) {
+    for (size_t h = first; h < last; ++h) {
+      unsigned int index = mesh.m_index[h];
+      adjacency.origin[h] = (index < vertexCount) ? remap[index] : kNoHalfEdge;
+    }
+  });
+  buildFromOrigins(adjacency, vertexCount, threadCount);
+  for (size_t v = 0; v < vertexCount; ++v) {
+    adjacency.vertexHalfEdge[v] = adjacency.vertexHalfEdge[remap[v]];
+  }
+}
@@ -0,0 +1,1525 @@
+#include "MeshBenchmark.h"
+#include "MeshAdjacency.h"
+#include "MeshBounds.h"
+#include "MeshCleanup.h"
+#include "MeshClusters.h"
+#include "MeshCodec.h"
+#include "MeshQuantization.h"
+#include "MeshSimplifier.h"
+#include "MappedFile.h"
+#include "PositionWeldGrid.h"
+#include "ProcessMemory.h"
+#include "Timer.h"
+#include "VertexDedupTable.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+
+void
+MeshBenchmark::run(const std::string& modelName) {
+  report("NovaEngine mesh benchmark: " + modelName);
+  benchmarkStream(modelName, 64u << 20);
+  benchmarkOBJ(modelName, 5);
+  benchmarkOBJThreads(modelName);
+  benchmarkCache(modelName);
+  benchmarkGLTF(modelName);
+  benchmarkPLY(modelName);
+  benchmarkSTL(modelName);
+  benchmarkNormals(modelName);
+  benchmarkTangents(modelName);
+  benchmarkVertexCache(modelName, 10000000);
+  benchmarkOverdraw(modelName);
+  benchmarkVertexFetch(modelName);
+  benchmarkLods(modelName);
+  benchmarkClusters(modelName);
+  benchmarkQuantization(modelName);
+  benchmarkCodec(modelName);
+  benchmarkCleanup(modelName);
+  benchmarkIndexFormat(modelName);
+  benchmarkDirtyRanges(modelName);
+  benchmarkAdjacency(modelName, 10000000);
+  benchmarkBounds(modelName);
+  benchmarkDedup(10000000);
+}
+
+void
+MeshBenchmark::benchmarkOBJ(const std::string& modelName, unsigned int iterations) {
+  ModelLoader loader;
+  MeshComponent reference;
+  MeshComponent mapped;
+  ModelLoadOptions options;
+  options.threadCount = 1;
+  options.useCache = false;
+  // The reference parser leaves missing normals at (0, 1, 0).
+  options.generateNormals = false;
+
+  // Warm the file cache so both parsers read from memory.
+  if (!loader.LoadOBJReference(modelName, reference)) {
+    report("OBJ: failed to load " + modelName);
+    return;
+  }
+
+  double referenceBest = 1e30;
+  double mappedBest = 1e30;
+  for (unsigned int i = 0; i < iterations; ++i) {
+    loader.LoadOBJReference(modelName, reference);
+    referenceBest = std::min(referenceBest, loader.m_stats.seconds);
+    loader.LoadOBJ(modelName, mapped, options);
+    mappedBest = std::min(mappedBest, loader.m_stats.seconds);
+  }
+
+  double megabytes = static_cast<double>(loader.m_stats.bytes) / (1024.0 * 1024.0);
+  std::ostringstream line;
+  line << "OBJ parse " << megabytes << " MB: reference " << megabytes / referenceBest
+       << " MB/s, mapped " << megabytes / mappedBest << " MB/s, speedup "
+       << referenceBest / mappedBest << "x, identical " << (identical(reference, mapped) ? "yes" : "NO");
+  report(line.str());
+}
+
+void
+MeshBenchmark::benchmarkOBJThreads(const std::string& modelName) {
+  ModelLoader loader;
+  MeshComponent single;
+  ModelLoadOptions options;
+  options.threadCount = 1;
+  options.useCache = false;
+  if (!loader.LoadOBJ(modelName, single, options)) {
+    report("OBJ threads: failed to load " + modelName);
+    return;
+  }
+
+  double singleBest = 0.0;
+  const unsigned int threadCounts[] = { 1, 2, 4, 8, 16, 32 };
+  for (unsigned int threads : threadCounts) {
+    options.threadCount = threads;
+    MeshComponent mesh;
+    double best = 1e30;
+    for (unsigned int i = 0; i < 3; ++i) {
+      loader.LoadOBJ(modelName, mesh, options);
+      best = std::min(best, loader.m_stats.seconds);
+    }
+    if (threads == 1) {
+      singleBest = best;
+    }
+
+    double megabytes = static_cast<double>(loader.m_stats.bytes) / (1024.0 * 1024.0);
+    std::ostringstream line;
+    line << "OBJ threads " << threads << ": " << megabytes / best << " MB/s, scaling "
+         << singleBest / best << "x, identical " << (identical(single, mesh) ? "yes" : "NO");
+    report(line.str());
+  }
+}
+
+void
+MeshBenchmark::benchmarkCache(const std::string& modelName) {
+  std::string cachePath = modelName + ".novamesh";
+  for (int compress = 1; compress >= 0; --compress) {
+    DeleteFileA(cachePath.c_str());
+
+    ModelLoader loader;
+    MeshComponent cold;
+    MeshComponent warm;
+    ModelLoadOptions options;
+    options.compressCache = compress != 0;
+    if (!loader.LoadOBJ(modelName, cold, options)) {
+      report("Cache: failed to load " + modelName);
+      return;
+    }
+    double coldSeconds = loader.m_stats.seconds;
+
+    double warmBest = 1e30;
+    bool hit = true;
+    for (unsigned int i = 0; i < 5; ++i) {
+      loader.LoadOBJ(modelName, warm, options);
+      warmBest = std::min(warmBest, loader.m_stats.seconds);
+      hit = hit && loader.m_stats.fromCache;
+    }
+
+    size_t cacheBytes = 0;
+    {
+      MappedFile file;
+      if (SUCCEEDED(file.init(cachePath))) {
+        cacheBytes = file.size();
+      }
+    }
+
+    std::ostringstream line;
+    line << "Cache (" << (compress ? "compressed" : "raw") << ", " << cacheBytes / 1024 << " KB): cold (parse + write) "
+         << coldSeconds * 1000.0 << " ms, warm (mapped .novamesh) " << warmBest * 1000.0 << " ms, speedup "
+         << coldSeconds / warmBest << "x, hit " << (hit ? "yes" : "NO") << ", identical "
+         << (identical(cold, warm) ? "yes" : "NO");
+    report(line.str());
+  }
+}
+
+void
+MeshBenchmark::benchmarkStream(const std::string& modelName, size_t memoryBudget) {
+  ModelLoader loader;
+  ModelStreamOptions streamOptions;
+  streamOptions.memoryBudget = memoryBudget;
+
+  unsigned long long streamHash = 0;
+  size_t streamIndices = 0;
+  bool streamed = loader.StreamOBJ(modelName, streamOptions, [&](MeshComponent& chunk) {
+    streamHash += triangleHash(chunk);
+    streamIndices += chunk.m_index.size();
+    return true;
+  });
+  if (!streamed) {
+    report("Stream: failed to stream " + modelName);
+    return;
+  }
+  ModelLoadStats streamStats = loader.m_stats;
+  unsigned long long streamProcessPeak = processPeakWorkingSet();
+
+  MeshComponent mesh;
+  ModelLoadOptions options;
+  options.useCache = false;
+  if (!loader.LoadOBJ(modelName, mesh, options)) {
+    report("Stream: failed to load " + modelName);
+    return;
+  }
+  ModelLoadStats loadStats = loader.m_stats;
+  unsigned long long loadProcessPeak = processPeakWorkingSet();
+  bool same = streamIndices == mesh.m_index.size() && streamHash == triangleHash(mesh);
+
+  const double megabyte = 1024.0 * 1024.0;
+  std::ostringstream line;
+  line << "Stream " << memoryBudget / megabyte << " MB budget: " << streamStats.megabytesPerSecond()
+       << " MB/s, " << streamStats.chunks << " chunks, peak " << streamStats.peakBytes / megabyte
+       << " MB, spilled " << streamStats.spilledBytes / megabyte << " MB, process peak "
+       << streamProcessPeak / megabyte << " MB | LoadOBJ " << loadStats.megabytesPerSecond()
+       << " MB/s, peak " << loadStats.peakBytes / megabyte << " MB, process peak "
+       << loadProcessPeak / megabyte << " MB | same triangles " << (same ? "yes" : "NO");
+  report(line.str());
+}
+
+void
+MeshBenchmark::benchmarkGLTF(const std::string& modelName) {
+  ModelLoader loader;
+  MeshComponent objMesh;
+  ModelLoadOptions options;
+  options.useCache = false;
+  if (!loader.LoadOBJ(modelName, objMesh, options)) {
+    report("glTF: failed to load " + modelName);
+    return;
+  }
+
+  std::string glbPath = modelName + ".glb";
+  bool temporary = GetFileAttributesA(glbPath.c_str()) == INVALID_FILE_ATTRIBUTES;
+  if (temporary) {
+    glbPath = modelName + "_bench.glb";
+    if (FAILED(writeGLB(glbPath, objMesh))) {
+      report("glTF: failed to write " + glbPath);
+      return;
+    }
+  }
+
+  double objBest = 1e30;
+  double gltfBest = 1e30;
+  MeshComponent gltfMesh;
+  bool loaded = true;
+  for (unsigned int i = 0; i < 5 && loaded; ++i) {
+    loader.LoadOBJ(modelName, objMesh, options);
+    objBest = std::min(objBest, loader.m_stats.seconds);
+    loaded = loader.LoadGLTF(glbPath, gltfMesh, options);
+    gltfBest = std::min(gltfBest, loader.m_stats.seconds);
+  }
+  ModelLoadStats gltfStats = loader.m_stats;
+  if (temporary) {
+    DeleteFileA(glbPath.c_str());
+  }
+  if (!loaded) {
+    report("glTF: failed to load " + glbPath);
+    return;
+  }
+
+  bool same = objMesh.m_index.size() == gltfMesh.m_index.size() && triangleHash(objMesh) == triangleHash(gltfMesh);
+  std::ostringstream line;
+  line << "glTF: LoadOBJ " << objBest * 1000.0 << " ms, LoadGLTF " << gltfBest * 1000.0 << " ms ("
+       << gltfStats.bytes / (1024.0 * 1024.0) << " MB " << (temporary ? "generated" : "existing") << " .glb), speedup "
+       << objBest / gltfBest << "x, " << gltfStats.chunks << " primitives, " << gltfStats.directCopies
+       << " vertex ranges block-copied, same triangles " << (same ? "yes" : "NO");
+  report(line.str());
+}
+
+void
+MeshBenchmark::benchmarkPLY(const std::string& modelName) {
+  ModelLoader loader;
+  MeshComponent objMesh;
+  ModelLoadOptions options;
+  options.useCache = false;
+  if (!loader.LoadOBJ(modelName, objMesh, options)) {
+    report("PLY: failed to load " + modelName);
+    return;
+  }
+  double objSeconds = loader.m_stats.seconds;
+
+  const char* variants[2] = { "_bench", "_bench_points" };
+  for (int variant = 0; variant < 2; ++variant) {
+    std::string plyName = modelName + variants[variant];
+    bool withFaces = variant == 0;
+    if (FAILED(writePLY(plyName + ".ply", objMesh, withFaces))) {
+      report("PLY: failed to write " + plyName + ".ply");
+      return;
+    }
+
+    // Read bandwidth of the same mapped file: one pass touching every cache line.
+    double readBest = 1e30;
+    {
+      MappedFile file;
+      if (SUCCEEDED(file.init(plyName + ".ply"))) {
+        for (unsigned int i = 0; i < 5; ++i) {
+          Timer timer;
+          const unsigned char* data = reinterpret_cast<const unsigned char*>(file.data());
+          size_t sum = 0;
+          for (size_t offset = 0; offset < file.size(); offset += 64) {
+            sum += data[offset];
+          }
+          readBest = std::min(readBest, timer.elapsedSeconds());
+          volatile size_t sink = sum;
+          (void)sink;
+        }
+      }
+    }
+
+    MeshComponent plyMesh;
+    double plyBest = 1e30;
+    bool loaded = true;
+    for (unsigned int i = 0; i < 5 && loaded; ++i) {
+      loaded = loader.LoadPLY(plyName, plyMesh, options);
+      plyBest = std::min(plyBest, loader.m_stats.seconds);
+    }
+    ModelLoadStats plyStats = loader.m_stats;
+    DeleteFileA((plyName + ".ply").c_str());
+    if (!loaded) {
+      report("PLY: failed to load " + plyName + ".ply");
+      return;
+    }
+
+    double megabytes = static_cast<double>(plyStats.bytes) / (1024.0 * 1024.0);
+    std::ostringstream line;
+    line << "PLY " << (withFaces ? "mesh" : "points") << " " << megabytes << " MB: LoadPLY " << plyBest * 1000.0
+         << " ms (" << megabytes / plyBest << " MB/s), mapped read " << megabytes / readBest << " MB/s";
+    if (withFaces) {
+      bool same = objMesh.m_index.size() == plyMesh.m_index.size() && triangleHash(objMesh) == triangleHash(plyMesh);
+      line << ", LoadOBJ " << objSeconds * 1000.0 << " ms, same triangles " << (same ? "yes" : "NO");
+    }
+    else {
+      bool same = plyMesh.m_index.empty() && plyMesh.m_vertex.size() == objMesh.m_vertex.size() &&
+        memcmp(plyMesh.m_vertex.data(), objMesh.m_vertex.data(), objMesh.m_vertex.size() * sizeof(SimpleVertex)) == 0;
+      line << ", same points " << (same ? "yes" : "NO");
+    }
+    report(line.str());
+  }
+}
+
+void
+MeshBenchmark::benchmarkSTL(const std::string& modelName) {
+  ModelLoader loader;
+  MeshComponent objMesh;
+  ModelLoadOptions loadOptions;
+  loadOptions.useCache = false;
+  if (!loader.LoadOBJ(modelName, objMesh, loadOptions)) {
+    report("STL: failed to load " + modelName);
+    return;
+  }
+  std::string stlName = modelName + "_bench";
+  if (FAILED(writeSTL(stlName + ".stl", objMesh))) {
+    report("STL: failed to write " + stlName + ".stl");
+    return;
+  }
+
+  float dx = objMesh.m_boundsMax.x - objMesh.m_boundsMin.x;
+  float dy = objMesh.m_boundsMax.y - objMesh.m_boundsMin.y;
+  float dz = objMesh.m_boundsMax.z - objMesh.m_boundsMin.z;
+  float diagonal = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+  struct Mode {
+    const char* name;
+    float tolerance;
+    bool smooth;
+  };
+  const Mode modes[] = { { "exact smooth", 0.0f, true },
+                         { "exact faceted", 0.0f, false },
+                         { "1e-5 diagonal smooth", diagonal * 1e-5f, true } };
+  for (const Mode& mode : modes) {
+    ModelLoadOptions options;
+    options.weldOptions.tolerance = mode.tolerance;
+    options.weldOptions.smoothNormals = mode.smooth;
+    MeshComponent stlMesh;
+    double best = 1e30;
+    bool loaded = true;
+    for (unsigned int i = 0; i < 3 && loaded; ++i) {
+      loaded = loader.LoadSTL(stlName, stlMesh, options);
+      best = std::min(best, loader.m_stats.seconds);
+    }
+    if (!loaded) {
+      report("STL: failed to load " + stlName + ".stl");
+      break;
+    }
+
+    std::ostringstream line;
+    line << "STL " << mode.name << ": " << loader.m_stats.inputVertices / 3 << " triangles in " << best * 1000.0
+         << " ms (" << loader.m_stats.bytes / (1024.0 * 1024.0) / best << " MB/s), "
+         << loader.m_stats.inputVertices << " -> " << stlMesh.m_vertex.size() << " vertices, weld ratio "
+         << static_cast<double>(loader.m_stats.inputVertices) / std::max<size_t>(1, stlMesh.m_vertex.size())
+         << ":1 (OBJ has " << objMesh.m_vertex.size() << ")";
+    if (mode.tolerance == 0.0f) {
+      bool same = stlMesh.m_index.size() == objMesh.m_index.size();
+      for (size_t i = 0; same && i < objMesh.m_index.size(); ++i) {
+        same = memcmp(&stlMesh.m_vertex[stlMesh.m_index[i]].Pos, &objMesh.m_vertex[objMesh.m_index[i]].Pos,
+                      sizeof(XMFLOAT3)) == 0;
+      }
+      line << ", same positions " << (same ? "yes" : "NO");
+    }
+    report(line.str());
+  }
+  DeleteFileA((stlName + ".stl").c_str());
+}
+
+void
+MeshBenchmark::benchmarkNormals(const std::string& modelName) {
+  ModelLoader loader;
+  MeshComponent objMesh;
+  ModelLoadOptions options;
+  options.useCache = false;
+  if (!loader.LoadOBJ(modelName, objMesh, options)) {
+    report("Normals: failed to load " + modelName);
+    return;
+  }
+  std::string bareName = modelName + "_nonormals";
+  if (FAILED(writeOBJ(bareName + ".obj", objMesh))) {
+    report("Normals: failed to write " + bareName + ".obj");
+    return;
+  }
+
+  MeshComponent plain;
+  MeshComponent generated;
+  MeshComponent single;
+  double plainBest = 1e30;
+  double generatedBest = 1e30;
+  double singleBest = 1e30;
+  bool loaded = true;
+  for (unsigned int i = 0; i < 3 && loaded; ++i) {
+    options.threadCount = 0;
+    options.generateNormals = false;
+    loaded = loader.LoadOBJ(bareName, plain, options);
+    plainBest = std::min(plainBest, loader.m_stats.seconds);
+    options.generateNormals = true;
+    loaded = loaded && loader.LoadOBJ(bareName, generated, options);
+    generatedBest = std::min(generatedBest, loader.m_stats.seconds);
+    options.threadCount = 1;
+    loaded = loaded && loader.LoadOBJ(bareName, single, options);
+    singleBest = std::min(singleBest, loader.m_stats.seconds);
+  }
+  size_t splits = loader.m_stats.normalSplits;
+  DeleteFileA((bareName + ".obj").c_str());
+  if (!loaded) {
+    report("Normals: failed to load " + bareName + ".obj");
+    return;
+  }
+
+  // The temporary file keeps the triangle order, so corners compare one to one.
+  double angleSum = 0.0;
+  size_t corners = std::min(objMesh.m_index.size(), generated.m_index.size());
+  for (size_t i = 0; i < corners; ++i) {
+    XMVECTOR a = XMLoadFloat3(&objMesh.m_vertex[objMesh.m_index[i]].Normal);
+    XMVECTOR b = XMLoadFloat3(&generated.m_vertex[generated.m_index[i]].Normal);
+    angleSum += XMVectorGetX(XMVector3AngleBetweenNormals(XMVector3Normalize(a), b));
+  }
+
+  std::ostringstream line;
+  line << "Normals: load without vn " << plainBest * 1000.0 << " ms, with generated normals "
+       << generatedBest * 1000.0 << " ms (1 thread " << singleBest * 1000.0 << " ms), "
+       << plain.m_vertex.size() << " -> " << generated.m_vertex.size() << " vertices (" << splits
+       << " splits), mean error vs source normals "
+       << (corners ? angleSum / corners * 180.0 / 3.14159265358979 : 0.0) << " degrees, thread-identical "
+       << (identical(generated, single) ? "yes" : "NO");
+  report(line.str());
+}
+
+void
+MeshBenchmark::benchmarkTangents(const std::string& modelName) {
+  ModelLoader loader;
+  ModelLoadOptions options;
+  options.useCache = false;
+  MeshComponent plain;
+  MeshComponent tangent;
+  MeshComponent single;
+  double plainBest = 1e30;
+  double tangentBest = 1e30;
+  double passBest = 1e30;
+  double singlePassBest = 1e30;
+  bool loaded = true;
+  for (unsigned int i = 0; i < 3 && loaded; ++i) {
+    options.threadCount = 0;
+    options.generateTangents = false;
+    loaded = loader.LoadOBJ(modelName, plain, options);
+    plainBest = std::min(plainBest, loader.m_stats.seconds);
+    options.generateTangents = true;
+    loaded = loaded && loader.LoadOBJ(modelName, tangent, options);
+    tangentBest = std::min(tangentBest, loader.m_stats.seconds);
+    passBest = std::min(passBest, loader.m_stats.tangentSeconds);
+    options.threadCount = 1;
+    loaded = loaded && loader.LoadOBJ(modelName, single, options);
+    singlePassBest = std::min(singlePassBest, loader.m_stats.tangentSeconds);
+  }
+  if (!loaded) {
+    report("Tangents: failed to load " + modelName);
+    return;
+  }
+
+  float worstDot = 0.0f;
+  for (size_t i = 0; i < tangent.m_vertex.size(); ++i) {
+    XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&tangent.m_vertex[i].Normal));
+    XMVECTOR t = XMLoadFloat4(&tangent.m_tangent[i]);
+    worstDot = std::max(worstDot, std::fabs(XMVectorGetX(XMVector3Dot(n, t))));
+  }
+  bool same = identical(tangent, single) && tangent.m_tangent.size() == single.m_tangent.size() &&
+    memcmp(tangent.m_tangent.data(), single.m_tangent.data(), tangent.m_tangent.size() * sizeof(XMFLOAT4)) == 0;
+
+  std::ostringstream line;
+  line << "Tangents: load " << plainBest * 1000.0 << " ms, with tangents " << tangentBest * 1000.0
+       << " ms (+" << (tangentBest / plainBest - 1.0) * 100.0 << "%), tangent pass " << passBest * 1000.0
+       << " ms (1 thread " << singlePassBest * 1000.0 << " ms), " << plain.m_vertex.size() << " -> "
+       << tangent.m_vertex.size() << " vertices, max |dot(N, T)| " << worstDot << ", thread-identical "
+       << (same ? "yes" : "NO");
+  report(line.str());
+}
+
+void
+MeshBenchmark::benchmarkVertexCache(const std::string& modelName, size_t gridTriangles) {
+  auto describe = [](const std::vector<unsigned int>& indices, size_t vertexCount) {
+    std::ostringstream text;
+    VertexCacheStats fifo16 = analyzeVertexCache(indices.data(), indices.size(), vertexCount, 16);
+    VertexCacheStats fifo32 = analyzeVertexCache(indices.data(), indices.size(), vertexCount, 32);
+    text << "ACMR " << fifo16.acmr << "/" << fifo32.acmr << ", ATVR " << fifo16.atvr << "/" << fifo32.atvr;
+    return text.str();
+  };
+
+  ModelLoader loader;
+  MeshComponent mesh;
+  ModelLoadOptions options;
+  options.useCache = false;
+  if (loader.LoadOBJ(modelName, mesh, options)) {
+    std::string before = describe(mesh.m_index, mesh.m_vertex.size());
+    unsigned long long hash = triangleHash(mesh);
+    Timer timer;
+    optimizeVertexCache(mesh);
+    double seconds = timer.elapsedSeconds();
+    std::ostringstream line;
+    line << "Vertex cache " << modelName << " (" << mesh.m_index.size() / 3 << " triangles, FIFO 16/32): "
+         << before << " -> " << describe(mesh.m_index, mesh.m_vertex.size()) << " in " << seconds * 1000.0
+         << " ms, same triangles " << (hash == triangleHash(mesh) ? "yes" : "NO");
+    report(line.str());
+  }
+  else {
+    report("Vertex cache: failed to load " + modelName);
+  }
+
+  // A regular grid in shuffled triangle order: the worst case for file order.
+  unsigned int side = 1;
+  while (static_cast<size_t>(side) * side * 2 < gridTriangles) {
+    ++side;
+  }
+  std::vector<unsigned int> quads(static_cast<size_t>(side) * side);
+  for (size_t i = 0; i < quads.size(); ++i) {
+    quads[i] = static_cast<unsigned int>(i);
+  }
+  unsigned long long state = 0x2545F4914F6CDD1Dull;
+  for (size_t i = quads.size(); i > 1; --i) {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    std::swap(quads[i - 1], quads[(state >> 33) % i]);
+  }
+  std::vector<unsigned int> indices;
+  indices.reserve(quads.size() * 6);
+  for (unsigned int quad : quads) {
+    unsigned int x = quad % side;
+    unsigned int y = quad / side;
+    unsigned int a = y * (side + 1) + x;
+    unsigned int b = a + 1;
+    unsigned int c = a + side + 2;
+    unsigned int d = a + side + 1;
+    unsigned int corners[6] = { a, b, c, a, c, d };
+    indices.insert(indices.end(), corners, corners + 6);
+  }
+  size_t vertexCount = static_cast<size_t>(side + 1) * (side + 1);
+  std::string before = describe(indices, vertexCount);
+  Timer timer;
+  optimizeVertexCache(indices.data(), indices.size(), vertexCount);
+  double seconds = timer.elapsedSeconds();
+
+  std::ostringstream line;
+  line << "Vertex cache shuffled grid (" << indices.size() / 3 << " triangles, FIFO 16/32): " << before << " -> "
+       << describe(indices, vertexCount) << " in " << seconds * 1000.0 << " ms ("
+       << indices.size() / 3 / std::max(seconds, 1e-9) / 1e6 << " M triangles/s)";
+  report(line.str());
+}
+
+void
+MeshBenchmark::benchmarkOverdraw(const std::string& modelName) {
+  ModelLoader loader;
+  MeshComponent mesh;
+  ModelLoadOptions options;
+  options.useCache = false;
+  if (!loader.LoadOBJ(modelName, mesh, options)) {
+    report("Overdraw: failed to load " + modelName);
+    return;
+  }
+  auto describe = [](const MeshComponent& m) {
+    std::ostringstream text;
+    text << "overdraw " << analyzeOverdraw(m.m_index.data(), m.m_index.size(), m.m_vertex.data(), m.m_vertex.size()).overdraw
+         << ", ACMR " << analyzeVertexCache(m.m_index.data(), m.m_index.size(), m.m_vertex.size()).acmr;
+    return text.str();
+  };
+
+  std::ostringstream line;
+  line << "Overdraw " << modelName << ": file order " << describe(mesh);
+  optimizeVertexCache(mesh);
+  line << "; vertex cache order " << describe(mesh);
+  report(line.str());
+
+  const float thresholds[] = { 1.05f, 1.25f, 2.0f };
+  for (float threshold : thresholds) {
+    MeshComponent sorted = mesh;
+    Timer timer;
+    optimizeOverdraw(sorted, threshold);
+    double seconds = timer.elapsedSeconds();
+    std::ostringstream sortedLine;
+    sortedLine << "Overdraw threshold " << threshold << ": " << describe(sorted) << " in " << seconds * 1000.0 << " ms";
+    report(sortedLine.str());
+  }
+}
+
+void
+MeshBenchmark::benchmarkVertexFetch(const std::string& modelName) {
+  ModelLoader loader;
+  MeshComponent mesh;
+  ModelLoadOptions options;
+  options.useCache = false;
+  if (!loader.LoadOBJ(modelName, mesh, options)) {
+    report("Vertex fetch: failed to load " + modelName);
+    return;
+  }
+  auto describe = [](const MeshComponent& m) {
+    VertexFetchStats stats = analyzeVertexFetch(m);
+    std::ostringstream text;
+    text << "overfetch " << stats.overfetch << " (" << stats.bytesFetched / 1024 << " KB)";
+    return text.str();
+  };
+
+  unsigned long long hash = triangleHash(mesh);
+  std::ostringstream line;
+  line << "Vertex fetch " << modelName << ": file order " << describe(mesh);
+  optimizeVertexCache(mesh);
+  line << "; vertex cache order " << describe(mesh);
+  Timer timer;
+  size_t removed = optimizeVertexFetch(mesh);
+  double seconds = timer.elapsedSeconds();
+  line << "; remapped " << describe(mesh) << " in " << seconds * 1000.0 << " ms, " << removed
+       << " unused vertices removed, same triangles " << (hash == triangleHash(mesh) ? "yes" : "NO");
+  report(line.str());
+
+  // A depth-only pass over split streams reads only the 12-byte position stream.
+  std::vector<XMFLOAT3> positions;
+  std::vector<VertexAttributes> attributes;
+  Timer splitTimer;
+  mesh.splitVertexStreams(positions, attributes);
+  double splitSeconds = splitTimer.elapsedSeconds();
+  VertexFetchStats interleaved = analyzeVertexFetch(mesh);
+  VertexFetchStats positionOnly = analyzeVertexFetch(mesh, sizeof(XMFLOAT3));
+  std::ostringstream depth;
+  depth << "Vertex fetch " << modelName << ": depth-only pass reads " << interleaved.bytesFetched / 1024
+        << " KB from the interleaved buffer, " << positionOnly.bytesFetched / 1024 << " KB from the position stream ("
+        << 100.0 * (1.0 - static_cast<double>(positionOnly.bytesFetched) / std::max(1ull, interleaved.bytesFetched))
+        << "% less); splitting the streams took " << splitSeconds * 1000.0 << " ms";
+  report(depth.str());
+}
+
+void
+MeshBenchmark::benchmarkLods(const std::string& modelName) {
+  ModelLoader loader;
+  MeshComponent mesh;
+  ModelLoadOptions options;
+  options.useCache = false;
+  if (!loader.LoadOBJ(modelName, mesh, options)) {
+    report("LODs: failed to load " + modelName);
+    return;
+  }
+
+  // Vertices numbered by position (the first vertex there), so an edge is
+  // open only if no triangle of any attribute seam side uses it the other way.
+  MeshAdjacency welded;
+  buildAdjacency(welded, mesh, true);
+  std::vector<unsigned int> positionId(mesh.m_vertex.size());
+  for (size_t v = 0; v < positionId.size(); ++v) {
+    unsigned int h = welded.vertexHalfEdge[v];
+    positionId[v] = (h == kNoHalfEdge) ? static_cast<unsigned int>(v) : welded.origin[h];
+  }
+  auto openEdges = [&](const MeshComponent& m, const std::vector<MeshSubmesh>& submeshes) {
+    std::vector<unsigned int> indices;
+    for (const MeshSubmesh& submesh : submeshes) {
+      unsigned int end = submesh.indexOffset + submesh.indexCount - submesh.indexCount % 3;
+      for (unsigned int i = submesh.indexOffset; i < end; ++i) {
+        indices.push_back(positionId[m.m_index[i]]);
+      }
+    }
+    MeshAdjacency adjacency;
+    buildAdjacency(adjacency, indices.data(), indices.size(), positionId.size());
+    size_t open = 0;
+    for (unsigned int h = 0; h < indices.size(); ++h) {
+      open += (adjacency.edge[h] != kNoHalfEdge && !halfEdgeHasOpposite(adjacency, h)) ? 1 : 0;
+    }
+    return open;
+  };
+
+  MeshComponent single = mesh;
+  Timer singleTimer;
+  generateLods(single, 4, 0.5f, kDefaultLodError, 1);
+  double singleSeconds = singleTimer.elapsedSeconds();
+  Timer timer;
+  generateLods(mesh, 4, 0.5f, kDefaultLodError);
+  double seconds = timer.elapsedSeconds();
+
+  size_t fullTriangles = 0;
+  for (const MeshSubmesh& submesh : mesh.m_submeshes) {
+    fullTriangles += submesh.indexCount / 3;
+  }
+  std::ostringstream line;
+  line << "LODs " << modelName << ": level 0 " << fullTriangles << " triangles, "
+       << openEdges(mesh, mesh.m_submeshes) << " open edges";
+  for (size_t level = 1; level <= mesh.m_lods.size(); ++level) {
+    size_t triangles = 0;
+    for (const MeshSubmesh& submesh : mesh.lodSubmeshes(level)) {
+      triangles += submesh.indexCount / 3;
+    }
+    line << "; level " << level << " " << triangles << " (" << 100.0 * triangles / std::max<size_t>(1, fullTriangles)
+         << "%), error " << mesh.m_lods[level - 1].error << ", " << openEdges(mesh, mesh.lodSubmeshes(level))
+         << " open edges";
+  }
+  report(line.str());
+
+  std::ostringstream timing;
+  timing << "LODs " << modelName << ": " << singleSeconds * 1000.0 << " ms on 1 thread, " << seconds * 1000.0
+         << " ms on all threads, identical " << (identical(single, mesh) ? "yes" : "NO");
+  report(timing.str());
+}
+
+void
+MeshBenchmark::benchmarkClusters(const std::string& modelName) {
+  ModelLoader loader;
+  MeshComponent mesh;
+  ModelLoadOptions options;
+  options.useCache = false;
+  if (!loader.LoadOBJ(modelName, mesh, options) || mesh.m_index.empty()) {
+    report("Clusters: failed to load " + modelName);
+    return;
+  }
+  optimizeVertexCache(mesh);
+  VertexCacheStats before = analyzeVertexCache(mesh.m_index.data(), mesh.m_index.size(), mesh.m_vertex.size());
+  unsigned long long hash = triangleHash(mesh);
+
+  MeshComponent single = mesh;
+  Timer singleTimer;
+  buildClusters(single, kClusterMaxVertices, kClusterMaxTriangles, kDefaultClusterConeWeight, 1);
+  double singleSeconds = singleTimer.elapsedSeconds();
+  Timer timer;
+  size_t clusterCount = buildClusters(mesh);
+  double seconds = timer.elapsedSeconds();
+  VertexCacheStats after = analyzeVertexCache(mesh.m_index.data(), mesh.m_index.size(), mesh.m_vertex.size());
+
+  size_t triangles = 0;
+  size_t vertices = 0;
+  size_t cones = 0;
+  for (const MeshCluster& cluster : mesh.m_clusters) {
+    triangles += cluster.indexCount / 3;
+    vertices += cluster.vertexCount;
+    cones += (cluster.coneCutoff < 1.0f) ? 1 : 0;
+  }
+  std::ostringstream line;
+  line << "Clusters " << modelName << ": " << clusterCount << " clusters, "
+       << static_cast<double>(triangles) / std::max<size_t>(1, clusterCount) << " triangles and "
+       << static_cast<double>(vertices) / std::max<size_t>(1, clusterCount) << " vertices on average, "
+       << 100.0 * cones / std::max<size_t>(1, clusterCount) << "% with a backface cone; ACMR " << before.acmr
+       << " -> " << after.acmr << "; " << singleSeconds * 1000.0 << " ms on 1 thread, " << seconds * 1000.0
+       << " ms on all threads, identical "
+       << (identical(single, mesh) && single.m_clusters.size() == clusterCount ? "yes" : "NO")
+       << ", same triangles " << (hash == triangleHash(mesh) ? "yes" : "NO");
+  report(line.str());
+
+  // Cameras on a spiral around the mesh: outside looking at the center, then
+  // close up looking past it.
+  XMFLOAT3 center((mesh.m_boundsMin.x + mesh.m_boundsMax.x) * 0.5f, (mesh.m_boundsMin.y + mesh.m_boundsMax.y) * 0.5f,
+                  (mesh.m_boundsMin.z + mesh.m_boundsMax.z) * 0.5f);
+  float extent = std::max(mesh.m_boundsMax.x - mesh.m_boundsMin.x,
+                          std::max(mesh.m_boundsMax.y - mesh.m_boundsMin.y, mesh.m_boundsMax.z - mesh.m_boundsMin.z));
+  extent = std::max(extent, 1e-6f);
+  const int kViews = 64;
+  std::vector<unsigned int> visibleIndices;
+  std::vector<MeshSubmesh> visibleSubmeshes;
+  size_t keptTriangles = 0;
+  ClusterCullStats total;
+  double cullSeconds = 0.0;
+  for (int view = 0; view < kViews; ++view) {
+    float height = 1.0f - 2.0f * (view % (kViews / 2) + 0.5f) / (kViews / 2);
+    float angle = 2.4f * view;
+    float ring = std::sqrt(1.0f - height * height);
+    bool outside = view < kViews / 2;
+    float distance = extent * (outside ? 1.5f : 0.6f);
+    XMVECTOR eye = XMVectorSet(center.x + std::cos(angle) * ring * distance, center.y + height * distance,
+                               center.z + std::sin(angle) * ring * distance, 1.0f);
+    XMVECTOR target = XMLoadFloat3(&center);
+    if (!outside) {
+      target = XMVectorAdd(target, XMVectorSet(std::sin(angle) * extent * 0.3f, 0.0f, std::cos(angle) * extent * 0.3f, 0.0f));
+    }
+    XMVECTOR up = std::fabs(height) > 0.99f ? XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+    XMMATRIX viewMatrix = XMMatrixLookAtLH(eye, target, up);
+    XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, extent * 0.01f, extent * 10.0f);
+
+    Timer cullTimer;
+    ClusterCullStats stats = cullClusters(mesh, 0, makeClusterCullView(XMMatrixIdentity(), viewMatrix, projection),
+                                          visibleIndices, visibleSubmeshes);
+    cullSeconds += cullTimer.elapsedSeconds();
+    keptTriangles += visibleIndices.size() / 3;
+    total.visible += stats.visible;
+    total.outsideFrustum += stats.outsideFrustum;
+    total.backfacing += stats.backfacing;
+  }
+  size_t tested = std::max<size_t>(1, total.visible + total.outsideFrustum + total.backfacing);
+  std::ostringstream culling;
+  culling << "Clusters " << modelName << ": " << kViews << " views kept " << 100.0 * keptTriangles / (triangles * kViews)
+          << "% of the triangles; " << 100.0 * total.outsideFrustum / tested << "% of the clusters outside the frustum, "
+          << 100.0 * total.backfacing / tested << "% back-facing; " << cullSeconds * 1000000.0 / kViews
+          << " us per cull";
+  report(culling.str());
+}
+
+void
+MeshBenchmark::benchmarkQuantization(const std::string& modelName) {
+  ModelLoader loader;
+  MeshComponent mesh;
+  ModelLoadOptions options;
+  options.useCache = false;
+  if (!loader.LoadOBJ(modelName, mesh, options) || mesh.m_vertex.empty()) {
+    report("Quantization: failed to load " + modelName);
+    return;
+  }
+  float dx = mesh.m_boundsMax.x - mesh.m_boundsMin.x;
+  float dy = mesh.m_boundsMax.y - mesh.m_boundsMin.y;
+  float dz = mesh.m_boundsMax.z - mesh.m_boundsMin.z;
+  float diagonal = std::max(std::sqrt(dx * dx + dy * dy + dz * dz), 1e-20f);
+
+  const VertexFormat formats[] = { VERTEX_FORMAT_UNORM16, VERTEX_FORMAT_HALF };
+  const char* names[] = { "UNORM16", "half" };
+  for (size_t f = 0; f < 2; ++f) {
+    std::vector<PackedVertex> single;
+    std::vector<PackedVertex> packed;
+    CBVertexDequantization singleConstants;
+    CBVertexDequantization constants;
+    VertexQuantizationStats stats;
+
+    Timer singleTimer;
+    quantizeVertices(mesh, formats[f], single, singleConstants, nullptr, 1);
+    double singleSeconds = singleTimer.elapsedSeconds();
+    Timer timer;
+    quantizeVertices(mesh, formats[f], packed, constants, nullptr);
+    double seconds = timer.elapsedSeconds();
+    quantizeVertices(mesh, formats[f], packed, constants, &stats);
+
+    bool same = single.size() == packed.size() &&
+                memcmp(single.data(), packed.data(), packed.size() * sizeof(PackedVertex)) == 0;
+    double megabytes = static_cast<double>(stats.sourceBytes) / (1024.0 * 1024.0);
+    std::ostringstream line;
+    line << "Quantization " << modelName << " (" << names[f] << " positions): " << stats.sourceBytes / 1024 << " KB -> "
+         << stats.packedBytes / 1024 << " KB (" << 100.0 * (1.0 - static_cast<double>(stats.packedBytes) / stats.sourceBytes)
+         << "% saved); position error max " << stats.maxPositionError << " (" << stats.maxPositionError / diagonal
+         << " of the diagonal), rms " << stats.rmsPositionError << "; normal error max " << stats.maxNormalError
+         << " deg, mean " << stats.meanNormalError << " deg; texcoord error max " << stats.maxTexcoordError << "; "
+         << megabytes / std::max(singleSeconds, 1e-9) << " MB/s on 1 thread, " << megabytes / std::max(seconds, 1e-9)
+         << " MB/s on all threads, identical " << (same ? "yes" : "NO");
+    report(line.str());
+  }
+}
+
+void
+MeshBenchmark::benchmarkCodec(const std::string& modelName) {
+  ModelLoader loader;
+  MeshComponent mesh;
+  ModelLoadOptions options;
+  options.useCache = false;
+  if (!loader.LoadOBJ(modelName, mesh, options) || mesh.m_vertex.empty()) {
+    report("Codec: failed to load " + modelName);
+    return;
+  }
+  const size_t vertexBytes = mesh.m_vertex.size() * sizeof(SimpleVertex);
+  const size_t indexBytes = mesh.m_index.size() * sizeof(unsigned int);
+  const size_t triangleCount = mesh.m_index.size() / 3;
+
+  std::vector<unsigned char> encodedVertices;
+  std::vector<unsigned char> encodedIndices;
+  encodeVertexBuffer(encodedVertices, mesh.m_vertex.data(), mesh.m_vertex.size(), sizeof(SimpleVertex));
+  encodeIndexBuffer(encodedIndices, mesh.m_index.data(), mesh.m_index.size());
+  std::ostringstream order;
+  order << "Codec " << modelName << " (file order): vertices " << static_cast<double>(encodedVertices.size()) / vertexBytes
+        << " of raw, indices " << static_cast<double>(encodedIndices.size()) / std::max<size_t>(1, triangleCount)
+        << " bytes/triangle";
+  report(order.str());
+
+  optimizeVertexCache(mesh);
+  optimizeVertexFetch(mesh);
+  Timer vertexTimer;
+  encodeVertexBuffer(encodedVertices, mesh.m_vertex.data(), mesh.m_vertex.size(), sizeof(SimpleVertex));
+  double vertexEncodeSeconds = vertexTimer.elapsedSeconds();
+  Timer indexTimer;
+  encodeIndexBuffer(encodedIndices, mesh.m_index.data(), mesh.m_index.size());
+  double indexEncodeSeconds = indexTimer.elapsedSeconds();
+
+  std::vector<SimpleVertex> vertices(mesh.m_vertex.size());
+  std::vector<unsigned int> indices(mesh.m_index.size());
+  double vertexSingle = 1e30;
+  double vertexAll = 1e30;
+  double indexBest = 1e30;
+  bool decoded = true;
+  for (unsigned int i = 0; i < 5; ++i) {
+    Timer singleTimer;
+    decoded = decodeVertexBuffer(vertices.data(), vertices.size(), sizeof(SimpleVertex),
+                                 encodedVertices.data(), encodedVertices.size(), 1) && decoded;
+    vertexSingle = std::min(vertexSingle, singleTimer.elapsedSeconds());
+    Timer allTimer;
+    decoded = decodeVertexBuffer(vertices.data(), vertices.size(), sizeof(SimpleVertex),
+                                 encodedVertices.data(), encodedVertices.size()) && decoded;
+    vertexAll = std::min(vertexAll, allTimer.elapsedSeconds());
+    Timer timer;
+    decoded = decodeIndexBuffer(indices.data(), indices.size(), encodedIndices.data(), encodedIndices.size()) && decoded;
+    indexBest = std::min(indexBest, timer.elapsedSeconds());
+  }
+  bool same = decoded &&
+              memcmp(vertices.data(), mesh.m_vertex.data(), vertexBytes) == 0 &&
+              memcmp(indices.data(), mesh.m_index.data(), indexBytes) == 0;
+
+  // Reading the encoded bytes and decoding them beats reading the raw bytes whenever the disk delivers less than
+  // (1 - ratio) times the decoding throughput.
+  const double gigabyte = 1024.0 * 1024.0 * 1024.0;
+  double vertexRatio = static_cast<double>(encodedVertices.size()) / std::max<size_t>(1, vertexBytes);
+  double indexRatio = static_cast<double>(encodedIndices.size()) / std::max<size_t>(1, indexBytes);
+  double vertexDecode = vertexBytes / gigabyte / std::max(vertexAll, 1e-9);
+  double indexDecode = indexBytes / gigabyte / std::max(indexBest, 1e-9);
+  std::ostringstream line;
+  line << "Codec " << modelName << " (optimized order): vertices " << vertexBytes / 1024 << " KB -> "
+       << encodedVertices.size() / 1024 << " KB (" << vertexRatio << ", "
+       << static_cast<double>(encodedVertices.size()) / mesh.m_vertex.size() << " bytes/vertex), encode "
+       << vertexBytes / (1024.0 * 1024.0) / std::max(vertexEncodeSeconds, 1e-9) << " MB/s, decode "
+       << vertexBytes / gigabyte / std::max(vertexSingle, 1e-9) << " GB/s on 1 thread, " << vertexDecode
+       << " GB/s on all threads; indices " << indexBytes / 1024 << " KB -> " << encodedIndices.size() / 1024 << " KB ("
+       << indexRatio << ", " << static_cast<double>(encodedIndices.size()) / std::max<size_t>(1, triangleCount)
+       << " bytes/triangle), encode " << indexBytes / (1024.0 * 1024.0) / std::max(indexEncodeSeconds, 1e-9)
+       << " MB/s, decode " << indexDecode << " GB/s; faster than a raw read below "
+       << (1.0 - vertexRatio) * vertexDecode << " GB/s (vertices) and " << (1.0 - indexRatio) * indexDecode
+       << " GB/s (indices) of disk bandwidth, identical " << (same ? "yes" : "NO");
+  report(line.str());
+}
+
+void
+MeshBenchmark::benchmarkCleanup(const std::string& modelName) {
+  ModelLoader loader;
+  MeshComponent mesh;
+  ModelLoadOptions options;
+  options.useCache = false;
+  if (!loader.LoadOBJ(modelName, mesh, options) || mesh.m_index.empty()) {
+    report("Cleanup: failed to load " + modelName);
+    return;
+  }
+
+  MeshCleanupOptions cleanupOptions;
+  float extent = std::max(mesh.m_boundsMax.x - mesh.m_boundsMin.x,
+                          std::max(mesh.m_boundsMax.y - mesh.m_boundsMin.y, mesh.m_boundsMax.z - mesh.m_boundsMin.z));
+  float jitter = cleanupOptions.positionTolerance * extent * 0.01f;
+  MeshComponent damaged;
+  damaged.m_vertex.reserve(mesh.m_index.size());
+  damaged.m_index.reserve(mesh.m_index.size() + mesh.m_index.size() / 50 + mesh.m_index.size() / 100);
+  size_t triangleCount = mesh.m_index.size() / 3;
+  for (size_t t = 0; t < triangleCount; ++t) {
+    unsigned int first = static_cast<unsigned int>(damaged.m_vertex.size());
+    for (size_t k = 0; k < 3; ++k) {
+      SimpleVertex vertex = mesh.m_vertex[mesh.m_index[t * 3 + k]];
+      vertex.Pos.x += ((t + k) & 1) ? jitter : -jitter;
+      damaged.m_vertex.push_back(vertex);
+      damaged.m_index.push_back(first + static_cast<unsigned int>(k));
+    }
+    if (t % 50 == 0) {
+      damaged.m_index.insert(damaged.m_index.end(), { first, first + 1, first + 1 });
+    }
+    if (t % 100 == 0) {
+      damaged.m_index.insert(damaged.m_index.end(), { first + 1, first + 2, first });
+    }
+  }
+  damaged.m_numVertex = static_cast<int>(damaged.m_vertex.size());
+  damaged.m_numIndex = static_cast<int>(damaged.m_index.size());
+  damaged.computeBounds();
+
+  const MeshComponent* sources[] = { &mesh, &damaged };
+  const char* names[] = { "as loaded", "exporter soup" };
+  for (size_t s = 0; s < 2; ++s) {
+    MeshComponent single = *sources[s];
+    MeshComponent cleaned = *sources[s];
+    Timer singleTimer;
+    cleanupMesh(single, cleanupOptions, 1);
+    double singleSeconds = singleTimer.elapsedSeconds();
+    Timer timer;
+    MeshCleanupStats stats = cleanupMesh(cleaned, cleanupOptions);
+    double seconds = timer.elapsedSeconds();
+
+    std::ostringstream line;
+    line << "Cleanup " << modelName << " (" << names[s] << "): " << stats.verticesBefore << " -> " << stats.verticesAfter
+         << " vertices (" << stats.weldedVertices << " welded, " << stats.unusedVertices << " unused), "
+         << stats.indicesBefore << " -> " << stats.indicesAfter << " indices (" << stats.degenerateTriangles
+         << " degenerate, " << stats.duplicateTriangles << " duplicate triangles), "
+         << 100.0 * (1.0 - static_cast<double>(stats.verticesAfter) / std::max<size_t>(1, stats.verticesBefore))
+         << "% fewer vertices, " << 100.0 * (1.0 - static_cast<double>(stats.indicesAfter) / std::max<size_t>(1, stats.indicesBefore))
+         << "% fewer indices; " << singleSeconds * 1000.0 << " ms on 1 thread, " << seconds * 1000.0
+         << " ms on all threads, identical " << (identical(single, cleaned) ? "yes" : "NO");
+    if (s == 1) {
+      line << "; the loaded mesh has " << mesh.m_vertex.size() << " vertices and " << mesh.m_index.size() << " indices";
+    }
+    report(line.str());
+  }
+}
+
+void
+MeshBenchmark::benchmarkIndexFormat(const std::string& modelName) {
+  ModelLoader loader;
+  MeshComponent mesh;
+  ModelLoadOptions options;
+  options.useCache = false;
+  if (!loader.LoadOBJ(modelName, mesh, options) || mesh.m_index.empty()) {
+    report("Index format: failed to load " + modelName);
+    return;
+  }
+
+  MeshComponent chunked = mesh;
+  optimizeVertexFetch(chunked);
+  const unsigned int chunkTriangles = 16384;
+  chunked.m_submeshes.clear();
+  chunked.m_lods.clear();
+  chunked.m_clusters.clear();
+  for (unsigned int first = 0; first < chunked.m_index.size(); first += chunkTriangles * 3) {
+    MeshSubmesh submesh;
+    submesh.indexOffset = first;
+    submesh.indexCount = std::min(chunkTriangles * 3, static_cast<unsigned int>(chunked.m_index.size()) - first);
+    chunked.m_submeshes.push_back(submesh);
+  }
+
+  MeshComponent* meshes[] = { &mesh, &chunked };
+  const char* names[] = { "as loaded", "fetch order, 16384-triangle submeshes" };
+  for (size_t m = 0; m < 2; ++m) {
+    MeshComponent& target = *meshes[m];
+    Timer timer;
+    bool use16 = target.buildIndex16();
+    double seconds = timer.elapsedSeconds();
+
+    bool exact = use16;
+    unsigned int largestBase = 0;
+    for (size_t level = 0; exact && level <= target.m_lods.size(); ++level) {
+      for (const MeshSubmesh& submesh : target.lodSubmeshes(level)) {
+        largestBase = std::max(largestBase, submesh.baseVertex);
+        for (unsigned int i = submesh.indexOffset; i < submesh.indexOffset + submesh.indexCount; ++i) {
+          exact = exact && target.m_index16[i] + submesh.baseVertex == target.m_index[i];
+        }
+      }
+    }
+    if (use16 && target.m_submeshes.empty()) {
+      for (size_t i = 0; i < target.m_index.size(); ++i) {
+        exact = exact && target.m_index16[i] == target.m_index[i];
+      }
+    }
+
+    size_t bytes32 = target.m_index.size() * sizeof(unsigned int);
+    size_t bytes = use16 ? target.m_index16.size() * sizeof(unsigned short) : bytes32;
+    std::ostringstream line;
+    line << "Index format " << modelName << " (" << names[m] << "): " << target.m_vertex.size() << " vertices, "
+         << target.m_submeshes.size() << " submeshes, " << (use16 ? "R16" : "R32");
+    if (use16) {
+      line << (largestBase != 0 ? " with per-submesh base vertices (largest " + std::to_string(largestBase) + ")"
+                                : " with base vertex 0");
+    }
+    line << ", " << bytes32 / 1024 << " KB in 32 bits -> " << bytes / 1024 << " KB uploaded; " << seconds * 1000.0
+         << " ms, exact " << (use16 ? (exact ? "yes" : "NO") : "n/a");
+    report(line.str());
+  }
+}
+
+void
+MeshBenchmark::benchmarkDirtyRanges(const std::string& modelName) {
+  ModelLoader loader;
+  MeshComponent loaded;
+  ModelLoadOptions options;
+  options.useCache = false;
+  if (!loader.LoadOBJ(modelName, loaded, options) || loaded.m_vertex.empty()) {
+    report("Dirty ranges: failed to load " + modelName);
+    return;
+  }
+  MeshComponent fetchOrdered = loaded;
+  optimizeVertexFetch(fetchOrdered);
+
+  float extent = std::max(loaded.m_boundsMax.x - loaded.m_boundsMin.x,
+                          std::max(loaded.m_boundsMax.y - loaded.m_boundsMin.y, loaded.m_boundsMax.z - loaded.m_boundsMin.z));
+  float radius = extent * 0.05f;
+  XMFLOAT3 center = loaded.m_vertex[loaded.m_vertex.size() / 2].Pos;
+  const size_t vertexBytes = sizeof(XMFLOAT3) + sizeof(VertexAttributes);
+
+  MeshComponent* meshes[] = { &loaded, &fetchOrdered };
+  const char* names[] = { "file order", "fetch order" };
+  for (size_t m = 0; m < 2; ++m) {
+    MeshComponent& mesh = *meshes[m];
+    size_t touched = 0;
+    size_t unmerged = 0;
+    double seconds = 0.0;
+    const unsigned int gaps[] = { 0, kDirtyRangeMergeGap };
+    for (unsigned int gap : gaps) {
+      mesh.clearDirtyRanges();
+      touched = 0;
+      Timer timer;
+      for (size_t v = 0; v < mesh.m_vertex.size(); ++v) {
+        XMFLOAT3& position = mesh.m_vertex[v].Pos;
+        float dx = position.x - center.x;
+        float dy = position.y - center.y;
+        float dz = position.z - center.z;
+        if (dx * dx + dy * dy + dz * dz <= radius * radius) {
+          position.y += radius * 0.01f;
+          mesh.markVerticesDirty(static_cast<unsigned int>(v), 1, gap);
+          ++touched;
+        }
+      }
+      seconds = timer.elapsedSeconds();
+      if (gap == 0) {
+        unmerged = mesh.m_dirtyVertices.size();
+      }
+    }
+
+    size_t uploaded = 0;
+    for (const MeshDirtyRange& range : mesh.m_dirtyVertices) {
+      uploaded += range.count;
+    }
+    std::ostringstream line;
+    line << "Dirty ranges " << modelName << " (" << names[m] << "): " << touched << " of " << mesh.m_vertex.size()
+         << " vertices moved, " << unmerged << " ranges unmerged -> " << mesh.m_dirtyVertices.size()
+         << " with a gap of " << kDirtyRangeMergeGap << ", " << uploaded * vertexBytes / 1024 << " KB uploaded instead of "
+         << mesh.m_vertex.size() * vertexBytes / 1024 << " KB (" << uploaded - touched << " unchanged vertices re-sent); "
+         << seconds * 1000.0 << " ms to move and mark";
+    report(line.str());
+  }
+}
+
+void
+MeshBenchmark::benchmarkAdjacency(const std::string& modelName, size_t gridTriangles) {
+  ModelLoader loader;
+  MeshComponent mesh;
+  ModelLoadOptions options;
+  options.useCache = false;
+  if (loader.LoadOBJ(modelName, mesh, options)) {
+    for (int weld = 0; weld < 2; ++weld) {
+      MeshAdjacency adjacency;
+      Timer timer;
+      buildAdjacency(adjacency, mesh, weld != 0);
+      double seconds = timer.elapsedSeconds();
+      std::ostringstream line;
+      line << "Adjacency " << modelName << " (" << (weld ? "welded positions" : "by vertex") << ", "
+           << mesh.m_index.size() / 3 << " triangles): " << adjacency.edgeHalfEdge.size() << " edges, "
+           << adjacency.openEdges << " open, " << adjacency.nonManifoldEdges << " non-manifold, "
+           << adjacency.degenerateHalfEdges << " degenerate half-edges in " << seconds * 1000.0 << " ms";
+      report(line.str());
+    }
+  }
+  else {
+    report("Adjacency: failed to load " + modelName);
+  }
+
+  // A regular grid in shuffled triangle order, so the half-edges of a vertex
+  // are far apart in the index list.
+  unsigned int side = 1;
+  while (static_cast<size_t>(side) * side * 2 < gridTriangles) {
+    ++side;
+  }
+  std::vector<unsigned int> quads(static_cast<size_t>(side) * side);
+  for (size_t i = 0; i < quads.size(); ++i) {
+    quads[i] = static_cast<unsigned int>(i);
+  }
+  unsigned long long state = 0x2545F4914F6CDD1Dull;
+  for (size_t i = quads.size(); i > 1; --i) {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    std::swap(quads[i - 1], quads[(state >> 33) % i]);
+  }
+  std::vector<unsigned int> indices;
+  indices.reserve(quads.size() * 6);
+  for (unsigned int quad : quads) {
+    unsigned int x = quad % side;
+    unsigned int y = quad / side;
+    unsigned int a = y * (side + 1) + x;
+    unsigned int corners[6] = { a, a + 1, a + side + 2, a, a + side + 2, a + side + 1 };
+    indices.insert(indices.end(), corners, corners + 6);
+  }
+  std::vector<unsigned int>().swap(quads);
+  size_t vertexCount = static_cast<size_t>(side + 1) * (side + 1);
+
+  MeshAdjacency single;
+  Timer singleTimer;
+  buildAdjacency(single, indices.data(), indices.size(), vertexCount, 1);
+  double singleSeconds = singleTimer.elapsedSeconds();
+  MeshAdjacency parallel;
+  Timer timer;
+  buildAdjacency(parallel, indices.data(), indices.size(), vertexCount);
+  double seconds = timer.elapsedSeconds();
+  bool identical = single.twin == parallel.twin && single.edge == parallel.edge &&
+                   single.vertexHalfEdge == parallel.vertexHalfEdge && single.edgeFlags == parallel.edgeFlags;
+
+  std::ostringstream line;
+  line << "Adjacency shuffled grid (" << indices.size() / 3 << " triangles, " << vertexCount << " vertices): "
+       << parallel.edgeHalfEdge.size() << " edges, " << parallel.openEdges << " open; " << singleSeconds * 1000.0
+       << " ms on 1 thread, " << seconds * 1000.0 << " ms on all threads ("
+       << indices.size() / 3 / std::max(seconds, 1e-9) / 1e6 << " M triangles/s), identical "
+       << (identical ? "yes" : "NO");
+  report(line.str());
+}
+
+void
+MeshBenchmark::benchmarkBounds(const std::string& modelName) {
+  ModelLoader loader;
+  MeshComponent mesh;
+  ModelLoadOptions options;
+  options.useCache = false;
+  if (!loader.LoadOBJ(modelName, mesh, options) || mesh.m_vertex.empty()) {
+    report("Bounds: failed to load " + modelName);
+    return;
+  }
+  const unsigned int repeats = 10;
+  double gigabytes = mesh.m_vertex.size() * sizeof(SimpleVertex) / 1e9;
+
+  // The box loop computeBounds ran before, for reference.
+  Timer timer;
+  XMFLOAT3 minimum = mesh.m_vertex[0].Pos;
+  XMFLOAT3 maximum = minimum;
+  for (unsigned int r = 0; r < repeats; ++r) {
+    for (const SimpleVertex& vertex : mesh.m_vertex) {
+      minimum.x = std::min(minimum.x, vertex.Pos.x);
+      minimum.y = std::min(minimum.y, vertex.Pos.y);
+      minimum.z = std::min(minimum.z, vertex.Pos.z);
+      maximum.x = std::max(maximum.x, vertex.Pos.x);
+      maximum.y = std::max(maximum.y, vertex.Pos.y);
+      maximum.z = std::max(maximum.z, vertex.Pos.z);
+    }
+  }
+  double scalarSeconds = timer.elapsedSeconds() / repeats;
+
+  MeshBounds bounds[2];
+  double seconds[2];
+  const unsigned int threadCounts[2] = { 1, 0 };
+  for (size_t t = 0; t < 2; ++t) {
+    Timer threadTimer;
+    for (unsigned int r = 0; r < repeats; ++r) {
+      bounds[t] = computeVertexBounds(mesh.m_vertex.data(), mesh.m_vertex.size(), threadCounts[t]);
+    }
+    seconds[t] = threadTimer.elapsedSeconds() / repeats;
+  }
+  bool identical = memcmp(&bounds[0], &bounds[1], sizeof(MeshBounds)) == 0 &&
+                   memcmp(&bounds[0].boundsMin, &minimum, sizeof(XMFLOAT3)) == 0 &&
+                   memcmp(&bounds[0].boundsMax, &maximum, sizeof(XMFLOAT3)) == 0;
+  float farthest = 0.0f;
+  for (const SimpleVertex& vertex : mesh.m_vertex) {
+    XMFLOAT3 offset(vertex.Pos.x - bounds[0].center.x, vertex.Pos.y - bounds[0].center.y,
+                    vertex.Pos.z - bounds[0].center.z);
+    farthest = std::max(farthest, std::sqrt(offset.x * offset.x + offset.y * offset.y + offset.z * offset.z));
+  }
+  XMFLOAT3 extent(maximum.x - minimum.x, maximum.y - minimum.y, maximum.z - minimum.z);
+  float boxRadius = 0.5f * std::sqrt(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z);
+
+  Timer meshTimer;
+  mesh.computeBounds();
+  double meshSeconds = meshTimer.elapsedSeconds();
+
+  std::ostringstream line;
+  line << "Bounds " << modelName << " (" << mesh.m_vertex.size() << " vertices): scalar box " << scalarSeconds * 1000.0
+       << " ms (" << gigabytes / scalarSeconds << " GB/s); SIMD box and sphere " << seconds[0] * 1000.0 << " ms on 1 thread ("
+       << gigabytes / seconds[0] << " GB/s), " << seconds[1] * 1000.0 << " ms on all threads (" << gigabytes / seconds[1]
+       << " GB/s), identical " << (identical ? "yes" : "NO") << "; sphere radius " << bounds[0].radius
+       << " vs " << boxRadius << " around the box, encloses " << (farthest <= bounds[0].radius ? "yes" : "NO")
+       << "; computeBounds with " << mesh.m_submeshes.size() << " submeshes and " << mesh.m_lods.size() << " levels "
+       << meshSeconds * 1000.0 << " ms";
+  report(line.str());
+}
+
+void
+MeshBenchmark::benchmarkDedup(size_t cornerCount) {
+  // Quad grid: every interior vertex is shared by four faces, and every
+  // eighth column carries a UV seam so some positions split.
+  unsigned int side = 1;
+  while (static_cast<size_t>(side) * side * 4 < cornerCount) {
+    ++side;
+  }
+  std::vector<OBJCorner> corners;
+  corners.reserve(static_cast<size_t>(side) * side * 4);
+  for (unsigned int y = 0; y < side && corners.size() < cornerCount; ++y) {
+    for (unsigned int x = 0; x < side && corners.size() < cornerCount; ++x) {
+      unsigned int quad[4] = { y * (side + 1) + x + 1, y * (side + 1) + x + 2,
+                               (y + 1) * (side + 1) + x + 2, (y + 1) * (side + 1) + x + 1 };
+      for (unsigned int v : quad) {
+        unsigned int vt = (x % 8 == 0) ? v + (side + 1) * (side + 1) : v;
+        corners.push_back(OBJCorner{ v, vt, v });
+      }
+    }
+  }
+
+  std::vector<std::string> tokens;
+  tokens.reserve(corners.size());
+  for (const OBJCorner& c : corners) {
+    tokens.push_back(std::to_string(c.v) + "/" + std::to_string(c.vt) + "/" + std::to_string(c.vn));
+  }
+
+  std::vector<unsigned int> mapIndices(corners.size());
+  Timer timer;
+  {
+    std::map<std::string, unsigned int> vertex_map;
+    unsigned int next = 0;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      if (vertex_map.find(tokens[i]) == vertex_map.end()) {
+        vertex_map[tokens[i]] = next++;
+      }
+      mapIndices[i] = vertex_map[tokens[i]];
+    }
+  }
+  double mapSeconds = timer.elapsedSeconds();
+
+  std::vector<unsigned int> tableIndices(corners.size());
+  timer.start();
+  {
+    VertexDedupTable table;
+    table.init(static_cast<size_t>(side + 1) * (side + 1));
+    unsigned int next = 0;
+    for (size_t i = 0; i < corners.size(); ++i) {
+      bool inserted = false;
+      tableIndices[i] = table.findOrInsert(corners[i], next, inserted);
+      if (inserted) ++next;
+    }
+  }
+  double tableSeconds = timer.elapsedSeconds();
+
+  std::ostringstream line;
+  line << "Dedup " << corners.size() << " corners: std::map<std::string> " << mapSeconds * 1000.0
+       << " ms, VertexDedupTable " << tableSeconds * 1000.0 << " ms, speedup "
+       << mapSeconds / tableSeconds << "x, same order " << (mapIndices == tableIndices ? "yes" : "NO");
+  report(line.str());
+}
+
+HRESULT
+MeshBenchmark::writeReport(const std::string& fileName) const {
+  std::ofstream file(fileName);
+  if (!file.is_open()) {
+    ERROR("MeshBenchmark", "writeReport", ("Failed to open report file: " + fileName).c_str());
+    return E_FAIL;
+  }
+  for (const std::string& line : m_lines) {
+    file << line << "\n";
+  }
+  return S_OK;
+}
+
+void
+MeshBenchmark::report(const std::string& line) {
+  m_lines.push_back(line);
+  REPORT("MeshBenchmark", "run", line.c_str());
+}
+
+bool
+MeshBenchmark::identical(const MeshComponent& a, const MeshComponent& b) {
+  return a.m_vertex.size() == b.m_vertex.size() &&
+         a.m_index.size() == b.m_index.size() &&
+         (a.m_vertex.empty() || memcmp(a.m_vertex.data(), b.m_vertex.data(), a.m_vertex.size() * sizeof(SimpleVertex)) == 0) &&
+         (a.m_index.empty() || memcmp(a.m_index.data(), b.m_index.data(), a.m_index.size() * sizeof(unsigned int)) == 0);
+}
+
+HRESULT
+MeshBenchmark::writeGLB(const std::string& fileName, const MeshComponent& mesh) {
+  size_t vertexBytes = mesh.m_vertex.size() * sizeof(SimpleVertex);
+  size_t indexBytes = mesh.m_index.size() * sizeof(unsigned int);
+  std::vector<MeshSubmesh> submeshes = mesh.m_submeshes;
+  if (submeshes.empty()) {
+    MeshSubmesh whole;
+    whole.indexCount = static_cast<unsigned int>(mesh.m_index.size());
+    submeshes.push_back(whole);
+  }
+
+  std::ostringstream json;
+  json << "{\"asset\":{\"version\":\"2.0\",\"generator\":\"NovaEngine MeshBenchmark\"},"
+       << "\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+       << "\"buffers\":[{\"byteLength\":" << vertexBytes + indexBytes << "}],"
+       << "\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" << vertexBytes
+       << ",\"byteStride\":" << sizeof(SimpleVertex) << ",\"target\":34962},"
+       << "{\"buffer\":0,\"byteOffset\":" << vertexBytes << ",\"byteLength\":" << indexBytes << ",\"target\":34963}],"
+       << "\"accessors\":["
+       << "{\"bufferView\":0,\"byteOffset\":0,\"componentType\":5126,\"count\":" << mesh.m_vertex.size()
+       << ",\"type\":\"VEC3\",\"min\":[" << mesh.m_boundsMin.x << "," << mesh.m_boundsMin.y << "," << mesh.m_boundsMin.z
+       << "],\"max\":[" << mesh.m_boundsMax.x << "," << mesh.m_boundsMax.y << "," << mesh.m_boundsMax.z << "]},"
+       << "{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,\"count\":" << mesh.m_vertex.size() << ",\"type\":\"VEC2\"},"
+       << "{\"bufferView\":0,\"byteOffset\":20,\"componentType\":5126,\"count\":" << mesh.m_vertex.size() << ",\"type\":\"VEC3\"}";
+  for (const MeshSubmesh& submesh : submeshes) {
+    json << ",{\"bufferView\":1,\"byteOffset\":" << submesh.indexOffset * sizeof(unsigned int)
+         << ",\"componentType\":5125,\"count\":" << submesh.indexCount << ",\"type\":\"SCALAR\"}";
+  }
+  json << "],\"materials\":[";
+  for (size_t i = 0; i < mesh.m_materials.size(); ++i) {
+    const MeshMaterial& material = mesh.m_materials[i];
+    json << (i ? "," : "") << "{\"pbrMetallicRoughness\":{\"baseColorFactor\":[" << material.diffuse.x << ","
+         << material.diffuse.y << "," << material.diffuse.z << "," << material.opacity << "]}}";
+  }
+  json << "],\"meshes\":[{\"primitives\":[";
+  for (size_t i = 0; i < submeshes.size(); ++i) {
+    json << (i ? "," : "") << "{\"attributes\":{\"POSITION\":0,\"TEXCOORD_0\":1,\"NORMAL\":2},\"indices\":" << 3 + i;
+    if (submeshes[i].materialId < mesh.m_materials.size()) {
+      json << ",\"material\":" << submeshes[i].materialId;
+    }
+    json << "}";
+  }
+  json << "]}]}";
+
+  // Chunks are 4-byte aligned: JSON is padded with spaces, BIN with zeros.
+  std::string text = json.str();
+  text.append((4 - text.size() % 4) % 4, ' ');
+  uint32_t binLength = static_cast<uint32_t>((vertexBytes + indexBytes + 3) & ~static_cast<size_t>(3));
+  uint32_t header[5] = { 0x46546C67, 2, static_cast<uint32_t>(12 + 8 + text.size() + 8 + binLength),
+                         static_cast<uint32_t>(text.size()), 0x4E4F534A };
+  uint32_t binHeader[2] = { binLength, 0x004E4942 };
+
+  std::ofstream file(fileName, std::ios::binary);
+  if (!file.is_open()) {
+    ERROR("MeshBenchmark", "writeGLB", ("Failed to open file: " + fileName).c_str());
+    return E_FAIL;
+  }
+  file.write(reinterpret_cast<const char*>(header), sizeof(header));
+  file.write(text.data(), text.size());
+  file.write(reinterpret_cast<const char*>(binHeader), sizeof(binHeader));
+  file.write(reinterpret_cast<const char*>(mesh.m_vertex.data()), vertexBytes);
+  file.write(reinterpret_cast<const char*>(mesh.m_index.data()), indexBytes);
+  const char padding[4] = { 0, 0, 0, 0 };
+  file.write(padding, binLength - (vertexBytes + indexBytes));
+  return file.good() ? S_OK : E_FAIL;
+}
+
+HRESULT
+MeshBenchmark::writePLY(const std::string& fileName, const MeshComponent& mesh, bool withFaces) {
+  std::ofstream file(fileName, std::ios::binary);
+  if (!file.is_open()) {
+    ERROR("MeshBenchmark", "writePLY", ("Failed to open file: " + fileName).c_str());
+    return E_FAIL;
+  }
+  file << "ply\nformat binary_little_endian 1.0\ncomment NovaEngine MeshBenchmark\n"
+       << "element vertex " << mesh.m_vertex.size() << "\n"
+       << "property float x\nproperty float y\nproperty float z\n"
+       << "property float nx\nproperty float ny\nproperty float nz\n"
+       << "property float u\nproperty float v\n";
+  if (withFaces) {
+    file << "element face " << mesh.m_index.size() / 3 << "\nproperty list uchar uint vertex_indices\n";
+  }
+  file << "end_header\n";
+
+  // PLY texture coordinates have V up, so the flip LoadPLY applies is undone here.
+  std::vector<float> records;
+  records.reserve(mesh.m_vertex.size() * 8);
+  for (const SimpleVertex& vertex : mesh.m_vertex) {
+    const float record[8] = { vertex.Pos.x, vertex.Pos.y, vertex.Pos.z,
+                              vertex.Normal.x, vertex.Normal.y, vertex.Normal.z,
+                              vertex.Tex.x, 1.0f - vertex.Tex.y };
+    records.insert(records.end(), record, record + 8);
+  }
+  file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(float));
+
+  if (withFaces) {
+    std::vector<unsigned char> faces(mesh.m_index.size() / 3 * 13);
+    for (size_t i = 0; i < mesh.m_index.size() / 3; ++i) {
+      faces[i * 13] = 3;
+      memcpy(&faces[i * 13 + 1], &mesh.m_index[i * 3], 3 * sizeof(unsigned int));
+    }
+    file.write(reinterpret_cast<const char*>(faces.data()), faces.size());
+  }
+  return file.good() ? S_OK : E_FAIL;
+}
+
+HRESULT
+MeshBenchmark::writeSTL(const std::string& fileName, const MeshComponent& mesh) {
+  uint32_t triangleCount = static_cast<uint32_t>(mesh.m_index.size() / 3);
+  std::vector<char> data(84 + static_cast<size_t>(triangleCount) * 50, 0);
+  memcpy(data.data(), "NovaEngine MeshBenchmark", 24);
+  memcpy(data.data() + 80, &triangleCount, sizeof(triangleCount));
+  for (size_t i = 0; i < triangleCount; ++i) {
+    char* record = data.data() + 84 + i * 50;
+    const XMFLOAT3 zero(0.0f, 0.0f, 0.0f);
+    memcpy(record, &zero, sizeof(zero));
+    for (size_t k = 0; k < 3; ++k) {
+      memcpy(record + 12 + k * 12, &mesh.m_vertex[mesh.m_index[i * 3 + k]].Pos, sizeof(XMFLOAT3));
+    }
+  }
+
+  std::ofstream file(fileName, std::ios::binary);
+  if (!file.is_open()) {
+    ERROR("MeshBenchmark", "writeSTL", ("Failed to open file: " + fileName).c_str());
+    return E_FAIL;
+  }
+  file.write(data.data(), data.size());
+  return file.good() ? S_OK : E_FAIL;
+}
+
+HRESULT
+MeshBenchmark::writeOBJ(const std::string& fileName, const MeshComponent& mesh) {
+  // Positions are welded so faces that met at a normal or UV seam share them again.
+  PositionWeldGrid grid;
+  grid.init(0.0f, mesh.m_vertex.size());
+  std::vector<unsigned int> positionOf(mesh.m_vertex.size());
+  std::vector<unsigned int> unique;
+  for (size_t i = 0; i < mesh.m_vertex.size(); ++i) {
+    bool inserted = false;
+    positionOf[i] = grid.findOrInsert(mesh.m_vertex[i].Pos, static_cast<unsigned int>(unique.size()), inserted,
+                                      [](unsigned int) { return true; });
+    if (inserted) {
+      unique.push_back(static_cast<unsigned int>(i));
+    }
+  }
+
+  std::string text;
+  char line[128];
+  for (unsigned int vertex : unique) {
+    const XMFLOAT3& p = mesh.m_vertex[vertex].Pos;
+    text.append(line, snprintf(line, sizeof(line), "v %.9g %.9g %.9g\n", p.x, p.y, p.z));
+  }
+  for (const SimpleVertex& vertex : mesh.m_vertex) {
+    text.append(line, snprintf(line, sizeof(line), "vt %.9g %.9g\n", vertex.Tex.x, 1.0f - vertex.Tex.y));
+  }
+  for (size_t i = 0; i + 2 < mesh.m_index.size(); i += 3) {
+    const unsigned int* tri = &mesh.m_index[i];
+    text.append(line, snprintf(line, sizeof(line), "f %u/%u %u/%u %u/%u\n",
+                               positionOf[tri[0]] + 1, tri[0] + 1,
+                               positionOf[tri[1]] + 1, tri[1] + 1,
+                               positionOf[tri[2]] + 1, tri[2] + 1));
+  }
+
+  std::ofstream file(fileName, std::ios::binary);
+  if (!file.is_open()) {
+    ERROR("MeshBenchmark", "writeOBJ", ("Failed to open file: " + fileName).c_str());
+    return E_FAIL;
+  }
+  file.write(text.data(), text.size());
+  return file.good() ? S_OK : E_FAIL;
+}
+
+unsigned long long
+MeshBenchmark::triangleHash(const MeshComponent& mesh) {
+  unsigned long long sum = 0;
+  for (size_t i = 0; i + 2 < mesh.m_index.size(); i += 3) {
+    SimpleVertex triangle[3] = { mesh.m_vertex[mesh.m_index[i]],
+                                 mesh.m_vertex[mesh.m_index[i + 1]],
+                                 mesh.m_vertex[mesh.m_index[i + 2]] };
+    sum += MeshCache::hashBytes(triangle, sizeof(triangle), 1);
+  }
+  return sum;
+}
@@ -0,0 +1,360 @@
+#include "MeshBounds.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#if (defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)) && !defined(_XM_NO_INTRINSICS_)
+#define NOVA_BOUNDS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+static_assert(sizeof(SimpleVertex) == 32 && offsetof(SimpleVertex, Pos) == 0,
+              "The bounds passes load 16 bytes from the start of every SimpleVertex");
+
+namespace {
+  /*
+    Positions per task. Fixed, and the chunks are merged in order, so the
+    reductions do not depend on the thread count.
+  */
+  const size_t kChunkPositions = 1 << 15;
+
+  /*
+    The positions of a vertex array, in order.
+  */
+  struct VertexPositions {
+    const SimpleVertex* vertices;
+
+    const float*
+    operator()(size_t i) const {
+      return &vertices[i].Pos.x;
+    }
+  };
+
+  /*
+    The positions an index range references, in index order.
+  */
+  struct IndexedPositions {
+    const SimpleVertex* vertices;
+    const unsigned int* indices;
+
+    const float*
+    operator()(size_t i) const {
+      return &vertices[indices[i]].Pos.x;
+    }
+  };
+
+  /*
+    Box of a range of positions and the first position at each of its faces.
+  */
+  struct Extremes {
+    float minimum[3];
+    float maximum[3];
+    size_t minimumAt[3];
+    size_t maximumAt[3];
+  };
+
+  /*
+    A sphere while it is being grown.
+  */
+  struct Sphere {
+    XMFLOAT3 center;
+    float radius;
+  };
+
+#if NOVA_BOUNDS_SSE2
+  inline __m128i
+  select(__m128i keep, __m128i take, __m128 mask) {
+    __m128i bits = _mm_castps_si128(mask);
+    return _mm_or_si128(_mm_andnot_si128(bits, keep), _mm_and_si128(bits, take));
+  }
+#endif
+
+  template<typename Positions>
+  Extremes
+  rangeExtremes(const Positions& positions, size_t first, size_t last) {
+    Extremes extremes;
+    const float* start = positions(first);
+    for (size_t k = 0; k < 3; ++k) {
+      extremes.minimum[k] = start[k];
+      extremes.maximum[k] = start[k];
+      extremes.minimumAt[k] = first;
+      extremes.maximumAt[k] = first;
+    }
+#if NOVA_BOUNDS_SSE2
+    // One position per iteration, xyz in the first three lanes; the lanes keep
+    // the offset of the position that last moved them. min(p, low) ignores a
+    // NaN p as the scalar std::min below does.
+    __m128 low = _mm_loadu_ps(start);
+    __m128 high = low;
+    __m128i lowAt = _mm_setzero_si128();
+    __m128i highAt = _mm_setzero_si128();
+    __m128i offset = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi32(1);
+    for (size_t i = first + 1; i < last; ++i) {
+      __m128 p = _mm_loadu_ps(positions(i));
+      offset = _mm_add_epi32(offset, one);
+      lowAt = select(lowAt, offset, _mm_cmplt_ps(p, low));
+      highAt = select(highAt, offset, _mm_cmpgt_ps(p, high));
+      low = _mm_min_ps(p, low);
+      high = _mm_max_ps(p, high);
+    }
+    float lowValues[4];
+    float highValues[4];
+    int lowOffsets[4];
+    int highOffsets[4];
+    _mm_storeu_ps(lowValues, low);
+    _mm_storeu_ps(highValues, high);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lowOffsets), lowAt);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(highOffsets), highAt);
+    for (size_t k = 0; k < 3; ++k) {
+      extremes.minimum[k] = lowValues[k];
+      extremes.maximum[k] = highValues[k];
+      extremes.minimumAt[k] = first + static_cast<size_t>(lowOffsets[k]);
+      extremes.maximumAt[k] = first + static_cast<size_t>(highOffsets[k]);
+    }
+#else
+    for (size_t i = first + 1; i < last; ++i) {
+      const float* p = positions(i);
+      for (size_t k = 0; k < 3; ++k) {
+        if (p[k] < extremes.minimum[k]) {
+          extremes.minimum[k] = p[k];
+          extremes.minimumAt[k] = i;
+        }
+        if (p[k] > extremes.maximum[k]) {
+          extremes.maximum[k] = p[k];
+          extremes.maximumAt[k] = i;
+        }
+      }
+    }
+#endif
+    return extremes;
+  }
+
+  inline float
+  distanceSq(const float* p, const XMFLOAT3& center) {
+    float dx = p[0] - center.x;
+    float dy = p[1] - center.y;
+    float dz = p[2] - center.z;
+    return dx * dx + dy * dy + dz * dz;
+  }
+
+  /*
+    Ritter's growth step: the smallest sphere holding the sphere and p, if p
+    is outside it.
+  */
+  inline void
+  growSphere(Sphere& sphere, const float* p) {
+    float d = distanceSq(p, sphere.center);
+    if (!(d > sphere.radius * sphere.radius)) {
+      return;
+    }
+    float distance = std::sqrt(d);
+    float grown = (sphere.radius + distance) * 0.5f;
+    float shift = (grown - sphere.radius) / distance;
+    sphere.center.x += (p[0] - sphere.center.x) * shift;
+    sphere.center.y += (p[1] - sphere.center.y) * shift;
+    sphere.center.z += (p[2] - sphere.center.z) * shift;
+    sphere.radius = grown;
+  }
+
+  /*
+    Smallest sphere holding both spheres.
+  */
+  Sphere
+  mergeSpheres(const Sphere& a, const Sphere& b) {
+    XMFLOAT3 offset(b.center.x - a.center.x, b.center.y - a.center.y, b.center.z - a.center.z);
+    float distance = std::sqrt(offset.x * offset.x + offset.y * offset.y + offset.z * offset.z);
+    if (distance + b.radius <= a.radius) {
+      return a;
+    }
+    if (distance + a.radius <= b.radius) {
+      return b;
+    }
+    Sphere merged;
+    merged.radius = (distance + a.radius + b.radius) * 0.5f;
+    float shift = (merged.radius - a.radius) / distance;
+    merged.center = XMFLOAT3(a.center.x + offset.x * shift, a.center.y + offset.y * shift,
+                             a.center.z + offset.z * shift);
+    return merged;
+  }
+
+#if NOVA_BOUNDS_SSE2
+  /*
+    Squared distances of four positions to a center.
+  */
+  inline __m128
+  distanceSq4(const float* p0, const float* p1, const float* p2, const float* p3,
+              __m128 centerX, __m128 centerY, __m128 centerZ) {
+    __m128 x = _mm_loadu_ps(p0);
+    __m128 y = _mm_loadu_ps(p1);
+    __m128 z = _mm_loadu_ps(p2);
+    __m128 w = _mm_loadu_ps(p3);
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    x = _mm_sub_ps(x, centerX);
+    y = _mm_sub_ps(y, centerY);
+    z = _mm_sub_ps(z, centerZ);
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+  }
+#endif
+
+  /*
+    Grows a sphere over a range of positions, in order.
+  */
+  template<typename Positions>
+  void
+  rangeGrow(const Positions& positions, size_t first, size_t last, Sphere& sphere) {
+    size_t i = first;
+#if NOVA_BOUNDS_SSE2
+    // Most positions are inside; four at a time are tested against the
+    // current sphere and only the ones outside go through growSphere.
+    for (; i + 4 <= last; i += 4) {
+      const float* p[4] = { positions(i), positions(i + 1), positions(i + 2), positions(i + 3) };
+      __m128 d = distanceSq4(p[0], p[1], p[2], p[3], _mm_set1_ps(sphere.center.x), _mm_set1_ps(sphere.center.y),
+                             _mm_set1_ps(sphere.center.z));
+      if (_mm_movemask_ps(_mm_cmpgt_ps(d, _mm_set1_ps(sphere.radius * sphere.radius))) != 0) {
+        for (size_t lane = 0; lane < 4; ++lane) {
+          growSphere(sphere, p[lane]);
+        }
+      }
+    }
+#endif
+    for (; i < last; ++i) {
+      growSphere(sphere, positions(i));
+    }
+  }
+
+  /*
+    Largest squared distance of a range of positions to each of two centers.
+  */
+  template<typename Positions>
+  void
+  rangeFarthest(const Positions& positions, size_t first, size_t last, const XMFLOAT3 centers[2], float farthest[2]) {
+    farthest[0] = 0.0f;
+    farthest[1] = 0.0f;
+    size_t i = first;
+#if NOVA_BOUNDS_SSE2
+    __m128 best[2] = { _mm_setzero_ps(), _mm_setzero_ps() };
+    for (; i + 4 <= last; i += 4) {
+      const float* p[4] = { positions(i), positions(i + 1), positions(i + 2), positions(i + 3) };
+      for (size_t c = 0; c < 2; ++c) {
+        __m128 d = distanceSq4(p[0], p[1], p[2], p[3], _mm_set1_ps(centers[c].x), _mm_set1_ps(centers[c].y),
+                               _mm_set1_ps(centers[c].z));
+        best[c] = _mm_max_ps(d, best[c]);
+      }
+    }
+    for (size_t c = 0; c < 2; ++c) {
+      float lanes[4];
+      _mm_storeu_ps(lanes, best[c]);
+      farthest[c] = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+    }
+#endif
+    for (; i < last; ++i) {
+      for (size_t c = 0; c < 2; ++c) {
+        farthest[c] = std::max(farthest[c], distanceSq(positions(i), centers[c]));
+      }
+    }
+  }
+
+  template<typename Positions>
+  MeshBounds
+  positionBounds(const Positions& positions, size_t count, unsigned int threadCount) {
+    MeshBounds bounds;
+    if (count == 0) {
+      return bounds;
+    }
+    unsigned int threads = resolveThreadCount(threadCount);
+    size_t chunks = (count + kChunkPositions - 1) / kChunkPositions;
+    auto chunkFirst = [](size_t c) {
+      return c * kChunkPositions;
+    };
+    auto chunkLast = [count](size_t c) {
+      return std::min(count, (c + 1) * kChunkPositions);
+    };
+
+    std::vector<Extremes> chunkExtremes(chunks);
+    parallelFor(chunks, threads, [&](size_t c) {
+      chunkExtremes[c] = rangeExtremes(positions, chunkFirst(c), chunkLast(c));
+    });
+    Extremes extremes = chunkExtremes[0];
+    for (size_t c = 1; c < chunks; ++c) {
+      for (size_t k = 0; k < 3; ++k) {
+        if (chunkExtremes[c].minimum[k] < extremes.minimum[k]) {
+          extremes.minimum[k] = chunkExtremes[c].minimum[k];
+          extremes.minimumAt[k] = chunkExtremes[c].minimumAt[k];
+        }
+        if (chunkExtremes[c].maximum[k] > extremes.maximum[k]) {
+          extremes.maximum[k] = chunkExtremes[c].maximum[k];
+          extremes.maximumAt[k] = chunkExtremes[c].maximumAt[k];
+        }
+      }
+    }
+    bounds.boundsMin = XMFLOAT3(extremes.minimum[0], extremes.minimum[1], extremes.minimum[2]);
+    bounds.boundsMax = XMFLOAT3(extremes.maximum[0], extremes.maximum[1], extremes.maximum[2]);
+
+    // Ritter's start: the sphere on the farthest apart of the three pairs of
+    // extreme positions.
+    size_t axis = 0;
+    float diameterSq = -1.0f;
+    for (size_t k = 0; k < 3; ++k) {
+      const float* low = positions(extremes.minimumAt[k]);
+      float d = distanceSq(positions(extremes.maximumAt[k]), XMFLOAT3(low[0], low[1], low[2]));
+      if (d > diameterSq) {
+        diameterSq = d;
+        axis = k;
+      }
+    }
+    const float* low = positions(extremes.minimumAt[axis]);
+    const float* high = positions(extremes.maximumAt[axis]);
+    Sphere start;
+    start.center = XMFLOAT3((low[0] + high[0]) * 0.5f, (low[1] + high[1]) * 0.5f, (low[2] + high[2]) * 0.5f);
+    start.radius = std::sqrt(std::max(diameterSq, 0.0f)) * 0.5f;
+
+    // Every chunk grows its own copy of it over its positions and the copies
+    // are merged in order.
+    std::vector<Sphere> chunkSpheres(chunks, start);
+    parallelFor(chunks, threads, [&](size_t c) {
+      rangeGrow(positions, chunkFirst(c), chunkLast(c), chunkSpheres[c]);
+    });
+    Sphere sphere = chunkSpheres[0];
+    for (size_t c = 1; c < chunks; ++c) {
+      sphere = mergeSpheres(sphere, chunkSpheres[c]);
+    }
+
+    // Growing overshoots; the exact radius around its center is smaller, and
+    // for boxy point sets the box center can do better still.
+    XMFLOAT3 centers[2] = { sphere.center,
+                            XMFLOAT3((extremes.minimum[0] + extremes.maximum[0]) * 0.5f,
+                                     (extremes.minimum[1] + extremes.maximum[1]) * 0.5f,
+                                     (extremes.minimum[2] + extremes.maximum[2]) * 0.5f) };
+    std::vector<float> chunkFarthest(chunks * 2);
+    parallelFor(chunks, threads, [&](size_t c) {
+      rangeFarthest(positions, chunkFirst(c), chunkLast(c), centers, &chunkFarthest[c * 2]);
+    });
+    float farthest[2] = { 0.0f, 0.0f };
+    for (size_t c = 0; c < chunks; ++c) {
+      farthest[0] = std::max(farthest[0], chunkFarthest[c * 2]);
+      farthest[1] = std::max(farthest[1], chunkFarthest[c * 2 + 1]);
+    }
+    size_t best = farthest[1] < farthest[0] ? 1 : 0;
+    XMFLOAT3 center = centers[best];
+    float radius = std::sqrt(farthest[best]);
+    bounds.center = center;
+    bounds.radius = radius;
+    return bounds;
+  }
+}
+
+MeshBounds
+computeVertexBounds(const SimpleVertex* vertices, size_t count, unsigned int threadCount) {
+  return positionBounds(VertexPositions{ vertices }, count, threadCount);
+}
+
+MeshBounds
+computeIndexedBounds(const SimpleVertex* vertices,
+                     const unsigned int* indices,
+                     size_t indexCount,
+                     unsigned int threadCount) {
+  return positionBounds(IndexedPositions{ vertices, indices }, indexCount, threadCount);
+}
@@ -0,0 +1,519 @@
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include "MeshCodec.h"
+#include "Parallel.h"
+#include <cstring>
+#include <fstream>
+
+namespace {
+  const unsigned long long kPrime1 = 0x9E3779B185EBCA87ull;
+  const unsigned long long kPrime2 = 0xC2B2AE3D27D4EB4Full;
+  const unsigned long long kPrime3 = 0x165667B19E3779F9ull;
+  const size_t kHashBlockSize = 4 << 20;
+
+  inline unsigned long long
+  rotl(unsigned long long x, int r) {
+    return (x << r) | (x >> (64 - r));
+  }
+
+  inline unsigned long long
+  read64(const unsigned char* p) {
+    unsigned long long value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+  }
+
+  inline unsigned long long
+  avalanche(unsigned long long h) {
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+  }
+
+  /*
+    Four independent multiply-rotate lanes keep the multipliers busy; the tail is
+    folded in eight bytes and then one byte at a time.
+  */
+  unsigned long long
+  hashBlock(const unsigned char* p, size_t size, unsigned long long seed) {
+    const unsigned char* end = p + size;
+    unsigned long long h;
+    if (size >= 32) {
+      unsigned long long lanes[4] = { seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1 };
+      const unsigned char* limit = end - 32;
+      do {
+        for (int i = 0; i < 4; ++i) {
+          lanes[i] = rotl(lanes[i] + read64(p + i * 8) * kPrime2, 31) * kPrime1;
+        }
+        p += 32;
+      } while (p <= limit);
+      h = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+    }
+    else {
+      h = seed + kPrime3;
+    }
+    h += static_cast<unsigned long long>(size);
+
+    while (p + 8 <= end) {
+      h ^= rotl(read64(p) * kPrime2, 31) * kPrime1;
+      h = rotl(h, 27) * kPrime1 + kPrime3;
+      p += 8;
+    }
+    while (p < end) {
+      h ^= static_cast<unsigned long long>(*p) * kPrime3;
+      h = rotl(h, 11) * kPrime1;
+      ++p;
+    }
+    return avalanche(h);
+  }
+
+  inline unsigned long long
+  alignOffset(unsigned long long offset) {
+    return (offset + 15) & ~15ull;
+  }
+
+  /*
+    The metadata block holds the variable-length tables: materials, then
+    dependencies. Strings are stored as a 32-bit length followed by the bytes.
+  */
+  template<typename T>
+  inline void
+  appendPod(std::string& blob, const T& value) {
+    blob.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  inline void
+  appendString(std::string& blob, const std::string& value) {
+    appendPod(blob, static_cast<uint32_t>(value.size()));
+    blob.append(value);
+  }
+
+  template<typename T>
+  inline bool
+  readPod(const char*& p, const char* end, T& value) {
+    if (static_cast<size_t>(end - p) < sizeof(T)) return false;
+    memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+  }
+
+  inline bool
+  readString(const char*& p, const char* end, std::string& value) {
+    uint32_t length = 0;
+    if (!readPod(p, end, length) || static_cast<size_t>(end - p) < length) return false;
+    value.assign(p, length);
+    p += length;
+    return true;
+  }
+
+  std::string
+  writeMetadata(const MeshComponent& mesh, const std::vector<MeshCacheDependency>& dependencies) {
+    std::string blob;
+    appendPod(blob, static_cast<uint32_t>(mesh.m_materials.size()));
+    for (const MeshMaterial& material : mesh.m_materials) {
+      appendPod(blob, material.ambient);
+      appendPod(blob, material.diffuse);
+      appendPod(blob, material.specular);
+      appendPod(blob, material.shininess);
+      appendPod(blob, material.opacity);
+      appendString(blob, material.name);
+      appendString(blob, material.diffuseTexture);
+      appendString(blob, material.normalTexture);
+    }
+    appendPod(blob, static_cast<uint32_t>(dependencies.size()));
+    for (const MeshCacheDependency& dependency : dependencies) {
+      appendPod(blob, static_cast<uint64_t>(dependency.size));
+      appendPod(blob, static_cast<uint64_t>(dependency.hash));
+      appendString(blob, dependency.path);
+    }
+    return blob;
+  }
+
+  /*
+    True if count elements of elementSize bytes starting at offset fit in a
+    file of fileSize bytes. Written with subtraction and division so corrupt
+    header values cannot overflow it.
+  */
+  inline bool
+  rangeFits(unsigned long long offset,
+            unsigned long long count,
+            unsigned long long elementSize,
+            unsigned long long fileSize) {
+    return offset <= fileSize && count <= (fileSize - offset) / elementSize;
+  }
+
+  /*
+    True if [first, first + count) lies inside [0, size).
+  */
+  inline bool
+  indexRangeFits(unsigned long long first, unsigned long long count, unsigned long long size) {
+    return first <= size && count <= size - first;
+  }
+
+  bool
+  readMaterials(const char*& p, const char* end, std::vector<MeshMaterial>& materials) {
+    uint32_t count = 0;
+    if (!readPod(p, end, count)) return false;
+    materials.resize(count);
+    for (MeshMaterial& material : materials) {
+      if (!readPod(p, end, material.ambient) ||
+          !readPod(p, end, material.diffuse) ||
+          !readPod(p, end, material.specular) ||
+          !readPod(p, end, material.shininess) ||
+          !readPod(p, end, material.opacity) ||
+          !readString(p, end, material.name) ||
+          !readString(p, end, material.diffuseTexture) ||
+          !readString(p, end, material.normalTexture)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool
+  readDependencies(const char*& p, const char* end, std::vector<MeshCacheDependency>& dependencies) {
+    uint32_t count = 0;
+    if (!readPod(p, end, count)) return false;
+    dependencies.resize(count);
+    for (MeshCacheDependency& dependency : dependencies) {
+      uint64_t size = 0, hash = 0;
+      if (!readPod(p, end, size) || !readPod(p, end, hash) || !readString(p, end, dependency.path)) {
+        return false;
+      }
+      dependency.size = size;
+      dependency.hash = hash;
+    }
+    return true;
+  }
+}
+
+HRESULT
+MeshCache::load(const std::string& cachePath,
+                unsigned long long sourceSize,
+                unsigned long long sourceHash,
+                MeshComponent& outMesh,
+                unsigned int threadCount) {
+  if (GetFileAttributesA(cachePath.c_str()) == INVALID_FILE_ATTRIBUTES) {
+    return S_FALSE;
+  }
+
+  MappedFile file;
+  if (FAILED(file.init(cachePath)) || file.size() < sizeof(NovaMeshHeader)) {
+    return S_FALSE;
+  }
+
+  // The view is page-aligned, so the header and the 16-byte aligned payloads
+  // can be read in place.
+  const NovaMeshHeader* header = reinterpret_cast<const NovaMeshHeader*>(file.data());
+  if (memcmp(header->magic, "NMSH", 4) != 0 ||
+      header->version != kNovaMeshVersion ||
+      header->headerSize != sizeof(NovaMeshHeader) ||
+      header->vertexStride != sizeof(SimpleVertex) ||
+      header->indexStride != sizeof(unsigned int) ||
+      header->clusterStride != sizeof(MeshCluster)) {
+    REPORT("MeshCache", "load", ("Ignoring incompatible cache " + cachePath).c_str());
+    return S_FALSE;
+  }
+  if (header->sourceSize != sourceSize || header->sourceHash != sourceHash) {
+    REPORT("MeshCache", "load", ("Source changed, ignoring stale cache " + cachePath).c_str());
+    return S_FALSE;
+  }
+
+  // Indices are 32-bit, so no valid cache holds more vertices or indices than
+  // that; checking it first also keeps the byte sizes below from overflowing.
+  const unsigned long long fileSize = file.size();
+  const unsigned long long kMaxCount = 0xFFFFFFFFull;
+  bool fits = header->vertexCount <= kMaxCount && header->indexCount <= kMaxCount &&
+              (header->tangentCount == 0 || header->tangentCount == header->vertexCount);
+  unsigned long long vertexBytes = header->vertexCount * sizeof(SimpleVertex);
+  unsigned long long indexBytes = header->indexCount * sizeof(unsigned int);
+  unsigned long long tangentBytes = header->tangentCount * sizeof(XMFLOAT4);
+  // Compressed payloads are stored in their encoded size at the same offsets.
+  unsigned long long vertexStored = header->vertexEncodedSize != 0 ? header->vertexEncodedSize : vertexBytes;
+  unsigned long long indexStored = header->indexEncodedSize != 0 ? header->indexEncodedSize : indexBytes;
+  unsigned long long tangentStored = header->tangentEncodedSize != 0 ? header->tangentEncodedSize : tangentBytes;
+  if (!fits ||
+      !rangeFits(header->vertexOffset, vertexStored, 1, fileSize) ||
+      !rangeFits(header->indexOffset, indexStored, 1, fileSize) ||
+      !rangeFits(header->submeshOffset, header->submeshCount, sizeof(NovaMeshSubmesh), fileSize) ||
+      !rangeFits(header->metadataOffset, header->metadataSize, 1, fileSize) ||
+      !rangeFits(header->tangentOffset, tangentStored, 1, fileSize) ||
+      !rangeFits(header->lodOffset, header->lodCount, sizeof(float), fileSize) ||
+      !rangeFits(header->clusterOffset, header->clusterCount, sizeof(MeshCluster), fileSize)) {
+    REPORT("MeshCache", "load", ("Ignoring truncated cache " + cachePath).c_str());
+    return S_FALSE;
+  }
+
+  const char* metadata = file.data() + header->metadataOffset;
+  const char* metadataEnd = metadata + header->metadataSize;
+  std::vector<MeshMaterial> materials;
+  std::vector<MeshCacheDependency> dependencies;
+  if (!readMaterials(metadata, metadataEnd, materials) || !readDependencies(metadata, metadataEnd, dependencies)) {
+    REPORT("MeshCache", "load", ("Ignoring corrupt cache " + cachePath).c_str());
+    return S_FALSE;
+  }
+  for (const MeshCacheDependency& dependency : dependencies) {
+    MeshCacheDependency current = describeFile(dependency.path);
+    if (current.size != dependency.size || current.hash != dependency.hash) {
+      REPORT("MeshCache", "load", (dependency.path + " changed, ignoring stale cache " + cachePath).c_str());
+      return S_FALSE;
+    }
+  }
+
+  const NovaMeshSubmesh* submeshes = reinterpret_cast<const NovaMeshSubmesh*>(file.data() + header->submeshOffset);
+  for (size_t i = 0; i < header->submeshCount; ++i) {
+    if (submeshes[i].lodLevel > header->lodCount ||
+        !indexRangeFits(submeshes[i].indexOffset, submeshes[i].indexCount, header->indexCount)) {
+      REPORT("MeshCache", "load", ("Ignoring corrupt cache " + cachePath).c_str());
+      return S_FALSE;
+    }
+  }
+
+  const MeshCluster* clusters = reinterpret_cast<const MeshCluster*>(file.data() + header->clusterOffset);
+  for (size_t i = 0; i < header->clusterCount; ++i) {
+    if (clusters[i].lodLevel > header->lodCount ||
+        !indexRangeFits(clusters[i].indexOffset, clusters[i].indexCount, header->indexCount)) {
+      REPORT("MeshCache", "load", ("Ignoring corrupt cache " + cachePath).c_str());
+      return S_FALSE;
+    }
+  }
+
+  const unsigned char* payload = reinterpret_cast<const unsigned char*>(file.data());
+  bool decoded = true;
+  if (header->vertexEncodedSize != 0) {
+    outMesh.m_vertex.resize(header->vertexCount);
+    decoded = decoded && decodeVertexBuffer(outMesh.m_vertex.data(), outMesh.m_vertex.size(), sizeof(SimpleVertex),
+      payload + header->vertexOffset, vertexStored, threadCount);
+  }
+  else {
+    const SimpleVertex* vertices = reinterpret_cast<const SimpleVertex*>(payload + header->vertexOffset);
+    outMesh.m_vertex.assign(vertices, vertices + header->vertexCount);
+  }
+  if (header->indexEncodedSize != 0) {
+    outMesh.m_index.resize(header->indexCount);
+    decoded = decoded && decodeIndexBuffer(outMesh.m_index.data(), outMesh.m_index.size(),
+      payload + header->indexOffset, indexStored);
+  }
+  else {
+    const unsigned int* indices = reinterpret_cast<const unsigned int*>(payload + header->indexOffset);
+    outMesh.m_index.assign(indices, indices + header->indexCount);
+  }
+  if (header->tangentEncodedSize != 0) {
+    outMesh.m_tangent.resize(header->tangentCount);
+    decoded = decoded && decodeVertexBuffer(outMesh.m_tangent.data(), outMesh.m_tangent.size(), sizeof(XMFLOAT4),
+      payload + header->tangentOffset, tangentStored, threadCount);
+  }
+  else {
+    const XMFLOAT4* tangents = reinterpret_cast<const XMFLOAT4*>(payload + header->tangentOffset);
+    outMesh.m_tangent.assign(tangents, tangents + header->tangentCount);
+  }
+  // An index past the vertices would make the GPU read outside the vertex buffer.
+  for (size_t i = 0; decoded && i < outMesh.m_index.size(); ++i) {
+    decoded = outMesh.m_index[i] < header->vertexCount;
+  }
+  if (!decoded) {
+    outMesh.m_vertex.clear();
+    outMesh.m_index.clear();
+    outMesh.m_tangent.clear();
+    REPORT("MeshCache", "load", ("Ignoring corrupt cache " + cachePath).c_str());
+    return S_FALSE;
+  }
+  outMesh.m_numVertex = static_cast<int>(outMesh.m_vertex.size());
+  outMesh.m_numIndex = static_cast<int>(outMesh.m_index.size());
+  outMesh.m_boundsMin = XMFLOAT3(header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]);
+  outMesh.m_boundsMax = XMFLOAT3(header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]);
+  outMesh.m_boundsCenter = XMFLOAT3(header->boundsCenter[0], header->boundsCenter[1], header->boundsCenter[2]);
+  outMesh.m_boundsRadius = header->boundsRadius;
+
+  const float* lodErrors = reinterpret_cast<const float*>(file.data() + header->lodOffset);
+  outMesh.m_submeshes.clear();
+  outMesh.m_lods.resize(header->lodCount);
+  for (size_t i = 0; i < outMesh.m_lods.size(); ++i) {
+    outMesh.m_lods[i].error = lodErrors[i];
+    outMesh.m_lods[i].submeshes.clear();
+  }
+  for (size_t i = 0; i < header->submeshCount; ++i) {
+    std::vector<MeshSubmesh>& level = (submeshes[i].lodLevel == 0)
+      ? outMesh.m_submeshes : outMesh.m_lods[submeshes[i].lodLevel - 1].submeshes;
+    level.emplace_back();
+    MeshSubmesh& submesh = level.back();
+    submesh.indexOffset = submeshes[i].indexOffset;
+    submesh.indexCount = submeshes[i].indexCount;
+    submesh.materialId = submeshes[i].materialId;
+    submesh.boundsMin = XMFLOAT3(submeshes[i].boundsMin[0], submeshes[i].boundsMin[1], submeshes[i].boundsMin[2]);
+    submesh.boundsMax = XMFLOAT3(submeshes[i].boundsMax[0], submeshes[i].boundsMax[1], submeshes[i].boundsMax[2]);
+    submesh.center = XMFLOAT3(submeshes[i].center[0], submeshes[i].center[1], submeshes[i].center[2]);
+    submesh.radius = submeshes[i].radius;
+  }
+  outMesh.m_clusters.assign(clusters, clusters + header->clusterCount);
+  outMesh.m_materials = std::move(materials);
+
+  return S_OK;
+}
+
+HRESULT
+MeshCache::save(const std::string& cachePath,
+                unsigned long long sourceSize,
+                unsigned long long sourceHash,
+                const MeshComponent& mesh,
+                const std::vector<MeshCacheDependency>& dependencies,
+                bool compress) {
+  std::vector<NovaMeshSubmesh> submeshes;
+  std::vector<float> lodErrors;
+  for (size_t level = 0; level <= mesh.m_lods.size(); ++level) {
+    for (const MeshSubmesh& submesh : mesh.lodSubmeshes(level)) {
+      submeshes.push_back(NovaMeshSubmesh{ submesh.indexOffset, submesh.indexCount, submesh.materialId,
+        static_cast<uint32_t>(level),
+        { submesh.boundsMin.x, submesh.boundsMin.y, submesh.boundsMin.z },
+        { submesh.boundsMax.x, submesh.boundsMax.y, submesh.boundsMax.z },
+        { submesh.center.x, submesh.center.y, submesh.center.z }, submesh.radius });
+    }
+    if (level > 0) {
+      lodErrors.push_back(mesh.m_lods[level - 1].error);
+    }
+  }
+  std::string metadata = writeMetadata(mesh, dependencies);
+
+  const char* vertexData = reinterpret_cast<const char*>(mesh.m_vertex.data());
+  const char* indexData = reinterpret_cast<const char*>(mesh.m_index.data());
+  const char* tangentData = reinterpret_cast<const char*>(mesh.m_tangent.data());
+  unsigned long long vertexBytes = mesh.m_vertex.size() * sizeof(SimpleVertex);
+  unsigned long long indexBytes = mesh.m_index.size() * sizeof(unsigned int);
+  unsigned long long tangentBytes = mesh.m_tangent.size() * sizeof(XMFLOAT4);
+  std::vector<unsigned char> encodedVertices;
+  std::vector<unsigned char> encodedIndices;
+  std::vector<unsigned char> encodedTangents;
+  if (compress) {
+    encodeVertexBuffer(encodedVertices, mesh.m_vertex.data(), mesh.m_vertex.size(), sizeof(SimpleVertex));
+    vertexData = reinterpret_cast<const char*>(encodedVertices.data());
+    vertexBytes = encodedVertices.size();
+    // The index codec works on whole triangles.
+    if (mesh.m_index.size() % 3 == 0) {
+      encodeIndexBuffer(encodedIndices, mesh.m_index.data(), mesh.m_index.size());
+      indexData = reinterpret_cast<const char*>(encodedIndices.data());
+      indexBytes = encodedIndices.size();
+    }
+    if (!mesh.m_tangent.empty()) {
+      encodeVertexBuffer(encodedTangents, mesh.m_tangent.data(), mesh.m_tangent.size(), sizeof(XMFLOAT4));
+      tangentData = reinterpret_cast<const char*>(encodedTangents.data());
+      tangentBytes = encodedTangents.size();
+    }
+  }
+
+  NovaMeshHeader header = {};
+  memcpy(header.magic, "NMSH", 4);
+  header.version = kNovaMeshVersion;
+  header.headerSize = sizeof(NovaMeshHeader);
+  header.vertexStride = sizeof(SimpleVertex);
+  header.indexStride = sizeof(unsigned int);
+  header.clusterStride = sizeof(MeshCluster);
+  header.sourceSize = sourceSize;
+  header.sourceHash = sourceHash;
+  header.vertexCount = mesh.m_vertex.size();
+  header.indexCount = mesh.m_index.size();
+  header.vertexOffset = alignOffset(sizeof(NovaMeshHeader));
+  header.indexOffset = alignOffset(header.vertexOffset + vertexBytes);
+  header.boundsMin[0] = mesh.m_boundsMin.x;
+  header.boundsMin[1] = mesh.m_boundsMin.y;
+  header.boundsMin[2] = mesh.m_boundsMin.z;
+  header.boundsMax[0] = mesh.m_boundsMax.x;
+  header.boundsMax[1] = mesh.m_boundsMax.y;
+  header.boundsMax[2] = mesh.m_boundsMax.z;
+  header.boundsCenter[0] = mesh.m_boundsCenter.x;
+  header.boundsCenter[1] = mesh.m_boundsCenter.y;
+  header.boundsCenter[2] = mesh.m_boundsCenter.z;
+  header.boundsRadius = mesh.m_boundsRadius;
+  header.submeshCount = submeshes.size();
+  header.submeshOffset = alignOffset(header.indexOffset + indexBytes);
+  header.metadataSize = metadata.size();
+  header.metadataOffset = alignOffset(header.submeshOffset + header.submeshCount * sizeof(NovaMeshSubmesh));
+  header.tangentCount = mesh.m_tangent.size();
+  header.tangentOffset = alignOffset(header.metadataOffset + header.metadataSize);
+  header.lodCount = lodErrors.size();
+  header.lodOffset = alignOffset(header.tangentOffset + tangentBytes);
+  header.clusterCount = mesh.m_clusters.size();
+  header.clusterOffset = alignOffset(header.lodOffset + header.lodCount * sizeof(float));
+  header.vertexEncodedSize = encodedVertices.size();
+  header.indexEncodedSize = encodedIndices.size();
+  header.tangentEncodedSize = encodedTangents.size();
+
+  std::string tempPath = cachePath + ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      ERROR("MeshCache", "save", ("Failed to create cache file: " + tempPath).c_str());
+      return E_FAIL;
+    }
+
+    const char padding[16] = {};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(padding, static_cast<std::streamsize>(header.vertexOffset - sizeof(header)));
+    file.write(vertexData, static_cast<std::streamsize>(vertexBytes));
+    file.write(padding, static_cast<std::streamsize>(header.indexOffset - header.vertexOffset - vertexBytes));
+    file.write(indexData, static_cast<std::streamsize>(indexBytes));
+    file.write(padding, static_cast<std::streamsize>(header.submeshOffset - header.indexOffset - indexBytes));
+    file.write(reinterpret_cast<const char*>(submeshes.data()),
+      static_cast<std::streamsize>(header.submeshCount * sizeof(NovaMeshSubmesh)));
+    file.write(padding, static_cast<std::streamsize>(header.metadataOffset - header.submeshOffset - header.submeshCount * sizeof(NovaMeshSubmesh)));
+    file.write(metadata.data(), static_cast<std::streamsize>(metadata.size()));
+    file.write(padding, static_cast<std::streamsize>(header.tangentOffset - header.metadataOffset - metadata.size()));
+    file.write(tangentData, static_cast<std::streamsize>(tangentBytes));
+    file.write(padding, static_cast<std::streamsize>(header.lodOffset - header.tangentOffset - tangentBytes));
+    file.write(reinterpret_cast<const char*>(lodErrors.data()),
+      static_cast<std::streamsize>(header.lodCount * sizeof(float)));
+    file.write(padding, static_cast<std::streamsize>(header.clusterOffset - header.lodOffset - header.lodCount * sizeof(float)));
+    file.write(reinterpret_cast<const char*>(mesh.m_clusters.data()),
+      static_cast<std::streamsize>(header.clusterCount * sizeof(MeshCluster)));
+    if (!file.good()) {
+      ERROR("MeshCache", "save", ("Failed to write cache file: " + tempPath).c_str());
+      file.close();
+      DeleteFileA(tempPath.c_str());
+      return E_FAIL;
+    }
+  }
+
+  if (!MoveFileExA(tempPath.c_str(), cachePath.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+    ERROR("MeshCache", "save", ("Failed to move cache file into place: " + cachePath).c_str());
+    DeleteFileA(tempPath.c_str());
+    return E_FAIL;
+  }
+
+  return S_OK;
+}
+
+MeshCacheDependency
+MeshCache::describeFile(const std::string& path) {
+  MeshCacheDependency dependency;
+  dependency.path = path;
+  if (GetFileAttributesA(path.c_str()) == INVALID_FILE_ATTRIBUTES) {
+    return dependency;
+  }
+  MappedFile file;
+  if (SUCCEEDED(file.init(path))) {
+    dependency.size = file.size();
+    dependency.hash = hashBytes(file.data(), file.size(), 1);
+  }
+  return dependency;
+}
+
+unsigned long long
+MeshCache::hashBytes(const void* data, size_t size, unsigned int threadCount) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  size_t blockCount = (size + kHashBlockSize - 1) / kHashBlockSize;
+  std::vector<unsigned long long> blockHashes(blockCount);
+
+  parallelFor(blockCount, threadCount, [&](size_t block) {
+    size_t offset = block * kHashBlockSize;
+    size_t length = std::min(kHashBlockSize, size - offset);
+    blockHashes[block] = hashBlock(bytes + offset, length, static_cast<unsigned long long>(block));
+  });
+
+  unsigned long long h = kPrime3 ^ static_cast<unsigned long long>(size);
+  for (unsigned long long blockHash : blockHashes) {
+    h = rotl(h ^ blockHash, 27) * kPrime1 + kPrime2;
+  }
+  return avalanche(h);
+}
@@ -0,0 +1,446 @@
+#include "MeshCleanup.h"
+#include "Parallel.h"
+#include "WeldCell.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+  const unsigned int kNoRange = 0xFFFFFFFFu;
+
+  /*
+    Stable counting sort of the items 0..n-1 by keys[i] < bucketCount: bucket b
+    holds items[start[b]..start[b + 1]), made by makeItem(i) in increasing i,
+    so a scan of a bucket meets earlier items first. Building the item during
+    the scatter reads the source sequentially.
+  */
+  template<typename Item, typename MakeItem>
+  void
+  bucketItems(const std::vector<unsigned int>& keys,
+              size_t bucketCount,
+              std::vector<unsigned int>& start,
+              std::vector<Item>& items,
+              MakeItem makeItem) {
+    start.assign(bucketCount + 1, 0);
+    for (unsigned int key : keys) {
+      ++start[key + 1];
+    }
+    for (size_t b = 0; b < bucketCount; ++b) {
+      start[b + 1] += start[b];
+    }
+    std::vector<unsigned int> cursor(start.begin(), start.end() - 1);
+    items.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      items[cursor[keys[i]]++] = makeItem(i);
+    }
+  }
+
+  /*
+    True if two directions (normals or tangents) are equal or within the angle
+    whose cosine is given.
+  */
+  inline bool
+  directionsMatch(float ax, float ay, float az, float bx, float by, float bz, float cosine) {
+    if (ax == bx && ay == by && az == bz) {
+      return true;
+    }
+    float lengths = (ax * ax + ay * ay + az * az) * (bx * bx + by * by + bz * bz);
+    return lengths > 0.0f && ax * bx + ay * by + az * bz >= cosine * std::sqrt(lengths);
+  }
+
+  /*
+    Rotates a triangle so its smallest index comes first; the winding is kept.
+  */
+  inline void
+  canonicalTriangle(const unsigned int* triangle, unsigned int (&out)[3]) {
+    unsigned int a = triangle[0];
+    unsigned int b = triangle[1];
+    unsigned int c = triangle[2];
+    if (b < a && b < c) {
+      out[0] = b; out[1] = c; out[2] = a;
+    }
+    else if (c < a && c < b) {
+      out[0] = c; out[1] = a; out[2] = b;
+    }
+    else {
+      out[0] = a; out[1] = b; out[2] = c;
+    }
+  }
+}
+
+MeshCleanupStats
+cleanupMesh(MeshComponent& mesh, const MeshCleanupOptions& options, unsigned int threadCount) {
+  MeshCleanupStats stats;
+  stats.verticesBefore = stats.verticesAfter = mesh.m_vertex.size();
+  stats.indicesBefore = stats.indicesAfter = mesh.m_index.size();
+  if (mesh.m_index.empty() || mesh.m_vertex.empty()) {
+    return stats;
+  }
+  threadCount = resolveThreadCount(threadCount);
+
+  const size_t vertexCount = mesh.m_vertex.size();
+  const SimpleVertex* vertices = mesh.m_vertex.data();
+  const bool hasColors = mesh.m_color.size() == vertexCount;
+  const bool hasTangents = mesh.m_tangent.size() == vertexCount;
+
+  XMFLOAT3 minimum = vertices[0].Pos;
+  XMFLOAT3 maximum = vertices[0].Pos;
+  for (size_t v = 1; v < vertexCount; ++v) {
+    minimum.x = std::min(minimum.x, vertices[v].Pos.x);
+    minimum.y = std::min(minimum.y, vertices[v].Pos.y);
+    minimum.z = std::min(minimum.z, vertices[v].Pos.z);
+    maximum.x = std::max(maximum.x, vertices[v].Pos.x);
+    maximum.y = std::max(maximum.y, vertices[v].Pos.y);
+    maximum.z = std::max(maximum.z, vertices[v].Pos.z);
+  }
+  float extent = std::max(maximum.x - minimum.x, std::max(maximum.y - minimum.y, maximum.z - minimum.z));
+  float tolerance = options.positionTolerance * extent;
+  if (!(tolerance > 0.0f) || !std::isfinite(tolerance)) {
+    tolerance = 0.0f;
+  }
+  const float tolerance2 = tolerance * tolerance;
+  // Cells at least twice the tolerance wide keep the tolerance box of a
+  // vertex within 2x2x2 cells. Cells about half the vertex spacing wide hold
+  // little more than one position each, and the box of most vertices then
+  // falls inside its home cell alone.
+  const float spacing = extent / std::sqrt(static_cast<float>(vertexCount));
+  const float inverseCell = (tolerance > 0.0f) ? 1.0f / std::max(2.0f * tolerance, 0.5f * spacing) : 0.0f;
+  const float texcoordTolerance = std::max(options.texcoordTolerance, 0.0f);
+  const float normalCosine = std::cos(std::min(std::max(options.normalTolerance, 0.0f), 180.0f) * 0.01745329252f);
+
+  auto weldable = [&](size_t a, size_t b) {
+    const SimpleVertex& va = vertices[a];
+    const SimpleVertex& vb = vertices[b];
+    float dx = va.Pos.x - vb.Pos.x;
+    float dy = va.Pos.y - vb.Pos.y;
+    float dz = va.Pos.z - vb.Pos.z;
+    if (tolerance == 0.0f ? (dx != 0.0f || dy != 0.0f || dz != 0.0f) : dx * dx + dy * dy + dz * dz > tolerance2) {
+      return false;
+    }
+    if (std::fabs(va.Tex.x - vb.Tex.x) > texcoordTolerance || std::fabs(va.Tex.y - vb.Tex.y) > texcoordTolerance) {
+      return false;
+    }
+    if (!directionsMatch(va.Normal.x, va.Normal.y, va.Normal.z, vb.Normal.x, vb.Normal.y, vb.Normal.z, normalCosine)) {
+      return false;
+    }
+    if (hasColors && mesh.m_color[a] != mesh.m_color[b]) {
+      return false;
+    }
+    if (hasTangents) {
+      const XMFLOAT4& ta = mesh.m_tangent[a];
+      const XMFLOAT4& tb = mesh.m_tangent[b];
+      if (ta.w != tb.w || !directionsMatch(ta.x, ta.y, ta.z, tb.x, tb.y, tb.z, normalCosine)) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  // Home cell of every vertex, hashed into a power-of-two bucket count of
+  // about one bucket per vertex.
+  size_t bucketCount = 1;
+  while (bucketCount < vertexCount) {
+    bucketCount <<= 1;
+  }
+  const unsigned int bucketMask = static_cast<unsigned int>(bucketCount - 1);
+  auto homeCell = [&](const XMFLOAT3& p, int (&cell)[3]) {
+    if (tolerance == 0.0f) {
+      cell[0] = weldCellBits(p.x);
+      cell[1] = weldCellBits(p.y);
+      cell[2] = weldCellBits(p.z);
+    }
+    else {
+      cell[0] = weldCellOf(p.x * inverseCell);
+      cell[1] = weldCellOf(p.y * inverseCell);
+      cell[2] = weldCellOf(p.z * inverseCell);
+    }
+  };
+  // The cell travels with the vertex id, so a bucket scan reads one array.
+  struct WeldEntry {
+    int cell[3];
+    unsigned int vertex;
+  };
+  std::vector<WeldEntry> homes(vertexCount);
+  std::vector<unsigned int> buckets(vertexCount);
+  std::vector<unsigned char> crossesCell(vertexCount, 0);
+  parallelForRange(vertexCount, threadCount, 1 << 14, [&](size_t first, size_t last) {
+    for (size_t v = first; v < last; ++v) {
+      const XMFLOAT3& p = vertices[v].Pos;
+      WeldEntry& home = homes[v];
+      homeCell(p, home.cell);
+      home.vertex = static_cast<unsigned int>(v);
+      buckets[v] = static_cast<unsigned int>(weldCellHash(home.cell[0], home.cell[1], home.cell[2])) & bucketMask;
+      if (tolerance > 0.0f) {
+        crossesCell[v] = (weldCellOf((p.x - tolerance) * inverseCell) != home.cell[0] ||
+                          weldCellOf((p.y - tolerance) * inverseCell) != home.cell[1] ||
+                          weldCellOf((p.z - tolerance) * inverseCell) != home.cell[2] ||
+                          weldCellOf((p.x + tolerance) * inverseCell) != home.cell[0] ||
+                          weldCellOf((p.y + tolerance) * inverseCell) != home.cell[1] ||
+                          weldCellOf((p.z + tolerance) * inverseCell) != home.cell[2]) ? 1 : 0;
+      }
+    }
+  });
+  std::vector<unsigned int> bucketStart;
+  std::vector<WeldEntry> entries;
+  bucketItems(buckets, bucketCount, bucketStart, entries, [&](size_t v) { return homes[v]; });
+  std::vector<unsigned int>().swap(buckets);
+
+  // Every vertex looks for the earliest vertex it can be welded to. Buckets
+  // list vertices in increasing order, so the first match is the earliest.
+  // The home cell is searched bucket by bucket, which walks the table in
+  // memory order.
+  std::vector<unsigned int> earliest(vertexCount);
+  parallelForRange(bucketCount, threadCount, 1 << 14, [&](size_t first, size_t last) {
+    for (size_t bucket = first; bucket < last; ++bucket) {
+      for (unsigned int k = bucketStart[bucket]; k < bucketStart[bucket + 1]; ++k) {
+        const WeldEntry& entry = entries[k];
+        unsigned int best = entry.vertex;
+        for (unsigned int j = bucketStart[bucket]; j < k; ++j) {
+          const WeldEntry& other = entries[j];
+          if (other.cell[0] == entry.cell[0] && other.cell[1] == entry.cell[1] && other.cell[2] == entry.cell[2] &&
+              weldable(entry.vertex, other.vertex)) {
+            best = other.vertex;
+            break;
+          }
+        }
+        earliest[entry.vertex] = best;
+      }
+    }
+  });
+
+  // Only vertices within the tolerance of a cell face also search the
+  // neighbouring cells, for an earlier vertex than the home cell gave.
+  if (tolerance > 0.0f) {
+    parallelForRange(vertexCount, threadCount, 1 << 12, [&](size_t first, size_t last) {
+      for (size_t v = first; v < last; ++v) {
+        if (crossesCell[v] == 0) {
+          continue;
+        }
+        const XMFLOAT3& p = vertices[v].Pos;
+        const int* home = homes[v].cell;
+        int low[3] = { weldCellOf((p.x - tolerance) * inverseCell), weldCellOf((p.y - tolerance) * inverseCell),
+                       weldCellOf((p.z - tolerance) * inverseCell) };
+        int high[3] = { weldCellOf((p.x + tolerance) * inverseCell), weldCellOf((p.y + tolerance) * inverseCell),
+                        weldCellOf((p.z + tolerance) * inverseCell) };
+        unsigned int best = earliest[v];
+        for (int x = low[0]; x <= high[0]; ++x) {
+          for (int y = low[1]; y <= high[1]; ++y) {
+            for (int z = low[2]; z <= high[2]; ++z) {
+              if (x == home[0] && y == home[1] && z == home[2]) {
+                continue;
+              }
+              size_t bucket = weldCellHash(x, y, z) & bucketMask;
+              for (unsigned int k = bucketStart[bucket]; k < bucketStart[bucket + 1]; ++k) {
+                const WeldEntry& entry = entries[k];
+                if (entry.vertex >= best) {
+                  break;
+                }
+                if (entry.cell[0] == x && entry.cell[1] == y && entry.cell[2] == z && weldable(v, entry.vertex)) {
+                  best = entry.vertex;
+                  break;
+                }
+              }
+            }
+          }
+        }
+        earliest[v] = best;
+      }
+    });
+  }
+  std::vector<WeldEntry>().swap(entries);
+  std::vector<WeldEntry>().swap(homes);
+
+  // A chain of matches merges into its first vertex: earlier vertices are
+  // resolved before the vertices that point at them.
+  std::vector<unsigned int> root(vertexCount);
+  for (size_t v = 0; v < vertexCount; ++v) {
+    if (earliest[v] == v) {
+      root[v] = static_cast<unsigned int>(v);
+    }
+    else {
+      root[v] = root[earliest[v]];
+      ++stats.weldedVertices;
+    }
+  }
+
+  std::vector<unsigned int>& indices = mesh.m_index;
+  const size_t triangleCount = indices.size() / 3;
+  parallelForRange(indices.size(), threadCount, 1 << 16, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      indices[i] = root[indices[i]];
+    }
+  });
+
+  // Duplicates are only looked for inside an index range, so a triangle that
+  // two submeshes or two levels of detail share stays in both.
+  std::vector<std::vector<MeshSubmesh>*> levels;
+  levels.push_back(&mesh.m_submeshes);
+  for (MeshLod& lod : mesh.m_lods) {
+    levels.push_back(&lod.submeshes);
+  }
+  std::vector<MeshSubmesh*> ranges;
+  for (std::vector<MeshSubmesh>* level : levels) {
+    for (MeshSubmesh& submesh : *level) {
+      ranges.push_back(&submesh);
+    }
+  }
+  std::vector<unsigned int> triangleRange(triangleCount, kNoRange);
+  parallelFor(ranges.size(), threadCount, [&](size_t r) {
+    size_t first = std::min<size_t>(ranges[r]->indexOffset / 3, triangleCount);
+    size_t last = std::min<size_t>((static_cast<size_t>(ranges[r]->indexOffset) + ranges[r]->indexCount) / 3,
+                                   triangleCount);
+    std::fill(triangleRange.begin() + first, triangleRange.begin() + last, static_cast<unsigned int>(r));
+  });
+
+  // 0 keeps a triangle, 1 marks it degenerate, 2 a duplicate.
+  std::vector<unsigned char> removed(triangleCount, 0);
+  std::vector<unsigned int> smallestVertex(triangleCount);
+  parallelForRange(triangleCount, threadCount, 1 << 14, [&](size_t first, size_t last) {
+    for (size_t t = first; t < last; ++t) {
+      const unsigned int* triangle = &indices[t * 3];
+      if (options.removeDegenerate) {
+        const XMFLOAT3& a = mesh.m_vertex[triangle[0]].Pos;
+        const XMFLOAT3& b = mesh.m_vertex[triangle[1]].Pos;
+        const XMFLOAT3& c = mesh.m_vertex[triangle[2]].Pos;
+        float e1x = b.x - a.x, e1y = b.y - a.y, e1z = b.z - a.z;
+        float e2x = c.x - a.x, e2y = c.y - a.y, e2z = c.z - a.z;
+        float e3x = c.x - b.x, e3y = c.y - b.y, e3z = c.z - b.z;
+        float nx = e1y * e2z - e1z * e2y;
+        float ny = e1z * e2x - e1x * e2z;
+        float nz = e1x * e2y - e1y * e2x;
+        float longest = std::max(e1x * e1x + e1y * e1y + e1z * e1z,
+                                 std::max(e2x * e2x + e2y * e2y + e2z * e2z, e3x * e3x + e3y * e3y + e3z * e3z));
+        // |n| is twice the area, and twice the area over the longest edge is
+        // the height of the triangle.
+        if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2] ||
+            nx * nx + ny * ny + nz * nz <= tolerance2 * longest) {
+          removed[t] = 1;
+        }
+      }
+      smallestVertex[t] = std::min(triangle[0], std::min(triangle[1], triangle[2]));
+    }
+  });
+
+  if (options.removeDuplicates) {
+    // Equal triangles start at the same smallest vertex, so they are looked
+    // for among the few triangles grouped under it. Indices mostly grow along
+    // the buffer, which keeps the grouping close to a sequential pass.
+    std::vector<unsigned int> triangleStart;
+    std::vector<unsigned int> triangleItems;
+    bucketItems(smallestVertex, vertexCount, triangleStart, triangleItems,
+                [](size_t t) { return static_cast<unsigned int>(t); });
+    std::vector<unsigned char> duplicate(triangleCount, 0);
+    parallelForRange(vertexCount, threadCount, 1 << 14, [&](size_t first, size_t last) {
+      for (size_t bucket = first; bucket < last; ++bucket) {
+        for (unsigned int k = triangleStart[bucket] + 1; k < triangleStart[bucket + 1]; ++k) {
+          unsigned int t = triangleItems[k];
+          if (removed[t] != 0) {
+            continue;
+          }
+          unsigned int canonical[3];
+          canonicalTriangle(&indices[static_cast<size_t>(t) * 3], canonical);
+          for (unsigned int earlier = triangleStart[bucket]; earlier < k; ++earlier) {
+            unsigned int other = triangleItems[earlier];
+            unsigned int otherCanonical[3];
+            canonicalTriangle(&indices[static_cast<size_t>(other) * 3], otherCanonical);
+            if (removed[other] == 0 && triangleRange[other] == triangleRange[t] &&
+                otherCanonical[0] == canonical[0] && otherCanonical[1] == canonical[1] &&
+                otherCanonical[2] == canonical[2]) {
+              duplicate[t] = 1;
+              break;
+            }
+          }
+        }
+      }
+    });
+    for (size_t t = 0; t < triangleCount; ++t) {
+      if (duplicate[t] != 0) {
+        removed[t] = 2;
+      }
+    }
+  }
+
+  // Kept triangles move down in place; every range keeps its position in the
+  // index buffer and shrinks by the triangles removed from it.
+  std::vector<unsigned int> keptBefore(triangleCount + 1, 0);
+  for (size_t t = 0; t < triangleCount; ++t) {
+    keptBefore[t + 1] = keptBefore[t] + (removed[t] == 0 ? 1u : 0u);
+    stats.degenerateTriangles += (removed[t] == 1) ? 1 : 0;
+    stats.duplicateTriangles += (removed[t] == 2) ? 1 : 0;
+  }
+  if (keptBefore[triangleCount] != triangleCount) {
+    std::vector<unsigned int> kept(static_cast<size_t>(keptBefore[triangleCount]) * 3 + indices.size() % 3);
+    parallelForRange(triangleCount, threadCount, 1 << 14, [&](size_t first, size_t last) {
+      for (size_t t = first; t < last; ++t) {
+        if (removed[t] == 0) {
+          memcpy(&kept[static_cast<size_t>(keptBefore[t]) * 3], &indices[t * 3], 3 * sizeof(unsigned int));
+        }
+      }
+    });
+    for (size_t i = triangleCount * 3; i < indices.size(); ++i) {
+      kept[static_cast<size_t>(keptBefore[triangleCount]) * 3 + i - triangleCount * 3] = indices[i];
+    }
+    for (MeshSubmesh* range : ranges) {
+      size_t first = std::min<size_t>(range->indexOffset / 3, triangleCount);
+      size_t last = std::min<size_t>((static_cast<size_t>(range->indexOffset) + range->indexCount) / 3, triangleCount);
+      range->indexOffset = keptBefore[first] * 3;
+      range->indexCount = (keptBefore[last] - keptBefore[first]) * 3;
+    }
+    indices.swap(kept);
+  }
+
+  // Welded copies and the vertices of removed triangles are no longer used.
+  std::vector<unsigned int> remap(vertexCount, 0);
+  for (unsigned int index : indices) {
+    remap[index] = 1;
+  }
+  unsigned int next = 0;
+  for (size_t v = 0; v < vertexCount; ++v) {
+    if (remap[v] != 0) {
+      remap[v] = next++;
+    }
+    else {
+      remap[v] = kNoRange;
+      stats.unusedVertices += (earliest[v] == v) ? 1 : 0;
+    }
+  }
+  if (next != vertexCount) {
+    std::vector<SimpleVertex> compacted(next);
+    std::vector<unsigned int> colors(hasColors ? next : 0);
+    std::vector<XMFLOAT4> tangents(hasTangents ? next : 0);
+    parallelForRange(vertexCount, threadCount, 1 << 14, [&](size_t first, size_t last) {
+      for (size_t v = first; v < last; ++v) {
+        if (remap[v] == kNoRange) {
+          continue;
+        }
+        compacted[remap[v]] = mesh.m_vertex[v];
+        if (hasColors) {
+          colors[remap[v]] = mesh.m_color[v];
+        }
+        if (hasTangents) {
+          tangents[remap[v]] = mesh.m_tangent[v];
+        }
+      }
+    });
+    parallelForRange(indices.size(), threadCount, 1 << 16, [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; ++i) {
+        indices[i] = remap[indices[i]];
+      }
+    });
+    mesh.m_vertex.swap(compacted);
+    if (hasColors) {
+      mesh.m_color.swap(colors);
+    }
+    if (hasTangents) {
+      mesh.m_tangent.swap(tangents);
+    }
+  }
+
+  mesh.m_clusters.clear();
+  mesh.m_numVertex = static_cast<int>(mesh.m_vertex.size());
+  mesh.m_numIndex = static_cast<int>(mesh.m_index.size());
+  mesh.computeBounds();
+  stats.verticesAfter = mesh.m_vertex.size();
+  stats.indicesAfter = mesh.m_index.size();
+  return stats;
+}
@@ -0,0 +1,544 @@
+#include "MeshClusters.h"
+#include "MeshOptimizer.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+  const unsigned int kNone = 0xFFFFFFFFu;
+
+  inline XMFLOAT3
+  subtract(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+  }
+
+  inline float
+  dot(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+  }
+
+  inline XMFLOAT3
+  cross(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+  }
+
+  /*
+    Scales a vector to unit length and returns its original length; a zero
+    vector stays zero.
+  */
+  inline float
+  normalize(XMFLOAT3& v) {
+    float length = std::sqrt(dot(v, v));
+    if (length > 0.0f) {
+      v.x /= length;
+      v.y /= length;
+      v.z /= length;
+    }
+    return length;
+  }
+
+  /*
+    Bounds and backface cone of a cluster, following meshoptimizer's
+    computeMeshletBounds: the cone axis is the average triangle normal and the
+    apex is pushed back until it lies behind every triangle plane.
+  */
+  void
+  computeClusterBounds(MeshCluster& cluster, const unsigned int* indices, const SimpleVertex* vertices) {
+    const unsigned int* first = indices + cluster.indexOffset;
+    XMFLOAT3 minimum = vertices[first[0]].Pos;
+    XMFLOAT3 maximum = minimum;
+    for (unsigned int i = 1; i < cluster.indexCount; ++i) {
+      const XMFLOAT3& pos = vertices[first[i]].Pos;
+      minimum.x = std::min(minimum.x, pos.x);
+      minimum.y = std::min(minimum.y, pos.y);
+      minimum.z = std::min(minimum.z, pos.z);
+      maximum.x = std::max(maximum.x, pos.x);
+      maximum.y = std::max(maximum.y, pos.y);
+      maximum.z = std::max(maximum.z, pos.z);
+    }
+    cluster.boundsMin = minimum;
+    cluster.boundsMax = maximum;
+    cluster.center = XMFLOAT3((minimum.x + maximum.x) * 0.5f, (minimum.y + maximum.y) * 0.5f,
+                              (minimum.z + maximum.z) * 0.5f);
+    float radiusSq = 0.0f;
+    for (unsigned int i = 0; i < cluster.indexCount; ++i) {
+      XMFLOAT3 offset = subtract(vertices[first[i]].Pos, cluster.center);
+      radiusSq = std::max(radiusSq, dot(offset, offset));
+    }
+    cluster.radius = std::sqrt(radiusSq);
+
+    size_t triangleCount = cluster.indexCount / 3;
+    std::vector<XMFLOAT3> normals(triangleCount);
+    XMFLOAT3 axis(0.0f, 0.0f, 0.0f);
+    for (size_t t = 0; t < triangleCount; ++t) {
+      const XMFLOAT3& p0 = vertices[first[t * 3 + 0]].Pos;
+      const XMFLOAT3& p1 = vertices[first[t * 3 + 1]].Pos;
+      const XMFLOAT3& p2 = vertices[first[t * 3 + 2]].Pos;
+      normals[t] = cross(subtract(p1, p0), subtract(p2, p0));
+      normalize(normals[t]);
+      axis.x += normals[t].x;
+      axis.y += normals[t].y;
+      axis.z += normals[t].z;
+    }
+    cluster.coneApex = cluster.center;
+    cluster.coneAxis = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    cluster.coneCutoff = 1.0f;
+    if (normalize(axis) == 0.0f) {
+      return;
+    }
+
+    // Degenerate triangles have a zero normal and do not constrain the cone.
+    float minDot = 1.0f;
+    for (const XMFLOAT3& normal : normals) {
+      if (normal.x != 0.0f || normal.y != 0.0f || normal.z != 0.0f) {
+        minDot = std::min(minDot, dot(normal, axis));
+      }
+    }
+    // Past about 84 degrees the cone would almost never cull and the apex
+    // would run off to infinity.
+    if (minDot <= 0.1f) {
+      return;
+    }
+
+    float maxT = 0.0f;
+    for (size_t t = 0; t < triangleCount; ++t) {
+      const XMFLOAT3& normal = normals[t];
+      float facing = dot(normal, axis);
+      if (facing <= 0.0f) {
+        continue;
+      }
+      float distance = dot(subtract(cluster.center, vertices[first[t * 3]].Pos), normal);
+      maxT = std::max(maxT, distance / facing);
+    }
+    cluster.coneApex = XMFLOAT3(cluster.center.x - axis.x * maxT, cluster.center.y - axis.y * maxT,
+                                cluster.center.z - axis.z * maxT);
+    cluster.coneAxis = axis;
+    // The normal cone has half-angle acos(minDot); the cone of camera
+    // directions that see only back faces has half-angle 90 - that, and this is
+    // its cosine.
+    cluster.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+  }
+
+  /*
+    cullClusters for either index width: source is m_index or m_index16, and
+    the surviving ranges are copied from it unchanged.
+  */
+  template <typename Index>
+  ClusterCullStats
+  cullClusterRanges(const MeshComponent& mesh,
+                    size_t level,
+                    const ClusterCullView& view,
+                    const std::vector<Index>& source,
+                    std::vector<Index>& outIndices,
+                    std::vector<MeshSubmesh>& outSubmeshes) {
+    ClusterCullStats stats;
+    level = (level == 0 || mesh.m_lods.empty()) ? 0 : std::min(level, mesh.m_lods.size());
+    const std::vector<MeshSubmesh>& submeshes = mesh.lodSubmeshes(level);
+    outSubmeshes.assign(submeshes.begin(), submeshes.end());
+    outIndices.clear();
+
+    // Clusters are sorted by level, then submesh.
+    std::vector<MeshCluster>::const_iterator cluster = std::lower_bound(
+      mesh.m_clusters.begin(), mesh.m_clusters.end(), level,
+      [](const MeshCluster& c, size_t value) { return c.lodLevel < value; });
+    bool clustered = cluster != mesh.m_clusters.end() && cluster->lodLevel == level;
+
+    for (size_t s = 0; s < outSubmeshes.size(); ++s) {
+      size_t offset = outIndices.size();
+      if (!clustered) {
+        outIndices.insert(outIndices.end(), source.begin() + submeshes[s].indexOffset,
+                          source.begin() + submeshes[s].indexOffset + submeshes[s].indexCount);
+      }
+      for (; clustered && cluster != mesh.m_clusters.end() && cluster->lodLevel == level && cluster->submesh == s;
+           ++cluster) {
+        if (!sphereInView(view, cluster->center, cluster->radius)) {
+          ++stats.outsideFrustum;
+          continue;
+        }
+        if (cluster->coneCutoff < 1.0f) {
+          XMFLOAT3 direction = subtract(cluster->coneApex, view.cameraPosition);
+          if (dot(direction, cluster->coneAxis) >= cluster->coneCutoff * std::sqrt(dot(direction, direction))) {
+            ++stats.backfacing;
+            continue;
+          }
+        }
+        ++stats.visible;
+        outIndices.insert(outIndices.end(), source.begin() + cluster->indexOffset,
+                          source.begin() + cluster->indexOffset + cluster->indexCount);
+      }
+      outSubmeshes[s].indexOffset = static_cast<unsigned int>(offset);
+      outSubmeshes[s].indexCount = static_cast<unsigned int>(outIndices.size() - offset);
+    }
+    return stats;
+  }
+}
+
+void
+buildClusters(std::vector<MeshCluster>& clusters,
+              unsigned int* indices,
+              size_t indexCount,
+              const SimpleVertex* vertices,
+              size_t /*vertexCount*/,
+              unsigned int maxVertices,
+              unsigned int maxTriangles,
+              float coneWeight) {
+  const size_t triangleCount = indexCount / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+  maxVertices = std::min(std::max(maxVertices, 3u), 256u);
+  maxTriangles = std::max(maxTriangles, 1u);
+  coneWeight = std::min(std::max(coneWeight, 0.0f), 1.0f);
+
+  std::vector<unsigned int> local;
+  std::vector<unsigned int> globalIds;
+  compactVertices(indices, triangleCount * 3, local, globalIds);
+  const size_t vertexCount = globalIds.size();
+
+  // Centroid and unit normal of every triangle, and the radius a full cluster
+  // of average triangles would have.
+  std::vector<XMFLOAT3> centroids(triangleCount);
+  std::vector<XMFLOAT3> normals(triangleCount);
+  double totalArea = 0.0;
+  for (size_t t = 0; t < triangleCount; ++t) {
+    const XMFLOAT3& p0 = vertices[indices[t * 3 + 0]].Pos;
+    const XMFLOAT3& p1 = vertices[indices[t * 3 + 1]].Pos;
+    const XMFLOAT3& p2 = vertices[indices[t * 3 + 2]].Pos;
+    centroids[t] = XMFLOAT3((p0.x + p1.x + p2.x) / 3.0f, (p0.y + p1.y + p2.y) / 3.0f, (p0.z + p1.z + p2.z) / 3.0f);
+    normals[t] = cross(subtract(p1, p0), subtract(p2, p0));
+    totalArea += 0.5 * normalize(normals[t]);
+  }
+  float expectedRadius = static_cast<float>(std::sqrt(totalArea / triangleCount * maxTriangles)) * 0.5f;
+  if (expectedRadius <= 0.0f) {
+    expectedRadius = 1.0f;
+  }
+
+  // Vertices split along UV or normal seams share a position; growing over
+  // positions lets a cluster cross the seam instead of stopping at it.
+  std::vector<unsigned int> positionOf(vertexCount);
+  size_t positionCount = 0;
+  {
+    size_t capacity = 16;
+    while (capacity < vertexCount * 2) {
+      capacity <<= 1;
+    }
+    std::vector<unsigned int> table(capacity, kNone);
+    for (size_t v = 0; v < vertexCount; ++v) {
+      const XMFLOAT3& pos = vertices[globalIds[v]].Pos;
+      unsigned int bits[3];
+      memcpy(bits, &pos, sizeof(bits));
+      unsigned int hash = (bits[0] * 0x8DA6B343u) ^ (bits[1] * 0xD8163841u) ^ (bits[2] * 0xCB1AB31Fu);
+      size_t slot = (hash ^ (hash >> 15)) & (capacity - 1);
+      while (table[slot] != kNone &&
+             memcmp(&vertices[globalIds[table[slot]]].Pos, &pos, sizeof(XMFLOAT3)) != 0) {
+        slot = (slot + 1) & (capacity - 1);
+      }
+      if (table[slot] == kNone) {
+        table[slot] = static_cast<unsigned int>(v);
+        positionOf[v] = static_cast<unsigned int>(positionCount++);
+      }
+      else {
+        positionOf[v] = positionOf[table[slot]];
+      }
+    }
+  }
+
+  // Triangles around every position (CSR). The first live[p] entries of a
+  // list are the triangles not yet in a cluster.
+  std::vector<unsigned int> live(positionCount, 0);
+  for (size_t i = 0; i < triangleCount * 3; ++i) {
+    ++live[positionOf[local[i]]];
+  }
+  std::vector<unsigned int> adjacencyStart(positionCount + 1, 0);
+  for (size_t p = 0; p < positionCount; ++p) {
+    adjacencyStart[p + 1] = adjacencyStart[p] + live[p];
+  }
+  std::vector<unsigned int> adjacency(triangleCount * 3);
+  {
+    std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t) {
+      for (size_t k = 0; k < 3; ++k) {
+        adjacency[fill[positionOf[local[t * 3 + k]]]++] = static_cast<unsigned int>(t);
+      }
+    }
+  }
+
+  std::vector<bool> emitted(triangleCount, false);
+  // Cluster a vertex or position was last added to, to test membership in O(1).
+  std::vector<unsigned int> vertexCluster(vertexCount, kNone);
+  std::vector<unsigned int> positionCluster(positionCount, kNone);
+  std::vector<unsigned int> clusterVertices;
+  std::vector<unsigned int> clusterPositions;
+  std::vector<unsigned int> clusterTriangles;
+  std::vector<unsigned int> order;
+  order.reserve(triangleCount * 3);
+  std::vector<unsigned int> clusterLocal;
+  std::vector<unsigned int> clusterIds;
+  unsigned int clusterId = 0;
+  size_t scan = 0;
+  XMFLOAT3 centerSum(0.0f, 0.0f, 0.0f);
+  XMFLOAT3 normalSum(0.0f, 0.0f, 0.0f);
+
+  auto newVertices = [&](size_t t) {
+    unsigned int count = 0;
+    for (size_t k = 0; k < 3; ++k) {
+      count += (vertexCluster[local[t * 3 + k]] != clusterId) ? 1 : 0;
+    }
+    return count;
+  };
+
+  auto addTriangle = [&](size_t t) {
+    emitted[t] = true;
+    clusterTriangles.push_back(static_cast<unsigned int>(t));
+    for (size_t k = 0; k < 3; ++k) {
+      unsigned int v = local[t * 3 + k];
+      if (vertexCluster[v] != clusterId) {
+        vertexCluster[v] = clusterId;
+        clusterVertices.push_back(v);
+      }
+      unsigned int p = positionOf[v];
+      if (positionCluster[p] != clusterId) {
+        positionCluster[p] = clusterId;
+        clusterPositions.push_back(p);
+      }
+      unsigned int* list = adjacency.data() + adjacencyStart[p];
+      unsigned int* entry = std::find(list, list + live[p], static_cast<unsigned int>(t));
+      *entry = list[--live[p]];
+      list[live[p]] = static_cast<unsigned int>(t);
+    }
+    centerSum.x += centroids[t].x;
+    centerSum.y += centroids[t].y;
+    centerSum.z += centroids[t].z;
+    normalSum.x += normals[t].x;
+    normalSum.y += normals[t].y;
+    normalSum.z += normals[t].z;
+  };
+
+  unsigned int seed = kNone;
+  for (;;) {
+    if (seed == kNone) {
+      while (scan < triangleCount && emitted[scan]) {
+        ++scan;
+      }
+      if (scan == triangleCount) {
+        break;
+      }
+      seed = static_cast<unsigned int>(scan);
+    }
+
+    clusterVertices.clear();
+    clusterPositions.clear();
+    clusterTriangles.clear();
+    centerSum = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    normalSum = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    addTriangle(seed);
+
+    while (clusterTriangles.size() < maxTriangles) {
+      float inverseCount = 1.0f / static_cast<float>(clusterTriangles.size());
+      XMFLOAT3 center(centerSum.x * inverseCount, centerSum.y * inverseCount, centerSum.z * inverseCount);
+      XMFLOAT3 axis = normalSum;
+      normalize(axis);
+
+      // As in meshoptimizer: triangles that add no vertex come first, then
+      // dangling ones (the last triangle left at a position, which would
+      // otherwise end up in a cluster of their own), then fewest new vertices;
+      // ties go to the closest triangle best aligned with the cluster.
+      unsigned int best = kNone;
+      unsigned int bestPriority = 5;
+      float bestScore = 0.0f;
+      for (unsigned int p : clusterPositions) {
+        const unsigned int* list = adjacency.data() + adjacencyStart[p];
+        for (unsigned int i = 0; i < live[p]; ++i) {
+          unsigned int t = list[i];
+          unsigned int extra = newVertices(t);
+          if (clusterVertices.size() + extra > maxVertices) {
+            continue;
+          }
+          unsigned int priority = 0;
+          if (extra != 0) {
+            bool dangling = live[positionOf[local[t * 3 + 0]]] == 1 ||
+                            live[positionOf[local[t * 3 + 1]]] == 1 ||
+                            live[positionOf[local[t * 3 + 2]]] == 1;
+            priority = dangling ? 1 : extra + 1;
+          }
+          if (priority > bestPriority) {
+            continue;
+          }
+          XMFLOAT3 offset = subtract(centroids[t], center);
+          float distance = std::sqrt(dot(offset, offset));
+          float cone = std::max(1.0f - dot(normals[t], axis) * coneWeight, 1e-3f);
+          float score = (1.0f + distance / expectedRadius * (1.0f - coneWeight)) * cone;
+          if (priority < bestPriority || score < bestScore || (score == bestScore && t < best)) {
+            best = t;
+            bestPriority = priority;
+            bestScore = score;
+          }
+        }
+      }
+
+      // Nothing adjacent fits: take the next triangle of the input order if it
+      // is close enough to belong to this cluster.
+      if (best == kNone) {
+        while (scan < triangleCount && emitted[scan]) {
+          ++scan;
+        }
+        if (scan < triangleCount && clusterVertices.size() + newVertices(scan) <= maxVertices) {
+          XMFLOAT3 offset = subtract(centroids[scan], center);
+          if (dot(offset, offset) <= expectedRadius * expectedRadius) {
+            best = static_cast<unsigned int>(scan);
+          }
+        }
+      }
+      if (best == kNone) {
+        break;
+      }
+      addTriangle(best);
+    }
+
+    // The next cluster starts next to this one, at the triangle with the
+    // fewest live neighbours, so the region fills up without leaving islands.
+    seed = kNone;
+    unsigned int seedLive = 0;
+    for (unsigned int p : clusterPositions) {
+      const unsigned int* list = adjacency.data() + adjacencyStart[p];
+      for (unsigned int i = 0; i < live[p]; ++i) {
+        unsigned int t = list[i];
+        unsigned int neighbours = live[positionOf[local[t * 3 + 0]]] + live[positionOf[local[t * 3 + 1]]] +
+                                  live[positionOf[local[t * 3 + 2]]];
+        if (seed == kNone || neighbours < seedLive || (neighbours == seedLive && t < seed)) {
+          seed = t;
+          seedLive = neighbours;
+        }
+      }
+    }
+
+    // Vertex cache order inside the cluster, on its own compact vertex range.
+    size_t start = order.size();
+    for (unsigned int t : clusterTriangles) {
+      for (size_t k = 0; k < 3; ++k) {
+        order.push_back(local[t * 3 + k]);
+      }
+    }
+    compactVertices(order.data() + start, order.size() - start, clusterLocal, clusterIds);
+    optimizeVertexCache(clusterLocal.data(), clusterLocal.size(), clusterIds.size());
+    for (size_t i = 0; i < clusterLocal.size(); ++i) {
+      order[start + i] = clusterIds[clusterLocal[i]];
+    }
+
+    MeshCluster cluster;
+    cluster.indexOffset = static_cast<unsigned int>(start);
+    cluster.indexCount = static_cast<unsigned int>(order.size() - start);
+    cluster.vertexCount = static_cast<unsigned int>(clusterVertices.size());
+    clusters.push_back(cluster);
+    ++clusterId;
+  }
+
+  for (size_t i = 0; i < order.size(); ++i) {
+    indices[i] = globalIds[order[i]];
+  }
+  for (size_t c = clusters.size() - clusterId; c < clusters.size(); ++c) {
+    computeClusterBounds(clusters[c], indices, vertices);
+  }
+}
+
+size_t
+buildClusters(MeshComponent& mesh,
+              unsigned int maxVertices,
+              unsigned int maxTriangles,
+              float coneWeight,
+              unsigned int threadCount) {
+  threadCount = resolveThreadCount(threadCount);
+  mesh.m_clusters.clear();
+  if (mesh.m_submeshes.empty() && !mesh.m_index.empty()) {
+    MeshSubmesh submesh;
+    submesh.indexCount = static_cast<unsigned int>(mesh.m_index.size());
+    mesh.m_submeshes.push_back(submesh);
+    mesh.computeBounds();
+  }
+
+  struct Range {
+    unsigned int level;
+    unsigned int submesh;
+    unsigned int indexOffset;
+    unsigned int indexCount;
+  };
+  std::vector<Range> ranges;
+  for (size_t level = 0; level <= mesh.m_lods.size(); ++level) {
+    const std::vector<MeshSubmesh>& submeshes = mesh.lodSubmeshes(level);
+    for (size_t s = 0; s < submeshes.size(); ++s) {
+      ranges.push_back(Range{ static_cast<unsigned int>(level), static_cast<unsigned int>(s),
+                              submeshes[s].indexOffset, submeshes[s].indexCount });
+    }
+  }
+
+  std::vector<std::vector<MeshCluster>> results(ranges.size());
+  parallelFor(ranges.size(), threadCount, [&](size_t r) {
+    const Range& range = ranges[r];
+    std::vector<MeshCluster>& clusters = results[r];
+    buildClusters(clusters, mesh.m_index.data() + range.indexOffset, range.indexCount - range.indexCount % 3,
+                  mesh.m_vertex.data(), mesh.m_vertex.size(), maxVertices, maxTriangles, coneWeight);
+    for (MeshCluster& cluster : clusters) {
+      cluster.indexOffset += range.indexOffset;
+      cluster.lodLevel = range.level;
+      cluster.submesh = range.submesh;
+    }
+  });
+
+  for (std::vector<MeshCluster>& clusters : results) {
+    mesh.m_clusters.insert(mesh.m_clusters.end(), clusters.begin(), clusters.end());
+  }
+  return mesh.m_clusters.size();
+}
+
+ClusterCullView
+makeClusterCullView(const XMMATRIX& world, const XMMATRIX& view, const XMMATRIX& projection) {
+  ClusterCullView cullView;
+
+  // Row vectors: clip = p * M, so each clip coordinate is p dotted with a
+  // column of M, and the planes are sums of columns (Gribb and Hartmann).
+  XMMATRIX worldView = XMMatrixMultiply(world, view);
+  XMMATRIX columns = XMMatrixTranspose(XMMatrixMultiply(worldView, projection));
+  XMVECTOR planes[6] = {
+    XMVectorAdd(columns.r[3], columns.r[0]),
+    XMVectorSubtract(columns.r[3], columns.r[0]),
+    XMVectorAdd(columns.r[3], columns.r[1]),
+    XMVectorSubtract(columns.r[3], columns.r[1]),
+    columns.r[2],
+    XMVectorSubtract(columns.r[3], columns.r[2])
+  };
+  for (size_t i = 0; i < 6; ++i) {
+    float length = XMVectorGetX(XMVector3Length(planes[i]));
+    XMStoreFloat4(&cullView.planes[i], XMVectorScale(planes[i], length > 0.0f ? 1.0f / length : 0.0f));
+  }
+
+  // The camera sits at the origin of view space.
+  XMVECTOR determinant;
+  XMMATRIX viewToObject = XMMatrixInverse(&determinant, worldView);
+  XMStoreFloat3(&cullView.cameraPosition, viewToObject.r[3]);
+  return cullView;
+}
+
+ClusterCullStats
+cullClusters(const MeshComponent& mesh,
+             size_t level,
+             const ClusterCullView& view,
+             std::vector<unsigned int>& outIndices,
+             std::vector<MeshSubmesh>& outSubmeshes) {
+  return cullClusterRanges(mesh, level, view, mesh.m_index, outIndices, outSubmeshes);
+}
+
+ClusterCullStats
+cullClusters(const MeshComponent& mesh,
+             size_t level,
+             const ClusterCullView& view,
+             std::vector<unsigned short>& outIndices,
+             std::vector<MeshSubmesh>& outSubmeshes) {
+  if (mesh.m_index16.size() != mesh.m_index.size()) {
+    ERROR("MeshClusters", "cullClusters", "The mesh has no 16-bit indices; call buildIndex16 first");
+    outIndices.clear();
+    outSubmeshes.clear();
+    return ClusterCullStats();
+  }
+  return cullClusterRanges(mesh, level, view, mesh.m_index16, outIndices, outSubmeshes);
+}
@@ -0,0 +1,532 @@
+#include "MeshCodec.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if (defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)) && !defined(_XM_NO_INTRINSICS_)
+#define NOVA_CODEC_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+  const unsigned char kVertexCodecTag = 0xA1;
+  const unsigned char kIndexCodecTag = 0xB1;
+  const size_t kGroupSize = 16;
+  const size_t kMaxVertexSize = 256;
+
+  /*
+    Bits per byte of a group for each 2-bit group header.
+  */
+  const unsigned int kGroupBits[4] = { 0, 2, 4, 8 };
+
+  inline unsigned int
+  read32(const unsigned char* p) {
+    unsigned int value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+  }
+
+  inline unsigned int
+  zigzag(unsigned int delta) {
+    return (delta << 1) ^ static_cast<unsigned int>(static_cast<int>(delta) >> 31);
+  }
+
+  inline unsigned int
+  unzigzag(unsigned int value) {
+    return (value >> 1) ^ (0u - (value & 1u));
+  }
+
+  /*
+    Encodes one byte plane: a 2-bit header per group of 16 bytes, then the
+    bytes of each group packed at the header's width.
+  */
+  void
+  encodePlane(std::vector<unsigned char>& out, const unsigned char* plane, size_t count) {
+    size_t groups = count / kGroupSize;
+    size_t headerAt = out.size();
+    out.resize(out.size() + (groups + 3) / 4, 0);
+    for (size_t g = 0; g < groups; ++g) {
+      const unsigned char* group = plane + g * kGroupSize;
+      unsigned char largest = *std::max_element(group, group + kGroupSize);
+      unsigned int code = largest == 0 ? 0 : (largest < 4 ? 1 : (largest < 16 ? 2 : 3));
+      out[headerAt + g / 4] |= static_cast<unsigned char>(code << ((g % 4) * 2));
+
+      unsigned int bits = kGroupBits[code];
+      if (bits == 8) {
+        out.insert(out.end(), group, group + kGroupSize);
+      }
+      else if (bits > 0) {
+        unsigned int perByte = 8 / bits;
+        for (size_t i = 0; i < kGroupSize; i += perByte) {
+          unsigned int packed = 0;
+          for (unsigned int k = 0; k < perByte; ++k) {
+            packed |= static_cast<unsigned int>(group[i + k]) << (k * bits);
+          }
+          out.push_back(static_cast<unsigned char>(packed));
+        }
+      }
+    }
+  }
+
+  /*
+    Unpacks one group of 16 bytes at the given width.
+  */
+  inline void
+  decodeGroup(const unsigned char* p, unsigned int code, unsigned char* group) {
+#if NOVA_CODEC_SSE2
+    __m128i result;
+    if (code == 0) {
+      result = _mm_setzero_si128();
+    }
+    else if (code == 1) {
+      // Byte j holds values 4j..4j+3, two bits each from the low end.
+      __m128i packed = _mm_cvtsi32_si128(static_cast<int>(read32(p)));
+      __m128i mask = _mm_set1_epi8(3);
+      __m128i v0 = _mm_and_si128(packed, mask);
+      __m128i v1 = _mm_and_si128(_mm_srli_epi16(packed, 2), mask);
+      __m128i v2 = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+      __m128i v3 = _mm_and_si128(_mm_srli_epi16(packed, 6), mask);
+      result = _mm_unpacklo_epi16(_mm_unpacklo_epi8(v0, v1), _mm_unpacklo_epi8(v2, v3));
+    }
+    else if (code == 2) {
+      // Byte j holds values 2j (low nibble) and 2j+1 (high nibble).
+      __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+      __m128i mask = _mm_set1_epi8(15);
+      result = _mm_unpacklo_epi8(_mm_and_si128(packed, mask), _mm_and_si128(_mm_srli_epi16(packed, 4), mask));
+    }
+    else {
+      result = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(group), result);
+#else
+    unsigned int bits = kGroupBits[code];
+    if (bits == 0) {
+      memset(group, 0, kGroupSize);
+    }
+    else if (bits == 8) {
+      memcpy(group, p, kGroupSize);
+    }
+    else {
+      unsigned int perByte = 8 / bits;
+      unsigned int mask = (1u << bits) - 1;
+      for (size_t i = 0; i < kGroupSize; ++i) {
+        group[i] = static_cast<unsigned char>((p[i / perByte] >> ((i % perByte) * bits)) & mask);
+      }
+    }
+#endif
+  }
+
+  /*
+    Decodes one byte plane of count bytes; returns the position after it, or
+    nullptr if the data ends early.
+  */
+  const unsigned char*
+  decodePlane(const unsigned char* p, const unsigned char* end, unsigned char* plane, size_t count) {
+    size_t groups = count / kGroupSize;
+    size_t headerBytes = (groups + 3) / 4;
+    if (static_cast<size_t>(end - p) < headerBytes) return nullptr;
+    const unsigned char* header = p;
+    p += headerBytes;
+    for (size_t g = 0; g < groups; ++g) {
+      unsigned int code = (header[g / 4] >> ((g % 4) * 2)) & 3u;
+      size_t bytes = kGroupBits[code] * kGroupSize / 8;
+      if (static_cast<size_t>(end - p) < bytes) return nullptr;
+      decodeGroup(p, code, plane + g * kGroupSize);
+      p += bytes;
+    }
+    return p;
+  }
+
+  /*
+    Rebuilds the words of one column from its four byte planes: joins the
+    bytes, undoes the zigzag mapping and prefix-sums the differences.
+  */
+  void
+  decodeColumn(const unsigned char planes[4][kVertexCodecBlockSize], unsigned int* words, size_t count) {
+#if NOVA_CODEC_SSE2
+    __m128i carry = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi32(1);
+    for (size_t i = 0; i < count; i += kGroupSize) {
+      __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[0] + i));
+      __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[1] + i));
+      __m128i p2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[2] + i));
+      __m128i p3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[3] + i));
+      __m128i low01 = _mm_unpacklo_epi8(p0, p1);
+      __m128i high01 = _mm_unpackhi_epi8(p0, p1);
+      __m128i low23 = _mm_unpacklo_epi8(p2, p3);
+      __m128i high23 = _mm_unpackhi_epi8(p2, p3);
+      __m128i values[4] = { _mm_unpacklo_epi16(low01, low23), _mm_unpackhi_epi16(low01, low23),
+                            _mm_unpacklo_epi16(high01, high23), _mm_unpackhi_epi16(high01, high23) };
+      for (size_t k = 0; k < 4; ++k) {
+        __m128i v = values[k];
+        v = _mm_xor_si128(_mm_srli_epi32(v, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(v, one)));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+        v = _mm_add_epi32(v, carry);
+        carry = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(words + i + k * 4), v);
+      }
+    }
+#else
+    unsigned int previous = 0;
+    for (size_t i = 0; i < count; ++i) {
+      unsigned int value = planes[0][i] | (planes[1][i] << 8) | (planes[2][i] << 16) |
+                           (static_cast<unsigned int>(planes[3][i]) << 24);
+      previous += unzigzag(value);
+      words[i] = previous;
+    }
+#endif
+  }
+
+  /*
+    Writes up to four columns of decoded words back into vertices.
+  */
+  void
+  storeColumns(const unsigned int words[4][kVertexCodecBlockSize],
+               size_t columns,
+               unsigned char* vertices,
+               size_t count,
+               size_t vertexSize) {
+    size_t i = 0;
+#if NOVA_CODEC_SSE2
+    if (columns == 4) {
+      for (; i + 4 <= count; i += 4) {
+        __m128 r0 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(words[0] + i)));
+        __m128 r1 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(words[1] + i)));
+        __m128 r2 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(words[2] + i)));
+        __m128 r3 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(words[3] + i)));
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(reinterpret_cast<float*>(vertices + (i + 0) * vertexSize), r0);
+        _mm_storeu_ps(reinterpret_cast<float*>(vertices + (i + 1) * vertexSize), r1);
+        _mm_storeu_ps(reinterpret_cast<float*>(vertices + (i + 2) * vertexSize), r2);
+        _mm_storeu_ps(reinterpret_cast<float*>(vertices + (i + 3) * vertexSize), r3);
+      }
+    }
+#endif
+    for (; i < count; ++i) {
+      for (size_t c = 0; c < columns; ++c) {
+        memcpy(vertices + i * vertexSize + c * 4, &words[c][i], 4);
+      }
+    }
+  }
+
+  /*
+    Decodes one block of count vertices into vertices; false if the block is
+    malformed or not exactly size bytes long.
+  */
+  bool
+  decodeVertexBlock(const unsigned char* p, size_t size, unsigned char* vertices, size_t count, size_t vertexSize) {
+    const unsigned char* end = p + size;
+    size_t padded = (count + kGroupSize - 1) / kGroupSize * kGroupSize;
+    size_t columnCount = vertexSize / 4;
+    unsigned char planes[4][kVertexCodecBlockSize];
+    unsigned int words[4][kVertexCodecBlockSize];
+    for (size_t first = 0; first < columnCount; first += 4) {
+      size_t columns = std::min<size_t>(4, columnCount - first);
+      for (size_t c = 0; c < columns; ++c) {
+        for (size_t k = 0; k < 4; ++k) {
+          p = decodePlane(p, end, planes[k], padded);
+          if (!p) return false;
+        }
+        decodeColumn(planes, words[c], padded);
+      }
+      storeColumns(words, columns, vertices + first * 4, count, vertexSize);
+    }
+    return p == end;
+  }
+
+  inline void
+  writeVarint(std::vector<unsigned char>& out, unsigned int value) {
+    while (value >= 0x80) {
+      out.push_back(static_cast<unsigned char>(value | 0x80));
+      value >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(value));
+  }
+
+  inline bool
+  readVarint(const unsigned char*& p, const unsigned char* end, unsigned int& value) {
+    value = 0;
+    for (unsigned int shift = 0; shift < 35; shift += 7) {
+      if (p == end) return false;
+      unsigned char byte = *p++;
+      value |= static_cast<unsigned int>(byte & 0x7F) << shift;
+      if (byte < 0x80) return true;
+    }
+    return false;
+  }
+
+  /*
+    State the index encoder and decoder update identically: the last 16
+    edges (stored reversed, as a neighbour walks them), the last 16 vertices
+    seen for the first time or coded explicitly, the next unused index and
+    the last explicit index.
+  */
+  struct IndexCodecState {
+    unsigned int edges[16][2];
+    unsigned int vertices[16];
+    unsigned int edgeOffset = 0;
+    unsigned int vertexOffset = 0;
+    unsigned int next = 0;
+    unsigned int last = 0;
+
+    IndexCodecState() {
+      memset(edges, 0xFF, sizeof(edges));
+      memset(vertices, 0xFF, sizeof(vertices));
+    }
+
+    void
+    pushEdge(unsigned int a, unsigned int b) {
+      edges[edgeOffset & 15][0] = a;
+      edges[edgeOffset & 15][1] = b;
+      ++edgeOffset;
+    }
+
+    void
+    pushVertex(unsigned int v) {
+      vertices[vertexOffset & 15] = v;
+      ++vertexOffset;
+    }
+
+    const unsigned int*
+    edge(unsigned int distance) const {
+      return edges[(edgeOffset - 1 - distance) & 15];
+    }
+
+    unsigned int
+    vertex(unsigned int distance) const {
+      return vertices[(vertexOffset - 1 - distance) & 15];
+    }
+  };
+
+  /*
+    Vertex codes: 0 is the next unused index, 1..14 a vertex FIFO entry and
+    15 an explicit zigzag delta to the last explicit index.
+  */
+  const unsigned int kVertexNext = 0;
+  const unsigned int kVertexExplicit = 15;
+  const unsigned int kNoEdge = 15;
+
+  unsigned int
+  encodeTriangleVertex(IndexCodecState& state, unsigned int v, std::vector<unsigned char>& extra) {
+    if (v == state.next) {
+      ++state.next;
+      state.pushVertex(v);
+      return kVertexNext;
+    }
+    for (unsigned int k = 0; k < 14; ++k) {
+      if (state.vertex(k) == v) {
+        return k + 1;
+      }
+    }
+    writeVarint(extra, zigzag(v - state.last));
+    state.last = v;
+    state.pushVertex(v);
+    return kVertexExplicit;
+  }
+
+  inline bool
+  decodeTriangleVertex(IndexCodecState& state, unsigned int code, const unsigned char*& p, const unsigned char* end,
+                       unsigned int& v) {
+    if (code == kVertexNext) {
+      v = state.next++;
+      state.pushVertex(v);
+    }
+    else if (code == kVertexExplicit) {
+      unsigned int delta;
+      if (!readVarint(p, end, delta)) return false;
+      v = state.last + unzigzag(delta);
+      state.last = v;
+      state.pushVertex(v);
+    }
+    else {
+      v = state.vertex(code - 1);
+    }
+    return true;
+  }
+}
+
+void
+encodeVertexBuffer(std::vector<unsigned char>& out, const void* vertices, size_t vertexCount, size_t vertexSize) {
+  out.clear();
+  out.push_back(kVertexCodecTag);
+  if (vertexSize == 0 || vertexSize % 4 != 0 || vertexSize > kMaxVertexSize) {
+    return;
+  }
+  const unsigned char* source = static_cast<const unsigned char*>(vertices);
+  size_t blockCount = (vertexCount + kVertexCodecBlockSize - 1) / kVertexCodecBlockSize;
+  size_t tableAt = out.size();
+  out.resize(out.size() + blockCount * sizeof(uint32_t));
+
+  unsigned char planes[4][kVertexCodecBlockSize];
+  for (size_t block = 0; block < blockCount; ++block) {
+    size_t first = block * kVertexCodecBlockSize;
+    size_t count = std::min(kVertexCodecBlockSize, vertexCount - first);
+    size_t padded = (count + kGroupSize - 1) / kGroupSize * kGroupSize;
+    size_t blockStart = out.size();
+    for (size_t column = 0; column < vertexSize / 4; ++column) {
+      unsigned int previous = 0;
+      for (size_t i = 0; i < padded; ++i) {
+        unsigned int value = 0;
+        if (i < count) {
+          unsigned int word = read32(source + (first + i) * vertexSize + column * 4);
+          value = zigzag(word - previous);
+          previous = word;
+        }
+        for (size_t k = 0; k < 4; ++k) {
+          planes[k][i] = static_cast<unsigned char>(value >> (k * 8));
+        }
+      }
+      for (size_t k = 0; k < 4; ++k) {
+        encodePlane(out, planes[k], padded);
+      }
+    }
+    uint32_t blockSize = static_cast<uint32_t>(out.size() - blockStart);
+    memcpy(out.data() + tableAt + block * sizeof(uint32_t), &blockSize, sizeof(blockSize));
+  }
+}
+
+bool
+decodeVertexBuffer(void* destination,
+                   size_t vertexCount,
+                   size_t vertexSize,
+                   const unsigned char* data,
+                   size_t size,
+                   unsigned int threadCount) {
+  if (size < 1 || data[0] != kVertexCodecTag ||
+      vertexSize == 0 || vertexSize % 4 != 0 || vertexSize > kMaxVertexSize) {
+    return false;
+  }
+  size_t blockCount = (vertexCount + kVertexCodecBlockSize - 1) / kVertexCodecBlockSize;
+  size_t tableSize = blockCount * sizeof(uint32_t);
+  if (size - 1 < tableSize) return false;
+
+  std::vector<size_t> offsets(blockCount + 1);
+  offsets[0] = 1 + tableSize;
+  for (size_t block = 0; block < blockCount; ++block) {
+    uint32_t blockSize;
+    memcpy(&blockSize, data + 1 + block * sizeof(uint32_t), sizeof(blockSize));
+    offsets[block + 1] = offsets[block] + blockSize;
+  }
+  if (offsets[blockCount] != size) return false;
+
+  unsigned char* vertices = static_cast<unsigned char*>(destination);
+  std::atomic<bool> valid(true);
+  parallelFor(blockCount, resolveThreadCount(threadCount), [&](size_t block) {
+    size_t first = block * kVertexCodecBlockSize;
+    size_t count = std::min(kVertexCodecBlockSize, vertexCount - first);
+    if (!decodeVertexBlock(data + offsets[block], offsets[block + 1] - offsets[block],
+                           vertices + first * vertexSize, count, vertexSize)) {
+      valid = false;
+    }
+  });
+  return valid;
+}
+
+void
+encodeIndexBuffer(std::vector<unsigned char>& out, const unsigned int* indices, size_t indexCount) {
+  size_t triangleCount = indexCount / 3;
+  std::vector<unsigned char> rotations((triangleCount + 3) / 4, 0);
+  std::vector<unsigned char> codes(triangleCount);
+  std::vector<unsigned char> extra;
+  std::vector<unsigned char> vertexExtra;
+  IndexCodecState state;
+
+  for (size_t t = 0; t < triangleCount; ++t) {
+    const unsigned int* triangle = indices + t * 3;
+
+    // The most recent edge this triangle shares, in any rotation.
+    unsigned int hitDistance = kNoEdge;
+    unsigned int rotation = 0;
+    for (unsigned int d = 0; d < kNoEdge && hitDistance == kNoEdge; ++d) {
+      const unsigned int* edge = state.edge(d);
+      for (unsigned int r = 0; r < 3; ++r) {
+        if (triangle[r] == edge[0] && triangle[(r + 1) % 3] == edge[1]) {
+          hitDistance = d;
+          rotation = r;
+          break;
+        }
+      }
+    }
+
+    if (hitDistance != kNoEdge) {
+      unsigned int a = triangle[rotation];
+      unsigned int b = triangle[(rotation + 1) % 3];
+      unsigned int c = triangle[(rotation + 2) % 3];
+      unsigned int code = encodeTriangleVertex(state, c, extra);
+      codes[t] = static_cast<unsigned char>((hitDistance << 4) | code);
+      rotations[t / 4] |= static_cast<unsigned char>(rotation << ((t % 4) * 2));
+      state.pushEdge(c, b);
+      state.pushEdge(a, c);
+    }
+    else {
+      // The second and third vertex codes go in a byte ahead of the three deltas.
+      vertexExtra.clear();
+      unsigned int codeA = encodeTriangleVertex(state, triangle[0], vertexExtra);
+      unsigned int codeB = encodeTriangleVertex(state, triangle[1], vertexExtra);
+      unsigned int codeC = encodeTriangleVertex(state, triangle[2], vertexExtra);
+      codes[t] = static_cast<unsigned char>((kNoEdge << 4) | codeA);
+      extra.push_back(static_cast<unsigned char>((codeB << 4) | codeC));
+      extra.insert(extra.end(), vertexExtra.begin(), vertexExtra.end());
+      state.pushEdge(triangle[1], triangle[0]);
+      state.pushEdge(triangle[2], triangle[1]);
+      state.pushEdge(triangle[0], triangle[2]);
+    }
+  }
+
+  out.clear();
+  out.reserve(1 + rotations.size() + codes.size() + extra.size());
+  out.push_back(kIndexCodecTag);
+  out.insert(out.end(), rotations.begin(), rotations.end());
+  out.insert(out.end(), codes.begin(), codes.end());
+  out.insert(out.end(), extra.begin(), extra.end());
+}
+
+bool
+decodeIndexBuffer(unsigned int* destination, size_t indexCount, const unsigned char* data, size_t size) {
+  size_t triangleCount = indexCount / 3;
+  size_t rotationBytes = (triangleCount + 3) / 4;
+  if (indexCount % 3 != 0 || size < 1 || data[0] != kIndexCodecTag || size - 1 < rotationBytes + triangleCount) {
+    return false;
+  }
+  const unsigned char* rotations = data + 1;
+  const unsigned char* codes = rotations + rotationBytes;
+  const unsigned char* p = codes + triangleCount;
+  const unsigned char* end = data + size;
+  IndexCodecState state;
+
+  for (size_t t = 0; t < triangleCount; ++t) {
+    unsigned int* triangle = destination + t * 3;
+    unsigned int code = codes[t];
+    unsigned int distance = code >> 4;
+
+    if (distance != kNoEdge) {
+      const unsigned int* edge = state.edge(distance);
+      unsigned int a = edge[0];
+      unsigned int b = edge[1];
+      unsigned int c;
+      if (!decodeTriangleVertex(state, code & 15u, p, end, c)) return false;
+      unsigned int rotation = (rotations[t / 4] >> ((t % 4) * 2)) & 3u;
+      if (rotation > 2) return false;
+      triangle[rotation] = a;
+      triangle[(rotation + 1) % 3] = b;
+      triangle[(rotation + 2) % 3] = c;
+      state.pushEdge(c, b);
+      state.pushEdge(a, c);
+    }
+    else {
+      if (p == end) return false;
+      unsigned int codes23 = *p++;
+      if (!decodeTriangleVertex(state, code & 15u, p, end, triangle[0]) ||
+          !decodeTriangleVertex(state, codes23 >> 4, p, end, triangle[1]) ||
+          !decodeTriangleVertex(state, codes23 & 15u, p, end, triangle[2])) {
+        return false;
+      }
+      state.pushEdge(triangle[1], triangle[0]);
+      state.pushEdge(triangle[2], triangle[1]);
+      state.pushEdge(triangle[0], triangle[2]);
+    }
+  }
+  return p == end;
+}
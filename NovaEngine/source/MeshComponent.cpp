@@ -0,0 +1,220 @@
+#include "MeshComponent.h"
+#include "MeshBounds.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  /*
+    Adds [first, first + count) to a sorted list of disjoint ranges, merged
+    with every range that overlaps it or lies at most gap elements away.
+  */
+  void
+  addDirtyRange(std::vector<MeshDirtyRange>& ranges, unsigned int first, unsigned int count, unsigned int gap) {
+    if (count == 0) {
+      return;
+    }
+    unsigned long long begin = first;
+    unsigned long long end = begin + count;
+    // Ranges are usually marked in order, so the new one tends to land at the end.
+    std::vector<MeshDirtyRange>::iterator merged = std::lower_bound(
+      ranges.begin(), ranges.end(), begin,
+      [gap](const MeshDirtyRange& range, unsigned long long value) {
+        return static_cast<unsigned long long>(range.first) + range.count + gap < value;
+      });
+    std::vector<MeshDirtyRange>::iterator last = merged;
+    while (last != ranges.end() && last->first <= end + gap) {
+      begin = std::min<unsigned long long>(begin, last->first);
+      end = std::max<unsigned long long>(end, static_cast<unsigned long long>(last->first) + last->count);
+      ++last;
+    }
+    MeshDirtyRange range;
+    range.first = static_cast<unsigned int>(begin);
+    range.count = static_cast<unsigned int>(end - begin);
+    if (merged == last) {
+      ranges.insert(merged, range);
+    }
+    else {
+      *merged = range;
+      ranges.erase(merged + 1, last);
+    }
+  }
+}
+
+void
+MeshComponent::computeBounds(unsigned int threadCount) {
+  MeshBounds bounds = computeVertexBounds(m_vertex.data(), m_vertex.size(), threadCount);
+  m_boundsMin = bounds.boundsMin;
+  m_boundsMax = bounds.boundsMax;
+  m_boundsCenter = bounds.center;
+  m_boundsRadius = bounds.radius;
+
+  auto submeshBounds = [this, threadCount](MeshSubmesh& submesh) {
+    MeshBounds range = computeIndexedBounds(m_vertex.data(), m_index.data() + submesh.indexOffset,
+                                            submesh.indexCount, threadCount);
+    submesh.boundsMin = range.boundsMin;
+    submesh.boundsMax = range.boundsMax;
+    submesh.center = range.center;
+    submesh.radius = range.radius;
+  };
+  for (MeshSubmesh& submesh : m_submeshes) {
+    submeshBounds(submesh);
+  }
+  for (MeshLod& lod : m_lods) {
+    for (MeshSubmesh& submesh : lod.submeshes) {
+      submeshBounds(submesh);
+    }
+  }
+}
+
+const std::vector<MeshSubmesh>&
+MeshComponent::lodSubmeshes(size_t level) const {
+  if (level == 0 || m_lods.empty()) {
+    return m_submeshes;
+  }
+  return m_lods[std::min(level, m_lods.size()) - 1].submeshes;
+}
+
+size_t
+MeshComponent::selectLod(float distance, float viewportHeight, float fovY, float maxPixelError) const {
+  float extent = std::max(m_boundsMax.x - m_boundsMin.x,
+                          std::max(m_boundsMax.y - m_boundsMin.y, m_boundsMax.z - m_boundsMin.z));
+  // Pixels covered by one world unit at this distance.
+  float pixelsPerUnit = viewportHeight / (2.0f * std::max(distance, 1e-6f) * std::tan(fovY * 0.5f));
+  size_t level = 0;
+  for (size_t i = 0; i < m_lods.size(); ++i) {
+    if (m_lods[i].error * extent * pixelsPerUnit > maxPixelError) {
+      break;
+    }
+    level = i + 1;
+  }
+  return level;
+}
+
+void
+MeshComponent::splitVertexStreams(std::vector<XMFLOAT3>& positions, std::vector<VertexAttributes>& attributes) const {
+  positions.resize(m_vertex.size());
+  attributes.resize(m_vertex.size());
+  for (size_t i = 0; i < m_vertex.size(); ++i) {
+    positions[i] = m_vertex[i].Pos;
+    attributes[i].Tex = m_vertex[i].Tex;
+    attributes[i].Normal = m_vertex[i].Normal;
+  }
+}
+
+bool
+MeshComponent::buildIndex16() {
+  m_index16.clear();
+  std::vector<MeshSubmesh*> ranges;
+  for (size_t level = 0; level <= m_lods.size(); ++level) {
+    std::vector<MeshSubmesh>& submeshes = (level == 0) ? m_submeshes : m_lods[level - 1].submeshes;
+    for (MeshSubmesh& submesh : submeshes) {
+      submesh.baseVertex = 0;
+      ranges.push_back(&submesh);
+    }
+  }
+
+  if (m_vertex.size() > 65536) {
+    // Without submeshes the whole list is drawn with base vertex 0.
+    if (ranges.empty()) {
+      return false;
+    }
+    for (MeshSubmesh* range : ranges) {
+      if (range->indexCount == 0) {
+        continue;
+      }
+      const unsigned int* first = m_index.data() + range->indexOffset;
+      std::pair<const unsigned int*, const unsigned int*> extremes =
+        std::minmax_element(first, first + range->indexCount);
+      if (*extremes.second - *extremes.first > 0xFFFFu) {
+        for (MeshSubmesh* reset : ranges) {
+          reset->baseVertex = 0;
+        }
+        return false;
+      }
+      range->baseVertex = *extremes.first;
+    }
+  }
+
+  if (ranges.empty()) {
+    m_index16.resize(m_index.size());
+    for (size_t i = 0; i < m_index.size(); ++i) {
+      m_index16[i] = static_cast<unsigned short>(m_index[i]);
+    }
+    return true;
+  }
+  // Indices outside every range are never drawn; they are stored as 0.
+  m_index16.assign(m_index.size(), 0);
+  for (const MeshSubmesh* range : ranges) {
+    for (unsigned int i = range->indexOffset; i < range->indexOffset + range->indexCount; ++i) {
+      m_index16[i] = static_cast<unsigned short>(m_index[i] - range->baseVertex);
+    }
+  }
+  return true;
+}
+
+void
+MeshComponent::markVerticesDirty(unsigned int first, unsigned int count, unsigned int mergeGap) {
+  addDirtyRange(m_dirtyVertices, first, count, mergeGap);
+}
+
+void
+MeshComponent::markIndicesDirty(unsigned int first, unsigned int count, unsigned int mergeGap) {
+  addDirtyRange(m_dirtyIndices, first, count, mergeGap);
+}
+
+bool
+MeshComponent::hasDirtyRanges() const {
+  return !m_dirtyVertices.empty() || !m_dirtyIndices.empty();
+}
+
+void
+MeshComponent::clearDirtyRanges() {
+  m_dirtyVertices.clear();
+  m_dirtyIndices.clear();
+}
+
+bool
+MeshComponent::refreshIndex16() {
+  if (m_index16.empty() || m_dirtyIndices.empty()) {
+    return true;
+  }
+  if (m_index16.size() != m_index.size()) {
+    return false;
+  }
+
+  // Every index range of every level, by offset; they do not overlap.
+  std::vector<const MeshSubmesh*> ranges;
+  MeshSubmesh whole;
+  whole.indexCount = static_cast<unsigned int>(m_index.size());
+  for (size_t level = 0; level <= m_lods.size(); ++level) {
+    for (const MeshSubmesh& submesh : (level == 0) ? m_submeshes : m_lods[level - 1].submeshes) {
+      ranges.push_back(&submesh);
+    }
+  }
+  if (ranges.empty()) {
+    ranges.push_back(&whole);
+  }
+  std::sort(ranges.begin(), ranges.end(),
+            [](const MeshSubmesh* a, const MeshSubmesh* b) { return a->indexOffset < b->indexOffset; });
+
+  size_t r = 0;
+  for (const MeshDirtyRange& dirty : m_dirtyIndices) {
+    size_t end = std::min(static_cast<size_t>(dirty.first) + dirty.count, m_index.size());
+    for (size_t i = dirty.first; i < end; ++i) {
+      while (r + 1 < ranges.size() && ranges[r + 1]->indexOffset <= i) {
+        ++r;
+      }
+      const MeshSubmesh* range = ranges[r];
+      if (i < range->indexOffset || i >= static_cast<size_t>(range->indexOffset) + range->indexCount) {
+        // Not drawn by any range.
+        m_index16[i] = 0;
+        continue;
+      }
+      if (m_index[i] < range->baseVertex || m_index[i] - range->baseVertex > 0xFFFFu) {
+        return false;
+      }
+      m_index16[i] = static_cast<unsigned short>(m_index[i] - range->baseVertex);
+    }
+  }
+  return true;
+}
@@ -0,0 +1,133 @@
+#include "MeshNormals.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  /*
+    Angle between two edge vectors, clamped against rounding outside [-1, 1].
+  */
+  inline float
+  cornerAngle(XMVECTOR a, XMVECTOR b) {
+    float lengths = std::sqrt(XMVectorGetX(XMVector3LengthSq(a)) * XMVectorGetX(XMVector3LengthSq(b)));
+    if (lengths <= 0.0f) {
+      return 0.0f;
+    }
+    float cosine = XMVectorGetX(XMVector3Dot(a, b)) / lengths;
+    return std::acos(std::min(1.0f, std::max(-1.0f, cosine)));
+  }
+}
+
+void
+generateCornerNormals(const XMFLOAT3* positions,
+                      size_t positionCount,
+                      const unsigned int* positionIndices,
+                      size_t triangleCount,
+                      const unsigned int* smoothingGroups,
+                      float creaseAngleDegrees,
+                      unsigned int threadCount,
+                      XMFLOAT3* cornerNormals) {
+  threadCount = resolveThreadCount(threadCount);
+  const size_t cornerCount = triangleCount * 3;
+
+  // Face normals as 16-byte XMFLOAT4 so the neighbour loop below is one aligned
+  // load per triangle, and one area * angle weight per corner.
+  std::vector<XMFLOAT4> faceNormals(triangleCount);
+  std::vector<float> weights(cornerCount);
+  parallelForRange(triangleCount, threadCount, 1 << 14, [&](size_t first, size_t last) {
+    for (size_t t = first; t < last; ++t) {
+      const unsigned int* tri = positionIndices + t * 3;
+      XMVECTOR p0 = XMLoadFloat3(&positions[tri[0]]);
+      XMVECTOR p1 = XMLoadFloat3(&positions[tri[1]]);
+      XMVECTOR p2 = XMLoadFloat3(&positions[tri[2]]);
+      XMVECTOR e01 = XMVectorSubtract(p1, p0);
+      XMVECTOR e02 = XMVectorSubtract(p2, p0);
+      XMVECTOR e12 = XMVectorSubtract(p2, p1);
+      XMVECTOR cross = XMVector3Cross(e01, e02);
+      float doubleArea = std::sqrt(XMVectorGetX(XMVector3LengthSq(cross)));
+      XMVECTOR normal = (doubleArea > 0.0f) ? XMVectorScale(cross, 1.0f / doubleArea) : XMVectorZero();
+      XMStoreFloat4(&faceNormals[t], normal);
+
+      // The angles of a triangle add up to pi, so the third one needs no acos.
+      float angle0 = cornerAngle(e01, e02);
+      float angle1 = cornerAngle(XMVectorNegate(e01), e12);
+      float angle2 = std::max(0.0f, 3.14159265358979f - angle0 - angle1);
+      float area = 0.5f * doubleArea;
+      weights[t * 3 + 0] = area * angle0;
+      weights[t * 3 + 1] = area * angle1;
+      weights[t * 3 + 2] = area * angle2;
+    }
+  });
+
+  // Corners around each position (CSR), filled in triangle order so every
+  // neighbour sum below adds its terms in the same order on every run.
+  std::vector<unsigned int> adjacencyStart(positionCount + 1, 0);
+  for (size_t i = 0; i < cornerCount; ++i) {
+    ++adjacencyStart[positionIndices[i] + 1];
+  }
+  for (size_t p = 0; p < positionCount; ++p) {
+    adjacencyStart[p + 1] += adjacencyStart[p];
+  }
+  std::vector<unsigned int> adjacency(cornerCount);
+  {
+    std::vector<unsigned int> cursor(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (size_t i = 0; i < cornerCount; ++i) {
+      adjacency[cursor[positionIndices[i]]++] = static_cast<unsigned int>(i);
+    }
+  }
+
+  // Corners are resolved per position: the faces around it are gathered once
+  // into a small local list, and every corner at that position sums from it.
+  const float cosCrease = std::cos(creaseAngleDegrees * 3.14159265358979f / 180.0f);
+  parallelForRange(positionCount, threadCount, 1 << 12, [&](size_t first, size_t last) {
+    struct Neighbour {
+      XMFLOAT4 normal;
+      float weight;
+      unsigned int corner;
+      unsigned int triangle;
+      unsigned int group;
+    };
+    std::vector<Neighbour> neighbours;
+    for (size_t position = first; position < last; ++position) {
+      neighbours.clear();
+      for (unsigned int a = adjacencyStart[position]; a < adjacencyStart[position + 1]; ++a) {
+        Neighbour neighbour;
+        neighbour.corner = adjacency[a];
+        neighbour.triangle = neighbour.corner / 3;
+        neighbour.normal = faceNormals[neighbour.triangle];
+        neighbour.weight = weights[neighbour.corner];
+        neighbour.group = smoothingGroups ? smoothingGroups[neighbour.triangle] : kDefaultSmoothingGroup;
+        neighbours.push_back(neighbour);
+      }
+
+      for (const Neighbour& self : neighbours) {
+        XMVECTOR faceNormal = XMLoadFloat4(&self.normal);
+        // A degenerate triangle has no direction to crease against; it takes the smooth normal of its corners.
+        bool degenerate = XMVectorGetX(XMVector3LengthSq(faceNormal)) == 0.0f;
+        XMVECTOR sum = XMVectorZero();
+        if (self.group != 0) {
+          for (const Neighbour& other : neighbours) {
+            XMVECTOR otherNormal = XMLoadFloat4(&other.normal);
+            if (other.triangle != self.triangle) {
+              if (other.group != self.group) continue;
+              if (!degenerate && XMVectorGetX(XMVector3Dot(faceNormal, otherNormal)) < cosCrease) continue;
+            }
+            sum = XMVectorAdd(sum, XMVectorScale(otherNormal, other.weight));
+          }
+        }
+
+        float length = std::sqrt(XMVectorGetX(XMVector3LengthSq(sum)));
+        XMFLOAT3& out = cornerNormals[self.corner];
+        if (length > 0.0f) {
+          XMStoreFloat3(&out, XMVectorScale(sum, 1.0f / length));
+        }
+        else if (!degenerate) {
+          XMStoreFloat3(&out, faceNormal);
+        }
+        else {
+          out = XMFLOAT3(0.0f, 1.0f, 0.0f);
+        }
+      }
+    }
+  });
+}
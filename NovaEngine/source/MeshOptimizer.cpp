@@ -0,0 +1,627 @@
+#include "MeshOptimizer.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  /*
+    Index ranges the per-submesh passes work on: every submesh of every level
+    of detail, or the whole index buffer of a mesh without submeshes.
+  */
+  std::vector<std::pair<unsigned int, unsigned int>>
+  submeshRanges(const MeshComponent& mesh) {
+    std::vector<std::pair<unsigned int, unsigned int>> ranges;
+    for (size_t level = 0; level <= mesh.m_lods.size(); ++level) {
+      for (const MeshSubmesh& submesh : mesh.lodSubmeshes(level)) {
+        ranges.emplace_back(submesh.indexOffset, submesh.indexCount);
+      }
+    }
+    if (ranges.empty()) {
+      ranges.emplace_back(0u, static_cast<unsigned int>(mesh.m_index.size()));
+    }
+    return ranges;
+  }
+
+  /*
+    Feeds one triangle to a simulated FIFO cache and returns how many of its
+    vertices missed.
+  */
+  inline unsigned int
+  simulateTriangle(const unsigned int* triangle,
+                   std::vector<unsigned int>& cachedAt,
+                   unsigned int& time,
+                   unsigned int cacheSize) {
+    unsigned int misses = 0;
+    for (size_t k = 0; k < 3; ++k) {
+      unsigned int vertex = triangle[k];
+      if (time - cachedAt[vertex] > cacheSize) {
+        cachedAt[vertex] = time++;
+        ++misses;
+      }
+    }
+    return misses;
+  }
+
+  /*
+    A run of triangles that is moved as a unit, with the key it is sorted by.
+  */
+  struct OverdrawCluster {
+    size_t first = 0;
+    size_t count = 0;
+    float sortKey = 0.0f;
+  };
+
+  // Line size and capacity of the cache analyzeVertexFetch simulates.
+  const size_t kFetchLineBytes = 64;
+  const size_t kFetchCacheLines = (128 * 1024) / kFetchLineBytes;
+
+  /*
+    Vertex fetch simulation over several draw calls: each range starts with a
+    cold cache and counts its own referenced vertices, and the totals add up.
+  */
+  struct FetchSimulation {
+    std::vector<size_t> tags;
+    std::vector<unsigned int> stamps;
+    unsigned int range = 0;
+    unsigned long long linesFetched = 0;
+    unsigned long long uniqueVertices = 0;
+
+    FetchSimulation(size_t vertexCount) : tags(kFetchCacheLines), stamps(vertexCount, 0) {}
+
+    void
+    addRange(const unsigned int* indices, size_t indexCount, size_t vertexSize) {
+      // Tags hold line + 1 so that 0 marks an empty slot.
+      std::fill(tags.begin(), tags.end(), 0);
+      ++range;
+      for (size_t i = 0; i < indexCount; ++i) {
+        unsigned int vertex = indices[i];
+        if (stamps[vertex] != range) {
+          stamps[vertex] = range;
+          ++uniqueVertices;
+        }
+        size_t firstLine = vertex * vertexSize / kFetchLineBytes;
+        size_t lastLine = (vertex * vertexSize + vertexSize - 1) / kFetchLineBytes;
+        for (size_t line = firstLine; line <= lastLine; ++line) {
+          size_t& tag = tags[line % kFetchCacheLines];
+          if (tag != line + 1) {
+            tag = line + 1;
+            ++linesFetched;
+          }
+        }
+      }
+    }
+
+    VertexFetchStats
+    stats(size_t vertexSize) const {
+      VertexFetchStats result;
+      if (uniqueVertices != 0) {
+        result.bytesFetched = linesFetched * kFetchLineBytes;
+        result.overfetch = static_cast<float>(result.bytesFetched) / static_cast<float>(uniqueVertices * vertexSize);
+      }
+      return result;
+    }
+  };
+
+  /*
+    Fetch statistics of the draw ranges of a mesh read through another index
+    buffer of the same layout (a candidate renumbering of m_index).
+  */
+  VertexFetchStats
+  rangeFetch(const MeshComponent& mesh, const unsigned int* indices, size_t vertexCount, size_t vertexSize) {
+    if (mesh.m_index.empty() || vertexCount == 0 || vertexSize == 0) {
+      return VertexFetchStats();
+    }
+    FetchSimulation simulation(vertexCount);
+    for (const std::pair<unsigned int, unsigned int>& range : submeshRanges(mesh)) {
+      simulation.addRange(indices + range.first, range.second, vertexSize);
+    }
+    return simulation.stats(vertexSize);
+  }
+}
+
+void
+compactVertices(const unsigned int* indices,
+                size_t indexCount,
+                std::vector<unsigned int>& localIndices,
+                std::vector<unsigned int>& globalIds) {
+  // Open addressing at a load factor of at most one half.
+  size_t capacity = 16;
+  while (capacity < indexCount * 2) {
+    capacity <<= 1;
+  }
+  const unsigned int kEmpty = 0xFFFFFFFFu;
+  std::vector<unsigned int> keys(capacity, kEmpty);
+  std::vector<unsigned int> values(capacity);
+  localIndices.resize(indexCount);
+  globalIds.clear();
+  for (size_t i = 0; i < indexCount; ++i) {
+    unsigned int vertex = indices[i];
+    size_t slot = (vertex * 0x9E3779B1u) & (capacity - 1);
+    while (keys[slot] != kEmpty && keys[slot] != vertex) {
+      slot = (slot + 1) & (capacity - 1);
+    }
+    if (keys[slot] == kEmpty) {
+      keys[slot] = vertex;
+      values[slot] = static_cast<unsigned int>(globalIds.size());
+      globalIds.push_back(vertex);
+    }
+    localIndices[i] = values[slot];
+  }
+}
+
+VertexCacheStats
+analyzeVertexCache(const unsigned int* indices,
+                   size_t indexCount,
+                   size_t vertexCount,
+                   unsigned int cacheSize) {
+  VertexCacheStats stats;
+  size_t triangleCount = indexCount / 3;
+  if (triangleCount == 0) {
+    return stats;
+  }
+
+  // A vertex is cached while fewer than cacheSize misses happened since its
+  // own; timestamps start past the cache size so nothing starts cached.
+  std::vector<unsigned int> cachedAt(vertexCount, 0);
+  unsigned int time = cacheSize + 1;
+  size_t misses = 0;
+  size_t referenced = 0;
+  for (size_t i = 0; i < triangleCount * 3; ++i) {
+    unsigned int vertex = indices[i];
+    if (time - cachedAt[vertex] > cacheSize) {
+      referenced += (cachedAt[vertex] == 0) ? 1 : 0;
+      cachedAt[vertex] = time++;
+      ++misses;
+    }
+  }
+  stats.acmr = static_cast<float>(misses) / static_cast<float>(triangleCount);
+  stats.atvr = static_cast<float>(misses) / static_cast<float>(std::max<size_t>(1, referenced));
+  return stats;
+}
+
+void
+optimizeVertexCache(unsigned int* indices,
+                    size_t indexCount,
+                    size_t vertexCount,
+                    unsigned int cacheSize) {
+  const size_t triangleCount = indexCount / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+
+  // Triangles around every vertex (CSR) and the number not yet emitted.
+  std::vector<unsigned int> live(vertexCount, 0);
+  for (size_t i = 0; i < triangleCount * 3; ++i) {
+    ++live[indices[i]];
+  }
+  std::vector<unsigned int> adjacencyStart(vertexCount + 1, 0);
+  for (size_t v = 0; v < vertexCount; ++v) {
+    adjacencyStart[v + 1] = adjacencyStart[v] + live[v];
+  }
+  std::vector<unsigned int> adjacency(triangleCount * 3);
+  {
+    std::vector<unsigned int> cursor(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; ++i) {
+      adjacency[cursor[indices[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+  }
+
+  std::vector<unsigned int> cachedAt(vertexCount, 0);
+  std::vector<unsigned char> emitted(triangleCount, 0);
+  std::vector<unsigned int> deadEnd;
+  std::vector<unsigned int> candidates;
+  std::vector<unsigned int> output;
+  deadEnd.reserve(triangleCount * 3);
+  output.reserve(triangleCount * 3);
+  unsigned int time = cacheSize + 1;
+  size_t scan = 0;
+
+  const unsigned int kNone = 0xFFFFFFFFu;
+  unsigned int fan = indices[0];
+  while (fan != kNone) {
+    candidates.clear();
+    for (unsigned int a = adjacencyStart[fan]; a < adjacencyStart[fan + 1]; ++a) {
+      unsigned int triangle = adjacency[a];
+      if (emitted[triangle]) {
+        continue;
+      }
+      emitted[triangle] = 1;
+      for (size_t k = 0; k < 3; ++k) {
+        unsigned int vertex = indices[triangle * 3 + k];
+        output.push_back(vertex);
+        deadEnd.push_back(vertex);
+        candidates.push_back(vertex);
+        --live[vertex];
+        if (time - cachedAt[vertex] > cacheSize) {
+          cachedAt[vertex] = time++;
+        }
+      }
+    }
+
+    // Prefer the oldest candidate that stays cached while its remaining
+    // triangles are emitted; any live candidate beats none.
+    unsigned int next = kNone;
+    int bestPriority = -1;
+    for (unsigned int vertex : candidates) {
+      if (live[vertex] == 0) {
+        continue;
+      }
+      int priority = 0;
+      if (time - cachedAt[vertex] + 2 * live[vertex] <= cacheSize) {
+        priority = static_cast<int>(time - cachedAt[vertex]);
+      }
+      if (priority > bestPriority) {
+        bestPriority = priority;
+        next = vertex;
+      }
+    }
+
+    // Dead end: back up to a recently used vertex, then fall back to the next
+    // vertex in index order that still has triangles.
+    while (next == kNone && !deadEnd.empty()) {
+      unsigned int vertex = deadEnd.back();
+      deadEnd.pop_back();
+      if (live[vertex] > 0) {
+        next = vertex;
+      }
+    }
+    while (next == kNone && scan < triangleCount * 3) {
+      unsigned int vertex = indices[scan++];
+      if (live[vertex] > 0) {
+        next = vertex;
+      }
+    }
+    fan = next;
+  }
+
+  std::copy(output.begin(), output.end(), indices);
+}
+
+void
+optimizeVertexCache(MeshComponent& mesh,
+                    unsigned int threadCount,
+                    unsigned int cacheSize) {
+  threadCount = resolveThreadCount(threadCount);
+  // The clusters were index ranges of the old order.
+  mesh.m_clusters.clear();
+  std::vector<std::pair<unsigned int, unsigned int>> ranges = submeshRanges(mesh);
+
+  parallelFor(ranges.size(), threadCount, [&](size_t r) {
+    unsigned int* indices = mesh.m_index.data() + ranges[r].first;
+    size_t indexCount = ranges[r].second;
+    std::vector<unsigned int> localIndices;
+    std::vector<unsigned int> globalIds;
+    compactVertices(indices, indexCount, localIndices, globalIds);
+    optimizeVertexCache(localIndices.data(), indexCount, globalIds.size(), cacheSize);
+    for (size_t i = 0; i < indexCount; ++i) {
+      indices[i] = globalIds[localIndices[i]];
+    }
+  });
+}
+
+OverdrawStats
+analyzeOverdraw(const unsigned int* indices,
+                size_t indexCount,
+                const SimpleVertex* vertices,
+                size_t vertexCount,
+                unsigned int resolution,
+                unsigned int threadCount) {
+  OverdrawStats stats;
+  size_t triangleCount = indexCount / 3;
+  if (triangleCount == 0 || vertexCount == 0 || resolution == 0) {
+    return stats;
+  }
+
+  float boundsMin[3] = { vertices[0].Pos.x, vertices[0].Pos.y, vertices[0].Pos.z };
+  float boundsMax[3] = { boundsMin[0], boundsMin[1], boundsMin[2] };
+  for (size_t i = 1; i < vertexCount; ++i) {
+    const float* p = &vertices[i].Pos.x;
+    for (size_t a = 0; a < 3; ++a) {
+      boundsMin[a] = std::min(boundsMin[a], p[a]);
+      boundsMax[a] = std::max(boundsMax[a], p[a]);
+    }
+  }
+
+  // View v looks along axis v / 2, from the positive side for even v.
+  unsigned long long shaded[6] = {};
+  unsigned long long covered[6] = {};
+  parallelFor(6, resolveThreadCount(threadCount), [&](size_t view) {
+    const size_t axis = view / 2;
+    const float side = (view % 2 == 0) ? 1.0f : -1.0f;
+    const size_t uAxis = (axis + 1) % 3;
+    const size_t vAxis = (axis + 2) % 3;
+    float extent = std::max(boundsMax[uAxis] - boundsMin[uAxis], boundsMax[vAxis] - boundsMin[vAxis]);
+    float scale = (extent > 0.0f) ? static_cast<float>(resolution) / extent : 0.0f;
+    const float kFar = 3.4e38f;
+    std::vector<float> depth(static_cast<size_t>(resolution) * resolution, kFar);
+
+    for (size_t t = 0; t < triangleCount; ++t) {
+      float x[3], y[3], z[3];
+      for (size_t k = 0; k < 3; ++k) {
+        const float* p = &vertices[indices[t * 3 + k]].Pos.x;
+        x[k] = (p[uAxis] - boundsMin[uAxis]) * scale;
+        y[k] = (p[vAxis] - boundsMin[vAxis]) * scale;
+        z[k] = -side * p[axis];
+      }
+      // (u, v, axis) is right-handed, so a counter-clockwise front face has a
+      // positive area seen from the positive side and a negative one from the other.
+      float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+      if (area * side <= 0.0f) {
+        continue;
+      }
+      if (area < 0.0f) {
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(z[1], z[2]);
+        area = -area;
+      }
+
+      int minX = std::max(0, static_cast<int>(std::floor(std::min(x[0], std::min(x[1], x[2])))));
+      int maxX = std::min(static_cast<int>(resolution) - 1, static_cast<int>(std::max(x[0], std::max(x[1], x[2]))));
+      int minY = std::max(0, static_cast<int>(std::floor(std::min(y[0], std::min(y[1], y[2])))));
+      int maxY = std::min(static_cast<int>(resolution) - 1, static_cast<int>(std::max(y[0], std::max(y[1], y[2]))));
+      float inverseArea = 1.0f / area;
+      for (int py = minY; py <= maxY; ++py) {
+        float cy = static_cast<float>(py) + 0.5f;
+        for (int px = minX; px <= maxX; ++px) {
+          float cx = static_cast<float>(px) + 0.5f;
+          float w0 = (x[2] - x[1]) * (cy - y[1]) - (y[2] - y[1]) * (cx - x[1]);
+          float w1 = (x[0] - x[2]) * (cy - y[2]) - (y[0] - y[2]) * (cx - x[2]);
+          float w2 = (x[1] - x[0]) * (cy - y[0]) - (y[1] - y[0]) * (cx - x[0]);
+          if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) {
+            continue;
+          }
+          float fragment = (w0 * z[0] + w1 * z[1] + w2 * z[2]) * inverseArea;
+          float& stored = depth[static_cast<size_t>(py) * resolution + px];
+          if (fragment < stored) {
+            stored = fragment;
+            ++shaded[view];
+          }
+        }
+      }
+    }
+
+    for (float value : depth) {
+      covered[view] += (value < kFar) ? 1 : 0;
+    }
+  });
+
+  for (size_t view = 0; view < 6; ++view) {
+    stats.pixelsShaded += shaded[view];
+    stats.pixelsCovered += covered[view];
+  }
+  stats.overdraw = (stats.pixelsCovered > 0)
+    ? static_cast<float>(stats.pixelsShaded) / static_cast<float>(stats.pixelsCovered) : 0.0f;
+  return stats;
+}
+
+void
+optimizeOverdraw(unsigned int* indices,
+                 size_t indexCount,
+                 const SimpleVertex* vertices,
+                 size_t vertexCount,
+                 float threshold,
+                 unsigned int cacheSize) {
+  const size_t triangleCount = indexCount / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+
+  // Hard boundaries: triangles whose three vertices all miss, where the
+  // input order already starts over with a cold cache.
+  std::vector<unsigned int> cachedAt(vertexCount, 0);
+  unsigned int time = cacheSize + 1;
+  std::vector<size_t> hard;
+  for (size_t t = 0; t < triangleCount; ++t) {
+    if (simulateTriangle(indices + t * 3, cachedAt, time, cacheSize) == 3) {
+      hard.push_back(t);
+    }
+  }
+  if (hard.empty() || hard[0] != 0) {
+    hard.insert(hard.begin(), 0);
+  }
+  hard.push_back(triangleCount);
+
+  // Soft boundaries: inside each hard cluster, cut as soon as the ACMR of
+  // the part so far is within the budget of the whole cluster's ACMR.
+  std::vector<OverdrawCluster> clusters;
+  for (size_t h = 0; h + 1 < hard.size(); ++h) {
+    size_t first = hard[h];
+    size_t last = hard[h + 1];
+    time += cacheSize + 1;
+    unsigned int misses = 0;
+    for (size_t t = first; t < last; ++t) {
+      misses += simulateTriangle(indices + t * 3, cachedAt, time, cacheSize);
+    }
+    float budget = threshold * static_cast<float>(misses) / static_cast<float>(last - first);
+
+    time += cacheSize + 1;
+    size_t start = first;
+    unsigned int runningMisses = 0;
+    for (size_t t = first; t < last; ++t) {
+      runningMisses += simulateTriangle(indices + t * 3, cachedAt, time, cacheSize);
+      if (t + 1 < last && static_cast<float>(runningMisses) <= budget * static_cast<float>(t + 1 - start)) {
+        OverdrawCluster cluster;
+        cluster.first = start;
+        cluster.count = t + 1 - start;
+        clusters.push_back(cluster);
+        start = t + 1;
+        runningMisses = 0;
+        time += cacheSize + 1;
+      }
+    }
+    OverdrawCluster cluster;
+    cluster.first = start;
+    cluster.count = last - start;
+    clusters.push_back(cluster);
+  }
+
+  // Area-weighted centroid and normal of every cluster and of the mesh.
+  std::vector<XMFLOAT3> centroids(clusters.size());
+  std::vector<XMFLOAT3> normals(clusters.size());
+  XMVECTOR meshCentroid = XMVectorZero();
+  float meshArea = 0.0f;
+  std::vector<float> areas(clusters.size());
+  for (size_t c = 0; c < clusters.size(); ++c) {
+    XMVECTOR centroid = XMVectorZero();
+    XMVECTOR normal = XMVectorZero();
+    float area = 0.0f;
+    for (size_t t = clusters[c].first; t < clusters[c].first + clusters[c].count; ++t) {
+      XMVECTOR p0 = XMLoadFloat3(&vertices[indices[t * 3]].Pos);
+      XMVECTOR p1 = XMLoadFloat3(&vertices[indices[t * 3 + 1]].Pos);
+      XMVECTOR p2 = XMLoadFloat3(&vertices[indices[t * 3 + 2]].Pos);
+      XMVECTOR cross = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+      float triangleArea = std::sqrt(XMVectorGetX(XMVector3LengthSq(cross)));
+      centroid = XMVectorAdd(centroid, XMVectorScale(XMVectorAdd(p0, XMVectorAdd(p1, p2)), triangleArea / 3.0f));
+      normal = XMVectorAdd(normal, cross);
+      area += triangleArea;
+    }
+    meshCentroid = XMVectorAdd(meshCentroid, centroid);
+    meshArea += area;
+    XMStoreFloat3(&centroids[c], (area > 0.0f) ? XMVectorScale(centroid, 1.0f / area) : centroid);
+    XMStoreFloat3(&normals[c], XMVector3Normalize(normal));
+  }
+  if (meshArea > 0.0f) {
+    meshCentroid = XMVectorScale(meshCentroid, 1.0f / meshArea);
+  }
+  for (size_t c = 0; c < clusters.size(); ++c) {
+    XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&centroids[c]), meshCentroid);
+    clusters[c].sortKey = XMVectorGetX(XMVector3Dot(offset, XMLoadFloat3(&normals[c])));
+  }
+
+  // Outward-facing clusters first; equal keys keep the cache-friendly order.
+  std::stable_sort(clusters.begin(), clusters.end(), [](const OverdrawCluster& a, const OverdrawCluster& b) {
+    return a.sortKey > b.sortKey;
+  });
+  std::vector<unsigned int> output;
+  output.reserve(triangleCount * 3);
+  for (const OverdrawCluster& cluster : clusters) {
+    output.insert(output.end(), indices + cluster.first * 3, indices + (cluster.first + cluster.count) * 3);
+  }
+  std::copy(output.begin(), output.end(), indices);
+}
+
+void
+optimizeOverdraw(MeshComponent& mesh,
+                 float threshold,
+                 unsigned int threadCount) {
+  threadCount = resolveThreadCount(threadCount);
+  // The clusters were index ranges of the old order.
+  mesh.m_clusters.clear();
+  std::vector<std::pair<unsigned int, unsigned int>> ranges = submeshRanges(mesh);
+
+  parallelFor(ranges.size(), threadCount, [&](size_t r) {
+    unsigned int* indices = mesh.m_index.data() + ranges[r].first;
+    size_t indexCount = ranges[r].second;
+    std::vector<unsigned int> localIndices;
+    std::vector<unsigned int> globalIds;
+    compactVertices(indices, indexCount, localIndices, globalIds);
+    std::vector<SimpleVertex> localVertices(globalIds.size());
+    for (size_t i = 0; i < globalIds.size(); ++i) {
+      localVertices[i] = mesh.m_vertex[globalIds[i]];
+    }
+    optimizeOverdraw(localIndices.data(), indexCount, localVertices.data(), localVertices.size(), threshold);
+    for (size_t i = 0; i < indexCount; ++i) {
+      indices[i] = globalIds[localIndices[i]];
+    }
+  });
+}
+
+VertexFetchStats
+analyzeVertexFetch(const unsigned int* indices,
+                   size_t indexCount,
+                   size_t vertexCount,
+                   size_t vertexSize) {
+  if (indexCount == 0 || vertexCount == 0 || vertexSize == 0) {
+    return VertexFetchStats();
+  }
+  FetchSimulation simulation(vertexCount);
+  simulation.addRange(indices, indexCount, vertexSize);
+  return simulation.stats(vertexSize);
+}
+
+VertexFetchStats
+analyzeVertexFetch(const MeshComponent& mesh, size_t vertexSize) {
+  return rangeFetch(mesh, mesh.m_index.data(), mesh.m_vertex.size(), vertexSize);
+}
+
+size_t
+optimizeVertexFetch(MeshComponent& mesh) {
+  if (mesh.m_index.empty()) {
+    return 0;
+  }
+
+  // First use in draw order: the submeshes of level 0, then the coarser
+  // levels, then any index outside those ranges.
+  const unsigned int kUnused = 0xFFFFFFFFu;
+  const size_t vertexCount = mesh.m_vertex.size();
+  std::vector<unsigned int> firstUse(vertexCount, kUnused);
+  unsigned int next = 0;
+  std::vector<std::pair<unsigned int, unsigned int>> ranges = submeshRanges(mesh);
+  ranges.emplace_back(0u, static_cast<unsigned int>(mesh.m_index.size()));
+  for (const std::pair<unsigned int, unsigned int>& range : ranges) {
+    for (unsigned int i = range.first; i < range.first + range.second; ++i) {
+      unsigned int& slot = firstUse[mesh.m_index[i]];
+      if (slot == kUnused) {
+        slot = next++;
+      }
+    }
+  }
+
+  // The same vertices in their current order, only without the unused ones.
+  std::vector<unsigned int> kept(vertexCount, kUnused);
+  unsigned int keptCount = 0;
+  for (size_t v = 0; v < vertexCount; ++v) {
+    if (firstUse[v] != kUnused) {
+      kept[v] = keptCount++;
+    }
+  }
+
+  // Keep the new order only if the draw ranges fetch less through it; first
+  // use over a whole mesh can scatter the ranges of a submesh or a level.
+  std::vector<unsigned int> firstUseIndices(mesh.m_index.size());
+  std::vector<unsigned int> keptIndices(mesh.m_index.size());
+  for (size_t i = 0; i < mesh.m_index.size(); ++i) {
+    firstUseIndices[i] = firstUse[mesh.m_index[i]];
+    keptIndices[i] = kept[mesh.m_index[i]];
+  }
+  VertexFetchStats reordered = rangeFetch(mesh, firstUseIndices.data(), next, sizeof(SimpleVertex));
+  VertexFetchStats unchanged = rangeFetch(mesh, keptIndices.data(), next, sizeof(SimpleVertex));
+  bool reorder = reordered.bytesFetched < unchanged.bytesFetched;
+  std::vector<unsigned int>& remap = reorder ? firstUse : kept;
+  mesh.m_index.swap(reorder ? firstUseIndices : keptIndices);
+
+  std::vector<SimpleVertex> vertices(next);
+  for (size_t v = 0; v < vertexCount; ++v) {
+    if (remap[v] != kUnused) {
+      vertices[remap[v]] = mesh.m_vertex[v];
+    }
+  }
+  mesh.m_vertex.swap(vertices);
+  if (mesh.m_color.size() == vertexCount) {
+    std::vector<unsigned int> colors(next);
+    for (size_t v = 0; v < vertexCount; ++v) {
+      if (remap[v] != kUnused) {
+        colors[remap[v]] = mesh.m_color[v];
+      }
+    }
+    mesh.m_color.swap(colors);
+  }
+  if (mesh.m_tangent.size() == vertexCount) {
+    std::vector<XMFLOAT4> tangents(next);
+    for (size_t v = 0; v < vertexCount; ++v) {
+      if (remap[v] != kUnused) {
+        tangents[remap[v]] = mesh.m_tangent[v];
+      }
+    }
+    mesh.m_tangent.swap(tangents);
+  }
+  mesh.m_numVertex = static_cast<int>(next);
+
+  // Dropped vertices may have stretched the mesh bounds.
+  size_t removed = vertexCount - next;
+  if (removed > 0) {
+    mesh.computeBounds();
+  }
+  return removed;
+}
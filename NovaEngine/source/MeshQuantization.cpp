@@ -0,0 +1,543 @@
+#include "MeshQuantization.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#if (defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)) && !defined(_XM_NO_INTRINSICS_)
+#define NOVA_QUANTIZE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+static_assert(sizeof(SimpleVertex) == 32, "The vertex encoder loads SimpleVertex as two 16-byte halves");
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+namespace {
+  /*
+    Vertices per task of the bounds and error passes; fixed so the reductions
+    do not depend on the thread count.
+  */
+  const size_t kChunkVertices = 1 << 15;
+
+  /*
+    Per-axis constants the encoder applies: q = (value - bias) * scale.
+  */
+  struct EncodeParams {
+    float positionBias[3];
+    float positionScale[3];
+    float texcoordBias[2];
+    float texcoordScale[2];
+    bool halfPositions;
+  };
+
+  inline unsigned int
+  floatBits(float value) {
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+  }
+
+  inline float
+  bitsFloat(unsigned int bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  /*
+    Float to half with rounding to nearest; values past the half range clamp
+    to the largest finite half. Scalar twin of floatToHalf4 below, bit for bit.
+  */
+  inline unsigned int
+  floatToHalf(float value) {
+    unsigned int bits = floatBits(value);
+    unsigned int sign = bits & 0x80000000u;
+    bits ^= sign;
+    unsigned int half;
+    if (bits >= 0x7F800000u) {
+      half = bits > 0x7F800000u ? 0x7E00u : 0x7C00u;
+    }
+    else {
+      float scaled = bitsFloat(bits & ~0xFFFu) * bitsFloat(15u << 23);
+      // 0x7BFF once rounded: the largest finite half, reached from 65520 upwards.
+      scaled = std::min(scaled, bitsFloat((30u << 23) | 0x7FE000u));
+      half = (floatBits(scaled) + 0x1000u) >> 13;
+    }
+    return half | (sign >> 16);
+  }
+
+  inline float
+  halfToFloat(unsigned int half) {
+    unsigned int sign = (half & 0x8000u) << 16;
+    unsigned int exponent = (half >> 10) & 0x1Fu;
+    unsigned int mantissa = half & 0x3FFu;
+    if (exponent == 0) {
+      return bitsFloat(sign) + (sign ? -1.0f : 1.0f) * static_cast<float>(mantissa) * (1.0f / 16777216.0f);
+    }
+    if (exponent == 31) {
+      return bitsFloat(sign | 0x7F800000u | (mantissa << 13));
+    }
+    return bitsFloat(sign | ((exponent + 112) << 23) | (mantissa << 13));
+  }
+
+  /*
+    Rounds a value in [0, 65535] (after clamping) to UNORM16.
+  */
+  inline unsigned int
+  toUnorm16(float value) {
+    value = std::min(std::max(value, 0.0f), 65535.0f);
+    return static_cast<unsigned int>(static_cast<int>(value + 0.5f));
+  }
+
+  /*
+    Rounds a value in [-1, 1] (after clamping) to SNORM16, as a 16-bit pattern.
+  */
+  inline unsigned int
+  toSnorm16(float value) {
+    value = std::min(std::max(value, -1.0f), 1.0f) * 32767.0f;
+    return static_cast<unsigned int>(static_cast<int>(value + (value < 0.0f ? -0.5f : 0.5f))) & 0xFFFFu;
+  }
+
+  /*
+    Octahedral projection of a normal: the unit octahedron is unfolded onto
+    the square [-1, 1]^2, folding the lower half over the diagonals.
+  */
+  inline void
+  octahedralEncode(float x, float y, float z, float& u, float& v) {
+    float sum = std::fabs(x) + std::fabs(y) + std::fabs(z);
+    float inv = sum > 0.0f ? 1.0f / std::max(sum, 1e-30f) : 0.0f;
+    u = x * inv;
+    v = y * inv;
+    if (z < 0.0f) {
+      float foldedU = bitsFloat(floatBits(1.0f - std::fabs(v)) | (floatBits(u) & 0x80000000u));
+      float foldedV = bitsFloat(floatBits(1.0f - std::fabs(u)) | (floatBits(v) & 0x80000000u));
+      u = foldedU;
+      v = foldedV;
+    }
+  }
+
+  /*
+    Encodes one vertex; used for the tail of every block and when SSE2 is not
+    available.
+  */
+  void
+  encodeVertex(const SimpleVertex& source, const EncodeParams& params, PackedVertex& packed) {
+    const float position[3] = { source.Pos.x, source.Pos.y, source.Pos.z };
+    for (size_t axis = 0; axis < 3; ++axis) {
+      float value = (position[axis] - params.positionBias[axis]) * params.positionScale[axis];
+      packed.Pos[axis] = static_cast<unsigned short>(params.halfPositions ? floatToHalf(value) : toUnorm16(value));
+    }
+    packed.Pos[3] = static_cast<unsigned short>(params.halfPositions ? 0x3C00u : 0xFFFFu);
+
+    float u, v;
+    octahedralEncode(source.Normal.x, source.Normal.y, source.Normal.z, u, v);
+    packed.Normal[0] = static_cast<short>(toSnorm16(u));
+    packed.Normal[1] = static_cast<short>(toSnorm16(v));
+
+    packed.Tex[0] = static_cast<unsigned short>(toUnorm16((source.Tex.x - params.texcoordBias[0]) * params.texcoordScale[0]));
+    packed.Tex[1] = static_cast<unsigned short>(toUnorm16((source.Tex.y - params.texcoordBias[1]) * params.texcoordScale[1]));
+  }
+
+#if NOVA_QUANTIZE_SSE2
+  inline __m128
+  absolute4(__m128 value) {
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), value);
+  }
+
+  inline __m128
+  clamp4(__m128 value, __m128 low, __m128 high) {
+    return _mm_min_ps(_mm_max_ps(value, low), high);
+  }
+
+  inline __m128i
+  toUnorm16x4(__m128 value) {
+    value = clamp4(value, _mm_setzero_ps(), _mm_set1_ps(65535.0f));
+    return _mm_cvttps_epi32(_mm_add_ps(value, _mm_set1_ps(0.5f)));
+  }
+
+  inline __m128i
+  toSnorm16x4(__m128 value) {
+    value = _mm_mul_ps(clamp4(value, _mm_set1_ps(-1.0f), _mm_set1_ps(1.0f)), _mm_set1_ps(32767.0f));
+    __m128 half = _mm_or_ps(_mm_set1_ps(0.5f), _mm_and_ps(value, _mm_set1_ps(-0.0f)));
+    return _mm_and_si128(_mm_cvttps_epi32(_mm_add_ps(value, half)), _mm_set1_epi32(0xFFFF));
+  }
+
+  /*
+    floatToHalf on four lanes: the magic multiply rebiases the exponent and
+    shifts half denormals into place, adding 0x1000 rounds.
+  */
+  inline __m128i
+  floatToHalf4(__m128 value) {
+    __m128 sign = _mm_and_ps(value, _mm_set1_ps(-0.0f));
+    __m128i absolute = _mm_castps_si128(_mm_xor_ps(value, sign));
+    __m128i infinity = _mm_set1_epi32(0x7F800000);
+    __m128i isNan = _mm_cmpgt_epi32(absolute, infinity);
+    __m128i isFinite = _mm_cmpgt_epi32(infinity, absolute);
+    __m128i special = _mm_or_si128(_mm_and_si128(isNan, _mm_set1_epi32(0x200)), _mm_set1_epi32(0x7C00));
+
+    __m128 truncated = _mm_castsi128_ps(_mm_and_si128(absolute, _mm_set1_epi32(~0xFFF)));
+    __m128 scaled = _mm_mul_ps(truncated, _mm_castsi128_ps(_mm_set1_epi32(15 << 23)));
+    scaled = _mm_min_ps(scaled, _mm_castsi128_ps(_mm_set1_epi32((30 << 23) | 0x7FE000)));
+    __m128i finite = _mm_srli_epi32(_mm_add_epi32(_mm_castps_si128(scaled), _mm_set1_epi32(0x1000)), 13);
+
+    __m128i half = _mm_or_si128(_mm_and_si128(isFinite, finite), _mm_andnot_si128(isFinite, special));
+    return _mm_or_si128(half, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+  }
+
+  /*
+    Encodes 4 * groups vertices: each group of four is
+    loaded and transposed so every lane holds one vertex, encoded lane-wise
+    and transposed back into four PackedVertex.
+  */
+  void
+  encodeVertices4(const SimpleVertex* source, const EncodeParams& params, PackedVertex* packed, size_t groups) {
+    const __m128 positionBias[3] = { _mm_set1_ps(params.positionBias[0]),
+                                     _mm_set1_ps(params.positionBias[1]),
+                                     _mm_set1_ps(params.positionBias[2]) };
+    const __m128 positionScale[3] = { _mm_set1_ps(params.positionScale[0]),
+                                      _mm_set1_ps(params.positionScale[1]),
+                                      _mm_set1_ps(params.positionScale[2]) };
+    const __m128 texcoordBias[2] = { _mm_set1_ps(params.texcoordBias[0]), _mm_set1_ps(params.texcoordBias[1]) };
+    const __m128 texcoordScale[2] = { _mm_set1_ps(params.texcoordScale[0]), _mm_set1_ps(params.texcoordScale[1]) };
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128i positionW = _mm_set1_epi32(params.halfPositions ? 0x3C000000 : static_cast<int>(0xFFFF0000u));
+
+    for (size_t group = 0; group < groups; ++group, source += 4, packed += 4) {
+      // Pos.x, Pos.y, Pos.z, Tex.x and Tex.y, Normal.x, Normal.y, Normal.z of each vertex.
+      __m128 px = _mm_loadu_ps(&source[0].Pos.x);
+      __m128 py = _mm_loadu_ps(&source[1].Pos.x);
+      __m128 pz = _mm_loadu_ps(&source[2].Pos.x);
+      __m128 tu = _mm_loadu_ps(&source[3].Pos.x);
+      __m128 tv = _mm_loadu_ps(&source[0].Tex.y);
+      __m128 nx = _mm_loadu_ps(&source[1].Tex.y);
+      __m128 ny = _mm_loadu_ps(&source[2].Tex.y);
+      __m128 nz = _mm_loadu_ps(&source[3].Tex.y);
+      _MM_TRANSPOSE4_PS(px, py, pz, tu);
+      _MM_TRANSPOSE4_PS(tv, nx, ny, nz);
+
+      __m128 position[3] = { px, py, pz };
+      __m128i quantized[3];
+      for (size_t axis = 0; axis < 3; ++axis) {
+        __m128 value = _mm_mul_ps(_mm_sub_ps(position[axis], positionBias[axis]), positionScale[axis]);
+        quantized[axis] = params.halfPositions ? floatToHalf4(value) : toUnorm16x4(value);
+      }
+
+      __m128 sum = _mm_add_ps(_mm_add_ps(absolute4(nx), absolute4(ny)), absolute4(nz));
+      __m128 valid = _mm_cmpgt_ps(sum, _mm_setzero_ps());
+      __m128 inv = _mm_and_ps(valid, _mm_div_ps(one, _mm_max_ps(sum, _mm_set1_ps(1e-30f))));
+      __m128 u = _mm_mul_ps(nx, inv);
+      __m128 v = _mm_mul_ps(ny, inv);
+      __m128 lower = _mm_cmplt_ps(nz, _mm_setzero_ps());
+      __m128 foldedU = _mm_or_ps(_mm_sub_ps(one, absolute4(v)), _mm_and_ps(u, signMask));
+      __m128 foldedV = _mm_or_ps(_mm_sub_ps(one, absolute4(u)), _mm_and_ps(v, signMask));
+      u = _mm_or_ps(_mm_and_ps(lower, foldedU), _mm_andnot_ps(lower, u));
+      v = _mm_or_ps(_mm_and_ps(lower, foldedV), _mm_andnot_ps(lower, v));
+
+      __m128i texU = toUnorm16x4(_mm_mul_ps(_mm_sub_ps(tu, texcoordBias[0]), texcoordScale[0]));
+      __m128i texV = toUnorm16x4(_mm_mul_ps(_mm_sub_ps(tv, texcoordBias[1]), texcoordScale[1]));
+
+      // One 32-bit word per pair of 16-bit fields, then back to one vertex per register.
+      __m128 word0 = _mm_castsi128_ps(_mm_or_si128(quantized[0], _mm_slli_epi32(quantized[1], 16)));
+      __m128 word1 = _mm_castsi128_ps(_mm_or_si128(quantized[2], positionW));
+      __m128 word2 = _mm_castsi128_ps(_mm_or_si128(toSnorm16x4(u), _mm_slli_epi32(toSnorm16x4(v), 16)));
+      __m128 word3 = _mm_castsi128_ps(_mm_or_si128(texU, _mm_slli_epi32(texV, 16)));
+      _MM_TRANSPOSE4_PS(word0, word1, word2, word3);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(packed + 0), _mm_castps_si128(word0));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(packed + 1), _mm_castps_si128(word1));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(packed + 2), _mm_castps_si128(word2));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(packed + 3), _mm_castps_si128(word3));
+    }
+  }
+#endif
+
+  /*
+    Bounds of the positions (xyz) and texture coordinates (uv) of a vertex range.
+  */
+  struct VertexBounds {
+    float minimum[5];
+    float maximum[5];
+  };
+
+  VertexBounds
+  rangeBounds(const SimpleVertex* vertices, size_t count) {
+    VertexBounds bounds;
+    for (size_t k = 0; k < 5; ++k) {
+      bounds.minimum[k] = FLT_MAX;
+      bounds.maximum[k] = -FLT_MAX;
+    }
+    size_t i = 0;
+#if NOVA_QUANTIZE_SSE2
+    __m128 low = _mm_set1_ps(FLT_MAX);
+    __m128 high = _mm_set1_ps(-FLT_MAX);
+    __m128 lowV = low;
+    __m128 highV = high;
+    for (; i < count; ++i) {
+      __m128 front = _mm_loadu_ps(&vertices[i].Pos.x);
+      __m128 texV = _mm_load_ss(&vertices[i].Tex.y);
+      low = _mm_min_ps(low, front);
+      high = _mm_max_ps(high, front);
+      lowV = _mm_min_ss(lowV, texV);
+      highV = _mm_max_ss(highV, texV);
+    }
+    _mm_storeu_ps(bounds.minimum, low);
+    _mm_storeu_ps(bounds.maximum, high);
+    _mm_store_ss(&bounds.minimum[4], lowV);
+    _mm_store_ss(&bounds.maximum[4], highV);
+#endif
+    for (; i < count; ++i) {
+      const float values[5] = { vertices[i].Pos.x, vertices[i].Pos.y, vertices[i].Pos.z,
+                                vertices[i].Tex.x, vertices[i].Tex.y };
+      for (size_t k = 0; k < 5; ++k) {
+        bounds.minimum[k] = std::min(bounds.minimum[k], values[k]);
+        bounds.maximum[k] = std::max(bounds.maximum[k], values[k]);
+      }
+    }
+    return bounds;
+  }
+
+  /*
+    Error sums of a vertex range, merged in chunk order.
+  */
+  struct ErrorSums {
+    double positionSquared = 0.0;
+    double normalAngle = 0.0;
+    size_t normals = 0;
+    float maxPosition = 0.0f;
+    float maxNormal = 0.0f;
+    float maxTexcoord = 0.0f;
+  };
+}
+
+unsigned int
+vertexStride(VertexFormat format) {
+  return format == VERTEX_FORMAT_FLOAT ? static_cast<unsigned int>(sizeof(SimpleVertex))
+                                       : static_cast<unsigned int>(sizeof(PackedVertex));
+}
+
+std::vector<D3D11_INPUT_ELEMENT_DESC>
+vertexInputLayout(VertexFormat format, VertexStreams streams) {
+  std::vector<D3D11_INPUT_ELEMENT_DESC> layout;
+  if (format != VERTEX_FORMAT_FLOAT && streams != VERTEX_STREAMS_INTERLEAVED) {
+    return layout;
+  }
+
+  DXGI_FORMAT positionFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+  DXGI_FORMAT texcoordFormat = DXGI_FORMAT_R32G32_FLOAT;
+  DXGI_FORMAT normalFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+  unsigned int attributeSlot = 0;
+  unsigned int texcoordOffset = 12;
+  unsigned int normalOffset = 20;
+  if (streams != VERTEX_STREAMS_INTERLEAVED) {
+    attributeSlot = 1;
+    texcoordOffset = static_cast<unsigned int>(offsetof(VertexAttributes, Tex));
+    normalOffset = static_cast<unsigned int>(offsetof(VertexAttributes, Normal));
+  }
+  if (format != VERTEX_FORMAT_FLOAT) {
+    positionFormat = format == VERTEX_FORMAT_HALF ? DXGI_FORMAT_R16G16B16A16_FLOAT : DXGI_FORMAT_R16G16B16A16_UNORM;
+    texcoordFormat = DXGI_FORMAT_R16G16_UNORM;
+    normalFormat = DXGI_FORMAT_R16G16_SNORM;
+    texcoordOffset = static_cast<unsigned int>(offsetof(PackedVertex, Tex));
+    normalOffset = static_cast<unsigned int>(offsetof(PackedVertex, Normal));
+  }
+
+  D3D11_INPUT_ELEMENT_DESC position;
+  position.SemanticName = "POSITION";
+  position.SemanticIndex = 0;
+  position.Format = positionFormat;
+  position.InputSlot = 0;
+  position.AlignedByteOffset = 0;
+  position.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+  position.InstanceDataStepRate = 0;
+  layout.push_back(position);
+  if (streams == VERTEX_STREAMS_POSITION) {
+    return layout;
+  }
+
+  D3D11_INPUT_ELEMENT_DESC texcoord = position;
+  texcoord.SemanticName = "TEXCOORD";
+  texcoord.Format = texcoordFormat;
+  texcoord.InputSlot = attributeSlot;
+  texcoord.AlignedByteOffset = texcoordOffset;
+  layout.push_back(texcoord);
+
+  D3D11_INPUT_ELEMENT_DESC normal = position;
+  normal.SemanticName = "NORMAL";
+  normal.Format = normalFormat;
+  normal.InputSlot = attributeSlot;
+  normal.AlignedByteOffset = normalOffset;
+  layout.push_back(normal);
+  return layout;
+}
+
+void
+quantizeVertices(const MeshComponent& mesh,
+                 VertexFormat format,
+                 std::vector<PackedVertex>& outVertices,
+                 CBVertexDequantization& outConstants,
+                 VertexQuantizationStats* outStats,
+                 unsigned int threadCount) {
+  const size_t vertexCount = mesh.m_vertex.size();
+  const SimpleVertex* vertices = mesh.m_vertex.data();
+  threadCount = resolveThreadCount(threadCount);
+  outVertices.clear();
+  outConstants.vPositionScale = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+  outConstants.vPositionOffset = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+  outConstants.vTexcoordScaleOffset = XMFLOAT4(1.0f, 1.0f, 0.0f, 0.0f);
+  if (outStats) {
+    *outStats = VertexQuantizationStats();
+    outStats->sourceBytes = vertexCount * sizeof(SimpleVertex);
+    outStats->packedBytes = outStats->sourceBytes;
+  }
+  if (format == VERTEX_FORMAT_FLOAT || vertexCount == 0) {
+    return;
+  }
+
+  // Bounds of positions and texture coordinates.
+  const size_t chunkCount = (vertexCount + kChunkVertices - 1) / kChunkVertices;
+  std::vector<VertexBounds> chunkBounds(chunkCount);
+  parallelFor(chunkCount, threadCount, [&](size_t chunk) {
+    size_t first = chunk * kChunkVertices;
+    chunkBounds[chunk] = rangeBounds(vertices + first, std::min(kChunkVertices, vertexCount - first));
+  });
+  VertexBounds bounds = chunkBounds[0];
+  for (const VertexBounds& chunk : chunkBounds) {
+    for (size_t k = 0; k < 5; ++k) {
+      bounds.minimum[k] = std::min(bounds.minimum[k], chunk.minimum[k]);
+      bounds.maximum[k] = std::max(bounds.maximum[k], chunk.maximum[k]);
+    }
+  }
+
+  // UNORM16 maps [min, max] to [0, 65535]; half maps it to [-1, 1] so large meshes cannot overflow.
+  EncodeParams params;
+  params.halfPositions = format == VERTEX_FORMAT_HALF;
+  float scale[3];
+  float offset[3];
+  for (size_t axis = 0; axis < 3; ++axis) {
+    float extent = bounds.maximum[axis] - bounds.minimum[axis];
+    if (params.halfPositions) {
+      scale[axis] = extent * 0.5f;
+      offset[axis] = bounds.minimum[axis] + scale[axis];
+      params.positionBias[axis] = offset[axis];
+      params.positionScale[axis] = scale[axis] > 0.0f ? 1.0f / scale[axis] : 0.0f;
+    }
+    else {
+      scale[axis] = extent;
+      offset[axis] = bounds.minimum[axis];
+      params.positionBias[axis] = offset[axis];
+      params.positionScale[axis] = extent > 0.0f ? 65535.0f / extent : 0.0f;
+    }
+  }
+  for (size_t axis = 0; axis < 2; ++axis) {
+    float extent = bounds.maximum[3 + axis] - bounds.minimum[3 + axis];
+    params.texcoordBias[axis] = bounds.minimum[3 + axis];
+    params.texcoordScale[axis] = extent > 0.0f ? 65535.0f / extent : 0.0f;
+  }
+  outConstants.vTexcoordScaleOffset = XMFLOAT4(bounds.maximum[3] - bounds.minimum[3],
+                                               bounds.maximum[4] - bounds.minimum[4],
+                                               bounds.minimum[3],
+                                               bounds.minimum[4]);
+  // w decodes to 1 whatever Pos.w holds.
+  outConstants.vPositionScale = XMFLOAT4(scale[0], scale[1], scale[2], 0.0f);
+  outConstants.vPositionOffset = XMFLOAT4(offset[0], offset[1], offset[2], 1.0f);
+
+  outVertices.resize(vertexCount);
+  PackedVertex* packed = outVertices.data();
+  parallelForRange(vertexCount, threadCount, 1 << 14, [&](size_t first, size_t last) {
+    size_t i = first;
+#if NOVA_QUANTIZE_SSE2
+    size_t groups = (last - first) / 4;
+    encodeVertices4(vertices + first, params, packed + first, groups);
+    i += groups * 4;
+#endif
+    for (; i < last; ++i) {
+      encodeVertex(vertices[i], params, packed[i]);
+    }
+  });
+
+  if (!outStats) {
+    return;
+  }
+
+  // Error, measured on the decoded vertices.
+  outStats->packedBytes = vertexCount * sizeof(PackedVertex);
+  std::vector<ErrorSums> chunkErrors(chunkCount);
+  parallelFor(chunkCount, threadCount, [&](size_t chunk) {
+    ErrorSums& sums = chunkErrors[chunk];
+    size_t last = std::min(vertexCount, (chunk + 1) * kChunkVertices);
+    for (size_t i = chunk * kChunkVertices; i < last; ++i) {
+      const SimpleVertex& source = vertices[i];
+      SimpleVertex decoded = dequantizeVertex(packed[i], outConstants, format);
+
+      float dx = decoded.Pos.x - source.Pos.x;
+      float dy = decoded.Pos.y - source.Pos.y;
+      float dz = decoded.Pos.z - source.Pos.z;
+      float positionSquared = dx * dx + dy * dy + dz * dz;
+      sums.positionSquared += positionSquared;
+      sums.maxPosition = std::max(sums.maxPosition, std::sqrt(positionSquared));
+
+      sums.maxTexcoord = std::max(sums.maxTexcoord, std::fabs(decoded.Tex.x - source.Tex.x));
+      sums.maxTexcoord = std::max(sums.maxTexcoord, std::fabs(decoded.Tex.y - source.Tex.y));
+
+      float length = std::sqrt(source.Normal.x * source.Normal.x +
+                               source.Normal.y * source.Normal.y +
+                               source.Normal.z * source.Normal.z);
+      if (length > 0.0f) {
+        float cosine = (decoded.Normal.x * source.Normal.x +
+                        decoded.Normal.y * source.Normal.y +
+                        decoded.Normal.z * source.Normal.z) / length;
+        float angle = std::acos(std::min(std::max(cosine, -1.0f), 1.0f)) * (180.0f / XM_PI);
+        sums.normalAngle += angle;
+        sums.maxNormal = std::max(sums.maxNormal, angle);
+        ++sums.normals;
+      }
+    }
+  });
+
+  ErrorSums total;
+  for (const ErrorSums& sums : chunkErrors) {
+    total.positionSquared += sums.positionSquared;
+    total.normalAngle += sums.normalAngle;
+    total.normals += sums.normals;
+    total.maxPosition = std::max(total.maxPosition, sums.maxPosition);
+    total.maxNormal = std::max(total.maxNormal, sums.maxNormal);
+    total.maxTexcoord = std::max(total.maxTexcoord, sums.maxTexcoord);
+  }
+  outStats->maxPositionError = total.maxPosition;
+  outStats->rmsPositionError = static_cast<float>(std::sqrt(total.positionSquared / vertexCount));
+  outStats->maxNormalError = total.maxNormal;
+  outStats->meanNormalError = total.normals ? static_cast<float>(total.normalAngle / total.normals) : 0.0f;
+  outStats->maxTexcoordError = total.maxTexcoord;
+}
+
+SimpleVertex
+dequantizeVertex(const PackedVertex& vertex, const CBVertexDequantization& constants, VertexFormat format) {
+  SimpleVertex decoded;
+  float position[3];
+  for (size_t axis = 0; axis < 3; ++axis) {
+    position[axis] = format == VERTEX_FORMAT_HALF ? halfToFloat(vertex.Pos[axis])
+                                                  : vertex.Pos[axis] * (1.0f / 65535.0f);
+  }
+  decoded.Pos.x = position[0] * constants.vPositionScale.x + constants.vPositionOffset.x;
+  decoded.Pos.y = position[1] * constants.vPositionScale.y + constants.vPositionOffset.y;
+  decoded.Pos.z = position[2] * constants.vPositionScale.z + constants.vPositionOffset.z;
+
+  decoded.Tex.x = vertex.Tex[0] * (1.0f / 65535.0f) * constants.vTexcoordScaleOffset.x + constants.vTexcoordScaleOffset.z;
+  decoded.Tex.y = vertex.Tex[1] * (1.0f / 65535.0f) * constants.vTexcoordScaleOffset.y + constants.vTexcoordScaleOffset.w;
+
+  // SNORM16 maps -32768 and -32767 both to -1.
+  float x = std::max(vertex.Normal[0] * (1.0f / 32767.0f), -1.0f);
+  float y = std::max(vertex.Normal[1] * (1.0f / 32767.0f), -1.0f);
+  float z = 1.0f - std::fabs(x) - std::fabs(y);
+  if (z < 0.0f) {
+    float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+    float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    x = foldedX;
+    y = foldedY;
+  }
+  float length = std::sqrt(x * x + y * y + z * z);
+  decoded.Normal = XMFLOAT3(x / length, y / length, z / length);
+  return decoded;
+}
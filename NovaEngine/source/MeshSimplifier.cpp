@@ -0,0 +1,721 @@
+#include "MeshSimplifier.h"
+#include "MeshAdjacency.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace {
+  const unsigned int kNone = 0xFFFFFFFFu;
+
+  // How a vertex may move. Border vertices have open edges, seam vertices
+  // are one of exactly two vertices at a position with an attribute seam
+  // between them, and locked vertices never move.
+  const unsigned char kKindManifold = 0;
+  const unsigned char kKindBorder = 1;
+  const unsigned char kKindSeam = 2;
+  const unsigned char kKindLocked = 3;
+
+  // kCanCollapse[a][b]: a vertex of kind a may move onto a vertex of kind b.
+  const unsigned char kCanCollapse[4][4] = {
+    { 1, 1, 1, 1 },
+    { 0, 1, 0, 0 },
+    { 0, 0, 1, 0 },
+    { 0, 0, 0, 0 },
+  };
+
+  // kHasOpposite[a][b]: an edge between kinds a and b is used by two
+  // triangles, once in each direction.
+  const unsigned char kHasOpposite[4][4] = {
+    { 1, 1, 1, 1 },
+    { 1, 0, 1, 0 },
+    { 1, 1, 1, 1 },
+    { 1, 0, 1, 0 },
+  };
+
+  // Weight of the planes that hold open edges in place, relative to face planes.
+  const float kBorderWeight = 2.0f;
+
+  /*
+    Symmetric 4x4 error quadric of a set of weighted planes; w is the total weight.
+    Double precision: on dense meshes the error is far below float resolution
+    of the plane offsets, and every collapse would cost zero.
+  */
+  struct Quadric {
+    double a00 = 0.0, a11 = 0.0, a22 = 0.0;
+    double a10 = 0.0, a20 = 0.0, a21 = 0.0;
+    double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+    double c = 0.0;
+    double w = 0.0;
+  };
+
+  inline void
+  addQuadric(Quadric& q, const Quadric& r) {
+    q.a00 += r.a00; q.a11 += r.a11; q.a22 += r.a22;
+    q.a10 += r.a10; q.a20 += r.a20; q.a21 += r.a21;
+    q.b0 += r.b0; q.b1 += r.b1; q.b2 += r.b2;
+    q.c += r.c;
+    q.w += r.w;
+  }
+
+  /*
+    Adds the plane n.p + d = 0 (n of unit length) with weight w.
+  */
+  inline void
+  addPlane(Quadric& q, const XMFLOAT3& n, float d, float w) {
+    const double x = n.x, y = n.y, z = n.z;
+    q.a00 += x * x * w; q.a11 += y * y * w; q.a22 += z * z * w;
+    q.a10 += y * x * w; q.a20 += z * x * w; q.a21 += z * y * w;
+    q.b0 += x * d * w; q.b1 += y * d * w; q.b2 += z * d * w;
+    q.c += static_cast<double>(d) * d * w;
+    q.w += w;
+  }
+
+  /*
+    Weighted mean squared distance from p to the planes of q.
+  */
+  inline float
+  quadricError(const Quadric& q, const XMFLOAT3& position) {
+    const double x = position.x, y = position.y, z = position.z;
+    double rx = q.a00 * x + q.a10 * y + q.a20 * z;
+    double ry = q.a10 * x + q.a11 * y + q.a21 * z;
+    double rz = q.a20 * x + q.a21 * y + q.a22 * z;
+    double r = rx * x + ry * y + rz * z + 2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+    return (q.w > 0.0) ? static_cast<float>(std::fabs(r) / q.w) : 0.0f;
+  }
+
+  inline XMFLOAT3
+  subtract(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+  }
+
+  inline XMFLOAT3
+  cross(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+  }
+
+  inline float
+  dot(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+  }
+
+  /*
+    A candidate collapse of vertex `from` onto vertex `to`.
+  */
+  struct Collapse {
+    unsigned int from = 0;
+    unsigned int to = 0;
+    float error = 0.0f;
+  };
+
+  /*
+    Orders the collapses by error with a stable three-pass radix sort of the
+    float bits, which sort like integers for errors >= 0.
+  */
+  void
+  sortCollapses(const std::vector<Collapse>& collapses,
+                std::vector<unsigned int>& order,
+                std::vector<unsigned int>& scratch) {
+    const size_t count = collapses.size();
+    order.resize(count);
+    scratch.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+      order[i] = static_cast<unsigned int>(i);
+    }
+    for (unsigned int shift = 0; shift < 33; shift += 11) {
+      unsigned int histogram[2048] = {};
+      for (size_t i = 0; i < count; ++i) {
+        unsigned int key;
+        memcpy(&key, &collapses[i].error, sizeof(key));
+        ++histogram[(key >> shift) & 2047];
+      }
+      unsigned int sum = 0;
+      for (unsigned int& bucket : histogram) {
+        unsigned int value = bucket;
+        bucket = sum;
+        sum += value;
+      }
+      for (size_t i = 0; i < count; ++i) {
+        unsigned int key;
+        memcpy(&key, &collapses[order[i]].error, sizeof(key));
+        scratch[histogram[(key >> shift) & 2047]++] = order[i];
+      }
+      order.swap(scratch);
+    }
+  }
+
+  /*
+    Everything about the full-detail triangles that does not change while
+    one level is simplified, so several levels can share it.
+  */
+  class
+    SimplifyContext {
+  public:
+    void
+      init(const unsigned int* indices,
+           size_t indexCount,
+           const unsigned int* groups,
+           const SimpleVertex* vertices,
+           size_t vertexCount,
+           unsigned int threadCount);
+
+    void
+      simplify(size_t targetIndexCount,
+               float targetError,
+               std::vector<unsigned int>& outIndices,
+               std::vector<unsigned int>& outGroups,
+               float& outError) const;
+
+  private:
+    bool
+      hasTriangleFlip(unsigned int from,
+                      unsigned int to,
+                      const std::vector<unsigned int>& indices,
+                      const std::vector<unsigned int>& adjacencyStart,
+                      const std::vector<unsigned int>& adjacency,
+                      const std::vector<unsigned int>& collapseRemap) const;
+
+    float
+      collapseError(const std::vector<Quadric>& quadrics, unsigned int from, unsigned int to) const {
+      Quadric q = quadrics[m_remap[from]];
+      addQuadric(q, quadrics[m_remap[to]]);
+      return quadricError(q, m_positions[to]);
+    }
+
+    size_t m_vertexCount = 0;
+    std::vector<unsigned int> m_indices;
+    std::vector<unsigned int> m_groups;
+    std::vector<XMFLOAT3> m_positions;   // Scaled so the largest side of the bounds is 1
+    std::vector<unsigned int> m_remap;   // First vertex with the same position
+    std::vector<unsigned int> m_wedge;   // Next vertex with the same position (a cycle)
+    std::vector<unsigned int> m_loop;    // Target of the open edge leaving the vertex
+    std::vector<unsigned int> m_loopBack; // Source of the open edge entering the vertex
+    std::vector<unsigned char> m_kind;
+    std::vector<Quadric> m_quadrics;     // Indexed by m_remap
+  };
+
+  void
+  SimplifyContext::init(const unsigned int* indices,
+                        size_t indexCount,
+                        const unsigned int* groups,
+                        const SimpleVertex* vertices,
+                        size_t vertexCount,
+                        unsigned int threadCount) {
+    const size_t triangleCount = indexCount / 3;
+    m_vertexCount = vertexCount;
+    m_indices.assign(indices, indices + triangleCount * 3);
+    if (groups) {
+      m_groups.assign(groups, groups + triangleCount);
+    }
+    else {
+      m_groups.assign(triangleCount, 0);
+    }
+
+    std::vector<unsigned char> used(vertexCount, 0);
+    for (unsigned int index : m_indices) {
+      used[index] = 1;
+    }
+
+    // Positions scaled into the unit cube, so errors are relative to the mesh size.
+    XMFLOAT3 minimum(FLT_MAX, FLT_MAX, FLT_MAX);
+    XMFLOAT3 maximum(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (size_t v = 0; v < vertexCount; ++v) {
+      if (used[v]) {
+        const XMFLOAT3& p = vertices[v].Pos;
+        minimum = XMFLOAT3(std::min(minimum.x, p.x), std::min(minimum.y, p.y), std::min(minimum.z, p.z));
+        maximum = XMFLOAT3(std::max(maximum.x, p.x), std::max(maximum.y, p.y), std::max(maximum.z, p.z));
+      }
+    }
+    float extent = std::max(maximum.x - minimum.x, std::max(maximum.y - minimum.y, maximum.z - minimum.z));
+    float scale = (extent > 0.0f) ? 1.0f / extent : 0.0f;
+    m_positions.resize(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+      const XMFLOAT3& p = vertices[v].Pos;
+      m_positions[v] = used[v] ? XMFLOAT3((p.x - minimum.x) * scale, (p.y - minimum.y) * scale, (p.z - minimum.z) * scale)
+                               : XMFLOAT3(0.0f, 0.0f, 0.0f);
+    }
+
+    // Vertices at the same position: remap points at the first one and wedge
+    // links them in a cycle. Positions compare by value, so -0 matches +0.
+    m_remap.resize(vertexCount);
+    m_wedge.resize(vertexCount);
+    {
+      size_t capacity = 16;
+      while (capacity < vertexCount * 2) {
+        capacity <<= 1;
+      }
+      std::vector<unsigned int> table(capacity, kNone);
+      for (size_t v = 0; v < vertexCount; ++v) {
+        m_remap[v] = static_cast<unsigned int>(v);
+        m_wedge[v] = static_cast<unsigned int>(v);
+        if (!used[v]) {
+          continue;
+        }
+        const XMFLOAT3& p = vertices[v].Pos;
+        float key[3] = { p.x + 0.0f, p.y + 0.0f, p.z + 0.0f };
+        unsigned int bits[3];
+        memcpy(bits, key, sizeof(bits));
+        size_t slot = ((bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u)) & (capacity - 1);
+        while (table[slot] != kNone) {
+          const XMFLOAT3& q = vertices[table[slot]].Pos;
+          if (q.x == p.x && q.y == p.y && q.z == p.z) {
+            break;
+          }
+          slot = (slot + 1) & (capacity - 1);
+        }
+        if (table[slot] == kNone) {
+          table[slot] = static_cast<unsigned int>(v);
+        }
+        else {
+          unsigned int first = table[slot];
+          m_remap[v] = first;
+          m_wedge[v] = m_wedge[first];
+          m_wedge[first] = static_cast<unsigned int>(v);
+        }
+      }
+    }
+
+    // Half-edges between vertices rather than positions, so attribute seams
+    // show up as open edges.
+    MeshAdjacency adjacency;
+    buildAdjacency(adjacency, m_indices.data(), m_indices.size(), vertexCount, threadCount);
+
+    // The single open edge entering and leaving every vertex; a vertex with
+    // several records itself instead.
+    std::vector<unsigned int> openIn(vertexCount, kNone);
+    std::vector<unsigned int> openOut(vertexCount, kNone);
+    for (unsigned int h = 0; h < m_indices.size(); ++h) {
+      if (adjacency.edge[h] == kNoHalfEdge || halfEdgeHasOpposite(adjacency, h)) {
+        continue;
+      }
+      unsigned int a = m_indices[h];
+      unsigned int b = m_indices[halfEdgeNext(h)];
+      openIn[b] = (openIn[b] == kNone) ? a : b;
+      openOut[a] = (openOut[a] == kNone) ? b : a;
+    }
+
+    m_kind.assign(vertexCount, kKindLocked);
+    for (unsigned int v = 0; v < vertexCount; ++v) {
+      unsigned int w = m_wedge[v];
+      if (w == v) {
+        if (openIn[v] == kNone && openOut[v] == kNone) {
+          m_kind[v] = kKindManifold;
+        }
+        else if (openIn[v] != kNone && openIn[v] != v && openOut[v] != kNone && openOut[v] != v) {
+          m_kind[v] = kKindBorder;
+        }
+      }
+      else if (m_wedge[w] == v) {
+        // A seam has one open edge in and out of each of the two vertices, and
+        // the edges of one side run opposite to those of the other.
+        bool single = openIn[v] != kNone && openIn[v] != v && openOut[v] != kNone && openOut[v] != v &&
+                      openIn[w] != kNone && openIn[w] != w && openOut[w] != kNone && openOut[w] != w;
+        if (single && m_remap[openIn[v]] == m_remap[openOut[w]] && m_remap[openOut[v]] == m_remap[openIn[w]]) {
+          m_kind[v] = kKindSeam;
+        }
+      }
+    }
+
+    // A position used by triangles of two groups (submeshes) stays where it is,
+    // so the groups keep meeting along the same edges.
+    {
+      std::vector<unsigned int> positionGroup(vertexCount, kNone);
+      std::vector<unsigned char> shared(vertexCount, 0);
+      for (size_t t = 0; t < triangleCount; ++t) {
+        for (size_t k = 0; k < 3; ++k) {
+          unsigned int r = m_remap[m_indices[t * 3 + k]];
+          if (positionGroup[r] == kNone) {
+            positionGroup[r] = m_groups[t];
+          }
+          else if (positionGroup[r] != m_groups[t]) {
+            shared[r] = 1;
+          }
+        }
+      }
+      for (size_t v = 0; v < vertexCount; ++v) {
+        if (shared[m_remap[v]]) {
+          m_kind[v] = kKindLocked;
+        }
+      }
+    }
+
+    m_loop.resize(vertexCount);
+    m_loopBack.resize(vertexCount);
+    for (unsigned int v = 0; v < vertexCount; ++v) {
+      m_loop[v] = (openOut[v] != kNone && openOut[v] != v) ? openOut[v] : kNone;
+      m_loopBack[v] = (openIn[v] != kNone && openIn[v] != v) ? openIn[v] : kNone;
+    }
+
+    // Face planes weighted by area, and planes through open edges at right
+    // angles to their face so borders and seams keep their shape.
+    m_quadrics.assign(vertexCount, Quadric());
+    for (size_t t = 0; t < triangleCount; ++t) {
+      const unsigned int* corner = &m_indices[t * 3];
+      const XMFLOAT3& p0 = m_positions[corner[0]];
+      XMFLOAT3 normal = cross(subtract(m_positions[corner[1]], p0), subtract(m_positions[corner[2]], p0));
+      float length = std::sqrt(dot(normal, normal));
+      if (length == 0.0f) {
+        continue;
+      }
+      normal = XMFLOAT3(normal.x / length, normal.y / length, normal.z / length);
+      Quadric face;
+      addPlane(face, normal, -dot(normal, p0), length * 0.5f);
+      for (size_t k = 0; k < 3; ++k) {
+        addQuadric(m_quadrics[m_remap[corner[k]]], face);
+      }
+
+      for (size_t k = 0; k < 3; ++k) {
+        unsigned int a = corner[k];
+        unsigned int b = corner[(k + 1) % 3];
+        if (a == b || halfEdgeHasOpposite(adjacency, static_cast<unsigned int>(t * 3 + k))) {
+          continue;
+        }
+        XMFLOAT3 edge = subtract(m_positions[b], m_positions[a]);
+        XMFLOAT3 side = cross(edge, normal);
+        float sideLength = std::sqrt(dot(side, side));
+        if (sideLength == 0.0f) {
+          continue;
+        }
+        side = XMFLOAT3(side.x / sideLength, side.y / sideLength, side.z / sideLength);
+        Quadric border;
+        addPlane(border, side, -dot(side, m_positions[a]), dot(edge, edge) * kBorderWeight);
+        addQuadric(m_quadrics[m_remap[a]], border);
+        addQuadric(m_quadrics[m_remap[b]], border);
+      }
+    }
+  }
+
+  bool
+  SimplifyContext::hasTriangleFlip(unsigned int from,
+                                   unsigned int to,
+                                   const std::vector<unsigned int>& indices,
+                                   const std::vector<unsigned int>& adjacencyStart,
+                                   const std::vector<unsigned int>& adjacency,
+                                   const std::vector<unsigned int>& collapseRemap) const {
+    const XMFLOAT3& target = m_positions[to];
+    for (unsigned int a = adjacencyStart[from]; a < adjacencyStart[from + 1]; ++a) {
+      const unsigned int* triangle = &indices[adjacency[a] * 3];
+      // Corners moved earlier in this pass are taken at their new position.
+      unsigned int corner[3] = { collapseRemap[triangle[0]], collapseRemap[triangle[1]], collapseRemap[triangle[2]] };
+      size_t k = (corner[0] == from) ? 0 : (corner[1] == from) ? 1 : 2;
+      unsigned int b = corner[(k + 1) % 3];
+      unsigned int c = corner[(k + 2) % 3];
+      // Triangles on the collapsed edge disappear.
+      if (m_remap[b] == m_remap[to] || m_remap[c] == m_remap[to] || m_remap[b] == m_remap[c]) {
+        continue;
+      }
+      const XMFLOAT3& source = m_positions[from];
+      XMFLOAT3 before = cross(subtract(m_positions[b], source), subtract(m_positions[c], source));
+      XMFLOAT3 after = cross(subtract(m_positions[b], target), subtract(m_positions[c], target));
+      if (dot(before, after) <= 0.0f) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void
+  SimplifyContext::simplify(size_t targetIndexCount,
+                            float targetError,
+                            std::vector<unsigned int>& outIndices,
+                            std::vector<unsigned int>& outGroups,
+                            float& outError) const {
+    std::vector<unsigned int> indices = m_indices;
+    std::vector<unsigned int> groups = m_groups;
+    std::vector<Quadric> quadrics = m_quadrics;
+    const float errorLimit = targetError * targetError;
+    float reached = 0.0f;
+
+    std::vector<unsigned int> adjacencyStart(m_vertexCount + 1);
+    std::vector<unsigned int> adjacency;
+    std::vector<unsigned int> collapseRemap(m_vertexCount);
+    std::vector<unsigned char> locked(m_vertexCount);
+    std::vector<Collapse> collapses;
+    std::vector<unsigned int> order;
+    std::vector<unsigned int> scratch;
+
+    while (indices.size() > targetIndexCount) {
+      const size_t triangleCount = indices.size() / 3;
+
+      // Triangles around every vertex (CSR), for the flip test.
+      std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0);
+      for (unsigned int index : indices) {
+        ++adjacencyStart[index + 1];
+      }
+      for (size_t v = 0; v < m_vertexCount; ++v) {
+        adjacencyStart[v + 1] += adjacencyStart[v];
+      }
+      adjacency.resize(indices.size());
+      {
+        std::vector<unsigned int> cursor(adjacencyStart.begin(), adjacencyStart.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i) {
+          adjacency[cursor[indices[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+      }
+
+      // Candidate collapses, one per edge, in the cheaper allowed direction.
+      collapses.clear();
+      for (size_t t = 0; t < triangleCount; ++t) {
+        for (size_t k = 0; k < 3; ++k) {
+          unsigned int i0 = indices[t * 3 + k];
+          unsigned int i1 = indices[t * 3 + (k + 1) % 3];
+          if (m_remap[i0] == m_remap[i1]) {
+            continue;
+          }
+          unsigned char k0 = m_kind[i0];
+          unsigned char k1 = m_kind[i1];
+          if (!kCanCollapse[k0][k1] && !kCanCollapse[k1][k0]) {
+            continue;
+          }
+          if (kHasOpposite[k0][k1] && m_remap[i1] > m_remap[i0]) {
+            continue;
+          }
+          // Two border or seam vertices joined by an edge that is not on the
+          // border or seam itself.
+          if (k0 == k1 && (k0 == kKindBorder || k0 == kKindSeam) && m_loop[i0] != i1) {
+            continue;
+          }
+          Collapse collapse;
+          if (kCanCollapse[k0][k1] && kCanCollapse[k1][k0]) {
+            float forward = collapseError(quadrics, i0, i1);
+            float backward = collapseError(quadrics, i1, i0);
+            collapse.from = (backward < forward) ? i1 : i0;
+            collapse.to = (backward < forward) ? i0 : i1;
+            collapse.error = std::min(forward, backward);
+          }
+          else {
+            collapse.from = kCanCollapse[k0][k1] ? i0 : i1;
+            collapse.to = kCanCollapse[k0][k1] ? i1 : i0;
+            collapse.error = collapseError(quadrics, collapse.from, collapse.to);
+          }
+          collapses.push_back(collapse);
+        }
+      }
+      if (collapses.empty()) {
+        break;
+      }
+
+      sortCollapses(collapses, order, scratch);
+
+      // Each collapse removes about two triangles. Stop a pass well past the
+      // cheapest collapses it needs, so later passes see updated quadrics.
+      size_t triangleGoal = (indices.size() - targetIndexCount + 2) / 3;
+      size_t edgeGoal = std::max<size_t>(1, triangleGoal / 2);
+      float passLimit = errorLimit;
+      if (edgeGoal < order.size()) {
+        passLimit = std::min(passLimit, 1.5f * collapses[order[edgeGoal]].error);
+      }
+
+      for (size_t v = 0; v < m_vertexCount; ++v) {
+        collapseRemap[v] = static_cast<unsigned int>(v);
+      }
+      std::fill(locked.begin(), locked.end(), 0);
+      size_t triangleCollapses = 0;
+      for (unsigned int c : order) {
+        const Collapse& collapse = collapses[c];
+        // If everything under the pass limit was blocked, go on up to the
+        // error bound rather than give up.
+        if (collapse.error > passLimit && triangleCollapses == 0) {
+          passLimit = errorLimit;
+        }
+        if (collapse.error > passLimit || triangleCollapses >= triangleGoal) {
+          break;
+        }
+        unsigned int from = collapse.from;
+        unsigned int to = collapse.to;
+        unsigned int r0 = m_remap[from];
+        unsigned int r1 = m_remap[to];
+        if (locked[r0] || locked[r1]) {
+          continue;
+        }
+
+        // A seam moves both of its vertices, each along its own side.
+        unsigned char kind = m_kind[from];
+        unsigned int seamFrom = kNone;
+        unsigned int seamTo = kNone;
+        if (kind == kKindSeam) {
+          seamFrom = m_wedge[from];
+          seamTo = (m_loop[from] == to) ? m_loopBack[seamFrom] : m_loop[seamFrom];
+          if (seamTo == kNone || m_remap[seamTo] != r1) {
+            continue;
+          }
+        }
+        if (hasTriangleFlip(from, to, indices, adjacencyStart, adjacency, collapseRemap) ||
+            (seamFrom != kNone && hasTriangleFlip(seamFrom, seamTo, indices, adjacencyStart, adjacency, collapseRemap))) {
+          continue;
+        }
+
+        collapseRemap[from] = to;
+        if (seamFrom != kNone) {
+          collapseRemap[seamFrom] = seamTo;
+        }
+        addQuadric(quadrics[r1], quadrics[r0]);
+        locked[r0] = 1;
+        locked[r1] = 1;
+        reached = std::max(reached, collapse.error);
+        triangleCollapses += (kind == kKindBorder) ? 1 : 2;
+      }
+      if (triangleCollapses == 0) {
+        break;
+      }
+
+      // Apply the pass and drop the triangles that lost their area.
+      size_t write = 0;
+      for (size_t t = 0; t < triangleCount; ++t) {
+        unsigned int a = collapseRemap[indices[t * 3]];
+        unsigned int b = collapseRemap[indices[t * 3 + 1]];
+        unsigned int c = collapseRemap[indices[t * 3 + 2]];
+        if (m_remap[a] == m_remap[b] || m_remap[b] == m_remap[c] || m_remap[a] == m_remap[c]) {
+          continue;
+        }
+        indices[write * 3] = a;
+        indices[write * 3 + 1] = b;
+        indices[write * 3 + 2] = c;
+        groups[write] = groups[t];
+        ++write;
+      }
+      indices.resize(write * 3);
+      groups.resize(write);
+    }
+
+    outIndices.swap(indices);
+    outGroups.swap(groups);
+    outError = std::sqrt(reached);
+  }
+}
+
+size_t
+simplifyMesh(unsigned int* destination,
+             const unsigned int* indices,
+             size_t indexCount,
+             const SimpleVertex* vertices,
+             size_t vertexCount,
+             size_t targetIndexCount,
+             float targetError,
+             float* resultError) {
+  SimplifyContext context;
+  context.init(indices, indexCount, nullptr, vertices, vertexCount, 1);
+  std::vector<unsigned int> result;
+  std::vector<unsigned int> groups;
+  float error = 0.0f;
+  context.simplify(targetIndexCount, targetError, result, groups, error);
+  std::copy(result.begin(), result.end(), destination);
+  if (resultError) {
+    *resultError = error;
+  }
+  return result.size();
+}
+
+size_t
+generateLods(MeshComponent& mesh,
+             unsigned int levelCount,
+             float ratio,
+             float maxError,
+             unsigned int threadCount) {
+  generateLods(std::vector<MeshComponent*>(1, &mesh), levelCount, ratio, maxError, threadCount);
+  return mesh.m_lods.size();
+}
+
+void
+generateLods(const std::vector<MeshComponent*>& meshes,
+             unsigned int levelCount,
+             float ratio,
+             float maxError,
+             unsigned int threadCount) {
+  threadCount = resolveThreadCount(threadCount);
+
+  // Drop earlier levels, so m_index ends with the full-detail ranges again.
+  // Clusters may refer to those levels.
+  for (MeshComponent* mesh : meshes) {
+    mesh->m_clusters.clear();
+    if (!mesh->m_lods.empty()) {
+      size_t end = mesh->m_index.size();
+      for (const MeshLod& lod : mesh->m_lods) {
+        for (const MeshSubmesh& submesh : lod.submeshes) {
+          end = std::min<size_t>(end, submesh.indexOffset);
+        }
+      }
+      mesh->m_index.resize(end);
+      mesh->m_lods.clear();
+    }
+    if (mesh->m_submeshes.empty() && !mesh->m_index.empty()) {
+      MeshSubmesh submesh;
+      submesh.indexCount = static_cast<unsigned int>(mesh->m_index.size());
+      mesh->m_submeshes.push_back(submesh);
+    }
+  }
+  if (levelCount == 0) {
+    return;
+  }
+
+  // The full-detail triangles of each mesh in submesh order, tagged with
+  // their submesh.
+  std::vector<SimplifyContext> contexts(meshes.size());
+  std::vector<size_t> fullIndexCounts(meshes.size(), 0);
+  parallelFor(meshes.size(), threadCount, [&](size_t m) {
+    const MeshComponent& mesh = *meshes[m];
+    std::vector<unsigned int> indices;
+    std::vector<unsigned int> groups;
+    for (size_t s = 0; s < mesh.m_submeshes.size(); ++s) {
+      const MeshSubmesh& submesh = mesh.m_submeshes[s];
+      size_t count = submesh.indexCount - submesh.indexCount % 3;
+      indices.insert(indices.end(), mesh.m_index.begin() + submesh.indexOffset,
+                     mesh.m_index.begin() + submesh.indexOffset + count);
+      groups.insert(groups.end(), count / 3, static_cast<unsigned int>(s));
+    }
+    fullIndexCounts[m] = indices.size();
+    // Several meshes already keep every thread busy.
+    contexts[m].init(indices.data(), indices.size(), groups.data(), mesh.m_vertex.data(), mesh.m_vertex.size(),
+                     meshes.size() == 1 ? threadCount : 1);
+  });
+
+  struct LevelResult {
+    std::vector<unsigned int> indices;
+    std::vector<unsigned int> groups;
+    float error = 0.0f;
+  };
+  std::vector<LevelResult> levels(meshes.size() * levelCount);
+  parallelFor(levels.size(), threadCount, [&](size_t job) {
+    size_t m = job / levelCount;
+    size_t level = job % levelCount + 1;
+    size_t targetTriangles = static_cast<size_t>(
+      static_cast<double>(fullIndexCounts[m] / 3) * std::pow(static_cast<double>(ratio), static_cast<double>(level)));
+    LevelResult& result = levels[job];
+    contexts[m].simplify(targetTriangles * 3, maxError, result.indices, result.groups, result.error);
+  });
+  contexts.clear();
+
+  for (size_t m = 0; m < meshes.size(); ++m) {
+    MeshComponent& mesh = *meshes[m];
+    size_t previous = fullIndexCounts[m];
+    for (size_t level = 0; level < levelCount; ++level) {
+      LevelResult& result = levels[m * levelCount + level];
+      if (result.indices.empty() || result.indices.size() * 10 > previous * 9) {
+        break;
+      }
+      previous = result.indices.size();
+
+      // Triangles are still grouped by submesh, in submesh order.
+      MeshLod lod;
+      lod.error = result.error;
+      lod.submeshes.resize(mesh.m_submeshes.size());
+      size_t base = mesh.m_index.size();
+      for (size_t s = 0; s < lod.submeshes.size(); ++s) {
+        lod.submeshes[s].indexOffset = static_cast<unsigned int>(base);
+        lod.submeshes[s].materialId = mesh.m_submeshes[s].materialId;
+      }
+      for (unsigned int group : result.groups) {
+        lod.submeshes[group].indexCount += 3;
+      }
+      for (size_t s = 1; s < lod.submeshes.size(); ++s) {
+        lod.submeshes[s].indexOffset = lod.submeshes[s - 1].indexOffset + lod.submeshes[s - 1].indexCount;
+      }
+      mesh.m_index.insert(mesh.m_index.end(), result.indices.begin(), result.indices.end());
+      mesh.m_lods.push_back(std::move(lod));
+      std::vector<unsigned int>().swap(result.indices);
+    }
+    mesh.m_numIndex = static_cast<int>(mesh.m_index.size());
+    mesh.computeBounds();
+  }
+}
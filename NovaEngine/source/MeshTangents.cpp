@@ -0,0 +1,198 @@
+#include "MeshTangents.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  // Orientation of a triangle's texture mapping. Triangles with no texture
+  // area have none and join whichever orientation their vertex ends up with.
+  const unsigned char kOrientReversed = 0;
+  const unsigned char kOrientPreserved = 1;
+  const unsigned char kOrientAny = 2;
+
+  /*
+    Removes the component of v along the unit normal n.
+  */
+  inline XMVECTOR
+  projectToPlane(XMVECTOR v, XMVECTOR n) {
+    return XMVectorSubtract(v, XMVectorScale(n, XMVectorGetX(XMVector3Dot(n, v))));
+  }
+
+  /*
+    Returns v normalized, or zero if it has no length.
+  */
+  inline XMVECTOR
+  safeNormalize(XMVECTOR v) {
+    float length = std::sqrt(XMVectorGetX(XMVector3LengthSq(v)));
+    return (length > 0.0f) ? XMVectorScale(v, 1.0f / length) : XMVectorZero();
+  }
+
+  /*
+    Any unit vector perpendicular to n, for vertices without a usable texture mapping.
+  */
+  inline XMVECTOR
+  anyPerpendicular(XMVECTOR n) {
+    XMVECTOR axis = (std::fabs(XMVectorGetX(n)) < 0.9f) ? XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f)
+                                                        : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+    return safeNormalize(projectToPlane(axis, n));
+  }
+}
+
+size_t
+generateTangents(MeshComponent& mesh, unsigned int threadCount) {
+  threadCount = resolveThreadCount(threadCount);
+  const size_t vertexCount = mesh.m_vertex.size();
+  const size_t cornerCount = mesh.m_index.size() - mesh.m_index.size() % 3;
+  const size_t triangleCount = cornerCount / 3;
+  const SimpleVertex* vertices = mesh.m_vertex.data();
+  unsigned int* indices = mesh.m_index.data();
+
+  // Per corner: the triangle's U direction in the vertex normal's tangent
+  // plane, already scaled by the corner angle in that plane.
+  std::vector<XMFLOAT4> contributions(cornerCount);
+  std::vector<unsigned char> orientation(triangleCount);
+  parallelForRange(triangleCount, threadCount, 1 << 14, [&](size_t first, size_t last) {
+    for (size_t t = first; t < last; ++t) {
+      const SimpleVertex* corner[3] = { &vertices[indices[t * 3]],
+                                        &vertices[indices[t * 3 + 1]],
+                                        &vertices[indices[t * 3 + 2]] };
+      XMVECTOR p[3];
+      for (size_t k = 0; k < 3; ++k) {
+        p[k] = XMLoadFloat3(&corner[k]->Pos);
+      }
+      float s1 = corner[1]->Tex.x - corner[0]->Tex.x;
+      float t1 = corner[1]->Tex.y - corner[0]->Tex.y;
+      float s2 = corner[2]->Tex.x - corner[0]->Tex.x;
+      float t2 = corner[2]->Tex.y - corner[0]->Tex.y;
+      float signedArea = s1 * t2 - t1 * s2;
+      XMVECTOR d1 = XMVectorSubtract(p[1], p[0]);
+      XMVECTOR d2 = XMVectorSubtract(p[2], p[0]);
+      XMVECTOR uDirection = XMVectorSubtract(XMVectorScale(d1, t2), XMVectorScale(d2, t1));
+      if (signedArea < 0.0f) {
+        uDirection = XMVectorNegate(uDirection);
+      }
+      // Collinear texture coordinates still give a direction here, but not one
+      // the mapping defines; such a triangle adds nothing to its vertices.
+      uDirection = (signedArea != 0.0f) ? safeNormalize(uDirection) : XMVectorZero();
+      orientation[t] = (signedArea > 0.0f) ? kOrientPreserved : (signedArea < 0.0f) ? kOrientReversed : kOrientAny;
+
+      for (size_t k = 0; k < 3; ++k) {
+        XMVECTOR normal = safeNormalize(XMLoadFloat3(&corner[k]->Normal));
+        XMVECTOR tangent = safeNormalize(projectToPlane(uDirection, normal));
+        XMVECTOR toNext = projectToPlane(XMVectorSubtract(p[(k + 1) % 3], p[k]), normal);
+        XMVECTOR toPrev = projectToPlane(XMVectorSubtract(p[(k + 2) % 3], p[k]), normal);
+        float lengths = std::sqrt(XMVectorGetX(XMVector3LengthSq(toNext)) * XMVectorGetX(XMVector3LengthSq(toPrev)));
+        float angle = 0.0f;
+        if (lengths > 0.0f) {
+          float cosine = XMVectorGetX(XMVector3Dot(toNext, toPrev)) / lengths;
+          angle = std::acos(std::min(1.0f, std::max(-1.0f, cosine)));
+        }
+        XMStoreFloat4(&contributions[t * 3 + k], XMVectorScale(tangent, angle));
+      }
+    }
+  });
+
+  // Corners of every vertex (CSR), in triangle order so the sums below are
+  // added in the same order on every run.
+  std::vector<unsigned int> cornerStart(vertexCount + 1, 0);
+  for (size_t i = 0; i < cornerCount; ++i) {
+    ++cornerStart[indices[i] + 1];
+  }
+  for (size_t v = 0; v < vertexCount; ++v) {
+    cornerStart[v + 1] += cornerStart[v];
+  }
+  std::vector<unsigned int> vertexCorners(cornerCount);
+  {
+    std::vector<unsigned int> cursor(cornerStart.begin(), cornerStart.end() - 1);
+    for (size_t i = 0; i < cornerCount; ++i) {
+      vertexCorners[cursor[indices[i]]++] = static_cast<unsigned int>(i);
+    }
+  }
+
+  // The first oriented corner decides a vertex's own orientation; corners of
+  // the opposite orientation are summed separately for the split copy.
+  std::vector<XMFLOAT4> tangents(vertexCount);
+  std::vector<XMFLOAT4> mirrored(vertexCount);
+  std::vector<unsigned char> primary(vertexCount, kOrientAny);
+  std::vector<unsigned char> needsSplit(vertexCount, 0);
+  parallelForRange(vertexCount, threadCount, 1 << 14, [&](size_t first, size_t last) {
+    for (size_t v = first; v < last; ++v) {
+      unsigned char own = kOrientAny;
+      for (unsigned int c = cornerStart[v]; c < cornerStart[v + 1] && own == kOrientAny; ++c) {
+        own = orientation[vertexCorners[c] / 3];
+      }
+      XMVECTOR sum = XMVectorZero();
+      XMVECTOR other = XMVectorZero();
+      bool split = false;
+      for (unsigned int c = cornerStart[v]; c < cornerStart[v + 1]; ++c) {
+        unsigned int corner = vertexCorners[c];
+        XMVECTOR contribution = XMLoadFloat4(&contributions[corner]);
+        unsigned char orient = orientation[corner / 3];
+        if (orient == kOrientAny || orient == own) {
+          sum = XMVectorAdd(sum, contribution);
+        }
+        else {
+          other = XMVectorAdd(other, contribution);
+          split = true;
+        }
+      }
+
+      XMVECTOR normal = safeNormalize(XMLoadFloat3(&vertices[v].Normal));
+      float sign = (own == kOrientReversed) ? -1.0f : 1.0f;
+      // Projected again: when opposing contributions nearly cancel, rounding
+      // would otherwise leave a visible normal component.
+      sum = safeNormalize(projectToPlane(sum, normal));
+      if (XMVectorGetX(XMVector3LengthSq(sum)) == 0.0f) {
+        sum = anyPerpendicular(normal);
+      }
+      XMStoreFloat4(&tangents[v], XMVectorSetW(sum, sign));
+      if (split) {
+        other = safeNormalize(projectToPlane(other, normal));
+        if (XMVectorGetX(XMVector3LengthSq(other)) == 0.0f) {
+          other = anyPerpendicular(normal);
+        }
+        XMStoreFloat4(&mirrored[v], XMVectorSetW(other, -sign));
+      }
+      primary[v] = own;
+      needsSplit[v] = split ? 1 : 0;
+    }
+  });
+
+  // Split copies are appended in vertex order, then the corners of the
+  // opposite orientation are pointed at them.
+  std::vector<unsigned int> splitOf(vertexCount, 0);
+  size_t added = 0;
+  for (size_t v = 0; v < vertexCount; ++v) {
+    if (needsSplit[v]) {
+      splitOf[v] = static_cast<unsigned int>(vertexCount + added++);
+    }
+  }
+  mesh.m_tangent.resize(vertexCount + added);
+  std::copy(tangents.begin(), tangents.end(), mesh.m_tangent.begin());
+  if (added > 0) {
+    mesh.m_vertex.reserve(vertexCount + added);
+    if (!mesh.m_color.empty()) {
+      mesh.m_color.reserve(vertexCount + added);
+    }
+    for (size_t v = 0; v < vertexCount; ++v) {
+      if (needsSplit[v]) {
+        mesh.m_vertex.push_back(mesh.m_vertex[v]);
+        if (!mesh.m_color.empty()) {
+          mesh.m_color.push_back(mesh.m_color[v]);
+        }
+        mesh.m_tangent[splitOf[v]] = mirrored[v];
+      }
+    }
+    parallelForRange(cornerCount, threadCount, 1 << 16, [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; ++i) {
+        unsigned int v = indices[i];
+        unsigned char orient = orientation[i / 3];
+        if (needsSplit[v] && orient != kOrientAny && orient != primary[v]) {
+          indices[i] = splitOf[v];
+        }
+      }
+    });
+    mesh.m_numVertex = static_cast<int>(mesh.m_vertex.size());
+  }
+  return added;
+}
@@ -0,0 +1,67 @@
+#include "ModelLoadTask.h"
+#include <system_error>
+
+HRESULT
+ModelLoadTask::init(const std::string& filename, const ModelLoadOptions& options) {
+  destroy();
+  m_filename = filename;
+  m_mesh = MeshComponent();
+  m_meshTaken = false;
+  m_progress.bytesDone = 0;
+  m_progress.bytesTotal = 0;
+  m_progress.cancel = false;
+  m_state = LOAD_RUNNING;
+
+  ModelLoadOptions taskOptions = options;
+  taskOptions.progress = &m_progress;
+  try {
+    m_thread = std::thread([this, taskOptions]() {
+      bool loaded = m_loader.LoadOBJ(m_filename, m_mesh, taskOptions);
+      ModelLoadState result = loaded ? LOAD_READY
+                            : m_progress.cancel.load(std::memory_order_relaxed) ? LOAD_CANCELLED
+                            : LOAD_FAILED;
+      m_state.store(result, std::memory_order_release);
+    });
+  }
+  catch (const std::system_error&) {
+    ERROR("ModelLoadTask", "init", ("Failed to start loader thread for " + filename).c_str());
+    m_state = LOAD_FAILED;
+    return E_FAIL;
+  }
+  return S_OK;
+}
+
+float
+ModelLoadTask::progress() const {
+  if (state() == LOAD_READY) {
+    return 1.0f;
+  }
+  unsigned long long total = bytesTotal();
+  return total ? static_cast<float>(static_cast<double>(bytesDone()) / static_cast<double>(total)) : 0.0f;
+}
+
+void
+ModelLoadTask::wait() {
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+}
+
+bool
+ModelLoadTask::takeMesh(MeshComponent& outMesh) {
+  if (state() != LOAD_READY || m_meshTaken) {
+    return false;
+  }
+  wait();
+  outMesh = std::move(m_mesh);
+  m_meshTaken = true;
+  return true;
+}
+
+void
+ModelLoadTask::destroy() {
+  if (m_thread.joinable()) {
+    cancel();
+    m_thread.join();
+  }
+}
@@ -1,10 +1,1477 @@
 #include "ModelLoader.h"
+#include "MappedFile.h"
+#include "MeshNormals.h"
+#include "MeshTangents.h"
+#include "ModelLoadTask.h"
+#include "SpillFile.h"
+#include "VertexDedupTable.h"
+#include "Parallel.h"
+#include "ProcessMemory.h"
+#include "Timer.h"
+#include <algorithm>
+#include <cfloat>
+#include <charconv>
+#include <cstring>
+
+namespace {
+  /*
+    Record counts gathered by the pre-pass so every vector is reserved once.
+  */
+  struct OBJRecordCounts {
+    size_t positions = 0;
+    size_t uvs = 0;
+    size_t normals = 0;
+    size_t corners = 0;
+    size_t indices = 0;
+  };
+
+  const float kPow10[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+  // scanInt stops accumulating here, well before a long long overflows.
+  const long long kIntLimit = 100000000000000000ll;
+
+  inline bool
+  isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+  }
+
+  inline bool
+  isDigit(char c) {
+    return static_cast<unsigned char>(c - '0') < 10;
+  }
+
+  inline const char*
+  skipBlanks(const char* p, const char* end) {
+    while (p < end && isBlank(*p)) ++p;
+    return p;
+  }
+
+  inline const char*
+  skipToken(const char* p, const char* end) {
+    while (p < end && !isBlank(*p)) ++p;
+    return p;
+  }
+
+  inline const char*
+  findLineEnd(const char* p, const char* end) {
+    const char* lineEnd = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p)));
+    return lineEnd ? lineEnd : end;
+  }
+
+  /*
+    Scans a decimal floating point token starting at p.
+    Mantissas that fit in 24 bits with a power-of-ten exponent in [-10, 10] are
+    converted with a single exact float operation, which is correctly rounded and
+    therefore matches operator>>. Anything else falls back to std::from_chars.
+    A value out of float range is clamped to +-FLT_MAX, or to zero if it is too
+    small, so one extreme component does not lose the rest of the line.
+    Returns the position after the token, or nullptr if no number was found.
+  */
+  const char*
+  scanFloat(const char* p, const char* end, float& out) {
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+      negative = (*p == '-');
+      ++p;
+    }
+
+    unsigned long long mantissa = 0;
+    int significant = 0;
+    int exponent = 0;
+    bool anyDigit = false;
+    bool overflow = false;
+
+    while (p < end && isDigit(*p)) {
+      if (significant < 19) {
+        mantissa = mantissa * 10 + static_cast<unsigned long long>(*p - '0');
+        if (mantissa) ++significant;
+      }
+      else {
+        // Dropped integer digits still scale the value.
+        overflow = true;
+        ++exponent;
+      }
+      anyDigit = true;
+      ++p;
+    }
+    if (p < end && *p == '.') {
+      ++p;
+      while (p < end && isDigit(*p)) {
+        if (significant < 19) {
+          mantissa = mantissa * 10 + static_cast<unsigned long long>(*p - '0');
+          if (mantissa) ++significant;
+          --exponent;
+        }
+        else {
+          overflow = true;
+        }
+        anyDigit = true;
+        ++p;
+      }
+    }
+
+    if (anyDigit && p < end && (*p == 'e' || *p == 'E')) {
+      const char* e = p + 1;
+      bool negativeExponent = false;
+      if (e < end && (*e == '-' || *e == '+')) {
+        negativeExponent = (*e == '-');
+        ++e;
+      }
+      if (e < end && isDigit(*e)) {
+        int value = 0;
+        while (e < end && isDigit(*e)) {
+          if (value < 10000) value = value * 10 + (*e - '0');
+          ++e;
+        }
+        exponent += negativeExponent ? -value : value;
+        p = e;
+      }
+    }
+
+    if (anyDigit && !overflow && mantissa <= (1ull << 24) && exponent >= -10 && exponent <= 10) {
+      float value = static_cast<float>(mantissa);
+      value = (exponent < 0) ? value / kPow10[-exponent] : value * kPow10[exponent];
+      out = negative ? -value : value;
+      return p;
+    }
+
+    // Slow path: long mantissas, large exponents, inf/nan.
+    const char* first = (*start == '+') ? start + 1 : start;
+    const char* tokenEnd = skipToken(start, end);
+    std::from_chars_result result = std::from_chars(first, tokenEnd, out);
+    if (result.ec == std::errc::result_out_of_range) {
+      // out is left untouched; the value is 0.d * 10^(exponent + significant).
+      float magnitude = (exponent + significant > 0) ? FLT_MAX : 0.0f;
+      out = negative ? -magnitude : magnitude;
+      return result.ptr;
+    }
+    if (result.ec != std::errc()) {
+      return nullptr;
+    }
+    return result.ptr;
+  }
+
+  /*
+    Scans an optionally signed decimal integer starting at p. Digits after the
+    value reaches kIntLimit are skipped rather than overflowing; no index range
+    accepts a value that large.
+  */
+  inline const char*
+  scanInt(const char* p, const char* end, long long& out) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+      negative = (*p == '-');
+      ++p;
+    }
+    if (p >= end || !isDigit(*p)) {
+      return nullptr;
+    }
+    long long value = 0;
+    while (p < end && isDigit(*p)) {
+      if (value < kIntLimit) {
+        value = value * 10 + (*p - '0');
+      }
+      ++p;
+    }
+    out = negative ? -value : value;
+    return p;
+  }
+
+  /*
+    Reads up to count floats from the rest of a line. Missing components read as
+    zero, like a failed operator>> extraction.
+  */
+  inline void
+  scanFloats(const char* p, const char* lineEnd, float* out, int count) {
+    for (int i = 0; i < count; ++i) {
+      p = skipBlanks(p, lineEnd);
+      const char* next = (p < lineEnd) ? scanFloat(p, lineEnd, out[i]) : nullptr;
+      if (!next) {
+        for (; i < count; ++i) out[i] = 0.0f;
+        return;
+      }
+      p = next;
+    }
+  }
+
+  /*
+    Resolves a one-based or negative (relative) OBJ index against the number of
+    records read so far. Returns zero if the index is out of range.
+  */
+  inline unsigned int
+  resolveIndex(long long index, size_t count) {
+    if (index < 0) {
+      index += static_cast<long long>(count) + 1;
+    }
+    return (index >= 1 && index <= static_cast<long long>(count)) ? static_cast<unsigned int>(index) : 0;
+  }
+
+  /*
+    Splits a face corner token ("v", "v/vt", "v//vn" or "v/vt/vn") into resolved
+    one-based indices. Absent texture coordinates and normals are returned as zero.
+  */
+  bool
+  scanCorner(const char* p,
+             const char* tokenEnd,
+             size_t positionCount,
+             size_t uvCount,
+             size_t normalCount,
+             OBJCorner& corner) {
+    long long v = 0, vt = 0, vn = 0;
+    corner = OBJCorner{ 0, 0, 0 };
+    p = scanInt(p, tokenEnd, v);
+    if (!p) return false;
+    corner.v = resolveIndex(v, positionCount);
+    if (!corner.v) return false;
+    if (p < tokenEnd && *p == '/') {
+      ++p;
+      if (p < tokenEnd && *p != '/') {
+        p = scanInt(p, tokenEnd, vt);
+        if (!p) return false;
+        corner.vt = resolveIndex(vt, uvCount);
+        if (!corner.vt) return false;
+      }
+      if (p < tokenEnd && *p == '/') {
+        ++p;
+        if (p < tokenEnd) {
+          p = scanInt(p, tokenEnd, vn);
+          if (!p) return false;
+          corner.vn = resolveIndex(vn, normalCount);
+          if (!corner.vn) return false;
+        }
+      }
+    }
+    return p == tokenEnd;
+  }
+
+  /*
+    Scans the corners of a face line (at most four are used). Returns false and
+    sets error on a malformed corner; faces with fewer than three corners come
+    back with cornerCount < 3 and are skipped by the callers.
+  */
+  inline bool
+  scanFace(const char* p,
+           const char* lineEnd,
+           size_t positionCount,
+           size_t uvCount,
+           size_t normalCount,
+           OBJCorner (&corners)[4],
+           unsigned int& cornerCount,
+           std::string& error) {
+    cornerCount = 0;
+    const char* token = skipBlanks(p, lineEnd);
+    while (cornerCount < 4 && token < lineEnd) {
+      const char* tokenEnd = skipToken(token, lineEnd);
+      if (!scanCorner(token, tokenEnd, positionCount, uvCount, normalCount, corners[cornerCount])) {
+        error = "Invalid face corner '" + std::string(token, tokenEnd) + "'";
+        return false;
+      }
+      ++cornerCount;
+      token = skipBlanks(tokenEnd, lineEnd);
+    }
+    return true;
+  }
+
+  enum OBJRecord {
+    OBJ_OTHER = 0,
+    OBJ_POSITION = 1,
+    OBJ_UV = 2,
+    OBJ_NORMAL = 3,
+    OBJ_FACE = 4,
+    OBJ_USEMTL = 5,
+    OBJ_MTLLIB = 6,
+    OBJ_SMOOTH = 7
+  };
+
+  /*
+    Classifies a line by its prefix token. The counting pre-pass and the parser
+    share it, so the counts used to lay out the arrays always match what is parsed.
+  */
+  inline OBJRecord
+  classifyLine(const char* p, const char* lineEnd, const char*& prefixEnd) {
+    prefixEnd = skipToken(p, lineEnd);
+    size_t length = static_cast<size_t>(prefixEnd - p);
+    if (length == 1) {
+      if (p[0] == 'v') return OBJ_POSITION;
+      if (p[0] == 'f') return OBJ_FACE;
+      if (p[0] == 's') return OBJ_SMOOTH;
+    }
+    else if (length == 2 && p[0] == 'v') {
+      if (p[1] == 't') return OBJ_UV;
+      if (p[1] == 'n') return OBJ_NORMAL;
+    }
+    else if (length == 6) {
+      if (memcmp(p, "usemtl", 6) == 0) return OBJ_USEMTL;
+      if (memcmp(p, "mtllib", 6) == 0) return OBJ_MTLLIB;
+    }
+    return OBJ_OTHER;
+  }
+
+  /*
+    Counting pre-pass: classifies every line and counts the face corners the
+    parser will consume (at most four per face, faces need at least three).
+  */
+  OBJRecordCounts
+  countOBJRecords(const char* begin, const char* end) {
+    OBJRecordCounts counts;
+    const char* cursor = begin;
+    while (cursor < end) {
+      const char* lineEnd = findLineEnd(cursor, end);
+      const char* prefixEnd = nullptr;
+      switch (classifyLine(skipBlanks(cursor, lineEnd), lineEnd, prefixEnd)) {
+      case OBJ_POSITION:
+        ++counts.positions;
+        break;
+      case OBJ_UV:
+        ++counts.uvs;
+        break;
+      case OBJ_NORMAL:
+        ++counts.normals;
+        break;
+      case OBJ_FACE: {
+        size_t corners = 0;
+        const char* token = skipBlanks(prefixEnd, lineEnd);
+        while (token < lineEnd && corners < 4) {
+          ++corners;
+          token = skipBlanks(skipToken(token, lineEnd), lineEnd);
+        }
+        if (corners >= 3) {
+          counts.corners += corners;
+          counts.indices += (corners == 4) ? 6 : 3;
+        }
+        break;
+      }
+      default:
+        break;
+      }
+      cursor = lineEnd + 1;
+    }
+    return counts;
+  }
+
+  inline void
+  addCounts(OBJRecordCounts& total, const OBJRecordCounts& counts) {
+    total.positions += counts.positions;
+    total.uvs += counts.uvs;
+    total.normals += counts.normals;
+    total.corners += counts.corners;
+    total.indices += counts.indices;
+  }
+
+  /*
+    Unique corners are bounded by the corner count; the largest attribute stream
+    is a close estimate that avoids reserving for the worst case.
+  */
+  inline size_t
+  estimateUniqueCorners(const OBJRecordCounts& counts) {
+    return std::min(counts.corners, std::max(counts.positions, std::max(counts.uvs, counts.normals)));
+  }
+
+  /*
+    Returns the rest of a line without surrounding blanks.
+  */
+  inline std::string
+  trimmedRest(const char* p, const char* lineEnd) {
+    p = skipBlanks(p, lineEnd);
+    while (lineEnd > p && isBlank(lineEnd[-1])) --lineEnd;
+    return std::string(p, lineEnd);
+  }
+
+  // Parsed bytes between progress updates and cancellation checks.
+  const size_t kProgressStep = 1 << 20;
+
+  /*
+    A usemtl switch: faces from firstTriangle on use the named material.
+  */
+  struct OBJMaterialRun {
+    size_t firstTriangle = 0;
+    std::string name;
+  };
+
+  /*
+    A line-aligned slice of the file handled by one worker.
+  */
+  struct OBJChunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    // Records inside this chunk, and in every chunk before it.
+    OBJRecordCounts counts;
+    OBJRecordCounts base;
+    // Unique corners in first-reference order and the triangle list indexing them.
+    std::vector<OBJCorner> corners;
+    std::vector<unsigned int> indices;
+    // Chunk-local corner index -> global vertex index, filled by the merge.
+    std::vector<unsigned int> remap;
+    // usemtl switches (chunk-local triangle numbers) and mtllib references, in file order.
+    std::vector<OBJMaterialRun> materialRuns;
+    // s switches: chunk-local first triangle and smoothing group (0 for "s off").
+    std::vector<std::pair<size_t, unsigned int>> smoothingRuns;
+    std::vector<std::string> libraries;
+    std::string error;
+    bool cancelled = false;
+  };
+
+  /*
+    Splits [begin, end) into up to chunkCount slices that start and end on line boundaries.
+  */
+  std::vector<OBJChunk>
+  splitOBJChunks(const char* begin, const char* end, size_t chunkCount) {
+    std::vector<OBJChunk> chunks;
+    size_t size = static_cast<size_t>(end - begin);
+    const char* cursor = begin;
+    for (size_t i = 0; i < chunkCount && cursor < end; ++i) {
+      const char* target = (i + 1 == chunkCount) ? end : begin + size / chunkCount * (i + 1);
+      const char* chunkEnd = end;
+      if (target < end) {
+        chunkEnd = findLineEnd(std::max(target, cursor), end);
+        if (chunkEnd < end) ++chunkEnd;
+      }
+      OBJChunk chunk;
+      chunk.begin = cursor;
+      chunk.end = chunkEnd;
+      chunks.push_back(std::move(chunk));
+      cursor = chunkEnd;
+    }
+    return chunks;
+  }
+
+  /*
+    Parses one chunk. Attributes are written straight into the shared arrays at
+    the chunk's base offsets; faces are deduplicated against a chunk-local table.
+    Relative indices resolve against the records seen so far in the whole file.
+  */
+  void
+  parseOBJChunk(OBJChunk& chunk,
+                XMFLOAT3* positions,
+                XMFLOAT2* uvs,
+                XMFLOAT3* normals,
+                ModelLoadProgress* progress) {
+    size_t position = chunk.base.positions;
+    size_t uv = chunk.base.uvs;
+    size_t normal = chunk.base.normals;
+
+    size_t expectedUnique = estimateUniqueCorners(chunk.counts);
+    chunk.corners.reserve(expectedUnique);
+    chunk.indices.reserve(chunk.counts.indices);
+    VertexDedupTable table;
+    table.init(expectedUnique);
+
+    const char* cursor = chunk.begin;
+    const char* reported = chunk.begin;
+    while (cursor < chunk.end) {
+      if (progress && static_cast<size_t>(cursor - reported) >= kProgressStep) {
+        progress->bytesDone.fetch_add(static_cast<unsigned long long>(cursor - reported), std::memory_order_relaxed);
+        reported = cursor;
+        if (progress->cancel.load(std::memory_order_relaxed)) {
+          chunk.cancelled = true;
+          return;
+        }
+      }
+
+      const char* lineEnd = findLineEnd(cursor, chunk.end);
+      const char* prefixEnd = nullptr;
+
+      switch (classifyLine(skipBlanks(cursor, lineEnd), lineEnd, prefixEnd)) {
+      case OBJ_POSITION:
+        scanFloats(prefixEnd, lineEnd, &positions[position++].x, 3);
+        break;
+      case OBJ_UV: {
+        XMFLOAT2& tex = uvs[uv++];
+        scanFloats(prefixEnd, lineEnd, &tex.x, 2);
+        tex.y = 1.0f - tex.y;
+        break;
+      }
+      case OBJ_NORMAL:
+        scanFloats(prefixEnd, lineEnd, &normals[normal++].x, 3);
+        break;
+      case OBJ_FACE: {
+        OBJCorner face[4];
+        unsigned int local_indices[4];
+        unsigned int vertex_count = 0;
+        if (!scanFace(prefixEnd, lineEnd, position, uv, normal, face, vertex_count, chunk.error)) {
+          return;
+        }
+
+        for (unsigned int i = 0; i < vertex_count; ++i) {
+          bool inserted = false;
+          local_indices[i] = table.findOrInsert(face[i],
+            static_cast<unsigned int>(chunk.corners.size()),
+            inserted);
+          if (inserted) {
+            chunk.corners.push_back(face[i]);
+          }
+        }
+
+        if (vertex_count >= 3) {
+          chunk.indices.push_back(local_indices[0]);
+          chunk.indices.push_back(local_indices[1]);
+          chunk.indices.push_back(local_indices[2]);
+
+          if (vertex_count == 4) {
+            chunk.indices.push_back(local_indices[0]);
+            chunk.indices.push_back(local_indices[2]);
+            chunk.indices.push_back(local_indices[3]);
+          }
+        }
+        break;
+      }
+      case OBJ_USEMTL: {
+        OBJMaterialRun run;
+        run.firstTriangle = chunk.indices.size() / 3;
+        run.name = trimmedRest(prefixEnd, lineEnd);
+        chunk.materialRuns.push_back(std::move(run));
+        break;
+      }
+      case OBJ_MTLLIB: {
+        const char* token = skipBlanks(prefixEnd, lineEnd);
+        while (token < lineEnd) {
+          const char* tokenEnd = skipToken(token, lineEnd);
+          chunk.libraries.emplace_back(token, tokenEnd);
+          token = skipBlanks(tokenEnd, lineEnd);
+        }
+        break;
+      }
+      case OBJ_SMOOTH: {
+        // "s off" and "s 0" turn smoothing off; any other name is one more group.
+        const char* token = skipBlanks(prefixEnd, lineEnd);
+        const char* tokenEnd = skipToken(token, lineEnd);
+        long long group = 0;
+        if (!scanInt(token, tokenEnd, group) && tokenEnd > token &&
+            !(tokenEnd - token == 3 && memcmp(token, "off", 3) == 0)) {
+          group = kDefaultSmoothingGroup;
+        }
+        chunk.smoothingRuns.emplace_back(chunk.indices.size() / 3, static_cast<unsigned int>(group));
+        break;
+      }
+      default:
+        break;
+      }
+
+      cursor = lineEnd + 1;
+    }
+    if (progress) {
+      progress->bytesDone.fetch_add(static_cast<unsigned long long>(chunk.end - reported), std::memory_order_relaxed);
+    }
+  }
+
+  /*
+    Directory part of a path including the trailing separator, or "" for a bare name.
+  */
+  inline std::string
+  directoryOf(const std::string& path) {
+    size_t slash = path.find_last_of("/\\");
+    return (slash == std::string::npos) ? std::string() : path.substr(0, slash + 1);
+  }
+
+  inline std::string
+  resolvePath(const std::string& directory, const std::string& path) {
+    bool absolute = !path.empty() && (path[0] == '/' || path[0] == '\\' || path.find(':') != std::string::npos);
+    return absolute ? path : directory + path;
+  }
+
+  /*
+    Parses a .mtl library into materials keyed by name. Texture statements keep
+    their last token (the file name follows any -option arguments) and are made
+    relative to the library's directory. Unknown statements are ignored.
+  */
+  void
+  parseMTL(const char* begin,
+           const char* end,
+           const std::string& directory,
+           std::map<std::string, MeshMaterial>& library) {
+    MeshMaterial* material = nullptr;
+    const char* cursor = begin;
+    while (cursor < end) {
+      const char* lineEnd = findLineEnd(cursor, end);
+      const char* p = skipBlanks(cursor, lineEnd);
+      const char* prefixEnd = skipToken(p, lineEnd);
+      std::string prefix(p, prefixEnd);
+      cursor = lineEnd + 1;
+
+      if (prefix == "newmtl") {
+        std::string name = trimmedRest(prefixEnd, lineEnd);
+        material = &library[name];
+        *material = MeshMaterial();
+        material->name = name;
+        continue;
+      }
+      if (!material) {
+        continue;
+      }
+
+      if (prefix == "Ka") {
+        scanFloats(prefixEnd, lineEnd, &material->ambient.x, 3);
+      }
+      else if (prefix == "Kd") {
+        scanFloats(prefixEnd, lineEnd, &material->diffuse.x, 3);
+      }
+      else if (prefix == "Ks") {
+        scanFloats(prefixEnd, lineEnd, &material->specular.x, 3);
+      }
+      else if (prefix == "Ns") {
+        scanFloats(prefixEnd, lineEnd, &material->shininess, 1);
+      }
+      else if (prefix == "d") {
+        scanFloats(prefixEnd, lineEnd, &material->opacity, 1);
+      }
+      else if (prefix == "Tr") {
+        float transparency = 0.0f;
+        scanFloats(prefixEnd, lineEnd, &transparency, 1);
+        material->opacity = 1.0f - transparency;
+      }
+      else if (prefix == "map_Kd" || prefix == "map_Bump" || prefix == "map_bump" ||
+               prefix == "bump" || prefix == "norm") {
+        const char* last = lineEnd;
+        while (last > prefixEnd && isBlank(last[-1])) --last;
+        const char* first = last;
+        while (first > prefixEnd && !isBlank(first[-1])) --first;
+        if (first == last) {
+          continue;
+        }
+        std::string texture = resolvePath(directory, std::string(first, last));
+        if (prefix == "map_Kd") {
+          material->diffuseTexture = texture;
+        }
+        else {
+          material->normalTexture = texture;
+        }
+      }
+    }
+  }
+
+  /*
+    Builds the material table for the used material names. Names missing from
+    the libraries (and the "" used for faces before any usemtl) get defaults.
+  */
+  void
+  buildMaterials(const std::vector<std::string>& names,
+                 const std::map<std::string, MeshMaterial>& library,
+                 std::vector<MeshMaterial>& materials,
+                 std::vector<std::string>* missing) {
+    materials.clear();
+    materials.reserve(names.size());
+    for (const std::string& name : names) {
+      auto found = library.find(name);
+      if (found != library.end()) {
+        materials.push_back(found->second);
+        continue;
+      }
+      MeshMaterial material;
+      material.name = name.empty() ? "default" : name;
+      materials.push_back(material);
+      if (missing && !name.empty()) {
+        missing->push_back(name);
+      }
+    }
+  }
+
+  /*
+    Loads one material library into the library map and describes it as a cache dependency.
+  */
+  MeshCacheDependency
+  loadMaterialLibrary(const std::string& path, std::map<std::string, MeshMaterial>& library) {
+    MeshCacheDependency dependency;
+    dependency.path = path;
+    MappedFile mtlFile;
+    if (GetFileAttributesA(path.c_str()) != INVALID_FILE_ATTRIBUTES && SUCCEEDED(mtlFile.init(path))) {
+      parseMTL(mtlFile.data(), mtlFile.data() + mtlFile.size(), directoryOf(path), library);
+      dependency.size = mtlFile.size();
+      dependency.hash = MeshCache::hashBytes(mtlFile.data(), mtlFile.size(), 1);
+    }
+    else {
+      REPORT("ModelLoader", "loadMaterialLibrary", ("Material library not found: " + path).c_str());
+    }
+    return dependency;
+  }
+
+  /*
+    Reorders whole triangles so every material's faces form one contiguous index
+    range, keeping file order within a material (a stable counting sort over the
+    usemtl runs). runs[r] covers triangles [runs[r].first, runs[r + 1].first).
+  */
+  void
+  groupTrianglesByMaterial(std::vector<unsigned int>& indices,
+                           const std::vector<std::pair<size_t, unsigned int>>& runs,
+                           size_t materialCount,
+                           unsigned int threadCount,
+                           std::vector<MeshSubmesh>& submeshes) {
+    size_t triangleCount = indices.size() / 3;
+    std::vector<size_t> runEnds(runs.size());
+    std::vector<size_t> materialTriangles(materialCount, 0);
+    for (size_t r = 0; r < runs.size(); ++r) {
+      runEnds[r] = (r + 1 < runs.size()) ? runs[r + 1].first : triangleCount;
+      materialTriangles[runs[r].second] += runEnds[r] - runs[r].first;
+    }
+
+    submeshes.clear();
+    std::vector<size_t> cursor(materialCount, 0);
+    size_t offset = 0;
+    for (size_t m = 0; m < materialCount; ++m) {
+      cursor[m] = offset;
+      if (materialTriangles[m] > 0) {
+        MeshSubmesh submesh;
+        submesh.indexOffset = static_cast<unsigned int>(offset * 3);
+        submesh.indexCount = static_cast<unsigned int>(materialTriangles[m] * 3);
+        submesh.materialId = static_cast<unsigned int>(m);
+        submeshes.push_back(submesh);
+      }
+      offset += materialTriangles[m];
+    }
+    if (submeshes.size() <= 1) {
+      return;
+    }
+
+    std::vector<size_t> destinations(runs.size());
+    for (size_t r = 0; r < runs.size(); ++r) {
+      destinations[r] = cursor[runs[r].second];
+      cursor[runs[r].second] += runEnds[r] - runs[r].first;
+    }
+
+    std::vector<unsigned int> grouped(indices.size());
+    parallelFor(runs.size(), threadCount, [&](size_t r) {
+      size_t count = (runEnds[r] - runs[r].first) * 3;
+      if (count > 0) {
+        memcpy(grouped.data() + destinations[r] * 3, indices.data() + runs[r].first * 3, count * sizeof(unsigned int));
+      }
+    });
+    indices.swap(grouped);
+  }
+
+  /*
+    Mixes the import options that change the parsed mesh into the source hash,
+    so a cache written with different options is rebuilt instead of reused.
+  */
+  inline unsigned long long
+  mixOptionsHash(unsigned long long hash, const ModelLoadOptions& options) {
+    if (options.generateNormals) {
+      unsigned int crease = 0;
+      memcpy(&crease, &options.normalCreaseAngle, sizeof(crease));
+      hash ^= (0x9E3779B97F4A7C15ull + crease) * 0xFF51AFD7ED558CCDull;
+    }
+    if (options.cleanupMesh) {
+      const MeshCleanupOptions& cleanup = options.cleanupOptions;
+      unsigned int values[4] = { (cleanup.removeDegenerate ? 1u : 0u) | (cleanup.removeDuplicates ? 2u : 0u), 0, 0, 0 };
+      memcpy(&values[1], &cleanup.positionTolerance, sizeof(values[1]));
+      memcpy(&values[2], &cleanup.texcoordTolerance, sizeof(values[2]));
+      memcpy(&values[3], &cleanup.normalTolerance, sizeof(values[3]));
+      for (unsigned int value : values) {
+        hash = (hash ^ (0x2545F4914F6CDD1Dull + value)) * 0xBF58476D1CE4E5B9ull;
+      }
+    }
+    if (options.generateTangents) {
+      hash ^= 0xC4CEB9FE1A85EC53ull;
+    }
+    if (options.optimizeVertexCache || options.optimizeOverdraw) {
+      hash ^= 0x27D4EB2F165667C5ull;
+    }
+    if (options.optimizeOverdraw) {
+      unsigned int threshold = 0;
+      memcpy(&threshold, &options.overdrawThreshold, sizeof(threshold));
+      hash ^= (0x165667B19E3779F9ull + threshold) * 0x85EBCA77C2B2AE63ull;
+    }
+    if (options.optimizeVertexFetch) {
+      hash ^= 0x94D049BB133111EBull;
+    }
+    if (options.lodCount > 0) {
+      unsigned int lod[3] = { options.lodCount, 0, 0 };
+      memcpy(&lod[1], &options.lodRatio, sizeof(lod[1]));
+      memcpy(&lod[2], &options.lodMaxError, sizeof(lod[2]));
+      for (unsigned int value : lod) {
+        hash = (hash ^ (0xD6E8FEB86659FD93ull + value)) * 0x9FB21C651E98DF25ull;
+      }
+    }
+    if (options.buildClusters) {
+      unsigned int limits[2] = { options.clusterMaxVertices, options.clusterMaxTriangles };
+      for (unsigned int value : limits) {
+        hash = (hash ^ (0xBF58476D1CE4E5B9ull + value)) * 0xE7037ED1A0B428DBull;
+      }
+    }
+    return hash;
+  }
+
+  // Below this size a file is parsed by a single worker.
+  const size_t kMinOBJChunkBytes = 1 << 20;
+
+  // Smallest memory budget StreamOBJ accepts.
+  const size_t kMinStreamBudget = 16u << 20;
+}
 
 bool
-ModelLoader::LoadOBJ(const std::string& filename, MeshComponent& outMesh) {
+ModelLoader::LoadOBJ(const std::string& filename,
+                     MeshComponent& outMesh,
+                     const ModelLoadOptions& options) {
+  Timer timer;
 
   outMesh.m_vertex.clear();
   outMesh.m_index.clear();
+  outMesh.m_color.clear();
+  outMesh.m_tangent.clear();
+  outMesh.m_lods.clear();
+  outMesh.m_clusters.clear();
+  outMesh.m_submeshes.clear();
+  outMesh.m_materials.clear();
+
+  std::string fullPath = filename + ".obj";
+  MappedFile file;
+  if (FAILED(file.init(fullPath))) {
+    ERROR("ModelLoader", "LoadOBJ", ("No se pudo abrir el archivo: " + fullPath).c_str());
+    return false;
+  }
+
+  const char* begin = file.data();
+  const char* end = begin + file.size();
+
+  unsigned int threadCount = resolveThreadCount(options.threadCount);
+  m_stats = ModelLoadStats();
+  m_stats.bytes = file.size();
+
+  ModelLoadProgress* progress = options.progress;
+  if (progress) {
+    progress->bytesTotal.store(file.size(), std::memory_order_relaxed);
+  }
+  auto cancelled = [&]() {
+    if (!progress || !progress->cancel.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    REPORT("ModelLoader", "LoadOBJ", ("Cancelled loading " + fullPath).c_str());
+    return true;
+  };
+
+  std::string cachePath = filename + ".novamesh";
+  unsigned long long sourceHash = 0;
+  if (options.useCache) {
+    sourceHash = MeshCache::hashBytes(begin, file.size(), threadCount);
+    sourceHash = mixOptionsHash(sourceHash, options);
+    if (m_meshCache.load(cachePath, file.size(), sourceHash, outMesh, threadCount) == S_OK) {
+      m_stats.fromCache = true;
+      m_stats.seconds = timer.elapsedSeconds();
+      if (progress) {
+        progress->bytesDone.store(file.size(), std::memory_order_relaxed);
+      }
+      std::ostringstream report;
+      report << fullPath << " " << outMesh.m_numVertex << " vertices, " << outMesh.m_numIndex
+             << " indices from " << cachePath << " in " << m_stats.seconds * 1000.0 << " ms";
+      REPORT("ModelLoader", "LoadOBJ", report.str().c_str());
+      return true;
+    }
+  }
+
+  size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, file.size() / kMinOBJChunkBytes));
+  std::vector<OBJChunk> chunks = splitOBJChunks(begin, end, chunkCount);
+
+  // Counting pre-pass per chunk; the prefix sums give every chunk its slot in
+  // the attribute and index arrays, so each vector is sized exactly once.
+  parallelFor(chunks.size(), threadCount, [&](size_t i) {
+    chunks[i].counts = countOBJRecords(chunks[i].begin, chunks[i].end);
+  });
+  OBJRecordCounts totals;
+  for (OBJChunk& chunk : chunks) {
+    chunk.base = totals;
+    addCounts(totals, chunk.counts);
+  }
+  if (cancelled()) {
+    return false;
+  }
+
+  std::vector<XMFLOAT3> temp_positions(totals.positions);
+  std::vector<XMFLOAT2> temp_uvs(totals.uvs);
+  std::vector<XMFLOAT3> temp_normals(totals.normals);
+
+  parallelFor(chunks.size(), threadCount, [&](size_t i) {
+    parseOBJChunk(chunks[i], temp_positions.data(), temp_uvs.data(), temp_normals.data(), progress);
+  });
+  if (cancelled()) {
+    return false;
+  }
+  for (const OBJChunk& chunk : chunks) {
+    if (!chunk.error.empty()) {
+      ERROR("ModelLoader", "LoadOBJ", (chunk.error + " in " + fullPath).c_str());
+      return false;
+    }
+  }
+
+  // Merge the chunk-local corner lists in file order. A corner gets its global
+  // index the first time any chunk references it, which is exactly the order the
+  // single-threaded parse discovers it in, so the result is bit-identical.
+  std::vector<OBJCorner> corners;
+  std::vector<unsigned int> final_indices;
+  if (chunks.size() <= 1) {
+    if (!chunks.empty()) {
+      corners = std::move(chunks[0].corners);
+      final_indices = std::move(chunks[0].indices);
+    }
+  }
+  else {
+    corners.reserve(estimateUniqueCorners(totals));
+    VertexDedupTable vertex_table;
+    vertex_table.init(corners.capacity());
+    for (OBJChunk& chunk : chunks) {
+      chunk.remap.resize(chunk.corners.size());
+      for (size_t i = 0; i < chunk.corners.size(); ++i) {
+        bool inserted = false;
+        chunk.remap[i] = vertex_table.findOrInsert(chunk.corners[i],
+          static_cast<unsigned int>(corners.size()),
+          inserted);
+        if (inserted) {
+          corners.push_back(chunk.corners[i]);
+        }
+      }
+      std::vector<OBJCorner>().swap(chunk.corners);
+    }
+
+    final_indices.resize(totals.indices);
+    parallelFor(chunks.size(), threadCount, [&](size_t c) {
+      OBJChunk& chunk = chunks[c];
+      unsigned int* out = final_indices.data() + chunk.base.indices;
+      for (size_t i = 0; i < chunk.indices.size(); ++i) {
+        out[i] = chunk.remap[chunk.indices[i]];
+      }
+      std::vector<unsigned int>().swap(chunk.indices);
+      std::vector<unsigned int>().swap(chunk.remap);
+    });
+  }
+
+  // Corners without a vn record get generated normals. A vertex shared by faces
+  // that end up with different normals (flat groups, creases) is split: the
+  // first normal keeps the vertex, every other one gets its own copy.
+  std::vector<XMFLOAT3> generated_normals;
+  if (options.generateNormals &&
+      std::any_of(corners.begin(), corners.end(), [](const OBJCorner& corner) { return corner.vn == 0; })) {
+    size_t triangleCount = final_indices.size() / 3;
+    std::vector<unsigned int> triangle_groups(triangleCount, kDefaultSmoothingGroup);
+    std::vector<std::pair<size_t, unsigned int>> switches;
+    for (const OBJChunk& chunk : chunks) {
+      for (const std::pair<size_t, unsigned int>& run : chunk.smoothingRuns) {
+        switches.emplace_back(chunk.base.indices / 3 + run.first, run.second);
+      }
+    }
+    for (size_t i = 0; i < switches.size(); ++i) {
+      size_t last = (i + 1 < switches.size()) ? switches[i + 1].first : triangleCount;
+      for (size_t t = switches[i].first; t < last; ++t) {
+        triangle_groups[t] = switches[i].second;
+      }
+    }
+
+    std::vector<unsigned int> position_indices(final_indices.size());
+    parallelForRange(final_indices.size(), threadCount, 1 << 16, [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; ++i) {
+        position_indices[i] = corners[final_indices[i]].v - 1;
+      }
+    });
+    std::vector<XMFLOAT3> corner_normals(final_indices.size());
+    generateCornerNormals(temp_positions.data(), temp_positions.size(), position_indices.data(), triangleCount,
+                          switches.empty() ? nullptr : triangle_groups.data(), options.normalCreaseAngle,
+                          threadCount, corner_normals.data());
+
+    const unsigned int kUnassigned = 0xFFFFFFFFu;
+    generated_normals.resize(corners.size());
+    std::vector<unsigned int> next_split(corners.size(), kUnassigned);
+    std::vector<bool> assigned(corners.size(), false);
+    for (size_t i = 0; i < final_indices.size(); ++i) {
+      unsigned int vertex = final_indices[i];
+      if (corners[vertex].vn != 0) {
+        continue;
+      }
+      const XMFLOAT3& normal = corner_normals[i];
+      if (!assigned[vertex]) {
+        assigned[vertex] = true;
+        generated_normals[vertex] = normal;
+        continue;
+      }
+      // Compared by value so -0 and +0 components do not split a vertex.
+      auto sameNormal = [&](unsigned int id) {
+        const XMFLOAT3& other = generated_normals[id];
+        return other.x == normal.x && other.y == normal.y && other.z == normal.z;
+      };
+      unsigned int candidate = vertex;
+      while (!sameNormal(candidate) && next_split[candidate] != kUnassigned) {
+        candidate = next_split[candidate];
+      }
+      if (!sameNormal(candidate)) {
+        unsigned int split = static_cast<unsigned int>(corners.size());
+        corners.push_back(corners[vertex]);
+        generated_normals.push_back(normal);
+        next_split.push_back(kUnassigned);
+        assigned.push_back(true);
+        next_split[candidate] = split;
+        ++m_stats.normalSplits;
+        candidate = split;
+      }
+      final_indices[i] = candidate;
+    }
+  }
+
+  // Resolve the usemtl runs to material ids in order of first use. Faces before
+  // any usemtl get a default material; consecutive runs of one material merge.
+  std::vector<std::pair<size_t, unsigned int>> material_runs;
+  std::vector<std::string> material_names;
+  std::vector<std::string> libraries;
+  {
+    std::vector<std::pair<size_t, const std::string*>> switches;
+    const std::string noMaterial;
+    switches.emplace_back(0, &noMaterial);
+    for (const OBJChunk& chunk : chunks) {
+      for (const OBJMaterialRun& run : chunk.materialRuns) {
+        switches.emplace_back(chunk.base.indices / 3 + run.firstTriangle, &run.name);
+      }
+      for (const std::string& library : chunk.libraries) {
+        if (std::find(libraries.begin(), libraries.end(), library) == libraries.end()) {
+          libraries.push_back(library);
+        }
+      }
+    }
+
+    std::map<std::string, unsigned int> material_ids;
+    size_t triangleCount = final_indices.size() / 3;
+    for (size_t i = 0; i < switches.size(); ++i) {
+      size_t last = (i + 1 < switches.size()) ? switches[i + 1].first : triangleCount;
+      if (last <= switches[i].first) {
+        continue;
+      }
+      auto found = material_ids.lower_bound(*switches[i].second);
+      if (found == material_ids.end() || found->first != *switches[i].second) {
+        found = material_ids.emplace_hint(found, *switches[i].second, static_cast<unsigned int>(material_names.size()));
+        material_names.push_back(*switches[i].second);
+      }
+      if (material_runs.empty() || material_runs.back().second != found->second) {
+        material_runs.emplace_back(switches[i].first, found->second);
+      }
+    }
+  }
+  groupTrianglesByMaterial(final_indices, material_runs, material_names.size(), threadCount, outMesh.m_submeshes);
+
+  // Material libraries are small; they are parsed after the geometry and
+  // recorded as cache dependencies so editing them invalidates the .novamesh.
+  std::vector<MeshCacheDependency> dependencies;
+  std::map<std::string, MeshMaterial> library;
+  std::string directory = directoryOf(filename);
+  for (const std::string& name : libraries) {
+    dependencies.push_back(loadMaterialLibrary(resolvePath(directory, name), library));
+  }
+  std::vector<std::string> missing;
+  buildMaterials(material_names, library, outMesh.m_materials, &missing);
+  for (const std::string& name : missing) {
+    REPORT("ModelLoader", "LoadOBJ", ("Material not found in any library: " + name).c_str());
+  }
+
+  std::vector<SimpleVertex> final_vertices(corners.size());
+  m_stats.chunks = chunks.size();
+  m_stats.peakBytes = file.size() +
+    temp_positions.capacity() * sizeof(XMFLOAT3) +
+    temp_uvs.capacity() * sizeof(XMFLOAT2) +
+    temp_normals.capacity() * sizeof(XMFLOAT3) +
+    corners.capacity() * sizeof(OBJCorner) +
+    final_indices.capacity() * sizeof(unsigned int) +
+    generated_normals.capacity() * sizeof(XMFLOAT3) +
+    final_vertices.capacity() * sizeof(SimpleVertex);
+  parallelForRange(corners.size(), threadCount, 1 << 16, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      const OBJCorner& corner = corners[i];
+      SimpleVertex& vertex = final_vertices[i];
+      vertex.Pos = temp_positions[corner.v - 1];
+      vertex.Tex = (corner.vt > 0) ? temp_uvs[corner.vt - 1] : XMFLOAT2(0, 0);
+      if (corner.vn > 0) {
+        vertex.Normal = temp_normals[corner.vn - 1];
+      }
+      else {
+        vertex.Normal = generated_normals.empty() ? XMFLOAT3(0, 1, 0) : generated_normals[i];
+      }
+    }
+  });
+
+  outMesh.m_vertex = std::move(final_vertices);
+  outMesh.m_index = std::move(final_indices);
+  outMesh.m_numVertex = static_cast<int>(outMesh.m_vertex.size());
+  outMesh.m_numIndex = static_cast<int>(outMesh.m_index.size());
+  outMesh.computeBounds();
+  applyMeshPasses(outMesh, options);
+
+  // A failed cache write only costs the next launch a re-parse.
+  if (options.useCache) {
+    m_meshCache.save(cachePath, file.size(), sourceHash, outMesh, dependencies, options.compressCache);
+  }
+
+  m_stats.seconds = timer.elapsedSeconds();
+  std::ostringstream report;
+  report << fullPath << " " << m_stats.bytes << " bytes, " << outMesh.m_numVertex << " vertices, "
+         << outMesh.m_numIndex << " indices, " << outMesh.m_submeshes.size() << " submeshes in "
+         << m_stats.seconds * 1000.0 << " ms ("
+         << m_stats.megabytesPerSecond() << " MB/s, " << chunks.size() << " chunks, peak "
+         << m_stats.peakBytes / (1024 * 1024) << " MB)";
+  REPORT("ModelLoader", "LoadOBJ", report.str().c_str());
+
+  return true;
+}
+
+void
+ModelLoader::applyMeshPasses(MeshComponent& mesh, const ModelLoadOptions& options) {
+  if (mesh.m_index.empty()) {
+    return;
+  }
+  if (options.cleanupMesh) {
+    Timer timer;
+    m_stats.cleanup = cleanupMesh(mesh, options.cleanupOptions, options.threadCount);
+    m_stats.cleanupSeconds = timer.elapsedSeconds();
+    const MeshCleanupStats& cleanup = m_stats.cleanup;
+    std::ostringstream report;
+    report << "Cleanup: " << cleanup.verticesBefore << " -> " << cleanup.verticesAfter << " vertices ("
+           << cleanup.weldedVertices << " welded, " << cleanup.unusedVertices << " unused), "
+           << cleanup.indicesBefore << " -> " << cleanup.indicesAfter << " indices ("
+           << cleanup.degenerateTriangles << " degenerate, " << cleanup.duplicateTriangles
+           << " duplicate triangles) in " << m_stats.cleanupSeconds * 1000.0 << " ms";
+    REPORT("ModelLoader", "applyMeshPasses", report.str().c_str());
+  }
+  if (options.generateTangents) {
+    Timer timer;
+    m_stats.tangentSplits = generateTangents(mesh, options.threadCount);
+    m_stats.tangentSeconds = timer.elapsedSeconds();
+  }
+  if (options.lodCount > 0) {
+    Timer timer;
+    size_t fullTriangles = mesh.m_index.size() / 3;
+    generateLods(mesh, options.lodCount, options.lodRatio, options.lodMaxError, options.threadCount);
+    m_stats.lodSeconds = timer.elapsedSeconds();
+    std::ostringstream report;
+    report << "Levels of detail: " << fullTriangles << " triangles";
+    for (const MeshLod& lod : mesh.m_lods) {
+      size_t triangles = 0;
+      for (const MeshSubmesh& submesh : lod.submeshes) {
+        triangles += submesh.indexCount / 3;
+      }
+      report << ", " << triangles << " (error " << lod.error << ")";
+    }
+    report << " in " << m_stats.lodSeconds * 1000.0 << " ms";
+    REPORT("ModelLoader", "applyMeshPasses", report.str().c_str());
+  }
+  if (options.optimizeVertexCache || options.optimizeOverdraw) {
+    Timer timer;
+    m_stats.vertexCacheBefore = analyzeVertexCache(mesh.m_index.data(), mesh.m_index.size(), mesh.m_vertex.size());
+    optimizeVertexCache(mesh, options.threadCount);
+    if (options.optimizeOverdraw) {
+      optimizeOverdraw(mesh, options.overdrawThreshold, options.threadCount);
+    }
+    m_stats.vertexCacheAfter = analyzeVertexCache(mesh.m_index.data(), mesh.m_index.size(), mesh.m_vertex.size());
+    std::ostringstream report;
+    report << (options.optimizeOverdraw ? "Vertex cache and overdraw order" : "Vertex cache order") << ": ACMR "
+           << m_stats.vertexCacheBefore.acmr << " -> " << m_stats.vertexCacheAfter.acmr << ", ATVR "
+           << m_stats.vertexCacheBefore.atvr << " -> " << m_stats.vertexCacheAfter.atvr << " in "
+           << timer.elapsedSeconds() * 1000.0 << " ms";
+    REPORT("ModelLoader", "applyMeshPasses", report.str().c_str());
+  }
+  if (options.buildClusters) {
+    Timer timer;
+    size_t clusterCount = buildClusters(mesh, options.clusterMaxVertices, options.clusterMaxTriangles,
+                                        kDefaultClusterConeWeight,
+                                        options.threadCount);
+    m_stats.clusterSeconds = timer.elapsedSeconds();
+    size_t triangles = 0;
+    size_t vertices = 0;
+    size_t cones = 0;
+    for (const MeshCluster& cluster : mesh.m_clusters) {
+      triangles += cluster.indexCount / 3;
+      vertices += cluster.vertexCount;
+      cones += (cluster.coneCutoff < 1.0f) ? 1 : 0;
+    }
+    std::ostringstream report;
+    report << "Clusters: " << clusterCount << ", " << static_cast<double>(triangles) / std::max<size_t>(1, clusterCount)
+           << " triangles and " << static_cast<double>(vertices) / std::max<size_t>(1, clusterCount)
+           << " vertices on average, " << cones << " with a backface cone in " << m_stats.clusterSeconds * 1000.0
+           << " ms";
+    REPORT("ModelLoader", "applyMeshPasses", report.str().c_str());
+  }
+  if (options.optimizeVertexFetch) {
+    Timer timer;
+    m_stats.vertexFetchBefore = analyzeVertexFetch(mesh);
+    m_stats.unusedVertices = optimizeVertexFetch(mesh);
+    m_stats.vertexFetchAfter = analyzeVertexFetch(mesh);
+    std::ostringstream report;
+    report << "Vertex fetch order: overfetch " << m_stats.vertexFetchBefore.overfetch << " -> "
+           << m_stats.vertexFetchAfter.overfetch << ", " << m_stats.unusedVertices << " unused vertices removed in "
+           << timer.elapsedSeconds() * 1000.0 << " ms";
+    REPORT("ModelLoader", "applyMeshPasses", report.str().c_str());
+  }
+}
+
+std::shared_ptr<ModelLoadTask>
+ModelLoader::LoadOBJAsync(const std::string& filename, const ModelLoadOptions& options) {
+  std::shared_ptr<ModelLoadTask> task = std::make_shared<ModelLoadTask>();
+  if (FAILED(task->init(filename, options))) {
+    return nullptr;
+  }
+  return task;
+}
+
+bool
+ModelLoader::StreamOBJ(const std::string& filename,
+                       const ModelStreamOptions& options,
+                       const MeshChunkCallback& onChunk) {
+  Timer timer;
+
+  std::string fullPath = filename + ".obj";
+  MappedFile file;
+  if (FAILED(file.init(fullPath, false))) {
+    ERROR("ModelLoader", "StreamOBJ", ("No se pudo abrir el archivo: " + fullPath).c_str());
+    return false;
+  }
+  m_stats = ModelLoadStats();
+  m_stats.bytes = file.size();
+
+  // Budget split: an eighth for the source window, a quarter for the attribute
+  // page caches, the rest for the chunk being assembled.
+  size_t budget = std::max(options.memoryBudget, kMinStreamBudget);
+  size_t windowBytes = budget / 8;
+  size_t cacheBytes = budget / 4;
+  size_t chunkBytes = budget - windowBytes - cacheBytes;
+
+  SpillFile positions;
+  SpillFile uvs;
+  SpillFile normals;
+  if (FAILED(positions.init(options.tempDirectory, sizeof(XMFLOAT3), cacheBytes / 2)) ||
+      FAILED(uvs.init(options.tempDirectory, sizeof(XMFLOAT2), cacheBytes / 4)) ||
+      FAILED(normals.init(options.tempDirectory, sizeof(XMFLOAT3), cacheBytes / 4))) {
+    return false;
+  }
+
+  // A chunk vertex costs the vertex plus at most four 16-byte table slots (load
+  // factor 0.5, capacity rounded up to a power of two). Indices are budgeted
+  // twice because grouping by material copies them.
+  size_t maxVertices = std::max<size_t>(4, (chunkBytes / 2) / (sizeof(SimpleVertex) + 64));
+  size_t maxIndices = std::max<size_t>(6, (chunkBytes / 2) / (2 * sizeof(unsigned int)));
+
+  VertexDedupTable table;
+  table.init(maxVertices);
+  std::vector<SimpleVertex> vertices;
+  std::vector<unsigned int> indices;
+  vertices.reserve(maxVertices);
+  indices.reserve(maxIndices);
+
+  std::vector<std::pair<size_t, unsigned int>> runs;
+  std::vector<std::string> materialNames;
+  std::map<std::string, unsigned int> materialIds;
+  std::map<std::string, MeshMaterial> library;
+  std::vector<std::string> libraries;
+  std::string activeMaterial;
+  bool materialChanged = true;
+  std::string directory = directoryOf(filename);
+  std::string error;
+
+  auto trackPeak = [&](size_t extra) {
+    unsigned long long held = file.viewSize() +
+      positions.memoryBytes() + uvs.memoryBytes() + normals.memoryBytes() +
+      table.memoryBytes() +
+      vertices.capacity() * sizeof(SimpleVertex) +
+      indices.capacity() * sizeof(unsigned int) + extra;
+    m_stats.peakBytes = std::max(m_stats.peakBytes, held);
+  };
+
+  auto emitChunk = [&]() -> bool {
+    if (indices.empty()) {
+      return true;
+    }
+    trackPeak(indices.size() * sizeof(unsigned int));
+    bool keepGoing = true;
+    {
+      MeshComponent mesh;
+      groupTrianglesByMaterial(indices, runs, materialNames.size(), 1, mesh.m_submeshes);
+      mesh.m_vertex = std::move(vertices);
+      mesh.m_index = std::move(indices);
+      mesh.m_numVertex = static_cast<int>(mesh.m_vertex.size());
+      mesh.m_numIndex = static_cast<int>(mesh.m_index.size());
+      buildMaterials(materialNames, library, mesh.m_materials, nullptr);
+      mesh.computeBounds();
+      ++m_stats.chunks;
+      keepGoing = onChunk(mesh);
+    }
+    vertices = std::vector<SimpleVertex>();
+    indices = std::vector<unsigned int>();
+    vertices.reserve(maxVertices);
+    indices.reserve(maxIndices);
+    table.clear();
+    runs.clear();
+    return keepGoing;
+  };
+
+  auto processLine = [&](const char* cursor, const char* lineEnd) -> bool {
+    const char* prefixEnd = nullptr;
+    switch (classifyLine(skipBlanks(cursor, lineEnd), lineEnd, prefixEnd)) {
+    case OBJ_POSITION: {
+      XMFLOAT3 position;
+      scanFloats(prefixEnd, lineEnd, &position.x, 3);
+      return SUCCEEDED(positions.append(&position));
+    }
+    case OBJ_UV: {
+      XMFLOAT2 tex;
+      scanFloats(prefixEnd, lineEnd, &tex.x, 2);
+      tex.y = 1.0f - tex.y;
+      return SUCCEEDED(uvs.append(&tex));
+    }
+    case OBJ_NORMAL: {
+      XMFLOAT3 normal;
+      scanFloats(prefixEnd, lineEnd, &normal.x, 3);
+      return SUCCEEDED(normals.append(&normal));
+    }
+    case OBJ_FACE: {
+      OBJCorner face[4];
+      unsigned int vertex_count = 0;
+      if (!scanFace(prefixEnd, lineEnd, positions.count(), uvs.count(), normals.count(), face, vertex_count, error)) {
+        return false;
+      }
+      if (vertex_count < 3) {
+        return true;
+      }
+      if (vertices.size() + 4 > maxVertices || indices.size() + 6 > maxIndices) {
+        if (!emitChunk()) {
+          error = "Import stopped by the caller";
+          return false;
+        }
+      }
+
+      if (materialChanged || runs.empty()) {
+        auto found = materialIds.lower_bound(activeMaterial);
+        if (found == materialIds.end() || found->first != activeMaterial) {
+          found = materialIds.emplace_hint(found, activeMaterial, static_cast<unsigned int>(materialNames.size()));
+          materialNames.push_back(activeMaterial);
+        }
+        if (runs.empty() || runs.back().second != found->second) {
+          runs.emplace_back(indices.size() / 3, found->second);
+        }
+        materialChanged = false;
+      }
+
+      unsigned int local_indices[4];
+      for (unsigned int i = 0; i < vertex_count; ++i) {
+        bool inserted = false;
+        local_indices[i] = table.findOrInsert(face[i], static_cast<unsigned int>(vertices.size()), inserted);
+        if (!inserted) {
+          continue;
+        }
+        SimpleVertex vertex;
+        const void* position = positions.read(face[i].v - 1);
+        const void* tex = face[i].vt ? uvs.read(face[i].vt - 1) : nullptr;
+        const void* normal = face[i].vn ? normals.read(face[i].vn - 1) : nullptr;
+        if (!position || (face[i].vt && !tex) || (face[i].vn && !normal)) {
+          error = "Failed to read back spilled attributes";
+          return false;
+        }
+        memcpy(&vertex.Pos, position, sizeof(XMFLOAT3));
+        vertex.Tex = XMFLOAT2(0, 0);
+        vertex.Normal = XMFLOAT3(0, 1, 0);
+        if (tex) memcpy(&vertex.Tex, tex, sizeof(XMFLOAT2));
+        if (normal) memcpy(&vertex.Normal, normal, sizeof(XMFLOAT3));
+        vertices.push_back(vertex);
+      }
+
+      indices.push_back(local_indices[0]);
+      indices.push_back(local_indices[1]);
+      indices.push_back(local_indices[2]);
+      if (vertex_count == 4) {
+        indices.push_back(local_indices[0]);
+        indices.push_back(local_indices[2]);
+        indices.push_back(local_indices[3]);
+      }
+      return true;
+    }
+    case OBJ_USEMTL: {
+      std::string name = trimmedRest(prefixEnd, lineEnd);
+      if (name != activeMaterial) {
+        activeMaterial = name;
+        materialChanged = true;
+      }
+      return true;
+    }
+    case OBJ_MTLLIB: {
+      const char* token = skipBlanks(prefixEnd, lineEnd);
+      while (token < lineEnd) {
+        const char* tokenEnd = skipToken(token, lineEnd);
+        std::string path = resolvePath(directory, std::string(token, tokenEnd));
+        if (std::find(libraries.begin(), libraries.end(), path) == libraries.end()) {
+          libraries.push_back(path);
+          loadMaterialLibrary(path, library);
+        }
+        token = skipBlanks(tokenEnd, lineEnd);
+      }
+      return true;
+    }
+    default:
+      return true;
+    }
+  };
+
+  // Slide a mapped window over the file. Only whole lines are consumed; a line
+  // cut by the window end is re-read from the start of the next window.
+  unsigned long long offset = 0;
+  unsigned long long fileSize = file.size();
+  while (offset < fileSize && error.empty()) {
+    size_t span = static_cast<size_t>(std::min<unsigned long long>(windowBytes, fileSize - offset));
+    bool lastWindow = (offset + span == fileSize);
+    const char* begin = file.mapWindow(offset, span);
+    if (!begin) {
+      error = "Failed to map file window";
+      break;
+    }
+    trackPeak(0);
+
+    const char* end = begin + span;
+    const char* cursor = begin;
+    while (cursor < end) {
+      const char* lineEnd = static_cast<const char*>(memchr(cursor, '\n', static_cast<size_t>(end - cursor)));
+      if (!lineEnd) {
+        if (!lastWindow) break;
+        lineEnd = end;
+      }
+      if (!processLine(cursor, lineEnd)) {
+        if (error.empty()) {
+          error = "Failed to spill vertex attributes";
+        }
+        break;
+      }
+      cursor = lineEnd + 1;
+    }
+    if (!error.empty()) {
+      break;
+    }
+
+    if (cursor == begin) {
+      // A single line longer than the window: widen the window and retry.
+      windowBytes *= 2;
+      continue;
+    }
+    offset += std::min<unsigned long long>(static_cast<unsigned long long>(cursor - begin), span);
+  }
+  if (error.empty() && !emitChunk()) {
+    error = "Import stopped by the caller";
+  }
+
+  m_stats.spilledBytes = positions.spilledBytes() + uvs.spilledBytes() + normals.spilledBytes();
+  m_stats.seconds = timer.elapsedSeconds();
+  if (!error.empty()) {
+    ERROR("ModelLoader", "StreamOBJ", (error + " in " + fullPath).c_str());
+    return false;
+  }
+
+  std::ostringstream report;
+  report << fullPath << " " << m_stats.bytes << " bytes streamed in " << m_stats.chunks << " chunks in "
+         << m_stats.seconds * 1000.0 << " ms (" << m_stats.megabytesPerSecond() << " MB/s, peak "
+         << m_stats.peakBytes / (1024 * 1024) << " MB of " << budget / (1024 * 1024) << " MB budget, spilled "
+         << m_stats.spilledBytes / (1024 * 1024) << " MB, process peak working set "
+         << processPeakWorkingSet() / (1024 * 1024) << " MB)";
+  REPORT("ModelLoader", "StreamOBJ", report.str().c_str());
+  return true;
+}
+
+bool
+ModelLoader::LoadOBJReference(const std::string& filename, MeshComponent& outMesh) {
+  Timer timer;
+
+  outMesh.m_vertex.clear();
+  outMesh.m_index.clear();
+  outMesh.m_color.clear();
+  outMesh.m_tangent.clear();
+  outMesh.m_lods.clear();
+  outMesh.m_clusters.clear();
+  outMesh.m_submeshes.clear();
+  outMesh.m_materials.clear();
 
   std::vector<XMFLOAT3> temp_positions;
   std::vector<XMFLOAT2> temp_uvs;
@@ -18,11 +1485,16 @@ ModelLoader::LoadOBJ(const std::string& filename, MeshComponent& outMesh) {
   std::string fullPath = filename + ".obj";
   std::ifstream file(fullPath);
   if (!file.is_open()) {
-    std::wstring errorMsg = L"ERROR: ModelLoader::LoadOBJ : No se pudo abrir el archivo: " + std::wstring(fullPath.begin(), fullPath.end()) + L"\n";
+    std::wstring errorMsg = L"ERROR: ModelLoader::LoadOBJReference : No se pudo abrir el archivo: " + std::wstring(fullPath.begin(), fullPath.end()) + L"\n";
     OutputDebugStringW(errorMsg.c_str());
     return false;
   }
 
+  m_stats = ModelLoadStats();
+  file.seekg(0, std::ios::end);
+  m_stats.bytes = static_cast<unsigned long long>(file.tellg());
+  file.seekg(0, std::ios::beg);
+
   std::string line;
   while (std::getline(file, line)) {
     std::stringstream ss(line);
@@ -107,5 +1579,7 @@ ModelLoader::LoadOBJ(const std::string& filename, MeshComponent& outMesh) {
   outMesh.m_numVertex = static_cast<int>(final_vertices.size());
   outMesh.m_numIndex = static_cast<int>(final_indices.size());
 
+  m_stats.seconds = timer.elapsedSeconds();
+
   return true;
-}
\ No newline at end of file
+}
@@ -0,0 +1,854 @@
+#include "ModelLoader.h"
+#include "JsonValue.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "Timer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+  const uint32_t kGLBMagic = 0x46546C67;      // "glTF"
+  const uint32_t kGLBChunkJSON = 0x4E4F534A;  // "JSON"
+  const uint32_t kGLBChunkBIN = 0x004E4942;   // "BIN\0"
+
+  const int kComponentByte = 5120;
+  const int kComponentUnsignedByte = 5121;
+  const int kComponentShort = 5122;
+  const int kComponentUnsignedShort = 5123;
+  const int kComponentUnsignedInt = 5125;
+  const int kComponentFloat = 5126;
+
+  const int kModeTriangles = 4;
+
+  /*
+    A byte range of a glTF buffer: the GLB binary chunk, an external .bin file or
+    a decoded data: URI.
+  */
+  struct GLTFBuffer {
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+  };
+
+  /*
+    An accessor resolved down to a pointer into its buffer.
+  */
+  struct GLTFAccessor {
+    const unsigned char* data = nullptr;
+    size_t count = 0;
+    size_t stride = 0;
+    int componentType = 0;
+    int components = 0;
+    bool normalized = false;
+  };
+
+  /*
+    Column-major 4x4 matrix, as glTF stores node transforms.
+  */
+  struct GLTFTransform {
+    float m[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    bool identity = true;
+  };
+
+  struct GLTFDraw {
+    size_t mesh = 0;
+    GLTFTransform transform;
+  };
+
+  /*
+    One primitive to copy: its streams and where it lands in the mesh.
+  */
+  struct GLTFPrimitive {
+    GLTFAccessor positions;
+    GLTFAccessor uvs;
+    GLTFAccessor normals;
+    GLTFAccessor indices;
+    bool hasUVs = false;
+    bool hasNormals = false;
+    bool hasIndices = false;
+    const GLTFTransform* transform = nullptr;
+    size_t baseVertex = 0;
+    size_t firstIndex = 0;
+    size_t indexCount = 0;
+    unsigned int materialId = 0;
+    bool directCopy = false;
+    bool sharedVertices = false;
+  };
+
+  inline size_t
+  componentSize(int componentType) {
+    switch (componentType) {
+    case kComponentByte:
+    case kComponentUnsignedByte: return 1;
+    case kComponentShort:
+    case kComponentUnsignedShort: return 2;
+    case kComponentUnsignedInt:
+    case kComponentFloat: return 4;
+    default: return 0;
+    }
+  }
+
+  inline int
+  componentCount(const std::string& type) {
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    if (type == "MAT2") return 4;
+    if (type == "MAT3") return 9;
+    if (type == "MAT4") return 16;
+    return 0;
+  }
+
+  /*
+    Resolves accessor -> bufferView -> buffer and checks that every element lies
+    inside both the view and the buffer.
+  */
+  bool
+  resolveAccessor(const JsonValue& doc,
+                  long long index,
+                  const std::vector<GLTFBuffer>& buffers,
+                  GLTFAccessor& out,
+                  std::string& error) {
+    const JsonValue& accessor = doc["accessors"].item(static_cast<size_t>(index));
+    if (index < 0 || accessor.isNull()) {
+      error = "invalid accessor " + std::to_string(index);
+      return false;
+    }
+    if (accessor.has("sparse") || !accessor.has("bufferView")) {
+      error = "accessor " + std::to_string(index) + " is sparse or has no bufferView (unsupported)";
+      return false;
+    }
+
+    const JsonValue& view = doc["bufferViews"].item(static_cast<size_t>(accessor["bufferView"].asInt(-1)));
+    long long bufferIndex = view["buffer"].asInt(-1);
+    if (view.isNull() || bufferIndex < 0 || static_cast<size_t>(bufferIndex) >= buffers.size()) {
+      error = "accessor " + std::to_string(index) + " references an invalid bufferView";
+      return false;
+    }
+
+    // Counts, offsets, lengths and strides are JSON numbers; a negative one
+    // would wrap around as size_t and slip past the bounds checks below.
+    long long count = accessor["count"].asInt(-1);
+    long long stride = view["byteStride"].asInt(0);
+    long long viewOffset = view["byteOffset"].asInt(0);
+    long long viewLength = view["byteLength"].asInt(-1);
+    long long accessorOffset = accessor["byteOffset"].asInt(0);
+    if (count < 0 || stride < 0 || viewOffset < 0 || viewLength < 0 || accessorOffset < 0) {
+      error = "accessor " + std::to_string(index) + " has a negative or missing count, offset, length or stride";
+      return false;
+    }
+
+    out.componentType = static_cast<int>(accessor["componentType"].asInt());
+    out.components = componentCount(accessor["type"].asString());
+    out.normalized = accessor["normalized"].asBool();
+    out.count = static_cast<size_t>(count);
+    size_t elementSize = componentSize(out.componentType) * static_cast<size_t>(out.components);
+    if (elementSize == 0) {
+      error = "accessor " + std::to_string(index) + " has an unknown component type";
+      return false;
+    }
+    out.stride = static_cast<size_t>(stride);
+    if (out.stride == 0) {
+      out.stride = elementSize;
+    }
+
+    // Written as subtractions of values already known to be in range, so no
+    // sum can overflow.
+    const GLTFBuffer& buffer = buffers[static_cast<size_t>(bufferIndex)];
+    size_t viewStart = static_cast<size_t>(viewOffset);
+    size_t viewSize = static_cast<size_t>(viewLength);
+    size_t elementStart = static_cast<size_t>(accessorOffset);
+    bool inside = viewStart <= buffer.size && viewSize <= buffer.size - viewStart;
+    if (inside && out.count != 0) {
+      inside = elementStart <= viewSize && elementSize <= viewSize - elementStart &&
+               out.count - 1 <= (viewSize - elementStart - elementSize) / out.stride;
+    }
+    if (!inside) {
+      error = "accessor " + std::to_string(index) + " reads past the end of its buffer";
+      return false;
+    }
+    out.data = buffer.data + viewStart + elementStart;
+    return true;
+  }
+
+  bool
+  decodeBase64(const char* p, const char* end, std::vector<unsigned char>& out) {
+    out.clear();
+    out.reserve(static_cast<size_t>(end - p) / 4 * 3);
+    unsigned int bits = 0;
+    int count = 0;
+    for (; p < end; ++p) {
+      char c = *p;
+      unsigned int value;
+      if (c >= 'A' && c <= 'Z') value = static_cast<unsigned int>(c - 'A');
+      else if (c >= 'a' && c <= 'z') value = static_cast<unsigned int>(c - 'a' + 26);
+      else if (c >= '0' && c <= '9') value = static_cast<unsigned int>(c - '0' + 52);
+      else if (c == '+' || c == '-') value = 62;
+      else if (c == '/' || c == '_') value = 63;
+      else if (c == '=') break;
+      else return false;
+      bits = (bits << 6) | value;
+      if (++count == 4) {
+        out.push_back(static_cast<unsigned char>(bits >> 16));
+        out.push_back(static_cast<unsigned char>(bits >> 8));
+        out.push_back(static_cast<unsigned char>(bits));
+        bits = 0;
+        count = 0;
+      }
+    }
+    if (count == 2) {
+      out.push_back(static_cast<unsigned char>(bits >> 4));
+    }
+    else if (count == 3) {
+      out.push_back(static_cast<unsigned char>(bits >> 10));
+      out.push_back(static_cast<unsigned char>(bits >> 2));
+    }
+    return count != 1;
+  }
+
+  /*
+    Value of a hexadecimal digit, or -1 if c is not one.
+  */
+  inline int
+  hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  }
+
+  /*
+    Decodes %XX escapes of a relative URI into a file path; a '%' not followed
+    by two hexadecimal digits is kept as it is.
+  */
+  std::string
+  uriToPath(const std::string& uri) {
+    std::string path;
+    for (size_t i = 0; i < uri.size(); ++i) {
+      if (uri[i] == '%' && i + 2 < uri.size() && hexDigit(uri[i + 1]) >= 0 && hexDigit(uri[i + 2]) >= 0) {
+        path.push_back(static_cast<char>(hexDigit(uri[i + 1]) * 16 + hexDigit(uri[i + 2])));
+        i += 2;
+      }
+      else {
+        path.push_back(uri[i]);
+      }
+    }
+    return path;
+  }
+
+  inline std::string
+  directoryOf(const std::string& path) {
+    size_t slash = path.find_last_of("/\\");
+    return (slash == std::string::npos) ? std::string() : path.substr(0, slash + 1);
+  }
+
+  GLTFTransform
+  multiply(const GLTFTransform& a, const GLTFTransform& b) {
+    if (a.identity) return b;
+    if (b.identity) return a;
+    GLTFTransform r;
+    for (int col = 0; col < 4; ++col) {
+      for (int row = 0; row < 4; ++row) {
+        float sum = 0.0f;
+        for (int k = 0; k < 4; ++k) {
+          sum += a.m[k * 4 + row] * b.m[col * 4 + k];
+        }
+        r.m[col * 4 + row] = sum;
+      }
+    }
+    r.identity = false;
+    return r;
+  }
+
+  /*
+    A node's local transform: its matrix, or translation * rotation * scale.
+  */
+  GLTFTransform
+  nodeTransform(const JsonValue& node) {
+    GLTFTransform t;
+    const JsonValue& matrix = node["matrix"];
+    if (matrix.size() == 16) {
+      for (size_t i = 0; i < 16; ++i) {
+        t.m[i] = static_cast<float>(matrix.item(i).asNumber());
+      }
+    }
+    else {
+      const JsonValue& translation = node["translation"];
+      const JsonValue& rotation = node["rotation"];
+      const JsonValue& scale = node["scale"];
+      float tx = static_cast<float>(translation.item(0).asNumber(0));
+      float ty = static_cast<float>(translation.item(1).asNumber(0));
+      float tz = static_cast<float>(translation.item(2).asNumber(0));
+      float x = static_cast<float>(rotation.item(0).asNumber(0));
+      float y = static_cast<float>(rotation.item(1).asNumber(0));
+      float z = static_cast<float>(rotation.item(2).asNumber(0));
+      float w = static_cast<float>(rotation.item(3).asNumber(1));
+      float sx = static_cast<float>(scale.item(0).asNumber(1));
+      float sy = static_cast<float>(scale.item(1).asNumber(1));
+      float sz = static_cast<float>(scale.item(2).asNumber(1));
+      t.m[0] = (1 - 2 * (y * y + z * z)) * sx;
+      t.m[1] = (2 * (x * y + z * w)) * sx;
+      t.m[2] = (2 * (x * z - y * w)) * sx;
+      t.m[4] = (2 * (x * y - z * w)) * sy;
+      t.m[5] = (1 - 2 * (x * x + z * z)) * sy;
+      t.m[6] = (2 * (y * z + x * w)) * sy;
+      t.m[8] = (2 * (x * z + y * w)) * sz;
+      t.m[9] = (2 * (y * z - x * w)) * sz;
+      t.m[10] = (1 - 2 * (x * x + y * y)) * sz;
+      t.m[12] = tx;
+      t.m[13] = ty;
+      t.m[14] = tz;
+    }
+    static const float kIdentity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    t.identity = memcmp(t.m, kIdentity, sizeof(kIdentity)) == 0;
+    return t;
+  }
+
+  /*
+    Walks the node hierarchy and records every mesh instance with its world transform.
+    glTF nodes form trees, so each node is expanded once: a node listed as a
+    child several times, or in a cycle, cannot multiply the draws.
+  */
+  void
+  collectDraws(const JsonValue& doc,
+               size_t nodeIndex,
+               const GLTFTransform& parent,
+               int depth,
+               std::vector<bool>& visited,
+               std::vector<GLTFDraw>& draws) {
+    const JsonValue& node = doc["nodes"].item(nodeIndex);
+    if (node.isNull() || depth > 64 || visited[nodeIndex]) {
+      return;
+    }
+    visited[nodeIndex] = true;
+    GLTFTransform world = multiply(parent, nodeTransform(node));
+    if (node.has("mesh")) {
+      GLTFDraw draw;
+      draw.mesh = static_cast<size_t>(node["mesh"].asInt());
+      draw.transform = world;
+      draws.push_back(draw);
+    }
+    const JsonValue& children = node["children"];
+    for (size_t i = 0; i < children.size(); ++i) {
+      collectDraws(doc, static_cast<size_t>(children.item(i).asInt()), world, depth + 1, visited, draws);
+    }
+  }
+
+  inline float
+  normalizedComponent(const unsigned char* p, int componentType) {
+    switch (componentType) {
+    case kComponentUnsignedByte: return *p / 255.0f;
+    case kComponentUnsignedShort: {
+      unsigned short value;
+      memcpy(&value, p, sizeof(value));
+      return value / 65535.0f;
+    }
+    case kComponentFloat: {
+      float value;
+      memcpy(&value, p, sizeof(value));
+      return value;
+    }
+    default: return 0.0f;
+    }
+  }
+
+  inline XMFLOAT3
+  transformPoint(const float* m, const XMFLOAT3& p) {
+    return XMFLOAT3(m[0] * p.x + m[4] * p.y + m[8] * p.z + m[12],
+                    m[1] * p.x + m[5] * p.y + m[9] * p.z + m[13],
+                    m[2] * p.x + m[6] * p.y + m[10] * p.z + m[14]);
+  }
+
+  /*
+    Normals go through the cofactor matrix of the upper 3x3 (the inverse transpose
+    up to scale), then are renormalized.
+  */
+  inline XMFLOAT3
+  transformNormal(const float* c, const XMFLOAT3& n) {
+    XMFLOAT3 r(c[0] * n.x + c[3] * n.y + c[6] * n.z,
+               c[1] * n.x + c[4] * n.y + c[7] * n.z,
+               c[2] * n.x + c[5] * n.y + c[8] * n.z);
+    float length = std::sqrt(r.x * r.x + r.y * r.y + r.z * r.z);
+    if (length > 0.0f) {
+      r.x /= length;
+      r.y /= length;
+      r.z /= length;
+    }
+    return r;
+  }
+
+  /*
+    Copies one primitive's vertices. When positions, texture coordinates and
+    normals are interleaved floats at SimpleVertex offsets with a 32-byte stride
+    and the node transform is identity, the whole range is one block copy.
+  */
+  void
+  copyVertices(const GLTFPrimitive& primitive, size_t first, size_t last, SimpleVertex* out) {
+    if (primitive.directCopy) {
+      memcpy(out + first, primitive.positions.data + first * sizeof(SimpleVertex), (last - first) * sizeof(SimpleVertex));
+      return;
+    }
+
+    const float* m = primitive.transform->m;
+    float cofactor[9] = {
+      m[5] * m[10] - m[6] * m[9], m[6] * m[8] - m[4] * m[10], m[4] * m[9] - m[5] * m[8],
+      m[2] * m[9] - m[1] * m[10], m[0] * m[10] - m[2] * m[8], m[1] * m[8] - m[0] * m[9],
+      m[1] * m[6] - m[2] * m[5], m[2] * m[4] - m[0] * m[6], m[0] * m[5] - m[1] * m[4] };
+    bool uvFloat = primitive.hasUVs && primitive.uvs.componentType == kComponentFloat;
+
+    for (size_t i = first; i < last; ++i) {
+      SimpleVertex& vertex = out[i];
+      memcpy(&vertex.Pos, primitive.positions.data + i * primitive.positions.stride, sizeof(XMFLOAT3));
+
+      if (uvFloat) {
+        memcpy(&vertex.Tex, primitive.uvs.data + i * primitive.uvs.stride, sizeof(XMFLOAT2));
+      }
+      else if (primitive.hasUVs) {
+        const unsigned char* uv = primitive.uvs.data + i * primitive.uvs.stride;
+        size_t size = componentSize(primitive.uvs.componentType);
+        vertex.Tex = XMFLOAT2(normalizedComponent(uv, primitive.uvs.componentType),
+                              normalizedComponent(uv + size, primitive.uvs.componentType));
+      }
+      else {
+        vertex.Tex = XMFLOAT2(0, 0);
+      }
+
+      if (primitive.hasNormals) {
+        memcpy(&vertex.Normal, primitive.normals.data + i * primitive.normals.stride, sizeof(XMFLOAT3));
+      }
+      else {
+        vertex.Normal = XMFLOAT3(0, 1, 0);
+      }
+
+      if (!primitive.transform->identity) {
+        vertex.Pos = transformPoint(m, vertex.Pos);
+        vertex.Normal = transformNormal(cofactor, vertex.Normal);
+      }
+    }
+  }
+
+  /*
+    Copies one primitive's indices, rebased onto its first vertex in the shared
+    vertex array. Returns the largest local index so the caller can validate it.
+  */
+  unsigned int
+  copyIndices(const GLTFPrimitive& primitive, size_t first, size_t last, unsigned int* out) {
+    unsigned int base = static_cast<unsigned int>(primitive.baseVertex);
+    unsigned int maxIndex = 0;
+    unsigned int* dst = out + primitive.firstIndex;
+    if (!primitive.hasIndices) {
+      for (size_t i = first; i < last; ++i) {
+        dst[i] = base + static_cast<unsigned int>(i);
+      }
+      return last > first ? static_cast<unsigned int>(last - 1) : 0;
+    }
+
+    const unsigned char* src = primitive.indices.data;
+    size_t stride = primitive.indices.stride;
+    switch (primitive.indices.componentType) {
+    case kComponentUnsignedInt:
+      if (stride == sizeof(unsigned int)) {
+        const unsigned int* indices = reinterpret_cast<const unsigned int*>(src);
+        for (size_t i = first; i < last; ++i) {
+          unsigned int index;
+          memcpy(&index, indices + i, sizeof(index));
+          maxIndex = std::max(maxIndex, index);
+          dst[i] = base + index;
+        }
+        break;
+      }
+      for (size_t i = first; i < last; ++i) {
+        unsigned int index;
+        memcpy(&index, src + i * stride, sizeof(index));
+        maxIndex = std::max(maxIndex, index);
+        dst[i] = base + index;
+      }
+      break;
+    case kComponentUnsignedShort:
+      for (size_t i = first; i < last; ++i) {
+        unsigned short index;
+        memcpy(&index, src + i * stride, sizeof(index));
+        maxIndex = std::max<unsigned int>(maxIndex, index);
+        dst[i] = base + index;
+      }
+      break;
+    default:
+      for (size_t i = first; i < last; ++i) {
+        unsigned int index = src[i * stride];
+        maxIndex = std::max(maxIndex, index);
+        dst[i] = base + index;
+      }
+      break;
+    }
+    return maxIndex;
+  }
+
+  /*
+    Converts glTF materials; baseColor stands in for the diffuse color and texture.
+    Images embedded in buffer views have no file path and are left out.
+  */
+  MeshMaterial
+  convertMaterial(const JsonValue& doc, const JsonValue& material, const std::string& directory) {
+    MeshMaterial out;
+    out.name = material["name"].asString();
+    const JsonValue& pbr = material["pbrMetallicRoughness"];
+    const JsonValue& factor = pbr["baseColorFactor"];
+    if (factor.size() == 4) {
+      out.diffuse = XMFLOAT3(static_cast<float>(factor.item(0).asNumber(1)),
+                             static_cast<float>(factor.item(1).asNumber(1)),
+                             static_cast<float>(factor.item(2).asNumber(1)));
+      out.opacity = static_cast<float>(factor.item(3).asNumber(1));
+    }
+
+    auto texturePath = [&](const JsonValue& textureInfo) -> std::string {
+      if (!textureInfo.has("index")) return std::string();
+      const JsonValue& texture = doc["textures"].item(static_cast<size_t>(textureInfo["index"].asInt()));
+      const JsonValue& image = doc["images"].item(static_cast<size_t>(texture["source"].asInt(-1)));
+      const std::string& uri = image["uri"].asString();
+      if (uri.empty() || uri.compare(0, 5, "data:") == 0) return std::string();
+      return directory + uriToPath(uri);
+    };
+    out.diffuseTexture = texturePath(pbr["baseColorTexture"]);
+    out.normalTexture = texturePath(material["normalTexture"]);
+    return out;
+  }
+}
+
+bool
+ModelLoader::LoadGLTF(const std::string& fileName,
+                      MeshComponent& outMesh,
+                      const ModelLoadOptions& options) {
+  Timer timer;
+
+  outMesh.m_vertex.clear();
+  outMesh.m_index.clear();
+  outMesh.m_color.clear();
+  outMesh.m_tangent.clear();
+  outMesh.m_lods.clear();
+  outMesh.m_clusters.clear();
+  outMesh.m_submeshes.clear();
+  outMesh.m_materials.clear();
+  m_stats = ModelLoadStats();
+
+  MappedFile file;
+  if (FAILED(file.init(fileName))) {
+    ERROR("ModelLoader", "LoadGLTF", ("No se pudo abrir el archivo: " + fileName).c_str());
+    return false;
+  }
+  m_stats.bytes = file.size();
+  ModelLoadProgress* progress = options.progress;
+  if (progress) {
+    progress->bytesTotal.store(file.size(), std::memory_order_relaxed);
+  }
+  auto cancelRequested = [&]() {
+    return progress && progress->cancel.load(std::memory_order_relaxed);
+  };
+
+  // A .glb is a 12-byte header followed by a JSON chunk and an optional BIN chunk;
+  // anything else is treated as .gltf JSON text.
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(file.data());
+  const char* jsonBegin = file.data();
+  const char* jsonEnd = file.data() + file.size();
+  GLTFBuffer binChunk;
+  uint32_t magic = 0;
+  if (file.size() >= 12) {
+    memcpy(&magic, bytes, sizeof(magic));
+  }
+  if (magic == kGLBMagic) {
+    uint32_t header[3];
+    memcpy(header, bytes, sizeof(header));
+    size_t length = std::min<size_t>(header[2], file.size());
+    size_t offset = 12;
+    bool haveJSON = false;
+    while (offset + 8 <= length) {
+      uint32_t chunk[2];
+      memcpy(chunk, bytes + offset, sizeof(chunk));
+      size_t chunkStart = offset + 8;
+      if (chunk[0] > length - chunkStart) {
+        break;
+      }
+      if (chunk[1] == kGLBChunkJSON && !haveJSON) {
+        jsonBegin = file.data() + chunkStart;
+        jsonEnd = jsonBegin + chunk[0];
+        haveJSON = true;
+      }
+      else if (chunk[1] == kGLBChunkBIN && !binChunk.data) {
+        binChunk.data = bytes + chunkStart;
+        binChunk.size = chunk[0];
+      }
+      offset = chunkStart + ((chunk[0] + 3) & ~3u);
+    }
+    if (header[1] != 2 || !haveJSON) {
+      ERROR("ModelLoader", "LoadGLTF", ("Unsupported or truncated GLB file: " + fileName).c_str());
+      return false;
+    }
+  }
+
+  JsonValue doc;
+  std::string error;
+  if (!JsonValue::parse(jsonBegin, jsonEnd, doc, error)) {
+    ERROR("ModelLoader", "LoadGLTF", ("Invalid glTF JSON (" + error + ") in " + fileName).c_str());
+    return false;
+  }
+  if (doc["asset"]["version"].asString().compare(0, 1, "2") != 0) {
+    ERROR("ModelLoader", "LoadGLTF", ("Only glTF 2.0 is supported: " + fileName).c_str());
+    return false;
+  }
+
+  // Buffers stay where they are: the GLB chunk and external files are mapped and
+  // accessors point straight into them. Only data: URIs are decoded into memory.
+  std::string directory = directoryOf(fileName);
+  const JsonValue& bufferList = doc["buffers"];
+  std::vector<GLTFBuffer> buffers(bufferList.size());
+  std::vector<std::unique_ptr<MappedFile>> externalFiles;
+  std::vector<std::vector<unsigned char>> decoded;
+  decoded.reserve(bufferList.size());
+  for (size_t i = 0; i < bufferList.size(); ++i) {
+    const JsonValue& buffer = bufferList.item(i);
+    const std::string& uri = buffer["uri"].asString();
+    size_t byteLength = static_cast<size_t>(buffer["byteLength"].asInt());
+    if (uri.empty()) {
+      if (i != 0 || !binChunk.data) {
+        ERROR("ModelLoader", "LoadGLTF", ("Buffer without uri and no GLB binary chunk in " + fileName).c_str());
+        return false;
+      }
+      buffers[i] = binChunk;
+    }
+    else if (uri.compare(0, 5, "data:") == 0) {
+      size_t comma = uri.find(";base64,");
+      decoded.emplace_back();
+      if (comma == std::string::npos ||
+          !decodeBase64(uri.data() + comma + 8, uri.data() + uri.size(), decoded.back())) {
+        ERROR("ModelLoader", "LoadGLTF", ("Unsupported data URI in buffer " + std::to_string(i) + " of " + fileName).c_str());
+        return false;
+      }
+      buffers[i].data = decoded.back().data();
+      buffers[i].size = decoded.back().size();
+    }
+    else {
+      externalFiles.emplace_back(new MappedFile());
+      std::string path = directory + uriToPath(uri);
+      if (FAILED(externalFiles.back()->init(path))) {
+        ERROR("ModelLoader", "LoadGLTF", ("Failed to open buffer file: " + path).c_str());
+        return false;
+      }
+      buffers[i].data = reinterpret_cast<const unsigned char*>(externalFiles.back()->data());
+      buffers[i].size = externalFiles.back()->size();
+      m_stats.bytes += externalFiles.back()->size();
+    }
+    if (buffers[i].size < byteLength) {
+      ERROR("ModelLoader", "LoadGLTF", ("Buffer " + std::to_string(i) + " is shorter than its byteLength in " + fileName).c_str());
+      return false;
+    }
+  }
+
+  // Mesh instances of the default scene, or every mesh once if there is no scene.
+  std::vector<GLTFDraw> draws;
+  const JsonValue& scene = doc["scenes"].item(static_cast<size_t>(doc["scene"].asInt(0)));
+  if (!scene.isNull()) {
+    const JsonValue& roots = scene["nodes"];
+    std::vector<bool> visited(doc["nodes"].size(), false);
+    for (size_t i = 0; i < roots.size(); ++i) {
+      collectDraws(doc, static_cast<size_t>(roots.item(i).asInt()), GLTFTransform(), 0, visited, draws);
+    }
+  }
+  else {
+    for (size_t i = 0; i < doc["meshes"].size(); ++i) {
+      GLTFDraw draw;
+      draw.mesh = i;
+      draws.push_back(draw);
+    }
+  }
+
+  // Resolve every primitive and lay them out back to back in the shared arrays.
+  std::vector<GLTFPrimitive> primitives;
+  size_t vertexCount = 0;
+  size_t indexCount = 0;
+  const size_t noMaterial = ~static_cast<size_t>(0);
+  size_t defaultMaterial = noMaterial;
+  const JsonValue& materials = doc["materials"];
+  for (const GLTFDraw& draw : draws) {
+    if (cancelRequested()) {
+      break;
+    }
+    const JsonValue& primitiveList = doc["meshes"].item(draw.mesh)["primitives"];
+    size_t drawFirstPrimitive = primitives.size();
+    for (size_t p = 0; p < primitiveList.size(); ++p) {
+      const JsonValue& source = primitiveList.item(p);
+      if (source["mode"].asInt(kModeTriangles) != kModeTriangles) {
+        REPORT("ModelLoader", "LoadGLTF", ("Skipping non-triangle primitive in mesh " + std::to_string(draw.mesh)).c_str());
+        continue;
+      }
+
+      const JsonValue& attributes = source["attributes"];
+      GLTFPrimitive primitive;
+      primitive.transform = &draw.transform;
+      if (!resolveAccessor(doc, attributes["POSITION"].asInt(-1), buffers, primitive.positions, error)) {
+        ERROR("ModelLoader", "LoadGLTF", ("Bad POSITION accessor (" + error + ") in " + fileName).c_str());
+        return false;
+      }
+      if (primitive.positions.componentType != kComponentFloat || primitive.positions.components != 3) {
+        ERROR("ModelLoader", "LoadGLTF", ("POSITION accessor is not a float VEC3 in " + fileName).c_str());
+        return false;
+      }
+      size_t count = primitive.positions.count;
+
+      if (attributes.has("TEXCOORD_0")) {
+        primitive.hasUVs = resolveAccessor(doc, attributes["TEXCOORD_0"].asInt(-1), buffers, primitive.uvs, error) &&
+          primitive.uvs.components == 2 && primitive.uvs.count >= count &&
+          (primitive.uvs.componentType == kComponentFloat ||
+           (primitive.uvs.normalized && (primitive.uvs.componentType == kComponentUnsignedByte ||
+                                         primitive.uvs.componentType == kComponentUnsignedShort)));
+        if (!primitive.hasUVs) {
+          REPORT("ModelLoader", "LoadGLTF", ("Ignoring unsupported TEXCOORD_0 in " + fileName).c_str());
+        }
+      }
+      if (attributes.has("NORMAL")) {
+        primitive.hasNormals = resolveAccessor(doc, attributes["NORMAL"].asInt(-1), buffers, primitive.normals, error) &&
+          primitive.normals.componentType == kComponentFloat && primitive.normals.components == 3 &&
+          primitive.normals.count >= count;
+        if (!primitive.hasNormals) {
+          REPORT("ModelLoader", "LoadGLTF", ("Ignoring unsupported NORMAL in " + fileName).c_str());
+        }
+      }
+      if (source.has("indices")) {
+        if (!resolveAccessor(doc, source["indices"].asInt(-1), buffers, primitive.indices, error)) {
+          ERROR("ModelLoader", "LoadGLTF", ("Bad index accessor (" + error + ") in " + fileName).c_str());
+          return false;
+        }
+        if (primitive.indices.components != 1 ||
+            (primitive.indices.componentType != kComponentUnsignedByte &&
+             primitive.indices.componentType != kComponentUnsignedShort &&
+             primitive.indices.componentType != kComponentUnsignedInt)) {
+          ERROR("ModelLoader", "LoadGLTF", ("Index accessor is not an unsigned SCALAR in " + fileName).c_str());
+          return false;
+        }
+        primitive.hasIndices = true;
+        primitive.indexCount = primitive.indices.count;
+      }
+      else {
+        primitive.indexCount = count;
+      }
+      primitive.indexCount -= primitive.indexCount % 3;
+
+      primitive.directCopy = draw.transform.identity &&
+        primitive.hasUVs && primitive.hasNormals &&
+        primitive.uvs.componentType == kComponentFloat &&
+        primitive.positions.stride == sizeof(SimpleVertex) &&
+        primitive.uvs.stride == sizeof(SimpleVertex) &&
+        primitive.normals.stride == sizeof(SimpleVertex) &&
+        primitive.uvs.data == primitive.positions.data + offsetof(SimpleVertex, Tex) &&
+        primitive.normals.data == primitive.positions.data + offsetof(SimpleVertex, Normal);
+
+      size_t material = static_cast<size_t>(source["material"].asInt(-1));
+      if (material >= materials.size()) {
+        if (defaultMaterial == noMaterial) {
+          defaultMaterial = materials.size();
+        }
+        material = defaultMaterial;
+      }
+      primitive.materialId = static_cast<unsigned int>(material);
+      primitive.firstIndex = indexCount;
+      indexCount += primitive.indexCount;
+
+      // Exporters usually give every primitive of a mesh the same attribute accessors and only
+      // different indices; such primitives share one vertex range instead of copying it again.
+      primitive.baseVertex = vertexCount;
+      for (size_t previous = primitives.size(); previous-- > drawFirstPrimitive;) {
+        const GLTFPrimitive& other = primitives[previous];
+        if (!other.sharedVertices && other.positions.data == primitive.positions.data &&
+            other.positions.count == count && other.hasUVs == primitive.hasUVs &&
+            other.uvs.data == primitive.uvs.data && other.hasNormals == primitive.hasNormals &&
+            other.normals.data == primitive.normals.data) {
+          primitive.baseVertex = other.baseVertex;
+          primitive.sharedVertices = true;
+          break;
+        }
+      }
+      if (!primitive.sharedVertices) {
+        vertexCount += count;
+      }
+      primitives.push_back(primitive);
+    }
+  }
+
+  for (size_t i = 0; i < materials.size(); ++i) {
+    outMesh.m_materials.push_back(convertMaterial(doc, materials.item(i), directory));
+  }
+  if (defaultMaterial != noMaterial) {
+    MeshMaterial material;
+    material.name = "default";
+    outMesh.m_materials.push_back(material);
+  }
+
+  // Copy the primitives; large ones are split in blocks across the threads. A
+  // cancel skips the blocks not started yet and stops before the next primitive.
+  unsigned int threadCount = resolveThreadCount(options.threadCount);
+  std::vector<SimpleVertex> final_vertices(vertexCount);
+  std::vector<unsigned int> final_indices(indexCount);
+  std::vector<unsigned int> maxIndices(primitives.size(), 0);
+  for (size_t p = 0; p < primitives.size() && !cancelRequested(); ++p) {
+    const GLTFPrimitive& primitive = primitives[p];
+    if (!primitive.sharedVertices) {
+      SimpleVertex* vertices = final_vertices.data() + primitive.baseVertex;
+      parallelForRange(primitive.positions.count, threadCount, 1 << 16, [&](size_t first, size_t last) {
+        if (!cancelRequested()) {
+          copyVertices(primitive, first, last, vertices);
+        }
+      });
+    }
+
+    // Each block keeps its own maximum, keyed by its first index, so no atomics are needed.
+    const size_t kIndexBlock = 1 << 16;
+    std::vector<unsigned int> blockMax(primitive.indexCount / kIndexBlock + 1, 0);
+    parallelForRange(primitive.indexCount, threadCount, kIndexBlock, [&](size_t first, size_t last) {
+      if (!cancelRequested()) {
+        blockMax[first / kIndexBlock] = copyIndices(primitive, first, last, final_indices.data());
+      }
+    });
+    maxIndices[p] = *std::max_element(blockMax.begin(), blockMax.end());
+  }
+  if (cancelRequested()) {
+    REPORT("ModelLoader", "LoadGLTF", ("Cancelled loading " + fileName).c_str());
+    outMesh.m_materials.clear();
+    return false;
+  }
+
+  for (size_t p = 0; p < primitives.size(); ++p) {
+    const GLTFPrimitive& primitive = primitives[p];
+    if (primitive.indexCount > 0 && maxIndices[p] >= primitive.positions.count) {
+      ERROR("ModelLoader", "LoadGLTF", ("Index out of range in " + fileName).c_str());
+      outMesh.m_materials.clear();
+      return false;
+    }
+    MeshSubmesh submesh;
+    submesh.indexOffset = static_cast<unsigned int>(primitive.firstIndex);
+    submesh.indexCount = static_cast<unsigned int>(primitive.indexCount);
+    submesh.materialId = primitive.materialId;
+    outMesh.m_submeshes.push_back(submesh);
+    m_stats.directCopies += (primitive.directCopy && !primitive.sharedVertices) ? 1 : 0;
+  }
+
+  outMesh.m_vertex = std::move(final_vertices);
+  outMesh.m_index = std::move(final_indices);
+  outMesh.m_numVertex = static_cast<int>(outMesh.m_vertex.size());
+  outMesh.m_numIndex = static_cast<int>(outMesh.m_index.size());
+  outMesh.computeBounds();
+  applyMeshPasses(outMesh, options);
+
+  m_stats.chunks = primitives.size();
+  m_stats.peakBytes = file.size() + outMesh.m_vertex.size() * sizeof(SimpleVertex) +
+    outMesh.m_index.size() * sizeof(unsigned int);
+  m_stats.seconds = timer.elapsedSeconds();
+  if (progress) {
+    progress->bytesDone.store(file.size(), std::memory_order_relaxed);
+  }
+
+  std::ostringstream report;
+  report << fileName << " " << m_stats.bytes << " bytes, " << outMesh.m_numVertex << " vertices, "
+         << outMesh.m_numIndex << " indices, " << primitives.size() << " primitives, "
+         << m_stats.directCopies << " vertex ranges block-copied in " << m_stats.seconds * 1000.0 << " ms";
+  REPORT("ModelLoader", "LoadGLTF", report.str().c_str());
+  return true;
+}
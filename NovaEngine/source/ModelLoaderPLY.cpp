@@ -0,0 +1,647 @@
+#include "ModelLoader.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "Timer.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+  enum PLYType {
+    PLY_NONE = 0,
+    PLY_INT8 = 1,
+    PLY_UINT8 = 2,
+    PLY_INT16 = 3,
+    PLY_UINT16 = 4,
+    PLY_INT32 = 5,
+    PLY_UINT32 = 6,
+    PLY_FLOAT32 = 7,
+    PLY_FLOAT64 = 8
+  };
+
+  struct PLYProperty {
+    std::string name;
+    PLYType type = PLY_NONE;
+    PLYType countType = PLY_NONE;  // Set for list properties only.
+    size_t offset = 0;             // Byte offset inside a fixed-size element.
+  };
+
+  /*
+    An element declared in the header. stride is 0 when the element has list
+    properties, so its records have to be walked one by one.
+  */
+  struct PLYElement {
+    std::string name;
+    size_t count = 0;
+    size_t stride = 0;
+    std::vector<PLYProperty> properties;
+    const unsigned char* data = nullptr;
+  };
+
+  /*
+    Where every SimpleVertex component (and the optional color) comes from in a
+    vertex record. A slot with type PLY_NONE keeps its default.
+  */
+  struct PLYVertexLayout {
+    enum Slot {
+      SLOT_X = 0, SLOT_Y, SLOT_Z, SLOT_U, SLOT_V, SLOT_NX, SLOT_NY, SLOT_NZ,
+      SLOT_RED, SLOT_GREEN, SLOT_BLUE, SLOT_ALPHA, SLOT_COUNT
+    };
+    PLYType type[SLOT_COUNT] = {};
+    size_t offset[SLOT_COUNT] = {};
+    bool hasUVs = false;
+    bool hasNormals = false;
+    bool hasColors = false;
+    bool floatRuns = false;  // x/y/z, u/v and nx/ny/nz are consecutive little-endian floats.
+  };
+
+  inline size_t
+  typeSize(PLYType type) {
+    switch (type) {
+    case PLY_INT8:
+    case PLY_UINT8: return 1;
+    case PLY_INT16:
+    case PLY_UINT16: return 2;
+    case PLY_INT32:
+    case PLY_UINT32:
+    case PLY_FLOAT32: return 4;
+    case PLY_FLOAT64: return 8;
+    default: return 0;
+    }
+  }
+
+  inline PLYType
+  parseType(const std::string& name) {
+    if (name == "char" || name == "int8") return PLY_INT8;
+    if (name == "uchar" || name == "uint8") return PLY_UINT8;
+    if (name == "short" || name == "int16") return PLY_INT16;
+    if (name == "ushort" || name == "uint16") return PLY_UINT16;
+    if (name == "int" || name == "int32") return PLY_INT32;
+    if (name == "uint" || name == "uint32") return PLY_UINT32;
+    if (name == "float" || name == "float32") return PLY_FLOAT32;
+    if (name == "double" || name == "float64") return PLY_FLOAT64;
+    return PLY_NONE;
+  }
+
+  /*
+    Reads one scalar, byte-swapping it first for big-endian files.
+  */
+  template<typename T>
+  inline T
+  loadScalar(const unsigned char* p, bool swap) {
+    unsigned char bytes[sizeof(T)];
+    memcpy(bytes, p, sizeof(T));
+    if (swap) {
+      std::reverse(bytes, bytes + sizeof(T));
+    }
+    T value;
+    memcpy(&value, bytes, sizeof(T));
+    return value;
+  }
+
+  inline double
+  readNumber(const unsigned char* p, PLYType type, bool swap) {
+    switch (type) {
+    case PLY_INT8: return static_cast<signed char>(*p);
+    case PLY_UINT8: return *p;
+    case PLY_INT16: return loadScalar<int16_t>(p, swap);
+    case PLY_UINT16: return loadScalar<uint16_t>(p, swap);
+    case PLY_INT32: return loadScalar<int32_t>(p, swap);
+    case PLY_UINT32: return loadScalar<uint32_t>(p, swap);
+    case PLY_FLOAT32: return loadScalar<float>(p, swap);
+    case PLY_FLOAT64: return loadScalar<double>(p, swap);
+    default: return 0.0;
+    }
+  }
+
+  /*
+    Reads a list count or a vertex index. Negative values come back as ~0u so
+    the range check rejects them.
+  */
+  inline unsigned int
+  readIndex(const unsigned char* p, PLYType type, bool swap) {
+    switch (type) {
+    case PLY_INT8: return static_cast<unsigned int>(static_cast<int>(static_cast<signed char>(*p)));
+    case PLY_UINT8: return *p;
+    case PLY_INT16: return static_cast<unsigned int>(static_cast<int>(loadScalar<int16_t>(p, swap)));
+    case PLY_UINT16: return loadScalar<uint16_t>(p, swap);
+    case PLY_INT32: return static_cast<unsigned int>(loadScalar<int32_t>(p, swap));
+    case PLY_UINT32: return loadScalar<uint32_t>(p, swap);
+    default: return ~0u;
+    }
+  }
+
+  /*
+    Converts a color channel to 0..255: integer channels are scaled from their
+    full range (uchar as is), float channels from 0..1.
+  */
+  inline unsigned int
+  readColorChannel(const unsigned char* p, PLYType type, bool swap) {
+    double value = readNumber(p, type, swap);
+    if (type == PLY_UINT16) value /= 257.0;
+    else if (type == PLY_FLOAT32 || type == PLY_FLOAT64) value *= 255.0;
+    value = std::min(255.0, std::max(0.0, value + 0.5));
+    return static_cast<unsigned int>(value);
+  }
+
+  /*
+    Parses the ASCII header. On success dataStart points at the first byte after
+    "end_header" and its line break.
+  */
+  bool
+  parsePLYHeader(const char* begin,
+                 const char* end,
+                 std::vector<PLYElement>& elements,
+                 bool& bigEndian,
+                 const char*& dataStart,
+                 std::string& error) {
+    const char* p = begin;
+    bool first = true;
+    bool haveFormat = false;
+    while (p < end) {
+      const char* lineEnd = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p)));
+      if (!lineEnd) {
+        error = "header has no end_header line";
+        return false;
+      }
+      std::istringstream line(std::string(p, (lineEnd > p && lineEnd[-1] == '\r') ? lineEnd - 1 : lineEnd));
+      p = lineEnd + 1;
+
+      std::string keyword;
+      line >> keyword;
+      if (first) {
+        if (keyword != "ply") {
+          error = "missing 'ply' magic";
+          return false;
+        }
+        first = false;
+        continue;
+      }
+
+      if (keyword == "format") {
+        std::string format;
+        line >> format;
+        if (format == "ascii") {
+          error = "ASCII PLY is not supported, only binary_little_endian and binary_big_endian";
+          return false;
+        }
+        if (format != "binary_little_endian" && format != "binary_big_endian") {
+          error = "unknown format '" + format + "'";
+          return false;
+        }
+        bigEndian = format == "binary_big_endian";
+        haveFormat = true;
+      }
+      else if (keyword == "element") {
+        PLYElement element;
+        line >> element.name >> element.count;
+        if (line.fail()) {
+          error = "malformed element line";
+          return false;
+        }
+        elements.push_back(element);
+      }
+      else if (keyword == "property") {
+        if (elements.empty()) {
+          error = "property before any element";
+          return false;
+        }
+        PLYProperty property;
+        std::string type;
+        line >> type;
+        if (type == "list") {
+          std::string countType;
+          line >> countType >> type;
+          property.countType = parseType(countType);
+          if (property.countType == PLY_NONE || property.countType == PLY_FLOAT32 || property.countType == PLY_FLOAT64) {
+            error = "invalid list count type '" + countType + "'";
+            return false;
+          }
+        }
+        property.type = parseType(type);
+        line >> property.name;
+        if (property.type == PLY_NONE || property.name.empty()) {
+          error = "invalid property type '" + type + "'";
+          return false;
+        }
+        elements.back().properties.push_back(property);
+      }
+      else if (keyword == "end_header") {
+        if (!haveFormat) {
+          error = "missing format line";
+          return false;
+        }
+        dataStart = p;
+        break;
+      }
+      // "comment", "obj_info" and unknown keywords are ignored.
+    }
+    if (!dataStart) {
+      error = "header has no end_header line";
+      return false;
+    }
+
+    for (PLYElement& element : elements) {
+      size_t offset = 0;
+      bool fixed = true;
+      for (PLYProperty& property : element.properties) {
+        property.offset = offset;
+        offset += typeSize(property.type);
+        fixed = fixed && property.countType == PLY_NONE;
+      }
+      element.stride = fixed ? offset : 0;
+    }
+    return true;
+  }
+
+  /*
+    Returns the end of an element's records, walking list properties if it has
+    any. Returns nullptr if the records run past the end of the file.
+  */
+  const unsigned char*
+  elementEnd(const PLYElement& element, const unsigned char* end, bool swap) {
+    const unsigned char* p = element.data;
+    if (element.stride > 0) {
+      if (element.count > static_cast<size_t>(end - p) / element.stride) return nullptr;
+      return p + element.count * element.stride;
+    }
+    for (size_t i = 0; i < element.count; ++i) {
+      for (const PLYProperty& property : element.properties) {
+        if (property.countType == PLY_NONE) {
+          p += typeSize(property.type);
+          continue;
+        }
+        size_t countSize = typeSize(property.countType);
+        if (countSize > static_cast<size_t>(end - p)) return nullptr;
+        unsigned int count = readIndex(p, property.countType, swap);
+        p += countSize;
+        if (count == ~0u || count > static_cast<size_t>(end - p) / typeSize(property.type)) return nullptr;
+        p += count * typeSize(property.type);
+      }
+      if (p > end) return nullptr;
+    }
+    return p;
+  }
+
+  PLYVertexLayout
+  buildVertexLayout(const PLYElement& vertices, bool bigEndian) {
+    static const char* const kNames[PLYVertexLayout::SLOT_COUNT][3] = {
+      { "x", nullptr, nullptr }, { "y", nullptr, nullptr }, { "z", nullptr, nullptr },
+      { "u", "s", "texture_u" }, { "v", "t", "texture_v" },
+      { "nx", nullptr, nullptr }, { "ny", nullptr, nullptr }, { "nz", nullptr, nullptr },
+      { "red", "diffuse_red", nullptr }, { "green", "diffuse_green", nullptr },
+      { "blue", "diffuse_blue", nullptr }, { "alpha", nullptr, nullptr } };
+
+    PLYVertexLayout layout;
+    for (const PLYProperty& property : vertices.properties) {
+      if (property.countType != PLY_NONE) continue;
+      for (int slot = 0; slot < PLYVertexLayout::SLOT_COUNT; ++slot) {
+        for (const char* name : kNames[slot]) {
+          if (name && property.name == name && layout.type[slot] == PLY_NONE) {
+            layout.type[slot] = property.type;
+            layout.offset[slot] = property.offset;
+          }
+        }
+      }
+    }
+    layout.hasUVs = layout.type[PLYVertexLayout::SLOT_U] != PLY_NONE && layout.type[PLYVertexLayout::SLOT_V] != PLY_NONE;
+    layout.hasNormals = layout.type[PLYVertexLayout::SLOT_NX] != PLY_NONE &&
+      layout.type[PLYVertexLayout::SLOT_NY] != PLY_NONE && layout.type[PLYVertexLayout::SLOT_NZ] != PLY_NONE;
+    layout.hasColors = layout.type[PLYVertexLayout::SLOT_RED] != PLY_NONE &&
+      layout.type[PLYVertexLayout::SLOT_GREEN] != PLY_NONE && layout.type[PLYVertexLayout::SLOT_BLUE] != PLY_NONE;
+
+    auto floatRun = [&](int first, int count) {
+      for (int i = 0; i < count; ++i) {
+        if (layout.type[first + i] != PLY_FLOAT32 ||
+            layout.offset[first + i] != layout.offset[first] + i * sizeof(float)) {
+          return false;
+        }
+      }
+      return true;
+    };
+    layout.floatRuns = !bigEndian && floatRun(PLYVertexLayout::SLOT_X, 3) &&
+      (!layout.hasUVs || floatRun(PLYVertexLayout::SLOT_U, 2)) &&
+      (!layout.hasNormals || floatRun(PLYVertexLayout::SLOT_NX, 3));
+    return layout;
+  }
+
+  /*
+    Copies vertex records [first, last) into SimpleVertex. The common layout
+    (float x y z [nx ny nz] [u v], little endian) is three fixed-size block
+    copies per record; anything else goes through per-component conversion.
+    V is flipped to the top-left origin, as in LoadOBJ.
+  */
+  void
+  copyPLYVertices(const PLYVertexLayout& layout,
+                  const PLYElement& element,
+                  bool swap,
+                  size_t first,
+                  size_t last,
+                  SimpleVertex* out,
+                  unsigned int* colors) {
+    typedef PLYVertexLayout L;
+    const size_t stride = element.stride;
+    const unsigned char* record = element.data + first * stride;
+    if (layout.floatRuns) {
+      const size_t pos = layout.offset[L::SLOT_X];
+      const size_t uv = layout.offset[L::SLOT_U];
+      const size_t normal = layout.offset[L::SLOT_NX];
+      for (size_t i = first; i < last; ++i, record += stride) {
+        SimpleVertex& vertex = out[i];
+        memcpy(&vertex.Pos, record + pos, sizeof(XMFLOAT3));
+        if (layout.hasUVs) {
+          memcpy(&vertex.Tex, record + uv, sizeof(XMFLOAT2));
+          vertex.Tex.y = 1.0f - vertex.Tex.y;
+        }
+        else {
+          vertex.Tex = XMFLOAT2(0, 0);
+        }
+        if (layout.hasNormals) {
+          memcpy(&vertex.Normal, record + normal, sizeof(XMFLOAT3));
+        }
+        else {
+          vertex.Normal = XMFLOAT3(0, 1, 0);
+        }
+      }
+    }
+    else {
+      auto read = [&](const unsigned char* r, int slot) {
+        return static_cast<float>(readNumber(r + layout.offset[slot], layout.type[slot], swap));
+      };
+      for (size_t i = first; i < last; ++i, record += stride) {
+        SimpleVertex& vertex = out[i];
+        vertex.Pos = XMFLOAT3(read(record, L::SLOT_X), read(record, L::SLOT_Y), read(record, L::SLOT_Z));
+        vertex.Tex = layout.hasUVs ? XMFLOAT2(read(record, L::SLOT_U), 1.0f - read(record, L::SLOT_V)) : XMFLOAT2(0, 0);
+        vertex.Normal = layout.hasNormals ?
+          XMFLOAT3(read(record, L::SLOT_NX), read(record, L::SLOT_NY), read(record, L::SLOT_NZ)) : XMFLOAT3(0, 1, 0);
+      }
+    }
+
+    if (colors) {
+      record = element.data + first * stride;
+      bool alpha = layout.type[L::SLOT_ALPHA] != PLY_NONE;
+      for (size_t i = first; i < last; ++i, record += stride) {
+        unsigned int r = readColorChannel(record + layout.offset[L::SLOT_RED], layout.type[L::SLOT_RED], swap);
+        unsigned int g = readColorChannel(record + layout.offset[L::SLOT_GREEN], layout.type[L::SLOT_GREEN], swap);
+        unsigned int b = readColorChannel(record + layout.offset[L::SLOT_BLUE], layout.type[L::SLOT_BLUE], swap);
+        unsigned int a = alpha ? readColorChannel(record + layout.offset[L::SLOT_ALPHA], layout.type[L::SLOT_ALPHA], swap) : 255u;
+        colors[i] = r | (g << 8) | (b << 16) | (a << 24);
+      }
+    }
+  }
+
+  /*
+    Finds the face index list: "vertex_indices" or "vertex_index".
+  */
+  int
+  findFaceList(const PLYElement& faces) {
+    for (size_t i = 0; i < faces.properties.size(); ++i) {
+      const PLYProperty& property = faces.properties[i];
+      if (property.countType != PLY_NONE && (property.name == "vertex_indices" || property.name == "vertex_index")) {
+        return static_cast<int>(i);
+      }
+    }
+    return -1;
+  }
+}
+
+bool
+ModelLoader::LoadPLY(const std::string& filename,
+                     MeshComponent& outMesh,
+                     const ModelLoadOptions& options) {
+  Timer timer;
+
+  outMesh.m_vertex.clear();
+  outMesh.m_index.clear();
+  outMesh.m_color.clear();
+  outMesh.m_tangent.clear();
+  outMesh.m_lods.clear();
+  outMesh.m_clusters.clear();
+  outMesh.m_submeshes.clear();
+  outMesh.m_materials.clear();
+  m_stats = ModelLoadStats();
+
+  std::string fullPath = filename + ".ply";
+  MappedFile file;
+  if (FAILED(file.init(fullPath))) {
+    ERROR("ModelLoader", "LoadPLY", ("No se pudo abrir el archivo: " + fullPath).c_str());
+    return false;
+  }
+  m_stats.bytes = file.size();
+  unsigned int threadCount = resolveThreadCount(options.threadCount);
+
+  ModelLoadProgress* progress = options.progress;
+  if (progress) {
+    progress->bytesTotal.store(file.size(), std::memory_order_relaxed);
+  }
+  auto cancelled = [&]() {
+    if (!progress || !progress->cancel.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    REPORT("ModelLoader", "LoadPLY", ("Cancelled loading " + fullPath).c_str());
+    return true;
+  };
+
+  std::vector<PLYElement> elements;
+  bool bigEndian = false;
+  const char* dataStart = nullptr;
+  std::string error;
+  if (!parsePLYHeader(file.data(), file.data() + file.size(), elements, bigEndian, dataStart, error)) {
+    ERROR("ModelLoader", "LoadPLY", ("Invalid PLY header (" + error + ") in " + fullPath).c_str());
+    return false;
+  }
+
+  // Elements are stored back to back. Records are only walked to find where the
+  // next element starts, and only if the vertex or face element is still ahead.
+  const unsigned char* end = reinterpret_cast<const unsigned char*>(file.data()) + file.size();
+  const unsigned char* cursor = reinterpret_cast<const unsigned char*>(dataStart);
+  PLYElement* vertices = nullptr;
+  PLYElement* faces = nullptr;
+  for (PLYElement& element : elements) {
+    if (element.name == "vertex" && !vertices) vertices = &element;
+    else if (element.name == "face" && !faces) faces = &element;
+  }
+  if (!vertices || vertices->stride == 0) {
+    ERROR("ModelLoader", "LoadPLY", ("No fixed-size vertex element in " + fullPath).c_str());
+    return false;
+  }
+  for (PLYElement& element : elements) {
+    element.data = cursor;
+    bool needed = (&element < vertices) || (faces && &element < faces);
+    if (!needed) break;
+    cursor = elementEnd(element, end, bigEndian);
+    if (!cursor) {
+      ERROR("ModelLoader", "LoadPLY", ("Element '" + element.name + "' runs past the end of " + fullPath).c_str());
+      return false;
+    }
+  }
+  if (!elementEnd(*vertices, end, bigEndian)) {
+    ERROR("ModelLoader", "LoadPLY", ("Vertex data runs past the end of " + fullPath).c_str());
+    return false;
+  }
+
+  // Vertices: fixed-size records, so the copy splits into independent blocks.
+  PLYVertexLayout layout = buildVertexLayout(*vertices, bigEndian);
+  if (layout.type[PLYVertexLayout::SLOT_X] == PLY_NONE || layout.type[PLYVertexLayout::SLOT_Y] == PLY_NONE ||
+      layout.type[PLYVertexLayout::SLOT_Z] == PLY_NONE) {
+    ERROR("ModelLoader", "LoadPLY", ("Vertex element has no x/y/z properties in " + fullPath).c_str());
+    return false;
+  }
+  std::vector<SimpleVertex> final_vertices(vertices->count);
+  std::vector<unsigned int> final_colors(layout.hasColors ? vertices->count : 0);
+  parallelForRange(vertices->count, threadCount, 1 << 16, [&](size_t first, size_t last) {
+    copyPLYVertices(layout, *vertices, bigEndian, first, last, final_vertices.data(),
+                    layout.hasColors ? final_colors.data() : nullptr);
+  });
+  if (progress) {
+    progress->bytesDone.store(static_cast<size_t>(vertices->data - reinterpret_cast<const unsigned char*>(file.data())) +
+                              vertices->count * vertices->stride, std::memory_order_relaxed);
+  }
+  if (cancelled()) {
+    return false;
+  }
+
+  // Faces: when every record is "count, i0, i1, i2" with a one-byte count of 3
+  // (the usual triangle mesh), the records have a fixed size and are copied in
+  // parallel blocks. Otherwise they are walked once to count triangles and once
+  // to fan-triangulate them.
+  std::vector<unsigned int> final_indices;
+  int listIndex = faces ? findFaceList(*faces) : -1;
+  if (faces && listIndex < 0) {
+    REPORT("ModelLoader", "LoadPLY", ("Face element has no vertex_indices list, loading points only: " + fullPath).c_str());
+  }
+  if (faces && listIndex >= 0 && faces->count > 0) {
+    const PLYProperty& list = faces->properties[static_cast<size_t>(listIndex)];
+    const size_t indexSize = typeSize(list.type);
+    const size_t triangleRecord = typeSize(list.countType) + 3 * indexSize;
+    unsigned int vertexCount = static_cast<unsigned int>(vertices->count);
+    bool fixedTriangles = faces->properties.size() == 1 && list.countType == PLY_UINT8 &&
+      faces->count <= static_cast<size_t>(end - faces->data) / triangleRecord;
+
+    // Blocks record their largest index, keyed by their first face.
+    const size_t kFaceBlock = 1 << 16;
+    if (fixedTriangles) {
+      std::vector<unsigned char> allTriangles(faces->count / kFaceBlock + 1, 1);
+      parallelForRange(faces->count, threadCount, kFaceBlock, [&](size_t first, size_t last) {
+        const unsigned char* record = faces->data + first * triangleRecord;
+        for (size_t i = first; i < last; ++i, record += triangleRecord) {
+          if (*record != 3) {
+            allTriangles[first / kFaceBlock] = 0;
+            return;
+          }
+        }
+      });
+      fixedTriangles = std::find(allTriangles.begin(), allTriangles.end(), 0) == allTriangles.end();
+    }
+
+    std::vector<unsigned int> blockMax(faces->count / kFaceBlock + 1, 0);
+    if (fixedTriangles) {
+      final_indices.resize(faces->count * 3);
+      parallelForRange(faces->count, threadCount, kFaceBlock, [&](size_t first, size_t last) {
+        const unsigned char* record = faces->data + first * triangleRecord + 1;
+        unsigned int maxIndex = 0;
+        for (size_t i = first; i < last; ++i, record += triangleRecord) {
+          for (size_t k = 0; k < 3; ++k) {
+            unsigned int index = readIndex(record + k * indexSize, list.type, bigEndian);
+            maxIndex = std::max(maxIndex, index);
+            final_indices[i * 3 + k] = index;
+          }
+        }
+        blockMax[first / kFaceBlock] = maxIndex;
+      });
+    }
+    else {
+      if (!elementEnd(*faces, end, bigEndian)) {
+        ERROR("ModelLoader", "LoadPLY", ("Face data runs past the end of " + fullPath).c_str());
+        return false;
+      }
+      size_t triangleCount = 0;
+      const unsigned char* p = faces->data;
+      for (size_t f = 0; f < faces->count; ++f) {
+        for (const PLYProperty& property : faces->properties) {
+          if (property.countType == PLY_NONE) {
+            p += typeSize(property.type);
+            continue;
+          }
+          unsigned int count = readIndex(p, property.countType, bigEndian);
+          p += typeSize(property.countType) + count * typeSize(property.type);
+          if (&property == &list && count >= 3) {
+            triangleCount += count - 2;
+          }
+        }
+      }
+
+      final_indices.reserve(triangleCount * 3);
+      unsigned int maxIndex = 0;
+      p = faces->data;
+      for (size_t f = 0; f < faces->count; ++f) {
+        for (const PLYProperty& property : faces->properties) {
+          if (property.countType == PLY_NONE) {
+            p += typeSize(property.type);
+            continue;
+          }
+          unsigned int count = readIndex(p, property.countType, bigEndian);
+          p += typeSize(property.countType);
+          if (&property == &list && count >= 3) {
+            unsigned int first = readIndex(p, list.type, bigEndian);
+            unsigned int previous = readIndex(p + indexSize, list.type, bigEndian);
+            maxIndex = std::max(maxIndex, std::max(first, previous));
+            for (unsigned int k = 2; k < count; ++k) {
+              unsigned int index = readIndex(p + k * indexSize, list.type, bigEndian);
+              maxIndex = std::max(maxIndex, index);
+              final_indices.push_back(first);
+              final_indices.push_back(previous);
+              final_indices.push_back(index);
+              previous = index;
+            }
+          }
+          p += count * typeSize(property.type);
+        }
+      }
+      blockMax[0] = maxIndex;
+    }
+
+    if (*std::max_element(blockMax.begin(), blockMax.end()) >= vertexCount) {
+      ERROR("ModelLoader", "LoadPLY", ("Face index out of range in " + fullPath).c_str());
+      return false;
+    }
+  }
+  if (cancelled()) {
+    return false;
+  }
+
+  if (!final_indices.empty()) {
+    MeshMaterial material;
+    material.name = "default";
+    outMesh.m_materials.push_back(material);
+    MeshSubmesh submesh;
+    submesh.indexCount = static_cast<unsigned int>(final_indices.size());
+    outMesh.m_submeshes.push_back(submesh);
+  }
+
+  m_stats.chunks = 1;
+  m_stats.peakBytes = file.size() +
+    final_vertices.capacity() * sizeof(SimpleVertex) +
+    final_indices.capacity() * sizeof(unsigned int) +
+    final_colors.capacity() * sizeof(unsigned int);
+
+  outMesh.m_vertex = std::move(final_vertices);
+  outMesh.m_index = std::move(final_indices);
+  outMesh.m_color = std::move(final_colors);
+  outMesh.m_numVertex = static_cast<int>(outMesh.m_vertex.size());
+  outMesh.m_numIndex = static_cast<int>(outMesh.m_index.size());
+  outMesh.computeBounds();
+  applyMeshPasses(outMesh, options);
+
+  m_stats.seconds = timer.elapsedSeconds();
+  if (progress) {
+    progress->bytesDone.store(file.size(), std::memory_order_relaxed);
+  }
+
+  std::ostringstream report;
+  report << fullPath << " " << m_stats.bytes << " bytes, " << outMesh.m_numVertex << " vertices"
+         << (layout.hasColors ? " with colors, " : ", ") << outMesh.m_numIndex << " indices in "
+         << m_stats.seconds * 1000.0 << " ms (" << m_stats.megabytesPerSecond() << " MB/s, "
+         << (layout.floatRuns ? "block" : "converted") << " vertex copy)";
+  REPORT("ModelLoader", "LoadPLY", report.str().c_str());
+  return true;
+}
@@ -0,0 +1,225 @@
+#include "ModelLoader.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "PositionWeldGrid.h"
+#include "Timer.h"
+#include <cmath>
+#include <cstring>
+
+namespace {
+  const size_t kSTLHeaderBytes = 84;
+  const size_t kSTLTriangleBytes = 50;
+
+  // The weld pass reports progress and checks for cancellation about once per megabyte.
+  const size_t kProgressTriangles = (1 << 20) / kSTLTriangleBytes;
+
+  // Faceted welding merges corners whose face normals are within about one degree.
+  const float kFacetNormalDot = 0.99985f;
+
+  /*
+    The three corners of triangle i; the record is facet normal, corners, attribute word.
+  */
+  inline void
+  readTriangle(const char* data, size_t i, XMFLOAT3 (&corners)[3], XMFLOAT3& storedNormal) {
+    const char* record = data + kSTLHeaderBytes + i * kSTLTriangleBytes;
+    memcpy(&storedNormal, record, sizeof(XMFLOAT3));
+    memcpy(corners, record + sizeof(XMFLOAT3), sizeof(corners));
+  }
+
+  inline XMFLOAT3
+  normalized(const XMFLOAT3& v, float& length) {
+    length = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+    if (length > 0.0f && std::isfinite(length)) {
+      return XMFLOAT3(v.x / length, v.y / length, v.z / length);
+    }
+    length = 0.0f;
+    return XMFLOAT3(0.0f, 0.0f, 0.0f);
+  }
+}
+
+bool
+ModelLoader::LoadSTL(const std::string& filename,
+                     MeshComponent& outMesh,
+                     const ModelLoadOptions& options) {
+  Timer timer;
+
+  outMesh.m_vertex.clear();
+  outMesh.m_index.clear();
+  outMesh.m_color.clear();
+  outMesh.m_tangent.clear();
+  outMesh.m_lods.clear();
+  outMesh.m_clusters.clear();
+  outMesh.m_submeshes.clear();
+  outMesh.m_materials.clear();
+  m_stats = ModelLoadStats();
+
+  std::string fullPath = filename + ".stl";
+  MappedFile file;
+  if (FAILED(file.init(fullPath))) {
+    ERROR("ModelLoader", "LoadSTL", ("No se pudo abrir el archivo: " + fullPath).c_str());
+    return false;
+  }
+  m_stats.bytes = file.size();
+  unsigned int threadCount = resolveThreadCount(options.threadCount);
+
+  ModelLoadProgress* progress = options.progress;
+  if (progress) {
+    progress->bytesTotal.store(file.size(), std::memory_order_relaxed);
+  }
+  auto cancelled = [&]() {
+    if (!progress || !progress->cancel.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    REPORT("ModelLoader", "LoadSTL", ("Cancelled loading " + fullPath).c_str());
+    return true;
+  };
+
+  // Binary STL: 80-byte header, triangle count, 50 bytes per triangle. ASCII files
+  // start with "solid", but so do some binary ones, so the size decides.
+  uint32_t triangleCount = 0;
+  if (file.size() >= kSTLHeaderBytes) {
+    memcpy(&triangleCount, file.data() + 80, sizeof(triangleCount));
+  }
+  if (file.size() < kSTLHeaderBytes ||
+      kSTLHeaderBytes + static_cast<unsigned long long>(triangleCount) * kSTLTriangleBytes > file.size()) {
+    bool ascii = file.size() >= 5 && memcmp(file.data(), "solid", 5) == 0;
+    ERROR("ModelLoader", "LoadSTL", ((ascii ? "ASCII STL is not supported: " : "Truncated binary STL: ") + fullPath).c_str());
+    return false;
+  }
+
+  // Face normals and areas, recomputed from the corners because exporters often
+  // write zero or stale facet normals. Independent per triangle.
+  std::vector<XMFLOAT3> faceNormals(triangleCount);
+  std::vector<float> faceAreas(triangleCount);
+  parallelForRange(triangleCount, threadCount, 1 << 14, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      XMFLOAT3 corners[3];
+      XMFLOAT3 stored;
+      readTriangle(file.data(), i, corners, stored);
+      XMFLOAT3 e1(corners[1].x - corners[0].x, corners[1].y - corners[0].y, corners[1].z - corners[0].z);
+      XMFLOAT3 e2(corners[2].x - corners[0].x, corners[2].y - corners[0].y, corners[2].z - corners[0].z);
+      XMFLOAT3 cross(e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x);
+      float length;
+      faceNormals[i] = normalized(cross, length);
+      faceAreas[i] = 0.5f * length;
+      if (length == 0.0f) {
+        float storedLength;
+        faceNormals[i] = normalized(stored, storedLength);
+        if (storedLength == 0.0f) {
+          faceNormals[i] = XMFLOAT3(0.0f, 1.0f, 0.0f);
+        }
+      }
+    }
+  });
+
+  // Welding is one sequential pass so the vertex order (first occurrence) is the
+  // same on every run. A closed mesh has about half as many vertices as triangles.
+  const ModelWeldOptions& weld = options.weldOptions;
+  const bool smooth = weld.smoothNormals;
+  std::vector<SimpleVertex> final_vertices;
+  std::vector<unsigned int> final_indices;
+  final_vertices.reserve(triangleCount / 2 + 16);
+  final_indices.reserve(static_cast<size_t>(triangleCount) * 3);
+  PositionWeldGrid grid;
+  grid.init(weld.tolerance, triangleCount / 2 + 16);
+  size_t degenerate = 0;
+  for (size_t i = 0; i < triangleCount; ++i) {
+    if (i % kProgressTriangles == 0) {
+      if (cancelled()) {
+        return false;
+      }
+      if (progress) {
+        progress->bytesDone.store(kSTLHeaderBytes + i * kSTLTriangleBytes, std::memory_order_relaxed);
+      }
+    }
+    XMFLOAT3 corners[3];
+    XMFLOAT3 stored;
+    readTriangle(file.data(), i, corners, stored);
+    const XMFLOAT3& normal = faceNormals[i];
+    auto sameFacet = [&](unsigned int id) {
+      if (smooth) return true;
+      const XMFLOAT3& other = final_vertices[id].Normal;
+      return other.x * normal.x + other.y * normal.y + other.z * normal.z >= kFacetNormalDot;
+    };
+
+    unsigned int ids[3];
+    for (int k = 0; k < 3; ++k) {
+      bool inserted = false;
+      ids[k] = grid.findOrInsert(corners[k], static_cast<unsigned int>(final_vertices.size()), inserted, sameFacet);
+      if (inserted) {
+        SimpleVertex vertex;
+        vertex.Pos = corners[k];
+        vertex.Tex = XMFLOAT2(0.0f, 0.0f);
+        vertex.Normal = smooth ? XMFLOAT3(0.0f, 0.0f, 0.0f) : normal;
+        final_vertices.push_back(vertex);
+      }
+    }
+    if (ids[0] == ids[1] || ids[1] == ids[2] || ids[0] == ids[2]) {
+      ++degenerate;
+      continue;
+    }
+    final_indices.insert(final_indices.end(), ids, ids + 3);
+
+    if (smooth) {
+      float area = faceAreas[i];
+      for (unsigned int id : ids) {
+        XMFLOAT3& sum = final_vertices[id].Normal;
+        sum.x += normal.x * area;
+        sum.y += normal.y * area;
+        sum.z += normal.z * area;
+      }
+    }
+  }
+
+  if (smooth) {
+    parallelForRange(final_vertices.size(), threadCount, 1 << 16, [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; ++i) {
+        float length;
+        XMFLOAT3 n = normalized(final_vertices[i].Normal, length);
+        final_vertices[i].Normal = (length > 0.0f) ? n : XMFLOAT3(0.0f, 1.0f, 0.0f);
+      }
+    });
+  }
+
+  if (!final_indices.empty()) {
+    MeshMaterial material;
+    material.name = "default";
+    outMesh.m_materials.push_back(material);
+    MeshSubmesh submesh;
+    submesh.indexCount = static_cast<unsigned int>(final_indices.size());
+    outMesh.m_submeshes.push_back(submesh);
+  }
+
+  m_stats.inputVertices = static_cast<unsigned long long>(triangleCount) * 3;
+  m_stats.chunks = 1;
+  m_stats.peakBytes = file.size() +
+    faceNormals.capacity() * sizeof(XMFLOAT3) +
+    faceAreas.capacity() * sizeof(float) +
+    grid.memoryBytes() +
+    final_vertices.capacity() * sizeof(SimpleVertex) +
+    final_indices.capacity() * sizeof(unsigned int);
+
+  // The passes below can split or drop vertices; the weld ratio is taken before them.
+  const size_t weldedVertices = final_vertices.size();
+  outMesh.m_vertex = std::move(final_vertices);
+  outMesh.m_index = std::move(final_indices);
+  outMesh.m_numVertex = static_cast<int>(outMesh.m_vertex.size());
+  outMesh.m_numIndex = static_cast<int>(outMesh.m_index.size());
+  outMesh.computeBounds();
+  applyMeshPasses(outMesh, options);
+
+  m_stats.seconds = timer.elapsedSeconds();
+  if (progress) {
+    progress->bytesDone.store(file.size(), std::memory_order_relaxed);
+  }
+
+  std::ostringstream report;
+  report << fullPath << " " << triangleCount << " triangles, " << m_stats.inputVertices << " corners welded to "
+         << weldedVertices << " vertices (ratio "
+         << (weldedVertices ? static_cast<double>(m_stats.inputVertices) / weldedVertices : 0.0)
+         << ":1, tolerance " << weld.tolerance << ", " << (smooth ? "smooth" : "faceted") << "), "
+         << degenerate << " degenerate triangles dropped in " << m_stats.seconds * 1000.0 << " ms ("
+         << m_stats.megabytesPerSecond() << " MB/s)";
+  REPORT("ModelLoader", "LoadSTL", report.str().c_str());
+  return true;
+}
@@ -0,0 +1,79 @@
+#include "PositionWeldGrid.h"
+
+void
+PositionWeldGrid::init(float tolerance, size_t expectedPoints) {
+  m_tolerance = tolerance > 0.0f ? tolerance : 0.0f;
+  m_inverseCell = m_tolerance > 0.0f ? 0.5f / m_tolerance : 0.0f;
+
+  size_t capacity = 16;
+  while (capacity < expectedPoints * 2) {
+    capacity <<= 1;
+  }
+  m_cells.assign(capacity, Cell{ 0, 0, 0, kNone });
+  m_mask = capacity - 1;
+  m_usedCells = 0;
+  m_points.clear();
+  m_points.reserve(expectedPoints);
+}
+
+void
+PositionWeldGrid::cellRange(const XMFLOAT3& position, int (&low)[3], int (&high)[3]) const {
+  if (m_tolerance == 0.0f) {
+    low[0] = high[0] = weldCellBits(position.x);
+    low[1] = high[1] = weldCellBits(position.y);
+    low[2] = high[2] = weldCellBits(position.z);
+    return;
+  }
+  const float p[3] = { position.x, position.y, position.z };
+  for (int axis = 0; axis < 3; ++axis) {
+    low[axis] = weldCellOf((p[axis] - m_tolerance) * m_inverseCell);
+    high[axis] = weldCellOf((p[axis] + m_tolerance) * m_inverseCell);
+  }
+}
+
+void
+PositionWeldGrid::insert(const XMFLOAT3& position, unsigned int id) {
+  if ((m_usedCells + 1) * 2 > m_cells.size()) {
+    grow();
+  }
+  int x, y, z;
+  homeCell(position, x, y, z);
+
+  size_t slot = findCell(x, y, z);
+  Cell& cell = m_cells[slot];
+  if (cell.head == kNone) {
+    cell.x = x;
+    cell.y = y;
+    cell.z = z;
+    ++m_usedCells;
+  }
+  unsigned int point = static_cast<unsigned int>(m_points.size());
+  m_points.push_back(Point{ position, id, cell.head });
+  cell.head = point;
+}
+
+void
+PositionWeldGrid::grow() {
+  std::vector<Cell> old;
+  old.swap(m_cells);
+  m_cells.assign(old.empty() ? 16 : old.size() * 2, Cell{ 0, 0, 0, kNone });
+  m_mask = m_cells.size() - 1;
+  for (const Cell& cell : old) {
+    if (cell.head == kNone) continue;
+    m_cells[findCell(cell.x, cell.y, cell.z)] = cell;
+  }
+}
+
+size_t
+PositionWeldGrid::memoryBytes() const {
+  return m_cells.capacity() * sizeof(Cell) +
+         m_points.capacity() * sizeof(Point);
+}
+
+void
+PositionWeldGrid::destroy() {
+  std::vector<Cell>().swap(m_cells);
+  std::vector<Point>().swap(m_points);
+  m_mask = 0;
+  m_usedCells = 0;
+}
@@ -0,0 +1,169 @@
+#include "SpillFile.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+  const size_t kPreferredPageBytes = 64 << 10;
+  const size_t kNoPage = ~static_cast<size_t>(0);
+}
+
+HRESULT
+SpillFile::init(const std::string& directory, size_t recordSize, size_t memoryBudget) {
+  destroy();
+  if (recordSize == 0) {
+    ERROR("SpillFile", "init", "Record size cannot be zero.");
+    return E_INVALIDARG;
+  }
+
+  // Keep at least a write page and two cached pages inside the budget.
+  size_t pageBytes = std::min(kPreferredPageBytes, memoryBudget / 3);
+  m_directory = directory;
+  m_recordSize = recordSize;
+  m_recordsPerPage = std::max<size_t>(1, pageBytes / recordSize);
+  m_pageBytes = m_recordsPerPage * recordSize;
+  m_writePage.reserve(m_pageBytes);
+
+  // Cache pages are only touched as they fill, so small inputs stay small.
+  size_t cachedPages = std::max<size_t>(2, memoryBudget / m_pageBytes - 1);
+  m_cache.reserve(cachedPages * m_pageBytes);
+  m_cachedPage.assign(cachedPages, kNoPage);
+  m_lastUse.assign(cachedPages, 0);
+  m_slotOfPage.reserve(cachedPages * 2);
+  return S_OK;
+}
+
+HRESULT
+SpillFile::append(const void* record) {
+  if (m_writePage.size() == m_pageBytes) {
+    HRESULT hr = writePage();
+    if (FAILED(hr)) {
+      return hr;
+    }
+    m_writePage.clear();
+    ++m_writePageIndex;
+  }
+  const char* bytes = static_cast<const char*>(record);
+  m_writePage.insert(m_writePage.end(), bytes, bytes + m_recordSize);
+  ++m_count;
+  return S_OK;
+}
+
+const void*
+SpillFile::read(size_t index) {
+  size_t page = index / m_recordsPerPage;
+  size_t offset = (index % m_recordsPerPage) * m_recordSize;
+  if (page == m_writePageIndex) {
+    return m_writePage.data() + offset;
+  }
+
+  size_t slot = m_lastSlot;
+  if (m_cachedPage[slot] != page) {
+    auto found = m_slotOfPage.find(page);
+    if (found != m_slotOfPage.end()) {
+      slot = found->second;
+    }
+    else {
+      slot = cacheSlot(page);
+      m_file.seekg(static_cast<std::streamoff>(page) * static_cast<std::streamoff>(m_pageBytes));
+      m_file.read(m_cache.data() + slot * m_pageBytes, static_cast<std::streamsize>(m_pageBytes));
+      if (!m_file.good()) {
+        ERROR("SpillFile", "read", ("Failed to read back page from " + m_path).c_str());
+        m_file.clear();
+        m_slotOfPage.erase(page);
+        m_cachedPage[slot] = kNoPage;
+        return nullptr;
+      }
+    }
+    m_lastSlot = slot;
+  }
+  m_lastUse[slot] = ++m_clock;
+  return m_cache.data() + slot * m_pageBytes + offset;
+}
+
+void
+SpillFile::destroy() {
+  if (m_file.is_open()) {
+    m_file.close();
+  }
+  if (!m_path.empty()) {
+    DeleteFileA(m_path.c_str());
+    m_path.clear();
+  }
+  std::vector<char>().swap(m_writePage);
+  std::vector<char>().swap(m_cache);
+  std::vector<size_t>().swap(m_cachedPage);
+  std::vector<unsigned long long>().swap(m_lastUse);
+  m_slotOfPage.clear();
+  m_count = 0;
+  m_spilledBytes = 0;
+  m_writePageIndex = 0;
+  m_lastSlot = 0;
+  m_clock = 0;
+}
+
+HRESULT
+SpillFile::writePage() {
+  if (!m_file.is_open()) {
+    char directory[MAX_PATH];
+    if (m_directory.empty()) {
+      if (GetTempPathA(MAX_PATH, directory) == 0) {
+        ERROR("SpillFile", "writePage", "Failed to query the temporary folder.");
+        return E_FAIL;
+      }
+    }
+    else {
+      strncpy(directory, m_directory.c_str(), MAX_PATH - 1);
+      directory[MAX_PATH - 1] = '\0';
+    }
+
+    char path[MAX_PATH];
+    if (GetTempFileNameA(directory, "nov", 0, path) == 0) {
+      ERROR("SpillFile", "writePage", ("Failed to create a temporary file in " + std::string(directory)).c_str());
+      return E_FAIL;
+    }
+    m_path = path;
+    m_file.open(m_path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open()) {
+      ERROR("SpillFile", "writePage", ("Failed to open temporary file: " + m_path).c_str());
+      return E_FAIL;
+    }
+  }
+
+  m_file.seekp(static_cast<std::streamoff>(m_writePageIndex) * static_cast<std::streamoff>(m_pageBytes));
+  m_file.write(m_writePage.data(), static_cast<std::streamsize>(m_pageBytes));
+  if (!m_file.good()) {
+    ERROR("SpillFile", "writePage", ("Failed to write temporary file: " + m_path).c_str());
+    return E_FAIL;
+  }
+  m_spilledBytes += m_pageBytes;
+
+  // The page just written is the likeliest to be read next.
+  size_t slot = cacheSlot(m_writePageIndex);
+  memcpy(m_cache.data() + slot * m_pageBytes, m_writePage.data(), m_pageBytes);
+  m_lastUse[slot] = ++m_clock;
+  m_lastSlot = slot;
+  return S_OK;
+}
+
+size_t
+SpillFile::cacheSlot(size_t page) {
+  size_t victim = 0;
+  for (size_t slot = 0; slot < m_cachedPage.size(); ++slot) {
+    if (m_cachedPage[slot] == kNoPage) {
+      victim = slot;
+      break;
+    }
+    if (m_lastUse[slot] < m_lastUse[victim]) {
+      victim = slot;
+    }
+  }
+  if (m_cachedPage[victim] != kNoPage) {
+    m_slotOfPage.erase(m_cachedPage[victim]);
+  }
+  else if (m_cache.size() < (victim + 1) * m_pageBytes) {
+    m_cache.resize((victim + 1) * m_pageBytes);
+  }
+  m_cachedPage[victim] = page;
+  m_slotOfPage[page] = victim;
+  return victim;
+}